@@ -0,0 +1,51 @@
+#ifndef JIKAN_BENCH_H
+#define JIKAN_BENCH_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+// Just enough of a benchmark runner for the bench targets: each measurement runs its body once
+// untimed to warm pools and caches, then ops times on the clock, and prints one line per result.
+// JIKAN_BENCH_SCALE multiplies every ops count, for quick smoke runs (0.01) or longer ones (10)
+struct JikanBench {
+    typedef std::chrono::steady_clock clock;
+
+    static double scale() {
+        const char* value = std::getenv("JIKAN_BENCH_SCALE");
+        double result = value ? std::atof(value) : 1.0;
+        return result > 0.0 ? result : 1.0;
+    }
+
+    static uint64_t scaled(uint64_t ops) {
+        uint64_t result = static_cast<uint64_t>(ops * scale());
+        return result > 0 ? result : 1;
+    }
+
+    static void report(const std::string& name, uint64_t ops, double seconds, const std::string& extra = std::string()) {
+        std::printf("%-44s %10llu ops %12.0f ops/s %10.2f us/op  %s\n", name.c_str(), static_cast<unsigned long long>(ops),
+                    ops / seconds, seconds * 1e6 / ops, extra.c_str());
+        std::fflush(stdout);
+    }
+
+    // Calls body(i) for i in [0, ops) and returns the seconds it took
+    template <typename Body>
+    static double time(uint64_t ops, Body body) {
+        body(0);
+        auto start = clock::now();
+        for (uint64_t i = 0; i < ops; ++i) body(i);
+        return std::chrono::duration<double>(clock::now() - start).count();
+    }
+
+    template <typename Body>
+    static double run(const std::string& name, uint64_t ops, Body body) {
+        ops = scaled(ops);
+        double seconds = time(ops, body);
+        report(name, ops, seconds);
+        return seconds;
+    }
+};
+
+#endif
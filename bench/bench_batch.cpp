@@ -0,0 +1,74 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "Jikan.h"
+#include "JikanBench.h"
+
+// Items per second of getManyById over 1000 replayed titles that each take 2 ms to answer, next to the same ids
+// fetched one after another with getAnimeById
+
+enum { titles = 1000 };
+
+static std::string write_fixtures() {
+    std::string directory = "jikan-bench-batch-" + std::to_string(getpid());
+    std::system(("rm -rf " + directory).c_str());
+    JikanFixtureStore store(directory);
+    for (int id = 1; id <= titles; ++id) {
+        JikanFixture fixture;
+        fixture.body = "{\"data\":{\"mal_id\":" + std::to_string(id) + ",\"title\":\"Title " + std::to_string(id) + "\",\"synopsis\":\"" +
+                       std::string(800, 's') + "\"}}";
+        store.save(JikanFixtureStore::key("GET", "/anime/" + std::to_string(id)), fixture);
+    }
+    return directory;
+}
+
+static void setup(Jikan& api, const std::string& directory) {
+    JikanRateLimit limit;
+    limit.per_second = 1e9;
+    limit.per_minute = 6e10;
+    api.set_rate_limit(limit);
+    // Every id must reach the transport
+    JikanCacheConfig config;
+    config.enabled = false;
+    api.set_cache_config(config);
+    JikanFaultConfig faults;
+    faults.latency = std::chrono::milliseconds(2);
+    api.replay_fixtures(directory, faults);
+}
+
+int main() {
+    std::string directory = write_fixtures();
+    std::vector<int> ids(JikanBench::scaled(titles));
+    for (size_t i = 0; i < ids.size(); ++i) ids[i] = static_cast<int>(i % titles) + 1;
+
+    {
+        Jikan api;
+        setup(api, directory);
+        auto start = JikanBench::clock::now();
+        for (int id : ids) {
+            if (api.getAnimeById(id).get().has_field(U("error"))) throw std::runtime_error("unexpected error answer");
+        }
+        JikanBench::report("getAnimeById in a loop", ids.size(), std::chrono::duration<double>(JikanBench::clock::now() - start).count(), "1 in flight");
+    }
+
+    for (size_t in_flight : {1, 8, 32, 128}) {
+        Jikan api;
+        setup(api, directory);
+        auto start = JikanBench::clock::now();
+        JikanBatchResult result = api.getManyById(JikanEndpointKind::Anime, ids, in_flight).get();
+        double seconds = std::chrono::duration<double>(JikanBench::clock::now() - start).count();
+        if (!result.failures.empty()) throw std::runtime_error("unexpected failures");
+        char detail[32];
+        std::snprintf(detail, sizeof(detail), "%llu in flight", static_cast<unsigned long long>(in_flight));
+        JikanBench::report("getManyById", ids.size(), seconds, detail);
+    }
+
+    std::system(("rm -rf " + directory).c_str());
+    return 0;
+}
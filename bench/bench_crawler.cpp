@@ -0,0 +1,84 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include <unistd.h>
+
+#include "JikanBench.h"
+#include "JikanCrawler.h"
+
+// Crawl throughput over a recorded graph of 2000 anime: each has a sequel, a side story and an
+// adaptation, and five characters with a voice actor each, all replayed from fixtures
+
+enum { titles = 2000, characters_per_title = 5 };
+
+static std::string entry(int id, const char* type) {
+    return "{\"mal_id\":" + std::to_string(id) + ",\"type\":\"" + type + "\",\"name\":\"Title " + std::to_string(id) + "\"}";
+}
+
+static std::string write_fixtures() {
+    std::string directory = "jikan-bench-crawl-" + std::to_string(getpid());
+    std::system(("rm -rf " + directory).c_str());
+    JikanFixtureStore store(directory);
+    auto save = [&store](const std::string& path, const std::string& body) {
+        JikanFixture fixture;
+        fixture.body = body;
+        store.save(JikanFixtureStore::key("GET", path), fixture);
+    };
+    for (int id = 1; id <= titles; ++id) {
+        save("/anime/" + std::to_string(id) + "/relations",
+             "{\"data\":[{\"relation\":\"Sequel\",\"entry\":[" + entry(id % titles + 1, "anime") + "]},"
+             "{\"relation\":\"Side story\",\"entry\":[" + entry((id * 7) % titles + 1, "anime") + "]},"
+             "{\"relation\":\"Adaptation\",\"entry\":[" + entry(id, "manga") + "]}]}");
+        save("/manga/" + std::to_string(id) + "/relations", "{\"data\":[]}");
+        std::string characters = "{\"data\":[";
+        for (int c = 0; c < characters_per_title; ++c) {
+            int character = id * characters_per_title + c;
+            if (c) characters += ",";
+            characters += "{\"character\":{\"mal_id\":" + std::to_string(character) + ",\"name\":\"Character " + std::to_string(character) +
+                          "\"},\"role\":\"Main\",\"voice_actors\":[{\"person\":{\"mal_id\":" + std::to_string(character % 700) +
+                          ",\"name\":\"Person\"},\"language\":\"Japanese\"}]}";
+        }
+        characters += "]}";
+        save("/anime/" + std::to_string(id) + "/characters", characters);
+        save("/manga/" + std::to_string(id) + "/characters", "{\"data\":[]}");
+    }
+    return directory;
+}
+
+static void crawl(const std::string& name, const std::string& directory, uint32_t edges, size_t in_flight) {
+    Jikan api;
+    JikanRateLimit limit;
+    limit.per_second = 1e9;
+    limit.per_minute = 6e10;
+    api.set_rate_limit(limit);
+    api.replay_fixtures(directory);
+    JikanCrawlConfig config;
+    config.edges = edges;
+    config.max_depth = 1000;
+    config.max_requests = JikanBench::scaled(4 * titles);
+    config.max_in_flight = in_flight;
+    std::atomic<uint64_t> seen{0};
+    JikanCrawlSink sink;
+    sink.on_node = [&seen](const JikanNode&) { ++seen; };
+
+    auto start = JikanBench::clock::now();
+    JikanCrawlReport report = JikanCrawler(api, config).crawl({{JikanNodeKind::Anime, 1}}, sink).get();
+    double seconds = std::chrono::duration<double>(JikanBench::clock::now() - start).count();
+    char extra[128];
+    std::snprintf(extra, sizeof(extra), "%llu in flight, %.0f nodes/s, %llu edges, %llu failed", static_cast<unsigned long long>(in_flight),
+                  report.nodes / seconds, static_cast<unsigned long long>(report.edges), static_cast<unsigned long long>(report.failed));
+    JikanBench::report(name, report.requests, seconds, extra);
+}
+
+int main() {
+    std::string directory = write_fixtures();
+    crawl("crawl relations", directory, JikanEdge::Relation, 8);
+    crawl("crawl relations", directory, JikanEdge::Relation, 32);
+    crawl("crawl relations, characters, voice actors", directory, JikanEdge::Relation | JikanEdge::Character | JikanEdge::VoiceActor, 8);
+    crawl("crawl relations, characters, voice actors", directory, JikanEdge::Relation | JikanEdge::Character | JikanEdge::VoiceActor, 32);
+    std::system(("rm -rf " + directory).c_str());
+    return 0;
+}
@@ -0,0 +1,152 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <malloc.h>
+#include <unistd.h>
+
+#include <cpprest/json.h>
+
+#include "JikanBench.h"
+#include "JikanReplay.h"
+#include "JikanTypes.h"
+
+// Typed decoding into JikanAnime next to json::value parsing, over 200 recorded /anime/{id}
+// bodies read back from replay fixtures: parse time, heap allocations per document and the heap
+// bytes a decoded document keeps alive
+
+enum { titles = 200 };
+
+static size_t allocations = 0;
+static long long live_bytes = 0;
+void* operator new(size_t size) {
+    ++allocations;
+    void* memory = std::malloc(size ? size : 1);
+    if (!memory) throw std::bad_alloc();
+    live_bytes += malloc_usable_size(memory);
+    return memory;
+}
+void operator delete(void* memory) noexcept {
+    if (memory) live_bytes -= malloc_usable_size(memory);
+    std::free(memory);
+}
+void operator delete(void* memory, size_t) noexcept {
+    if (memory) live_bytes -= malloc_usable_size(memory);
+    std::free(memory);
+}
+
+static std::string refs(const char* type, int first, int count) {
+    std::string result = "[";
+    for (int i = 0; i < count; ++i) {
+        if (i) result += ",";
+        result += "{\"mal_id\":" + std::to_string(first + i) + ",\"type\":\"" + type + "\",\"name\":\"Name " + std::to_string(first + i) +
+                  "\",\"url\":\"https://myanimelist.net/anime/" + type + "/" + std::to_string(first + i) + "\"}";
+    }
+    return result + "]";
+}
+
+static std::string anime(int id) {
+    std::string n = std::to_string(id);
+    return "{\"data\":{\"mal_id\":" + n + ",\"url\":\"https://myanimelist.net/anime/" + n +
+           "\",\"images\":{\"jpg\":{\"image_url\":\"https://cdn.myanimelist.net/images/anime/" + n +
+           ".jpg\",\"small_image_url\":\"https://cdn.myanimelist.net/images/anime/" + n + "t.jpg\"}},\"trailer\":{\"youtube_id\":null,\"url\":null},"
+           "\"approved\":true,\"title\":\"Title " + n + "\",\"title_english\":\"English " + n + "\",\"title_japanese\":\"\\u30bf\\u30a4\\u30c8\\u30eb\","
+           "\"title_synonyms\":[\"Synonym " + n + "\",\"Other " + n + "\"],\"type\":\"TV\",\"source\":\"Manga\",\"episodes\":" +
+           std::to_string(12 + id % 40) + ",\"status\":\"Finished Airing\",\"airing\":false,"
+           "\"aired\":{\"from\":\"2009-04-05T00:00:00+00:00\",\"to\":\"2010-07-04T00:00:00+00:00\",\"string\":\"Apr 5, 2009 to Jul 4, 2010\"},"
+           "\"duration\":\"24 min per ep\",\"rating\":\"R - 17+ (violence & profanity)\",\"score\":" + std::to_string(5 + id % 5) + ".37,"
+           "\"scored_by\":" + std::to_string(1000 * id) + ",\"rank\":" + n + ",\"popularity\":" + std::to_string(id * 3) +
+           ",\"members\":" + std::to_string(5000 * id) + ",\"favorites\":" + std::to_string(40 * id) + ",\"synopsis\":\"" + std::string(1200, 's') +
+           "\",\"background\":\"" + std::string(300, 'b') + "\",\"season\":\"spring\",\"year\":2009,"
+           "\"broadcast\":{\"day\":\"Sundays\",\"time\":\"17:00\",\"timezone\":\"Asia/Tokyo\",\"string\":\"Sundays at 17:00 (JST)\"},"
+           "\"producers\":" + refs("producer", 10, 4) + ",\"licensors\":" + refs("licensor", 30, 1) + ",\"studios\":" + refs("studio", 40, 1) +
+           ",\"genres\":" + refs("genre", 1, 4) + ",\"explicit_genres\":[],\"themes\":" + refs("theme", 50, 1) + ",\"demographics\":" +
+           refs("demographic", 60, 1) + "}}";
+}
+
+static std::vector<std::string> read_fixtures() {
+    std::string directory = "jikan-bench-decode-" + std::to_string(getpid());
+    std::system(("rm -rf " + directory).c_str());
+    {
+        JikanFixtureStore store(directory);
+        for (int id = 1; id <= titles; ++id) {
+            JikanFixture fixture;
+            fixture.body = anime(id);
+            store.save(JikanFixtureStore::key("GET", "/anime/" + std::to_string(id)), fixture);
+        }
+    }
+    // A second store starts cold, so every body comes from its file
+    JikanFixtureStore store(directory);
+    std::vector<std::string> bodies;
+    for (int id = 1; id <= titles; ++id) {
+        JikanFixture fixture;
+        if (!store.load(JikanFixtureStore::key("GET", "/anime/" + std::to_string(id)), fixture)) std::abort();
+        bodies.push_back(fixture.body);
+    }
+    std::system(("rm -rf " + directory).c_str());
+    return bodies;
+}
+
+// decode(body) turns one body into a Result; reports documents per second, allocations per
+// document and, with every decoded title held at once, heap bytes kept per document
+template <typename Result, typename Decode>
+static void measure(const std::string& name, const std::vector<JikanBuffer>& bodies, uint64_t rounds, Decode decode) {
+    rounds = JikanBench::scaled(rounds);
+    size_t before = allocations;
+    double seconds = JikanBench::time(rounds, [&](uint64_t) {
+        for (const auto& body : bodies) {
+            Result result = decode(body);
+            (void)result;
+        }
+    });
+    uint64_t documents = rounds * bodies.size();
+    // The untimed warm-up round is counted too
+    double per_document = static_cast<double>(allocations - before) / (documents + bodies.size());
+
+    long long held_before = live_bytes;
+    double retained = 0.0;
+    {
+        std::vector<Result> held;
+        held.reserve(bodies.size());
+        for (const auto& body : bodies) held.push_back(decode(body));
+        retained = static_cast<double>(live_bytes - held_before) / bodies.size();
+    }
+    char extra[128];
+    std::snprintf(extra, sizeof(extra), "%.1f allocations/document  %.0f bytes retained/document", per_document, retained);
+    JikanBench::report(name, documents, seconds, extra);
+}
+
+int main() {
+    std::vector<std::string> texts = read_fixtures();
+    std::vector<JikanBuffer> bodies;
+    size_t total = 0;
+    for (const auto& text : texts) {
+        bodies.push_back(JikanBuffer(text));
+        total += text.size();
+    }
+    std::printf("%zu bodies, %zu bytes on average\n", bodies.size(), total / bodies.size());
+
+    measure<web::json::value>("json::value parse", bodies, 50, [](const JikanBuffer& body) {
+        auto value = web::json::value::parse(utility::conversions::to_string_t(std::string(body.data(), body.size())));
+        if (value.at(U("data")).at(U("mal_id")).as_integer() <= 0) std::abort();
+        return value;
+    });
+
+    measure<JikanAnime>("JikanAnime decode, all fields", bodies, 500, [](const JikanBuffer& body) {
+        JikanAnime anime;
+        jikan_decode_document(body, anime);
+        if (anime.mal_id <= 0) std::abort();
+        return anime;
+    });
+
+    measure<JikanAnime>("JikanAnime decode, id, titles and score", bodies, 500, [](const JikanBuffer& body) {
+        JikanAnime anime;
+        jikan_decode_document(body, anime, JikanAnime::MalId | JikanAnime::Titles | JikanAnime::Score);
+        if (anime.mal_id <= 0) std::abort();
+        return anime;
+    });
+    return 0;
+}
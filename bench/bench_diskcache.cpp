@@ -0,0 +1,72 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+#include <unistd.h>
+
+#include "JikanBench.h"
+#include "JikanDiskCache.h"
+
+// Warm restart of a disk cache holding 50000 bodies: writing them, rebuilding the index from the
+// segment files, the first reads that check each body's checksum, and the reads after that
+
+enum { entries = 50000, body_bytes = 1500 };
+
+static std::string key_for(uint64_t i) {
+    return "GET /anime/" + std::to_string(i + 1) + "/full";
+}
+
+static double seconds_since(JikanBench::clock::time_point start) {
+    return std::chrono::duration<double>(JikanBench::clock::now() - start).count();
+}
+
+int main() {
+    uint64_t count = JikanBench::scaled(entries);
+    JikanDiskCacheConfig config;
+    config.directory = "jikan-bench-disk-" + std::to_string(getpid());
+    std::system(("rm -rf " + config.directory).c_str());
+
+    JikanCacheEntry entry;
+    entry.etag = U("\"0123456789abcdef\"");
+    entry.expires = std::chrono::system_clock::now() + std::chrono::hours(24);
+    {
+        JikanDiskCache cache(config);
+        auto start = JikanBench::clock::now();
+        for (uint64_t i = 0; i < count; ++i) {
+            entry.body = JikanBuffer("{\"data\":{\"mal_id\":" + std::to_string(i + 1) + ",\"synopsis\":\"" + std::string(body_bytes, 's') + "\"}}");
+            cache.put(key_for(i), entry);
+        }
+        JikanBench::report("disk cache put", count, seconds_since(start));
+    }
+
+    auto start = JikanBench::clock::now();
+    std::unique_ptr<JikanDiskCache> cache(new JikanDiskCache(config));
+    double rebuild = seconds_since(start);
+    JikanDiskCacheStats stats = cache->stats();
+    char extra[96];
+    std::snprintf(extra, sizeof(extra), "%zu entries, %zu segments, %.0f MB, %.1f ms in all", stats.entries, stats.segments,
+                  stats.disk_bytes / 1e6, rebuild * 1e3);
+    JikanBench::report("warm restart index rebuild", stats.entries, rebuild, extra);
+
+    size_t bytes = 0;
+    start = JikanBench::clock::now();
+    for (uint64_t i = 0; i < count; ++i) {
+        JikanCacheEntry found;
+        if (!cache->get(key_for(i), found)) std::abort();
+        bytes += found.body.size();
+    }
+    JikanBench::report("first get after restart", count, seconds_since(start), "checks the body checksum");
+    JikanBench::run("later gets, bodies already checked", count, [&cache, &bytes, count](uint64_t i) {
+        JikanCacheEntry found;
+        if (!cache->get(key_for(i % count), found)) std::abort();
+        bytes += found.body.size();
+    });
+
+    cache.reset();
+    std::system(("rm -rf " + config.directory).c_str());
+    // Keeps the reads from being optimized away
+    std::printf("%zu bytes read\n", bytes);
+    return 0;
+}
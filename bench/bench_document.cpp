@@ -0,0 +1,154 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include <cpprest/json.h>
+
+#include "JikanBench.h"
+#include "JikanDocument.h"
+#include "JikanReplay.h"
+
+// Parse throughput and heap allocations per document for a json::value DOM and for arena
+// documents, over 200 /anime/{id}/full bodies read back from replay fixtures, on one thread and
+// on many at once: bench_document [threads], 8 by default
+
+enum { titles = 200, page = 25 };
+
+static std::atomic<size_t> allocations{0};
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void* memory = std::malloc(size ? size : 1);
+    if (!memory) throw std::bad_alloc();
+    return memory;
+}
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+void operator delete(void* memory, size_t) noexcept {
+    std::free(memory);
+}
+
+static std::string anime_full(int id) {
+    std::string n = std::to_string(id);
+    std::string body = "{\"data\":{\"mal_id\":" + n + ",\"url\":\"https://myanimelist.net/anime/" + n + "\",\"title\":\"Title " + n + "\","
+                       "\"titles\":[";
+    for (int i = 0; i < 6; ++i) {
+        if (i) body += ",";
+        body += "{\"type\":\"Synonym\",\"title\":\"Hagane no Renkinjutsushi \\u00e9 " + std::to_string(i) + "\"}";
+    }
+    body += "],\"type\":\"TV\",\"episodes\":64,\"airing\":false,\"aired\":{\"from\":\"2009-04-05T00:00:00+00:00\",\"to\":null},"
+            "\"score\":9.1,\"scored_by\":2200000,\"rank\":1,\"members\":3400000,\"synopsis\":\"" +
+            std::string(1500 + id % 7 * 200, 's') + "\",\"background\":null,\"genres\":[";
+    for (int i = 0; i < 8; ++i) {
+        if (i) body += ",";
+        body += "{\"mal_id\":" + std::to_string(i) + ",\"type\":\"anime\",\"name\":\"Genre " + std::to_string(i) +
+                "\",\"url\":\"https://myanimelist.net/anime/genre/" + std::to_string(i) + "\"}";
+    }
+    body += "],\"relations\":[";
+    for (int i = 0; i < 10; ++i) {
+        if (i) body += ",";
+        body += "{\"relation\":\"Side story\",\"entry\":[{\"mal_id\":" + std::to_string(6000 + i) +
+                ",\"type\":\"anime\",\"name\":\"Side \\\"story\\\" " + std::to_string(i) + "\"}]}";
+    }
+    body += "]}}";
+    return body;
+}
+
+static std::vector<JikanBuffer> read_fixtures(size_t& total_bytes) {
+    std::string directory = "jikan-bench-document-" + std::to_string(getpid());
+    std::system(("rm -rf " + directory).c_str());
+    {
+        JikanFixtureStore store(directory);
+        for (int id = 1; id <= titles; ++id) {
+            JikanFixture fixture;
+            fixture.body = anime_full(id);
+            store.save(JikanFixtureStore::key("GET", "/anime/" + std::to_string(id) + "/full"), fixture);
+        }
+    }
+    // A second store starts cold, so every body comes from its file
+    JikanFixtureStore store(directory);
+    std::vector<JikanBuffer> bodies;
+    total_bytes = 0;
+    for (int id = 1; id <= titles; ++id) {
+        JikanFixture fixture;
+        if (!store.load(JikanFixtureStore::key("GET", "/anime/" + std::to_string(id) + "/full"), fixture)) std::abort();
+        total_bytes += fixture.body.size();
+        bodies.push_back(JikanBuffer(fixture.body));
+    }
+    std::system(("rm -rf " + directory).c_str());
+    return bodies;
+}
+
+// Every thread runs parse(bodies, i) rounds times, each call handling per_call documents; reports
+// documents per second and MB/s over all threads, and heap allocations per document
+template <typename Parse>
+static void measure(const std::string& name, const std::vector<JikanBuffer>& bodies, size_t body_bytes, int threads,
+                    uint64_t rounds, int per_call, Parse parse) {
+    rounds = JikanBench::scaled(rounds);
+    std::atomic<int> ready{0};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            // Warms this thread's arena pool and scratch stack
+            parse(bodies, t);
+            ++ready;
+            while (!go) std::this_thread::yield();
+            for (uint64_t i = 0; i < rounds; ++i) parse(bodies, t + i * threads);
+        });
+    }
+    while (ready < threads) std::this_thread::yield();
+    size_t before = allocations;
+    auto start = JikanBench::clock::now();
+    go = true;
+    for (auto& worker : workers) worker.join();
+    double seconds = std::chrono::duration<double>(JikanBench::clock::now() - start).count();
+    uint64_t documents = rounds * per_call * threads;
+    char extra[128];
+    std::snprintf(extra, sizeof(extra), "%d threads  %.0f MB/s  %.2f allocations/document", threads,
+                  body_bytes * documents / seconds / 1e6, static_cast<double>(allocations - before) / documents);
+    JikanBench::report(name, documents, seconds, extra);
+}
+
+static void run_all(const std::vector<JikanBuffer>& bodies, size_t average_bytes, int threads) {
+    measure("json::value parse", bodies, average_bytes, threads, 20000 / threads, 1, [](const std::vector<JikanBuffer>& bodies, uint64_t i) {
+        const JikanBuffer& body = bodies[i % bodies.size()];
+        auto value = web::json::value::parse(utility::conversions::to_string_t(std::string(body.data(), body.size())));
+        if (value.at(U("data")).at(U("mal_id")).as_integer() <= 0) std::abort();
+    });
+
+    measure("JikanDocument parse, pooled arena", bodies, average_bytes, threads, 100000 / threads, 1,
+            [](const std::vector<JikanBuffer>& bodies, uint64_t i) {
+                auto document = JikanDocument::parse(bodies[i % bodies.size()]);
+                if (document["data"]["mal_id"].as_integer() <= 0) std::abort();
+            });
+
+    // Bodies of one page held together and released in one step
+    measure("JikanDocument parse, 25 per arena", bodies, average_bytes, threads, 100000 / page / threads, page,
+            [](const std::vector<JikanBuffer>& bodies, uint64_t i) {
+                auto arena = JikanArenaPool::acquire();
+                std::vector<JikanDocument> documents;
+                documents.reserve(page);
+                for (int k = 0; k < page; ++k) documents.push_back(JikanDocument::parse(bodies[(i * page + k) % bodies.size()], arena));
+                if (documents.back()["data"]["rank"].as_integer() != 1) std::abort();
+            });
+}
+
+int main(int argc, char** argv) {
+    int threads = argc > 1 ? std::atoi(argv[1]) : 8;
+    if (threads < 1) threads = 1;
+    size_t total = 0;
+    std::vector<JikanBuffer> bodies = read_fixtures(total);
+    std::printf("%zu bodies, %zu bytes on average\n", bodies.size(), total / bodies.size());
+
+    run_all(bodies, total / bodies.size(), 1);
+    if (threads > 1) run_all(bodies, total / bodies.size(), threads);
+    return 0;
+}
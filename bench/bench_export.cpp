@@ -0,0 +1,165 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "JikanBench.h"
+#include "JikanExport.h"
+#include "JikanMockServer.h"
+
+// Throughput and peak resident memory of exporting the friends lists of 200 users from
+// JikanMockServer over loopback HTTP: 10 heavy users with 5000 entries each, the rest with 50.
+// Each run is its own child process, so every peak is its own
+
+enum { users = 200, heavy_users = 10, per_page = 25, heavy_pages = 200, light_pages = 2 };
+
+static std::string username(int user) {
+    return "user" + std::to_string(user);
+}
+
+static int pages_of(int user) {
+    return user < heavy_users ? heavy_pages : light_pages;
+}
+
+static std::string write_fixtures() {
+    std::string directory = "jikan-bench-export-" + std::to_string(getpid());
+    std::system(("rm -rf " + directory).c_str());
+    JikanFixtureStore store(directory);
+    for (int user = 0; user < users; ++user) {
+        int pages = pages_of(user);
+        for (int page = 1; page <= pages; ++page) {
+            JikanFixture fixture;
+            fixture.body = "{\"data\":[";
+            for (int i = 0; i < per_page; ++i) {
+                std::string name = "friend" + std::to_string(page * 1000 + i);
+                if (i) fixture.body += ",";
+                fixture.body += "{\"user\":{\"username\":\"" + name + "\",\"url\":\"https://myanimelist.net/profile/" + name +
+                                "\",\"images\":{\"jpg\":{\"image_url\":\"https://cdn.myanimelist.net/images/userimages/" +
+                                std::to_string(page * 1000 + i) + ".jpg\"}}},\"last_online\":\"2024-03-01T12:00:00+00:00\","
+                                "\"friends_since\":\"2019-05-20T08:30:00+00:00\"}";
+            }
+            fixture.body += "],\"pagination\":{\"last_visible_page\":" + std::to_string(pages) +
+                            ",\"has_next_page\":" + (page < pages ? "true" : "false") + "}}";
+            store.save(JikanFixtureStore::key("GET", "/users/" + username(user) + "/friends?page=" + std::to_string(page)), fixture);
+        }
+    }
+    return directory;
+}
+
+static std::vector<std::string> usernames() {
+    std::vector<std::string> names;
+    for (int user = 0; user < users; ++user) names.push_back(username(user));
+    return names;
+}
+
+static uint64_t total_pages() {
+    uint64_t pages = 0;
+    for (int user = 0; user < users; ++user) pages += pages_of(user);
+    return pages;
+}
+
+// Runs export(api) in a child process that also hosts the mock server, and reports pages per
+// second, rows and output per second, and the peak RSS before and after the export
+template <typename Export>
+static void measure(const std::string& name, const std::string& directory, Export run_export) {
+    std::fflush(stdout);
+    pid_t child = fork();
+    if (child == 0) {
+        std::string base = "http://127.0.0.1:" + std::to_string(20000 + getpid() % 20000) + "/v4";
+        JikanMockServer server(base, std::make_shared<JikanFixtureStore>(directory));
+        try {
+            server.start();
+        } catch (const std::exception& e) {
+            std::printf("%s: skipped, cannot listen on %s: %s\n", name.c_str(), base.c_str(), e.what());
+            std::_Exit(0);
+        }
+        Jikan api;
+        JikanRateLimit limit;
+        limit.per_second = 1e9;
+        limit.per_minute = 6e10;
+        api.set_rate_limit(limit);
+        JikanCacheConfig config;
+        config.enabled = false;
+        api.set_cache_config(config);
+        api.set_api_base(server.base());
+
+        rusage before;
+        getrusage(RUSAGE_SELF, &before);
+        auto start = JikanBench::clock::now();
+        JikanExportReport report = run_export(api);
+        double seconds = std::chrono::duration<double>(JikanBench::clock::now() - start).count();
+        rusage after;
+        getrusage(RUSAGE_SELF, &after);
+        server.stop();
+        if (report.failed_pages != 0 || report.pages != total_pages()) {
+            std::printf("%s: %llu of %llu pages, %llu failed\n", name.c_str(), static_cast<unsigned long long>(report.pages),
+                        static_cast<unsigned long long>(total_pages()), static_cast<unsigned long long>(report.failed_pages));
+            std::_Exit(1);
+        }
+        char extra[128];
+        std::snprintf(extra, sizeof(extra), "%.0f rows/s  %ld KB peak RSS (%ld KB before)", report.rows / seconds, after.ru_maxrss,
+                      before.ru_maxrss);
+        JikanBench::report(name, report.pages, seconds, extra);
+        std::_Exit(0);
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) std::printf("%s: child failed\n", name.c_str());
+}
+
+static JikanExportReport exporter(Jikan& api, JikanExportFormat format, size_t in_flight) {
+    JikanExportConfig config;
+    config.lists = {JikanUserList::Friends};
+    config.format = format;
+    config.max_in_flight = in_flight;
+    auto sink = std::make_shared<JikanCallbackSink>([](const char*, size_t) {});
+    return JikanUserExporter(api, config).run(usernames(), sink).get();
+}
+
+int main() {
+    std::string directory = write_fixtures();
+    std::printf("%llu pages, %d rows\n", static_cast<unsigned long long>(total_pages()),
+                static_cast<int>(total_pages()) * per_page);
+
+    // What the exporter replaced: one page after another, every row held until the end
+    measure("serial loop, buffered NDJSON", directory, [](Jikan& api) {
+        JikanExportReport report;
+        std::string out;
+        for (const auto& user : usernames()) {
+            for (int page = 1;; ++page) {
+                web::json::value result = api.getUserFriends(user, page).get();
+                if (result.has_field(U("error"))) {
+                    ++report.failed_pages;
+                    break;
+                }
+                ++report.pages;
+                for (const auto& item : result.at(U("data")).as_array()) {
+                    out += utility::conversions::to_utf8string(item.serialize());
+                    out += '\n';
+                    ++report.rows;
+                }
+                if (!result.at(U("pagination")).at(U("has_next_page")).as_bool()) break;
+            }
+        }
+        auto sink = std::make_shared<JikanCallbackSink>([](const char*, size_t) {});
+        sink->write(out.data(), out.size());
+        return report;
+    });
+    measure("exporter NDJSON, 8 in flight", directory, [](Jikan& api) {
+        return exporter(api, JikanExportFormat::Ndjson, 8);
+    });
+    measure("exporter NDJSON, 32 in flight", directory, [](Jikan& api) {
+        return exporter(api, JikanExportFormat::Ndjson, 32);
+    });
+    measure("exporter CSV, 32 in flight", directory, [](Jikan& api) {
+        return exporter(api, JikanExportFormat::Csv, 32);
+    });
+
+    std::system(("rm -rf " + directory).c_str());
+    return 0;
+}
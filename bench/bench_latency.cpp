@@ -0,0 +1,90 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "Jikan.h"
+#include "JikanBench.h"
+#include "JikanMockServer.h"
+
+// Latency percentiles of 1000 getAnimeById calls over loopback HTTP from the mock server, with the
+// client pool reusing its clients and with a new client for every call, as before the pool
+
+enum { titles = 100, calls = 1000 };
+
+static std::string write_fixtures() {
+    std::string directory = "jikan-bench-latency-" + std::to_string(getpid());
+    std::system(("rm -rf " + directory).c_str());
+    JikanFixtureStore store(directory);
+    for (int id = 1; id <= titles; ++id) {
+        JikanFixture fixture;
+        fixture.body = "{\"data\":{\"mal_id\":" + std::to_string(id) + ",\"title\":\"Title " + std::to_string(id) + "\",\"synopsis\":\"" +
+                       std::string(800, 's') + "\"}}";
+        store.save(JikanFixtureStore::key("GET", "/anime/" + std::to_string(id)), fixture);
+    }
+    return directory;
+}
+
+static double percentile(const std::vector<double>& sorted, double share) {
+    size_t at = static_cast<size_t>(share * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(at, sorted.size() - 1)];
+}
+
+static void measure(const std::string& name, const std::string& base, const JikanPoolConfig& pool) {
+    Jikan api(pool);
+    JikanRateLimit limit;
+    limit.per_second = 1e9;
+    limit.per_minute = 6e10;
+    api.set_rate_limit(limit);
+    JikanCacheConfig config;
+    config.enabled = false;
+    api.set_cache_config(config);
+    api.set_api_base(base);
+
+    uint64_t count = JikanBench::scaled(calls);
+    std::vector<double> latencies;
+    latencies.reserve(count);
+    // Warms the first client, as the pooled case would after its first call anyway
+    api.getAnimeById(1).wait();
+    auto start = JikanBench::clock::now();
+    for (uint64_t i = 0; i < count; ++i) {
+        auto sent = JikanBench::clock::now();
+        if (api.getAnimeById(static_cast<int>(i % titles) + 1).get().has_field(U("error"))) throw std::runtime_error("unexpected error answer");
+        latencies.push_back(std::chrono::duration<double, std::micro>(JikanBench::clock::now() - sent).count());
+    }
+    double seconds = std::chrono::duration<double>(JikanBench::clock::now() - start).count();
+    std::sort(latencies.begin(), latencies.end());
+    JikanPoolStats stats = api.pool_stats();
+    char extra[160];
+    std::snprintf(extra, sizeof(extra), "p50 %.0f us  p99 %.0f us  max %.0f us  %llu clients created", percentile(latencies, 0.5),
+                  percentile(latencies, 0.99), latencies.back(), static_cast<unsigned long long>(stats.clients_created));
+    JikanBench::report(name, count, seconds, extra);
+}
+
+int main() {
+    std::string directory = write_fixtures();
+    std::string base = "http://127.0.0.1:" + std::to_string(20000 + getpid() % 20000) + "/v4";
+    JikanMockServer server(base, std::make_shared<JikanFixtureStore>(directory));
+    try {
+        server.start();
+    } catch (const std::exception& e) {
+        std::printf("skipped, cannot listen on %s: %s\n", base.c_str(), e.what());
+        std::system(("rm -rf " + directory).c_str());
+        return 0;
+    }
+
+    measure("getAnimeById, pooled clients", server.base(), JikanPoolConfig());
+    // An idle timeout of zero retires every client after its call, so each call builds a new one
+    JikanPoolConfig fresh;
+    fresh.idle_timeout = std::chrono::seconds(0);
+    measure("getAnimeById, new client per call", server.base(), fresh);
+
+    server.stop();
+    std::system(("rm -rf " + directory).c_str());
+    return 0;
+}
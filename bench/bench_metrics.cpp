@@ -0,0 +1,70 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "JikanBench.h"
+#include "JikanMetrics.h"
+
+// What metrics cost a request: JikanMetrics::record on one thread and on 8 threads sharing the
+// series of a few endpoints, and the endpoint_template call that names every trace
+
+enum { records = 5000000, threads = 8 };
+
+static const char* endpoints[] = {"/anime/{id}", "/anime/{id}/full", "/anime/{id}/characters", "/manga/{id}", "/anime", "/seasons/now"};
+
+static JikanRequestTrace trace_for(int i) {
+    JikanRequestTrace trace;
+    trace.endpoint = endpoints[i % 6];
+    trace.started = JikanRequestTrace::clock::now();
+    trace.queue_wait = std::chrono::microseconds(50 + i % 200);
+    trace.dispatched = trace.started + trace.queue_wait;
+    trace.first_byte = trace.dispatched + std::chrono::milliseconds(20 + i % 300);
+    trace.finished = trace.first_byte + std::chrono::milliseconds(1);
+    trace.status = i % 50 ? 200 : 503;
+    trace.bytes = 2000 + i % 30000;
+    return trace;
+}
+
+int main() {
+    // Traces are built up front so only record itself is timed
+    std::vector<JikanRequestTrace> traces;
+    for (int i = 0; i < 1024; ++i) traces.push_back(trace_for(i));
+
+    {
+        JikanMetrics metrics;
+        JikanBench::run("record, 1 thread", records, [&](uint64_t i) { metrics.record(traces[i & 1023]); });
+    }
+
+    {
+        JikanMetrics metrics;
+        uint64_t per_thread = JikanBench::scaled(records) / threads;
+        metrics.record(traces[0]);
+        std::vector<std::thread> workers;
+        std::atomic<int> ready{0};
+        std::atomic<bool> go{false};
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t]() {
+                ++ready;
+                while (!go) std::this_thread::yield();
+                for (uint64_t i = 0; i < per_thread; ++i) metrics.record(traces[(i + t * 128) & 1023]);
+            });
+        }
+        while (ready < threads) std::this_thread::yield();
+        auto start = JikanBench::clock::now();
+        go = true;
+        for (auto& worker : workers) worker.join();
+        double seconds = std::chrono::duration<double>(JikanBench::clock::now() - start).count();
+        char extra[64];
+        std::snprintf(extra, sizeof(extra), "%d threads, %.1f ns/record/thread", threads, seconds * 1e9 / per_thread);
+        JikanBench::report("record, shared series", per_thread * threads, seconds, extra);
+    }
+
+    std::vector<std::string> paths = {"/anime/5114/full", "/anime/5114/characters?page=2", "/seasons/2024/winter", "/users/someone/animelist"};
+    size_t length = 0;
+    JikanBench::run("endpoint_template", records / 5, [&](uint64_t i) { length += JikanMetrics::endpoint_template(paths[i & 3]).size(); });
+    if (length == 0) std::printf("unexpected empty templates\n");
+    return 0;
+}
@@ -0,0 +1,115 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "Jikan.h"
+#include "JikanBench.h"
+
+// CPU time and peak resident memory of the ways to read a /anime/{id}/full body: the json getter,
+// raw(), document() and stream_to(). Each runs in its own child process, so every peak is its own
+
+enum { titles = 200, in_flight = 32 };
+
+static std::string anime_full(int id) {
+    std::string body = "{\"data\":{\"mal_id\":" + std::to_string(id) + ",\"title\":\"Title " + std::to_string(id) +
+                       "\",\"type\":\"TV\",\"episodes\":64,\"score\":9.1,\"members\":3400000,\"synopsis\":\"" + std::string(4000, 's') +
+                       "\",\"relations\":[";
+    for (int i = 0; i < 40; ++i) {
+        if (i) body += ",";
+        body += "{\"relation\":\"Side story\",\"entry\":[{\"mal_id\":" + std::to_string(10000 + i) +
+                ",\"type\":\"anime\",\"name\":\"Side story " + std::to_string(i) + "\",\"url\":\"https://myanimelist.net/anime/" +
+                std::to_string(10000 + i) + "\"}]}";
+    }
+    body += "]}}";
+    return body;
+}
+
+static std::string write_fixtures() {
+    std::string directory = "jikan-bench-raw-" + std::to_string(getpid());
+    std::system(("rm -rf " + directory).c_str());
+    JikanFixtureStore store(directory);
+    for (int id = 1; id <= titles; ++id) {
+        JikanFixture fixture;
+        fixture.body = anime_full(id);
+        store.save(JikanFixtureStore::key("GET", "/anime/" + std::to_string(id) + "/full"), fixture);
+    }
+    return directory;
+}
+
+static double cpu_seconds(const rusage& usage) {
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+// Runs read(api, id) for ops calls, in_flight at a time, in a child process and reports its CPU
+// time per call and its peak RSS
+template <typename Read>
+static void measure(const std::string& name, const std::string& directory, uint64_t ops, Read read) {
+    ops = JikanBench::scaled(ops) / in_flight * in_flight;
+    if (ops == 0) ops = in_flight;
+    std::fflush(stdout);
+    pid_t child = fork();
+    if (child == 0) {
+        Jikan api;
+        JikanRateLimit limit;
+        limit.per_second = 1e9;
+        limit.per_minute = 6e10;
+        api.set_rate_limit(limit);
+        JikanCacheConfig config;
+        config.enabled = false;
+        api.set_cache_config(config);
+        api.replay_fixtures(directory);
+        rusage before;
+        getrusage(RUSAGE_SELF, &before);
+        double seconds = JikanBench::time(ops / in_flight, [&api, &read](uint64_t round) {
+            std::vector<pplx::task<size_t>> calls;
+            for (uint64_t i = 0; i < in_flight; ++i) calls.push_back(read(api, static_cast<int>((round * in_flight + i) % titles) + 1));
+            for (auto& call : calls) {
+                if (call.get() == 0) std::abort();
+            }
+        });
+        rusage after;
+        getrusage(RUSAGE_SELF, &after);
+        char extra[96];
+        std::snprintf(extra, sizeof(extra), "%.1f us CPU/call  %ld KB peak RSS", (cpu_seconds(after) - cpu_seconds(before)) * 1e6 / ops,
+                      after.ru_maxrss);
+        JikanBench::report(name, ops, seconds, extra);
+        std::_Exit(0);
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) std::printf("%s: child failed\n", name.c_str());
+}
+
+int main() {
+    std::string directory = write_fixtures();
+    std::printf("body: %zu bytes\n", anime_full(1).size());
+
+    measure("json getter", directory, 20000, [](Jikan& api, int id) {
+        return api.getAnimeFullById(id).then([](web::json::value value) {
+            return value.at(U("data")).at(U("relations")).size();
+        });
+    });
+    measure("raw body", directory, 20000, [](Jikan& api, int id) {
+        return api.raw([&api, id] { return api.getAnimeFullById(id); }).then([](JikanBuffer body) {
+            return body.size();
+        });
+    });
+    measure("arena document", directory, 20000, [](Jikan& api, int id) {
+        return api.document([&api, id] { return api.getAnimeFullById(id); }).then([](JikanDocument document) {
+            return document["data"]["relations"].size();
+        });
+    });
+    measure("stream_to 16 KB chunks", directory, 20000, [](Jikan& api, int id) {
+        auto sink = std::make_shared<JikanCallbackSink>([](const char*, size_t) {});
+        return api.stream_to(sink, [&api, id] { return api.getAnimeFullById(id); }, 16 * 1024);
+    });
+
+    std::system(("rm -rf " + directory).c_str());
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "Jikan.h"
+#include "JikanBench.h"
+#include "JikanMockServer.h"
+
+// Requests per second through the whole request pipeline with the network taken out: straight
+// from the replay transport, through Jikan on replayed fixtures, from the cache, and over
+// loopback HTTP from the mock server, one call at a time and with many in flight
+
+enum { titles = 500, in_flight = 64 };
+
+static std::string anime_body(int id) {
+    std::string synopsis(1500, 'x');
+    return "{\"data\":{\"mal_id\":" + std::to_string(id) + ",\"title\":\"Title " + std::to_string(id) +
+           "\",\"type\":\"TV\",\"episodes\":24,\"score\":8.12,\"members\":123456,\"synopsis\":\"" + synopsis +
+           "\",\"genres\":[{\"mal_id\":1,\"name\":\"Action\"},{\"mal_id\":8,\"name\":\"Drama\"}]}}";
+}
+
+static std::string write_fixtures() {
+    std::string directory = "jikan-bench-fixtures-" + std::to_string(getpid());
+    std::system(("rm -rf " + directory).c_str());
+    JikanFixtureStore store(directory);
+    for (int id = 1; id <= titles; ++id) {
+        JikanFixture fixture;
+        fixture.body = anime_body(id);
+        store.save(JikanFixtureStore::key("GET", "/anime/" + std::to_string(id)), fixture);
+    }
+    return directory;
+}
+
+static void unlimited(Jikan& api, bool cache) {
+    JikanRateLimit limit;
+    limit.per_second = 1e9;
+    limit.per_minute = 6e10;
+    api.set_rate_limit(limit);
+    JikanCacheConfig config;
+    config.enabled = cache;
+    api.set_cache_config(config);
+}
+
+static int id_for(uint64_t i) {
+    return static_cast<int>(i % titles) + 1;
+}
+
+static void one_at_a_time(const std::string& name, Jikan& api, uint64_t ops) {
+    JikanBench::run(name, ops, [&api](uint64_t i) {
+        if (api.getAnimeById(id_for(i)).get().has_field(U("error"))) throw std::runtime_error("unexpected error answer");
+    });
+}
+
+// ops counts requests, sent in rounds of in_flight
+static void concurrent(const std::string& name, Jikan& api, uint64_t ops) {
+    ops = JikanBench::scaled(ops) / in_flight * in_flight;
+    if (ops == 0) ops = in_flight;
+    double seconds = JikanBench::time(ops / in_flight, [&api](uint64_t round) {
+        std::vector<pplx::task<web::json::value>> calls;
+        for (uint64_t i = 0; i < in_flight; ++i) calls.push_back(api.getAnimeById(id_for(round * in_flight + i)));
+        pplx::when_all(calls.begin(), calls.end()).wait();
+    });
+    JikanBench::report(name, ops, seconds, std::to_string(in_flight) + " in flight");
+}
+
+int main() {
+    std::string directory = write_fixtures();
+    auto store = std::make_shared<JikanFixtureStore>(directory);
+
+    JikanReplayTransport replay(store);
+    JikanBench::run("replay transport respond", 200000, [&replay](uint64_t i) {
+        replay.respond("GET /anime/" + std::to_string(id_for(i))).get();
+    });
+
+    {
+        Jikan api;
+        unlimited(api, false);
+        api.replay_fixtures(directory);
+        one_at_a_time("jikan on replay, no cache", api, 20000);
+        concurrent("jikan on replay, no cache", api, 50000);
+    }
+
+    {
+        Jikan api;
+        unlimited(api, true);
+        api.replay_fixtures(directory);
+        for (int id = 1; id <= titles; ++id) api.getAnimeById(id).wait();
+        one_at_a_time("jikan cache hits", api, 50000);
+        concurrent("jikan cache hits", api, 200000);
+    }
+
+    {
+        std::string base = "http://127.0.0.1:" + std::to_string(20000 + getpid() % 20000) + "/v4";
+        JikanMockServer server(base, store);
+        try {
+            server.start();
+        } catch (const std::exception& e) {
+            std::printf("mock server skipped, cannot listen on %s: %s\n", base.c_str(), e.what());
+            std::system(("rm -rf " + directory).c_str());
+            return 0;
+        }
+        Jikan api;
+        unlimited(api, false);
+        api.set_api_base(server.base());
+        one_at_a_time("jikan on loopback mock server", api, 5000);
+        concurrent("jikan on loopback mock server", api, 20000);
+        JikanPoolStats pool = api.pool_stats();
+        std::printf("pool: %llu clients created, %llu reused\n", static_cast<unsigned long long>(pool.clients_created),
+                    static_cast<unsigned long long>(pool.clients_reused));
+        server.stop();
+    }
+
+    std::system(("rm -rf " + directory).c_str());
+    return 0;
+}
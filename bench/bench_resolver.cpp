@@ -0,0 +1,167 @@
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "JikanBench.h"
+#include "JikanTitleIndex.h"
+
+using web::http::http_request;
+using web::http::http_response;
+
+// How many misspelled titles the trigram index settles on its own, how many of those it gets
+// right, and how many lookups per second it answers, locally and with the search fallback
+
+enum { entries = 20000, queries = 20000 };
+
+struct Entry {
+    int mal_id;
+    std::string title;
+    std::string synonym;
+};
+
+struct Query {
+    std::string text;
+    int mal_id;
+};
+
+// Pronounceable words of two to four consonant-vowel syllables, some closed by a consonant
+static std::string word(std::mt19937& random) {
+    static const char consonants[] = "bcdfghjklmnprstvwyz";
+    static const char vowels[] = "aeiou";
+    std::string result;
+    int length = 2 + random() % 3;
+    for (int i = 0; i < length; ++i) {
+        result += consonants[random() % (sizeof(consonants) - 1)];
+        result += vowels[random() % (sizeof(vowels) - 1)];
+    }
+    if (random() % 3 == 0) result += consonants[random() % (sizeof(consonants) - 1)];
+    result[0] = static_cast<char>(std::toupper(result[0]));
+    return result;
+}
+
+static std::string title(std::mt19937& random) {
+    std::string result;
+    int words = 2 + random() % 4;
+    for (int i = 0; i < words; ++i) {
+        if (i) result += i == 2 && random() % 3 == 0 ? ": " : " ";
+        result += word(random);
+    }
+    return result;
+}
+
+// The ways titles come in from user lists and scraped pages
+static std::string misspell(const Entry& entry, std::mt19937& random) {
+    std::string text = entry.title;
+    switch (random() % 6) {
+        case 0:
+            return text;
+        case 1:
+            for (auto& c : text) c = static_cast<char>(std::tolower(c));
+            return text;
+        case 2:
+            text.erase(random() % text.size(), 1);
+            return text;
+        case 3: {
+            size_t at = random() % (text.size() - 1);
+            std::swap(text[at], text[at + 1]);
+            return text;
+        }
+        case 4:
+            return text.substr(0, text.rfind(' '));
+        default:
+            return entry.synonym;
+    }
+}
+
+// Every search finds nothing, so each one costs a request and is remembered
+class EmptySearchTransport : public JikanTransport {
+public:
+    std::atomic<uint64_t> requests{0};
+
+    pplx::task<http_response> request(const http_request&, bool* new_client, pplx::cancellation_token) override {
+        if (new_client) *new_client = false;
+        ++requests;
+        http_response response(200);
+        response.set_body(std::string("{\"data\":[],\"pagination\":{\"has_next_page\":false}}"), "application/json");
+        return pplx::task_from_result(response);
+    }
+};
+
+static void outcome(const std::string& name, JikanTitleResolver& resolver, const std::vector<Query>& input) {
+    uint64_t right = 0;
+    uint64_t wrong = 0;
+    // No warm-up round: a resolve ahead of the clock would change what the timed ones remember
+    auto start = JikanBench::clock::now();
+    for (const auto& query : input) {
+        int found = resolver.resolve(query.text).get().mal_id;
+        if (found == query.mal_id) {
+            ++right;
+        } else if (found != 0) {
+            ++wrong;
+        }
+    }
+    double seconds = std::chrono::duration<double>(JikanBench::clock::now() - start).count();
+    char extra[96];
+    std::snprintf(extra, sizeof(extra), "%.1f%% right, %.1f%% wrong, %.1f%% unresolved", 100.0 * right / input.size(),
+                  100.0 * wrong / input.size(), 100.0 * (input.size() - right - wrong) / input.size());
+    JikanBench::report(name, input.size(), seconds, extra);
+}
+
+int main() {
+    std::mt19937 random(42);
+    std::vector<Entry> corpus;
+    for (int i = 0; i < entries; ++i) corpus.push_back(Entry{i + 1, title(random), title(random)});
+    std::vector<Query> input;
+    for (uint64_t i = 0; i < JikanBench::scaled(queries); ++i) {
+        const Entry& entry = corpus[random() % corpus.size()];
+        input.push_back(Query{misspell(entry, random), entry.mal_id});
+    }
+
+    JikanTitleIndex index;
+    auto start = JikanBench::clock::now();
+    for (const auto& entry : corpus) {
+        index.add(JikanTitleKind::Anime, entry.mal_id, entry.title, entry.title);
+        index.add(JikanTitleKind::Anime, entry.mal_id, entry.title, entry.synonym);
+    }
+    JikanBench::report("index add", corpus.size(), std::chrono::duration<double>(JikanBench::clock::now() - start).count(),
+                       "title and one synonym each");
+    JikanBench::run("index search", input.size(), [&index, &input](uint64_t i) {
+        index.search(input[i % input.size()].text, JikanTitleKind::Anime, 2);
+    });
+
+    Jikan api;
+    JikanRateLimit unlimited;
+    unlimited.per_second = 1e9;
+    unlimited.per_minute = 6e10;
+    api.set_rate_limit(unlimited);
+    auto upstream = std::make_shared<EmptySearchTransport>();
+    api.set_transport(upstream);
+
+    JikanTitleResolverConfig local_only;
+    local_only.search_fallback = false;
+    JikanTitleResolver local(api, local_only);
+    for (const auto& entry : corpus) {
+        local.add(JikanTitleKind::Anime, entry.mal_id, entry.title, entry.title);
+        local.add(JikanTitleKind::Anime, entry.mal_id, entry.title, entry.synonym);
+    }
+    outcome("resolver, local only", local, input);
+
+    // Two passes over the same titles: the second finds every unsure title remembered
+    JikanTitleResolver fallback(api);
+    for (const auto& entry : corpus) {
+        fallback.add(JikanTitleKind::Anime, entry.mal_id, entry.title, entry.title);
+        fallback.add(JikanTitleKind::Anime, entry.mal_id, entry.title, entry.synonym);
+    }
+    outcome("resolver with search, first pass", fallback, input);
+    uint64_t first = upstream->requests;
+    outcome("resolver with search, second pass", fallback, input);
+    JikanTitleResolverStats stats = fallback.stats();
+    std::printf("searches: %llu in the first pass, %llu in the second; %llu local, %llu remembered over both\n",
+                static_cast<unsigned long long>(first), static_cast<unsigned long long>(upstream->requests - first),
+                static_cast<unsigned long long>(stats.local), static_cast<unsigned long long>(stats.remembered));
+    return 0;
+}
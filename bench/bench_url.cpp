@@ -0,0 +1,118 @@
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <new>
+#include <string>
+
+#include <cpprest/http_client.h>
+
+#include "JikanBench.h"
+#include "JikanUrl.h"
+
+// Heap allocations and time to build the getAnimeSearch request target, with JikanUrl and with
+// the std::map and build_query_params path it replaced, reproduced here as it was
+
+enum { urls = 1000000 };
+
+static size_t allocations = 0;
+void* operator new(size_t size) {
+    ++allocations;
+    void* memory = std::malloc(size ? size : 1);
+    if (!memory) throw std::bad_alloc();
+    return memory;
+}
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+void operator delete(void* memory, size_t) noexcept {
+    std::free(memory);
+}
+
+struct Search {
+    int page;
+    int limit;
+    std::string q;
+    std::string type;
+    double min_score;
+    std::string status;
+    std::string rating;
+    bool sfw;
+    std::string genres;
+    std::string order_by;
+    std::string sort;
+};
+
+static std::string encoded(const std::string& value) {
+    return utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(value)));
+}
+
+static std::string build_query_params(const std::map<std::string, std::string>& params) {
+    if (params.empty()) return "";
+    std::string query = "?";
+    bool first = true;
+    for (const auto& param : params) {
+        if (!param.second.empty()) {
+            if (!first) query += "&";
+            auto encoded_value = web::uri::encode_data_string(utility::conversions::to_string_t(param.second));
+            query += param.first + "=" + utility::conversions::to_utf8string(encoded_value);
+            first = false;
+        }
+    }
+    return query;
+}
+
+static std::string old_url(const Search& s) {
+    std::map<std::string, std::string> params;
+    if (s.page > 0) params["page"] = std::to_string(s.page);
+    if (s.limit > 0) params["limit"] = std::to_string(s.limit);
+    if (!s.q.empty()) params["q"] = encoded(s.q);
+    if (!s.type.empty()) params["type"] = encoded(s.type);
+    if (s.min_score > 0) params["min_score"] = std::to_string(s.min_score);
+    if (!s.status.empty()) params["status"] = encoded(s.status);
+    if (!s.rating.empty()) params["rating"] = encoded(s.rating);
+    if (s.sfw) params["sfw"] = "";
+    if (!s.genres.empty()) params["genres"] = encoded(s.genres);
+    if (!s.order_by.empty()) params["order_by"] = encoded(s.order_by);
+    if (!s.sort.empty()) params["sort"] = encoded(s.sort);
+    return "/anime" + build_query_params(params);
+}
+
+static std::string new_url(const Search& s) {
+    return JikanUrl("/anime")
+        .param("page", s.page)
+        .param("limit", s.limit)
+        .param("q", s.q)
+        .param("type", s.type)
+        .param("min_score", s.min_score)
+        .param("status", s.status)
+        .param("rating", s.rating)
+        .flag("sfw", s.sfw)
+        .param("genres", s.genres)
+        .param("order_by", s.order_by)
+        .param("sort", s.sort);
+}
+
+template <typename Build>
+static void measure(const std::string& name, const Search& search, Build build) {
+    uint64_t count = JikanBench::scaled(urls);
+    size_t length = 0;
+    size_t before = allocations;
+    double seconds = JikanBench::time(count, [&](uint64_t) { length += build(search).size(); });
+    char extra[96];
+    std::snprintf(extra, sizeof(extra), "%.1f allocations/url  %zu bytes", static_cast<double>(allocations - before) / (count + 1),
+                  build(search).size());
+    JikanBench::report(name, count, seconds, extra);
+    if (length == 0) std::abort();
+}
+
+int main() {
+    Search query_only = {0, 0, "fullmetal", "", 0.0, "", "", false, "", "", ""};
+    Search filtered = {2, 25, "fullmetal alchemist", "tv", 7.5, "complete", "pg13", true, "1,2", "score", "desc"};
+    std::printf("%s\n%s\n", new_url(filtered).c_str(), old_url(filtered).c_str());
+
+    measure("getAnimeSearch url, q only, JikanUrl", query_only, new_url);
+    measure("getAnimeSearch url, q only, map", query_only, old_url);
+    measure("getAnimeSearch url, 11 filters, JikanUrl", filtered, new_url);
+    measure("getAnimeSearch url, 11 filters, map", filtered, old_url);
+    return 0;
+}
@@ -1,573 +1,1129 @@
 #ifndef JIKAN_H
 #define JIKAN_H
 
+#include <cpprest/containerstream.h>
 #include <cpprest/http_client.h>
 #include <cpprest/json.h>
 #include <pplx/pplx.h>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
+#include "JikanBatch.h"
+#include "JikanCache.h"
+#include "JikanCancel.h"
+#include "JikanClientPool.h"
+#include "JikanCoroutine.h"
+#include "JikanDiskCache.h"
+#include "JikanDocument.h"
+#include "JikanMetrics.h"
+#include "JikanPager.h"
+#include "JikanRaw.h"
+#include "JikanReplay.h"
+#include "JikanRetry.h"
+#include "JikanScheduler.h"
+#include "JikanSingleFlight.h"
+#include "JikanTypes.h"
+#include "JikanUrl.h"
+
 using namespace web;
 using namespace web::http;
 using namespace web::http::client;
 
+// Thrown inside the byte-level pipeline for a non-200 answer; the json getters turn it back into an error object
+class JikanHttpError : public std::runtime_error {
+private:
+    status_code code;
+
+public:
+    explicit JikanHttpError(status_code code)
+        : std::runtime_error("HTTP Error: " + std::to_string(code)), code(code) {}
+
+    status_code status() const {
+        return code;
+    }
+};
+
 class Jikan {
 private:
     std::string api_base = "https://api.jikan.moe/v4";
     http_client_config client_config;
+    // client_pool, transport, cache, retry and metrics can be replaced while requests are running:
+    // they are read with std::atomic_load and replaced with std::atomic_store
+    std::shared_ptr<JikanClientPool> client_pool;
+    // Stands in for client_pool when set, see set_transport
+    std::shared_ptr<JikanTransport> transport;
+    utility::string_t host = U("api.jikan.moe");
+    std::shared_ptr<JikanScheduler> scheduler;
+    std::shared_ptr<JikanResponseCache> cache;
+    std::shared_ptr<JikanSingleFlight<JikanCacheEntry>> flights;
+    std::shared_ptr<JikanRetryEngine> retry;
+    std::shared_ptr<JikanMetrics> metrics;
+    std::shared_ptr<JikanTimer> timer;
+
+    typedef std::map<utility::string_t, utility::string_t> header_map;
+
+    struct ApiCall {
+        std::string endpoint;
+        web::http::method verb;
+        std::string data;
+        header_map headers;
+        JikanPriority priority;
+        std::shared_ptr<JikanRequestTrace> trace;
+        pplx::cancellation_token cancel = pplx::cancellation_token::none();
+        JikanCallOptions::clock::time_point deadline = JikanCallOptions::clock::time_point::max();
+    };
     
-    http_request create_request(const std::string& endpoint, const std::string& method, const std::string& data = "") {
-        http_request request;
-        
-        if (method == "GET") {
-            request.set_method(methods::GET);
-        } else if (method == "POST") {
-            request.set_method(methods::POST);
-        } else if (method == "PUT") {
-            request.set_method(methods::PUT);
-        } else if (method == "DEL") {
-            request.set_method(methods::DEL);
-        }
-        
+    static http_request create_request(const std::string& endpoint, const web::http::method& verb, const std::string& data = "", const header_map& extra_headers = header_map()) {
+        http_request request(verb);
         request.set_request_uri(utility::conversions::to_string_t(endpoint));
         
-        // Set headers
-        request.headers().add(U("Host"), U("api.jikan.moe"));
+        // Set headers, Host comes in extra_headers from api_base
         request.headers().add(U("User-Agent"), U("Mozilla/5.0 (X11; Linux x86_64; rv:109.0) Gecko/20100101 Firefox/115.0"));
+        for (const auto& header : extra_headers) {
+            request.headers().add(header.first, header.second);
+        }
         
-        if (!data.empty() && (method == "POST" || method == "PUT")) {
+        if (!data.empty() && (verb == methods::POST || verb == methods::PUT)) {
             request.set_body(data);
         }
         
         return request;
     }
     
-    std::string build_query_params(const std::map<std::string, std::string>& params) {
-        if (params.empty()) return "";
-        
-        std::string query = "?";
-        bool first = true;
-        for (const auto& param : params) {
-            if (!param.second.empty()) {
-                if (!first) query += "&";
-                // Кодируем значения параметров
-                auto encoded_value = web::uri::encode_data_string(utility::conversions::to_string_t(param.second));
-                query += param.first + "=" + utility::conversions::to_utf8string(encoded_value);
-                first = false;
+    // Waits for a rate limit token, then sends; a 429 pauses the scheduler for Retry-After and requeues the request
+    static pplx::task<http_response> dispatch(std::shared_ptr<JikanScheduler> scheduler, std::shared_ptr<JikanTransport> pool,
+                                              const ApiCall& call, int throttle_retries) {
+        auto queued = JikanRequestTrace::clock::now();
+        return scheduler->schedule(call.priority, [pool, call, queued]() {
+                auto trace = call.trace;
+                trace->dispatched = JikanRequestTrace::clock::now();
+                trace->queue_wait += trace->dispatched - queued;
+                trace->status = 0;
+                return pool->request(create_request(call.endpoint, call.verb, call.data, call.headers), &trace->new_client, call.cancel);
+            }, call.cancel)
+            .then([scheduler, pool, call, throttle_retries](http_response response) {
+                call.trace->first_byte = JikanRequestTrace::clock::now();
+                call.trace->status = response.status_code();
+                if (response.status_code() == 429 && throttle_retries > 0) {
+                    scheduler->throttle(JikanScheduler::retry_after(response));
+                    return dispatch(scheduler, pool, call, throttle_retries - 1);
+                }
+                return pplx::task_from_result(response);
+            });
+    }
+
+    // One attempt for the retry engine; every attempt waits for the rate limiter again
+    static std::function<pplx::task<http_response>()> sender(std::shared_ptr<JikanScheduler> scheduler, std::shared_ptr<JikanTransport> pool,
+                                                             const ApiCall& call, int throttle_retries) {
+        return [scheduler, pool, call, throttle_retries]() {
+            return dispatch(scheduler, pool, call, throttle_retries);
+        };
+    }
+
+    static json::value make_error(const utility::string_t& message) {
+        json::value error_obj;
+        error_obj[U("error")] = json::value::string(message);
+        error_obj[U("success")] = json::value::boolean(false);
+        return error_obj;
+    }
+
+    static json::value http_error(status_code code) {
+        return make_error(U("HTTP Error: ") + utility::conversions::to_string_t(std::to_string(code)));
+    }
+
+    static pplx::task<json::value> catch_errors(pplx::task<json::value> task) {
+        return task.then([](pplx::task<json::value> previousTask) {
+            try {
+                return previousTask.get();
+            } catch (const JikanHttpError& e) {
+                return http_error(e.status());
+            } catch (const pplx::task_canceled&) {
+                return make_error(U("Cancelled"));
+            } catch (const std::exception& e) {
+                return make_error(U("Exception: ") + utility::conversions::to_string_t(e.what()));
             }
+        });
+    }
+
+    static json::value entry_json(const JikanCacheEntry& entry) {
+        if (entry.json) return *entry.json;
+        return jikan_parse_json(entry.body);
+    }
+
+    static utility::string_t header_value(const http_response& response, const utility::string_t& name) {
+        auto it = response.headers().find(name);
+        return it != response.headers().end() ? it->second : utility::string_t();
+    }
+
+    // Body and validators of a 200 answer; the DOM is only built when parse is set
+    static pplx::task<JikanCacheEntry> read_entry(http_response response, bool parse) {
+        if (response.status_code() != status_codes::OK) {
+            throw JikanHttpError(response.status_code());
         }
-        return query;
+        auto etag = header_value(response, U("ETag"));
+        auto last_modified = header_value(response, U("Last-Modified"));
+        // Read into a string from this thread's pool; it goes back to a pool when the last copy of the body is dropped
+        concurrency::streams::container_buffer<std::string> buffer(JikanArenaPool::acquire_body(), std::ios_base::out);
+        return response.body().read_to_end(buffer).then([buffer, etag, last_modified, parse](size_t) {
+            JikanCacheEntry entry;
+            entry.body = JikanArenaPool::buffer(std::move(buffer.collection()));
+            if (parse) entry.json = std::make_shared<const json::value>(jikan_parse_json(entry.body));
+            entry.etag = etag;
+            entry.last_modified = last_modified;
+            return entry;
+        });
     }
-    
-    pplx::task<json::value> make_api_call(const std::string& endpoint, const std::string& method, const std::string& data = "") {
-        http_client client(utility::conversions::to_string_t(api_base), client_config);
-        auto request = create_request(endpoint, method, data);
-
-        return client.request(request)
-            .then([](http_response response) {
-                if (response.status_code() == status_codes::OK) {
-                    return response.extract_json();
-                } else {
-                    json::value error_obj;
-                    error_obj[U("error")] = json::value::string(
-                        U("HTTP Error: ") + utility::conversions::to_string_t(std::to_string(response.status_code())));
-                    error_obj[U("success")] = json::value::boolean(false);
-                    return pplx::task_from_result(error_obj);
-                }
-            })
-            .then([](pplx::task<json::value> previousTask) {
-                try {
-                    return previousTask.get();
-                } catch (const std::exception& e) {
-                    json::value error_obj;
-                    error_obj[U("error")] = json::value::string(
-                        U("Exception: ") + utility::conversions::to_string_t(e.what()));
-                    error_obj[U("success")] = json::value::boolean(false);
-                    return error_obj;
-                }
+
+    // Records one finished network request; cache hits and coalesced waiters never get here
+    static pplx::task<JikanCacheEntry> traced(std::shared_ptr<JikanMetrics> metrics, std::shared_ptr<JikanRequestTrace> trace,
+                                              pplx::task<JikanCacheEntry> task) {
+        return task.then([metrics, trace](pplx::task<JikanCacheEntry> previousTask) {
+            trace->finished = JikanRequestTrace::clock::now();
+            try {
+                JikanCacheEntry entry = previousTask.get();
+                // A 304 hands back the cached body, nothing came over the wire
+                if (trace->status == status_codes::OK) trace->bytes = entry.body.size();
+                metrics->record(*trace);
+                return entry;
+            } catch (...) {
+                metrics->record(*trace);
+                throw;
+            }
+        });
+    }
+
+    // What call_token arms for a deadline, taken down again by disarm when the call is over
+    struct DeadlineHooks {
+        bool armed = false;
+        // Cancels the timer wait
+        pplx::cancellation_token_source finished;
+        pplx::cancellation_token parent = pplx::cancellation_token::none();
+        pplx::cancellation_token_registration registration;
+    };
+
+    // Folds the deadline into the caller's token so every layer below watches a single token
+    pplx::cancellation_token call_token(const JikanCallOptions& options, DeadlineHooks& hooks) {
+        if (options.deadline == JikanCallOptions::clock::time_point::max()) return options.cancel;
+        pplx::cancellation_token_source source;
+        hooks.armed = true;
+        hooks.parent = options.cancel;
+        // Not a linked source: those stay registered on the parent for as long as it lives.
+        // Cancelling the call drops its timer entry at once too, instead of when disarm runs
+        auto finished = hooks.finished;
+        if (hooks.parent.is_cancelable()) {
+            hooks.registration = hooks.parent.register_callback([source, finished]() {
+                source.cancel();
+                finished.cancel();
             });
+        }
+        auto now = JikanCallOptions::clock::now();
+        // Rounded up: a wait cut short by the truncation would cancel before expire_at sees the deadline as passed
+        std::chrono::milliseconds remaining(0);
+        if (options.deadline > now) {
+            remaining = std::chrono::duration_cast<std::chrono::milliseconds>(options.deadline - now);
+            if (now + remaining < options.deadline) remaining += std::chrono::milliseconds(1);
+        }
+        timer->after(remaining, hooks.finished.get_token()).then([source](pplx::task<void> previousTask) {
+            try {
+                previousTask.get();
+                source.cancel();
+            } catch (...) {
+            }
+        });
+        return source.get_token();
+    }
+
+    // A call that ends before its deadline drops its timer entry and its callback on the caller's token
+    static pplx::task<JikanCacheEntry> disarm(const DeadlineHooks& hooks, pplx::task<JikanCacheEntry> task) {
+        if (!hooks.armed) return task;
+        auto finished = hooks.finished;
+        auto parent = hooks.parent;
+        auto registration = hooks.registration;
+        return task.then([finished, parent, registration](pplx::task<JikanCacheEntry> previousTask) {
+            finished.cancel();
+            if (parent.is_cancelable()) parent.deregister_callback(registration);
+            return previousTask.get();
+        });
+    }
+
+    // A call cancelled because its deadline passed reports that instead of a plain cancellation
+    static pplx::task<JikanCacheEntry> expire_at(JikanCallOptions::clock::time_point deadline, pplx::task<JikanCacheEntry> task) {
+        if (deadline == JikanCallOptions::clock::time_point::max()) return task;
+        return task.then([deadline](pplx::task<JikanCacheEntry> previousTask) {
+            try {
+                return previousTask.get();
+            } catch (const pplx::task_canceled&) {
+                if (JikanCallOptions::clock::now() >= deadline) throw JikanDeadlineError();
+                throw;
+            }
+        });
+    }
+
+    // Cache, coalescing, rate limit and pool in front of one request; non-200 answers surface as JikanHttpError
+    pplx::task<JikanCacheEntry> fetch(const std::string& endpoint, const web::http::method& verb, const std::string& data, bool parse) {
+        const JikanCallOptions& options = JikanCallScope::current();
+        if (options.cancel.is_canceled()) return pplx::task_from_exception<JikanCacheEntry>(pplx::task_canceled());
+        return expire_at(options.deadline, fetch(endpoint, verb, data, parse, options));
+    }
+
+    pplx::task<JikanCacheEntry> fetch(const std::string& endpoint, const web::http::method& verb, const std::string& data, bool parse,
+                                      const JikanCallOptions& options) {
+        ApiCall call;
+        call.endpoint = endpoint;
+        call.verb = verb;
+        call.data = data;
+        call.priority = JikanPriorityScope::current();
+        call.headers[U("Host")] = host;
+        call.trace = std::make_shared<JikanRequestTrace>();
+        call.trace->endpoint = JikanMetrics::endpoint_template(endpoint);
+        call.trace->started = JikanRequestTrace::clock::now();
+        call.deadline = options.deadline;
+        int throttle_retries = scheduler->rate_limit().max_throttle_retries;
+
+        auto scheduler = this->scheduler;
+        std::shared_ptr<JikanTransport> pool = std::atomic_load(&transport);
+        if (!pool) pool = std::atomic_load(&client_pool);
+        auto cache = std::atomic_load(&this->cache);
+        auto retry = std::atomic_load(&this->retry);
+        auto metrics = std::atomic_load(&this->metrics);
+        auto trace = call.trace;
+        std::string method = utility::conversions::to_utf8string(verb);
+        std::string key = JikanResponseCache::key(pool->backend(), method, endpoint);
+        auto deadline = call.deadline;
+        // A cancellable call never shares its request, one caller giving up must not fail the others
+        bool shareable = !options.cancellable();
+
+        DeadlineHooks hooks;
+        if (!cache->cacheable(method, endpoint)) {
+            call.cancel = call_token(options, hooks);
+            auto cancel = call.cancel;
+            auto send_once = sender(scheduler, pool, call, throttle_retries);
+            std::function<pplx::task<JikanCacheEntry>()> send = [retry, send_once, cancel, deadline, parse, metrics, trace]() {
+                return traced(metrics, trace, retry->run(send_once, cancel, deadline)
+                    .then([parse](http_response response) {
+                        return read_entry(response, parse);
+                    }));
+            };
+            // Zero-TTL endpoints like /random must not hand one answer to several callers
+            bool coalesce = shareable && verb == methods::GET && cache->ttl(endpoint).count() > 0;
+            return disarm(hooks, coalesce ? flights->run(key, send) : send());
+        }
+
+        // Fresh entries are answered without a request, stale ones are revalidated with their validators
+        JikanCacheEntry cached;
+        bool have = cache->lookup(key, cached);
+        if (have && cached.fresh() && !options.revalidate) {
+            cache->record_hit();
+            if (parse && !cached.json) {
+                // Came from a tier that only keeps bytes: parsed once, and kept parsed for the next hit
+                return pplx::task_from_result(cached).then([cache, key](JikanCacheEntry entry) {
+                    entry.json = std::make_shared<const json::value>(jikan_parse_json(entry.body));
+                    cache->keep_parsed(key, entry);
+                    return entry;
+                });
+            }
+            return pplx::task_from_result(cached);
+        }
+        cache->record_miss();
+        if (have && cached.revalidatable()) {
+            if (!cached.etag.empty()) call.headers[U("If-None-Match")] = cached.etag;
+            if (!cached.last_modified.empty()) call.headers[U("If-Modified-Since")] = cached.last_modified;
+        }
+
+        auto ttl = cache->ttl(endpoint);
+        call.cancel = call_token(options, hooks);
+        auto cancel = call.cancel;
+        auto send_once = sender(scheduler, pool, call, throttle_retries);
+        std::function<pplx::task<JikanCacheEntry>()> send = [retry, send_once, cancel, deadline, cache, key, cached, have, ttl, parse, metrics, trace]() {
+            return traced(metrics, trace, retry->run(send_once, cancel, deadline)
+                .then([cache, key, cached, have, ttl, parse](http_response response) -> pplx::task<JikanCacheEntry> {
+                    if (response.status_code() == status_codes::NotModified && have) {
+                        cache->record_revalidated();
+                        JikanCacheEntry entry = cached;
+                        entry.expires = std::chrono::system_clock::now() + ttl;
+                        if (parse && !entry.json) entry.json = std::make_shared<const json::value>(jikan_parse_json(entry.body));
+                        cache->store_entry(key, entry);
+                        return pplx::task_from_result(entry);
+                    }
+                    return read_entry(response, parse).then([cache, key, ttl](JikanCacheEntry entry) {
+                        entry.expires = std::chrono::system_clock::now() + ttl;
+                        cache->store_entry(key, entry);
+                        return entry;
+                    });
+                }));
+        };
+        // Concurrent misses for the same key share one request
+        return disarm(hooks, shareable ? flights->run(key, send) : send());
+    }
+
+    pplx::task<json::value> make_api_call(const std::string& endpoint, const web::http::method& verb = methods::GET, const std::string& data = "") {
+        JikanRawScope* raw = JikanRawScope::current();
+        if (raw && raw->capturing()) {
+            // The body and its errors reach the caller through the scope
+            raw->capture(make_raw_api_call(endpoint, verb, data));
+            return pplx::task_from_result(json::value());
+        }
+        return catch_errors(fetch(endpoint, verb, data, true).then([](JikanCacheEntry entry) {
+            return entry_json(entry);
+        }));
+    }
+
+    // Response body without building a DOM
+    pplx::task<JikanBuffer> make_raw_api_call(const std::string& endpoint, const web::http::method& verb = methods::GET, const std::string& data = "") {
+        return fetch(endpoint, verb, data, false).then([](JikanCacheEntry entry) {
+            return entry.body;
+        });
+    }
+
+    template <typename T>
+    pplx::task<JikanResult<T>> make_typed_call(const std::string& endpoint, uint64_t fields) {
+        return make_raw_api_call(endpoint).then([fields](pplx::task<JikanBuffer> previousTask) {
+            JikanResult<T> result;
+            try {
+                jikan_decode_document(previousTask.get(), result.data, fields);
+            } catch (const std::exception& e) {
+                result.success = false;
+                result.error = e.what();
+            }
+            return result;
+        });
+    }
+
+    template <typename T>
+    pplx::task<JikanPage<T>> make_typed_page_call(const std::string& endpoint, uint64_t fields) {
+        return make_raw_api_call(endpoint).then([fields](pplx::task<JikanBuffer> previousTask) {
+            JikanPage<T> page;
+            try {
+                jikan_decode_page(previousTask.get(), page, fields);
+            } catch (const std::exception& e) {
+                page.success = false;
+                page.error = e.what();
+            }
+            return page;
+        });
+    }
+
+    typedef pplx::task<json::value> (Jikan::*by_id_getter)(int);
+
+    static by_id_getter getter_for(JikanEndpointKind kind) {
+        switch (kind) {
+            case JikanEndpointKind::Anime: return &Jikan::getAnimeById;
+            case JikanEndpointKind::AnimeFull: return &Jikan::getAnimeFullById;
+            case JikanEndpointKind::AnimeCharacters: return &Jikan::getAnimeCharacters;
+            case JikanEndpointKind::AnimeStaff: return &Jikan::getAnimeStaff;
+            case JikanEndpointKind::AnimeRelations: return &Jikan::getAnimeRelations;
+            case JikanEndpointKind::Manga: return &Jikan::getMangaById;
+            case JikanEndpointKind::MangaFull: return &Jikan::getMangaFullById;
+            case JikanEndpointKind::MangaCharacters: return &Jikan::getMangaCharacters;
+            case JikanEndpointKind::Character: return &Jikan::getCharacterById;
+            case JikanEndpointKind::CharacterFull: return &Jikan::getCharacterFullById;
+            case JikanEndpointKind::CharacterVoiceActors: return &Jikan::getCharacterVoiceActors;
+            case JikanEndpointKind::Person: return &Jikan::getPersonById;
+            case JikanEndpointKind::PersonFull: return &Jikan::getPersonFullById;
+            case JikanEndpointKind::PersonAnime: return &Jikan::getPersonAnime;
+            case JikanEndpointKind::Producer: return &Jikan::getProducerById;
+            case JikanEndpointKind::ProducerFull: return &Jikan::getProducerFullById;
+            case JikanEndpointKind::Club: return &Jikan::getClubsById;
+        }
+        return &Jikan::getAnimeById;
     }
 
 public:
-    Jikan(){
+    Jikan(const JikanPoolConfig& pool_config = JikanPoolConfig()){
         client_config.set_validate_certificates(false);
+        client_pool = std::make_shared<JikanClientPool>(utility::conversions::to_string_t(api_base), client_config, pool_config);
+        scheduler = std::make_shared<JikanScheduler>();
+        cache = std::make_shared<JikanResponseCache>();
+        flights = std::make_shared<JikanSingleFlight<JikanCacheEntry>>();
+        timer = std::make_shared<JikanTimer>();
+        retry = std::make_shared<JikanRetryEngine>(JikanRetryConfig(), timer);
+        metrics = std::make_shared<JikanMetrics>();
+    }
+
+    // Replaces the connection pool, requests already in flight finish on the old one
+    void set_pool_config(const JikanPoolConfig& pool_config) {
+        std::atomic_store(&client_pool, std::make_shared<JikanClientPool>(utility::conversions::to_string_t(api_base), client_config, pool_config));
+    }
+
+    // Points the connection pool at another server, e.g. a JikanMockServer on loopback.
+    // Call it before the first request: the Host header it sets is not synchronized.
+    void set_api_base(const std::string& base) {
+        api_base = base;
+        web::uri uri(utility::conversions::to_string_t(base));
+        host = uri.host();
+        if (uri.port() > 0) host += U(":") + utility::conversions::to_string_t(std::to_string(uri.port()));
+        auto pool_config = std::atomic_load(&client_pool)->get_config();
+        std::atomic_store(&client_pool, std::make_shared<JikanClientPool>(utility::conversions::to_string_t(api_base), client_config, pool_config));
+    }
+
+    const std::string& get_api_base() const {
+        return api_base;
+    }
+
+    // Sends every request through transport instead of the connection pool; nullptr goes back to the pool
+    void set_transport(std::shared_ptr<JikanTransport> custom) {
+        std::atomic_store(&transport, std::move(custom));
+    }
+
+    // Real requests whose answers are saved as fixtures in directory
+    void record_fixtures(const std::string& directory) {
+        std::shared_ptr<JikanTransport> recording =
+            std::make_shared<JikanRecordingTransport>(std::atomic_load(&client_pool), std::make_shared<JikanFixtureStore>(directory));
+        std::atomic_store(&transport, recording);
+    }
+
+    // Answers from the fixtures in directory, nothing goes to the network
+    std::shared_ptr<JikanReplayTransport> replay_fixtures(const std::string& directory, const JikanFaultConfig& faults = JikanFaultConfig()) {
+        auto replay = std::make_shared<JikanReplayTransport>(std::make_shared<JikanFixtureStore>(directory), faults);
+        std::atomic_store(&transport, std::shared_ptr<JikanTransport>(replay));
+        return replay;
+    }
+
+    JikanPoolStats pool_stats() const {
+        return std::atomic_load(&client_pool)->stats();
+    }
+
+    void set_rate_limit(const JikanRateLimit& limit) {
+        scheduler->set_rate_limit(limit);
+    }
+
+    // Draws permits from a budget shared with other processes as well, e.g. a JikanSharedQuota; nullptr drops it
+    void set_quota(std::shared_ptr<JikanQuota> quota) {
+        scheduler->set_quota(std::move(quota));
+    }
+
+    JikanSchedulerStats scheduler_stats() const {
+        return scheduler->stats();
+    }
+
+    // Pass a custom store to share or persist cached responses, by default an in-memory LRU is used
+    void set_cache_config(const JikanCacheConfig& config, std::shared_ptr<JikanCacheStore> store = nullptr) {
+        std::atomic_store(&cache, std::make_shared<JikanResponseCache>(config, store));
+    }
+
+    void set_retry_config(const JikanRetryConfig& config) {
+        std::atomic_store(&retry, std::make_shared<JikanRetryEngine>(config, timer));
+    }
+
+    JikanRetryStats retry_stats() const {
+        return std::atomic_load(&retry)->stats();
+    }
+
+    JikanSingleFlightStats coalescing_stats() const {
+        return flights->stats();
+    }
+
+    // Deadlines and retry backoffs waiting on the timer; a cancelled call leaves none behind
+    size_t timer_waiting() const {
+        return timer->waiting();
+    }
+
+    // Per endpoint template counters and latency histograms of requests that went to the network
+    std::vector<JikanEndpointSnapshot> metrics_snapshot() const {
+        return std::atomic_load(&metrics)->snapshot();
+    }
+
+    // Same data in the Prometheus text format, ready to be served from a /metrics handler
+    std::string metrics_prometheus() const {
+        return std::atomic_load(&metrics)->prometheus();
+    }
+
+    // Requests still in flight are recorded into the replaced metrics
+    void reset_metrics() {
+        std::atomic_store(&metrics, std::make_shared<JikanMetrics>());
+    }
+
+    // Applies a cancellation token and deadline to every request call starts on this thread:
+    //     pplx::cancellation_token_source source;
+    //     auto anime = api.with_options(JikanCallOptions::within(std::chrono::seconds(5), source.get_token()),
+    //                                   [&api] { return api.getAnimeById(1); });
+    //     source.cancel(); // anime completes with a "Cancelled" error object
+    template <typename Call>
+    auto with_options(const JikanCallOptions& options, Call call) -> decltype(call()) {
+        JikanCallScope scope(options);
+        return call();
+    }
+
+    // Body of the first request a json getter makes, as shared bytes and without building a DOM.
+    // Errors surface as exceptions (JikanHttpError for non-200 answers) instead of error objects:
+    //     JikanBuffer body = api.raw([&api] { return api.getAnimeFullById(5114); }).get();
+    template <typename Call>
+    pplx::task<JikanBuffer> raw(Call call) {
+        JikanRawScope scope;
+        try {
+            call();
+        } catch (...) {
+            return pplx::task_from_exception<JikanBuffer>(std::current_exception());
+        }
+        return scope.result();
+    }
+
+    // Same body written to sink in chunk_size pieces; the task yields the byte count.
+    // A cached body is written straight from the cache, mapped disk segments included.
+    template <typename Call>
+    pplx::task<size_t> stream_to(std::shared_ptr<JikanSink> sink, Call call, size_t chunk_size = 64 * 1024) {
+        return raw(call).then([sink, chunk_size](JikanBuffer body) {
+            return jikan_write_chunks(body, *sink, chunk_size);
+        });
+    }
+
+    // Body parsed into an arena instead of a json::value: one allocation per document instead of one per node.
+    // Every call parses into its own pooled arena, since parses of concurrent calls run on different threads.
+    template <typename Call>
+    pplx::task<JikanDocument> document(Call call) {
+        return raw(call).then([](JikanBuffer body) {
+            return JikanDocument::parse(body);
+        });
+    }
+
+#ifdef JIKAN_HAS_COROUTINES
+    // Coroutine form of with_options: auto anime = co_await api.awaitable(options, [&] { return api.getAnimeById(1); });
+    template <typename Call>
+    auto awaitable(const JikanCallOptions& options, Call call) -> JikanAwaitable<typename decltype(call())::result_type> {
+        return jikan_await(with_options(options, call));
+    }
+#endif
+
+    // Streams every page of a paged endpoint, prefetching the next one:
+    //     auto pages = api.paginate([&api](int page) { return api.getAnimeSearch(page, 25); });
+    // Pages after the first are requested from continuations, which run on pool threads and carry
+    // the caller's priority and call options only through in_caller_scope.
+    JikanPageStream paginate(JikanPageFetcher fetch, int first_page = 1) {
+        return JikanPageStream(in_caller_scope(fetch), first_page);
+    }
+
+    // Wraps fetch so every call runs under the priority and call options of the thread that wrapped it
+    static std::function<pplx::task<web::json::value>(int)> in_caller_scope(std::function<pplx::task<web::json::value>(int)> fetch) {
+        JikanPriority priority = JikanPriorityScope::current();
+        JikanCallOptions options = JikanCallScope::current();
+        return [fetch, priority, options](int arg) {
+            JikanPriorityScope priority_scope(priority);
+            JikanCallScope call_scope(options);
+            return fetch(arg);
+        };
+    }
+
+    // Fetches many ids of one by-id endpoint with at most max_in_flight requests outstanding.
+    // Results keep the order of ids; failed ids are listed in failures. The Jikan object must outlive the batch.
+    pplx::task<JikanBatchResult> getManyById(JikanEndpointKind kind, const std::vector<int>& ids, size_t max_in_flight = 8) {
+        by_id_getter getter = getter_for(kind);
+        return JikanBatch::collect(ids, max_in_flight, in_caller_scope([this, getter](int id) { return (this->*getter)(id); }));
+    }
+
+    // Streaming form: on_result sees each id as soon as it finishes, nothing is retained
+    pplx::task<void> getManyById(JikanEndpointKind kind, const std::vector<int>& ids, JikanBatchCallback on_result, size_t max_in_flight = 8) {
+        by_id_getter getter = getter_for(kind);
+        return JikanBatch::run(ids, max_in_flight, in_caller_scope([this, getter](int id) { return (this->*getter)(id); }), on_result);
+    }
+
+    // Keeps response bodies on disk below the in-memory cache so they survive restarts
+    std::shared_ptr<JikanDiskCache> set_disk_cache(const JikanDiskCacheConfig& config) {
+        auto disk = std::make_shared<JikanDiskCache>(config);
+        auto config_in_use = std::atomic_load(&cache)->get_config();
+        auto memory = std::make_shared<JikanMemoryCache>(config_in_use.max_memory_bytes);
+        std::atomic_store(&cache, std::make_shared<JikanResponseCache>(config_in_use, std::make_shared<JikanTieredCache>(memory, disk)));
+        return disk;
+    }
+
+    JikanCacheStats cache_stats() const {
+        return std::atomic_load(&cache)->stats();
+    }
+
+    void clear_cache() {
+        std::atomic_load(&cache)->clear();
     }
 
     pplx::task<json::value> getAnimeById(int id) {
-        return make_api_call("/anime/" + std::to_string(id),"GET");
+        return make_api_call(JikanUrl("/anime").segment(id));
     }
 
     pplx::task<json::value> getAnimeCharacters(int id) {
-        return make_api_call("/anime/" + std::to_string(id) + "/characters","GET");
+        return make_api_call(JikanUrl("/anime").segment(id).path("/characters"));
     }
     pplx::task<json::value> getAnimeStaff(int id) {
-        return make_api_call("/anime/" + std::to_string(id) + "/staff","GET");
+        return make_api_call(JikanUrl("/anime").segment(id).path("/staff"));
     }
 
     pplx::task<json::value> getAnimeEpisodes(int id) {
-        return make_api_call("/anime/" + std::to_string(id) + "/episodes","GET");
+        return make_api_call(JikanUrl("/anime").segment(id).path("/episodes"));
     }
     pplx::task<json::value> getAnimeEpisodeById(int id,int episode) {
-        return make_api_call("/anime/" + std::to_string(id) + "/episodes/" + std::to_string(episode),"GET");
+        return make_api_call(JikanUrl("/anime").segment(id).path("/episodes").segment(episode));
     }
     pplx::task<json::value> getAnimeNews(int id) {
-        return make_api_call("/anime/" + std::to_string(id) + "/news","GET");
+        return make_api_call(JikanUrl("/anime").segment(id).path("/news"));
     }
     pplx::task<json::value> getAnimeForum(int id) {
-        return make_api_call("/anime/" + std::to_string(id) + "/forum","GET");
+        return make_api_call(JikanUrl("/anime").segment(id).path("/forum"));
     }
     pplx::task<json::value> getAnimeVideos(int id) {
-        return make_api_call("/anime/" + std::to_string(id) + "/videos","GET");
+        return make_api_call(JikanUrl("/anime").segment(id).path("/videos"));
     }
     pplx::task<json::value> getAnimeVideosEpisodes(int id) {
-        return make_api_call("/anime/" + std::to_string(id) + "/videos/episodes","GET");
+        return make_api_call(JikanUrl("/anime").segment(id).path("/videos/episodes"));
     }
     pplx::task<json::value> getAnimePictures(int id) {
-        return make_api_call("/anime/" + std::to_string(id) + "/pictures","GET");
+        return make_api_call(JikanUrl("/anime").segment(id).path("/pictures"));
     }
     pplx::task<json::value> getAnimeStatistics(int id) {
-        return make_api_call("/anime/" + std::to_string(id) + "/statistics","GET");
+        return make_api_call(JikanUrl("/anime").segment(id).path("/statistics"));
     }
     pplx::task<json::value> getAnimeMoreInfo(int id) {
-        return make_api_call("/anime/" + std::to_string(id) + "/moreinfo","GET");
+        return make_api_call(JikanUrl("/anime").segment(id).path("/moreinfo"));
     }
     pplx::task<json::value> getAnimeRecommendations(int id) {
-        return make_api_call("/anime/" + std::to_string(id) + "/recommendations","GET");
+        return make_api_call(JikanUrl("/anime").segment(id).path("/recommendations"));
     }
     pplx::task<json::value> getAnimeUserUpdates(int id) {
-        return make_api_call("/anime/" + std::to_string(id) + "/userupdates","GET");
+        return make_api_call(JikanUrl("/anime").segment(id).path("/userupdates"));
     }
     pplx::task<json::value> getAnimeReviews(int id) {
-        return make_api_call("/anime/" + std::to_string(id) + "/reviews","GET");
+        return make_api_call(JikanUrl("/anime").segment(id).path("/reviews"));
     }
     pplx::task<json::value> getAnimeRelations(int id) {
-        return make_api_call("/anime/" + std::to_string(id) + "/relations","GET");
+        return make_api_call(JikanUrl("/anime").segment(id).path("/relations"));
     }
     pplx::task<json::value> getAnimeThemes(int id) {
-        return make_api_call("/anime/" + std::to_string(id) + "/themes","GET");
+        return make_api_call(JikanUrl("/anime").segment(id).path("/themes"));
     }
     pplx::task<json::value> getAnimeExternal(int id) {
-        return make_api_call("/anime/" + std::to_string(id) + "/external","GET");
+        return make_api_call(JikanUrl("/anime").segment(id).path("/external"));
     }
     pplx::task<json::value> getAnimeStreaming(int id) {
-        return make_api_call("/anime/" + std::to_string(id) + "/streaming","GET");
+        return make_api_call(JikanUrl("/anime").segment(id).path("/streaming"));
     }
     pplx::task<json::value> getAnimeFullById(int id) {
-        return make_api_call("/anime/" + std::to_string(id) + "/full","GET");
+        return make_api_call(JikanUrl("/anime").segment(id).path("/full"));
     }
     pplx::task<json::value> getAnimeSearch(int page = 0,int limit = 0,const std::string& q = "", const std::string& type = "",double score = 0.0,double min_score = 0.0,double max_score = 0.0,const std::string& status = "", const std::string& rating = "",bool sfw = false,const std::string& genres = "", const std::string& genres_exclude = "", const std::string& order_by = "", const std::string& sort = "", const std::string& letter = "", const std::string& producers = "", const std::string& start_date = "", const std::string& end_date = "",bool unapproved = false) {
-        std::map<std::string, std::string> params;
-        if (unapproved) params["unapproved"] = "";
-        if (page > 0) params["page"] = std::to_string(page);
-        if (limit > 0) params["limit"] = std::to_string(limit);
-        if (!q.empty()) params["q"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(q)));
-        if (!type.empty()) params["type"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(type)));
-        if (score > 0) params["score"] = std::to_string(score);
-        if (min_score > 0) params["min_score"] = std::to_string(min_score);
-        if (max_score > 0) params["max_score"] = std::to_string(max_score);
-        if (!status.empty()) params["status"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(status)));
-        if (!rating.empty()) params["rating"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(rating)));
-        if (sfw) params["sfw"] = "";
-        if (!genres.empty()) params["genres"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(genres)));
-        if (!genres_exclude.empty()) params["genres_exclude"] = genres_exclude;
-        if (!order_by.empty()) params["order_by"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(order_by)));
-        if (!sort.empty()) params["sort"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(sort)));
-        if (!letter.empty()) params["letter"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(letter)));
-        if (!producers.empty()) params["producers"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(producers)));
-        if (!start_date.empty()) params["start_date"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(start_date)));
-        if (!end_date.empty()) params["end_date"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(end_date)));
-        std::string url = "/anime" + build_query_params(params);
-        return make_api_call(url, "GET");
+        return make_api_call(JikanUrl("/anime")
+            .flag("unapproved", unapproved)
+            .param("page", page)
+            .param("limit", limit)
+            .param("q", q)
+            .param("type", type)
+            .param("score", score)
+            .param("min_score", min_score)
+            .param("max_score", max_score)
+            .param("status", status)
+            .param("rating", rating)
+            .flag("sfw", sfw)
+            .param("genres", genres)
+            .param("genres_exclude", genres_exclude)
+            .param("order_by", order_by)
+            .param("sort", sort)
+            .param("letter", letter)
+            .param("producers", producers)
+            .param("start_date", start_date)
+            .param("end_date", end_date));
     }
 
     pplx::task<json::value> getCharacterFullById(int id) {
-        return make_api_call("/characters/" + std::to_string(id) + "/full","GET");
+        return make_api_call(JikanUrl("/characters").segment(id).path("/full"));
     }
     pplx::task<json::value> getCharacterById(int id) {
-        return make_api_call("/characters/" + std::to_string(id),"GET");
+        return make_api_call(JikanUrl("/characters").segment(id));
     }
     pplx::task<json::value> getCharacterAnime(int id) {
-        return make_api_call("/characters/" + std::to_string(id) + "/anime","GET");
+        return make_api_call(JikanUrl("/characters").segment(id).path("/anime"));
     }
     pplx::task<json::value> getCharacterManga(int id) {
-        return make_api_call("/characters/" + std::to_string(id) + "/manga","GET");
+        return make_api_call(JikanUrl("/characters").segment(id).path("/manga"));
     }
     pplx::task<json::value> getCharacterVoiceActors(int id) {
-        return make_api_call("/characters/" + std::to_string(id) + "/voices","GET");
+        return make_api_call(JikanUrl("/characters").segment(id).path("/voices"));
     }
     pplx::task<json::value> getCharacterPictures(int id) {
-        return make_api_call("/characters/" + std::to_string(id) + "/pictures","GET");
+        return make_api_call(JikanUrl("/characters").segment(id).path("/pictures"));
     }
     pplx::task<json::value> getCharactersSearch(int page = 0,int limit = 0,const std::string& q = "", const std::string& order_by = "", const std::string& sort = "", const std::string& letter = "") {
-        std::map<std::string, std::string> params;
-        if (page > 0) params["page"] = std::to_string(page);
-        if (limit > 0) params["limit"] = std::to_string(limit);
-        if (!q.empty()) params["q"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(q)));
-        if (!order_by.empty()) params["order_by"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(order_by)));
-        if (!sort.empty()) params["sort"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(sort)));
-        if (!letter.empty()) params["letter"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(letter)));
-        std::string url = "/characters" + build_query_params(params);
-        return make_api_call(url, "GET");
+        return make_api_call(JikanUrl("/characters")
+            .param("page", page)
+            .param("limit", limit)
+            .param("q", q)
+            .param("order_by", order_by)
+            .param("sort", sort)
+            .param("letter", letter));
     }
 
     pplx::task<json::value> getClubsById(int id) {
-        return make_api_call("/clubs/" + std::to_string(id),"GET");
+        return make_api_call(JikanUrl("/clubs").segment(id));
     }
     pplx::task<json::value> getClubMembers(int id) {
-        return make_api_call("/clubs/" + std::to_string(id) + "/members","GET");
+        return make_api_call(JikanUrl("/clubs").segment(id).path("/members"));
     }
     pplx::task<json::value> getClubStaff(int id) {
-        return make_api_call("/clubs/" + std::to_string(id) + "/staff","GET");
+        return make_api_call(JikanUrl("/clubs").segment(id).path("/staff"));
     }
     pplx::task<json::value> getClubRelations(int id) {
-        return make_api_call("/clubs/" + std::to_string(id) + "/relations","GET");
-    }
-    pplx::task<json::value> getCharactersSearch(int page = 0,int limit = 0,const std::string& q = "",const std::string& type = "", const std::string& category = "", const std::string& order_by = "", const std::string& sort = "", const std::string& letter = "") {
-        std::map<std::string, std::string> params;
-        if (page > 0) params["page"] = std::to_string(page);
-        if (limit > 0) params["limit"] = std::to_string(limit);
-        if (!q.empty()) params["q"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(q)));
-        if (!type.empty()) params["type"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(type)));
-        if (!category.empty()) params["category"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(category)));
-        if (!order_by.empty()) params["order_by"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(order_by)));
-        if (!sort.empty()) params["sort"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(sort)));
-        if (!letter.empty()) params["letter"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(letter)));
-        std::string url = "/clubs" + build_query_params(params);
-        return make_api_call(url, "GET");
+        return make_api_call(JikanUrl("/clubs").segment(id).path("/relations"));
+    }
+    pplx::task<json::value> getClubsSearch(int page = 0,int limit = 0,const std::string& q = "",const std::string& type = "", const std::string& category = "", const std::string& order_by = "", const std::string& sort = "", const std::string& letter = "") {
+        return make_api_call(JikanUrl("/clubs")
+            .param("page", page)
+            .param("limit", limit)
+            .param("q", q)
+            .param("type", type)
+            .param("category", category)
+            .param("order_by", order_by)
+            .param("sort", sort)
+            .param("letter", letter));
     }
     pplx::task<json::value> getAnimeGenres(const std::string& filter="") {
-        std::map<std::string, std::string> params;
-        if (!filter.empty()) params["filter"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(filter)));
-        return make_api_call("/genres/anime" + build_query_params(params),"GET");
+        return make_api_call(JikanUrl("/genres/anime")
+            .param("filter", filter));
     }
     pplx::task<json::value> getMangaGenres(const std::string& filter="") {
-        std::map<std::string, std::string> params;
-        if (!filter.empty()) params["filter"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(filter)));
-        return make_api_call("/genres/manga" + build_query_params(params),"GET");
+        return make_api_call(JikanUrl("/genres/manga")
+            .param("filter", filter));
     }
     pplx::task<json::value> getMagazines(int page = 0,int limit = 0,const std::string& q = "", const std::string& order_by = "", const std::string& sort = "", const std::string& letter = "") {
-        std::map<std::string, std::string> params;
-        if (page > 0) params["page"] = std::to_string(page);
-        if (limit > 0) params["limit"] = std::to_string(limit);
-        if (!q.empty()) params["q"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(q)));
-        if (!order_by.empty()) params["order_by"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(order_by)));
-        if (!sort.empty()) params["sort"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(sort)));
-        if (!letter.empty()) params["letter"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(letter)));
-        std::string url = "/magazines" + build_query_params(params);
-        return make_api_call(url, "GET");
+        return make_api_call(JikanUrl("/magazines")
+            .param("page", page)
+            .param("limit", limit)
+            .param("q", q)
+            .param("order_by", order_by)
+            .param("sort", sort)
+            .param("letter", letter));
     }
 
     pplx::task<json::value> getMangaFullById(int id) {
-        return make_api_call("/manga/" + std::to_string(id) + "/full","GET");
+        return make_api_call(JikanUrl("/manga").segment(id).path("/full"));
     }
 
     pplx::task<json::value> getMangaById(int id) {
-        return make_api_call("/manga/" + std::to_string(id),"GET");
+        return make_api_call(JikanUrl("/manga").segment(id));
     }
 
     pplx::task<json::value> getMangaCharacters(int id) {
-        return make_api_call("/manga/" + std::to_string(id) + "/characters","GET");
+        return make_api_call(JikanUrl("/manga").segment(id).path("/characters"));
     }
     pplx::task<json::value> getMangaNews(int id) {
-        return make_api_call("/manga/" + std::to_string(id) + "/news","GET");
+        return make_api_call(JikanUrl("/manga").segment(id).path("/news"));
     }
     pplx::task<json::value> getMangaTopics(int id) {
-        return make_api_call("/mannga/" + std::to_string(id) + "/forum","GET");
+        return make_api_call(JikanUrl("/manga").segment(id).path("/forum"));
     }
     pplx::task<json::value> getMangaPictures(int id) {
-        return make_api_call("/manga/" + std::to_string(id) + "/pictures","GET");
+        return make_api_call(JikanUrl("/manga").segment(id).path("/pictures"));
     }
     pplx::task<json::value> getMangaStatistics(int id) {
-        return make_api_call("/manga/" + std::to_string(id) + "/statistics","GET");
+        return make_api_call(JikanUrl("/manga").segment(id).path("/statistics"));
     }
     pplx::task<json::value> getMangaMoreInfo(int id) {
-        return make_api_call("/manga/" + std::to_string(id) + "/moreinfo","GET");
+        return make_api_call(JikanUrl("/manga").segment(id).path("/moreinfo"));
     }
     pplx::task<json::value> getMangaRecommendations(int id) {
-        return make_api_call("/manga/" + std::to_string(id) + "/recommendations","GET");
+        return make_api_call(JikanUrl("/manga").segment(id).path("/recommendations"));
     }
     pplx::task<json::value> getMangaUserUpdates(int id) {
-        return make_api_call("/manga/" + std::to_string(id) + "/userupdates","GET");
+        return make_api_call(JikanUrl("/manga").segment(id).path("/userupdates"));
     }
     pplx::task<json::value> getMangaReviews(int id) {
-        return make_api_call("/manga/" + std::to_string(id) + "/reviews","GET");
+        return make_api_call(JikanUrl("/manga").segment(id).path("/reviews"));
     }
     pplx::task<json::value> getMangaRelations(int id) {
-        return make_api_call("/manga/" + std::to_string(id) + "/relations","GET");
+        return make_api_call(JikanUrl("/manga").segment(id).path("/relations"));
     }
     pplx::task<json::value> getMangaExternal(int id) {
-        return make_api_call("/manga/" + std::to_string(id) + "/external","GET");
+        return make_api_call(JikanUrl("/manga").segment(id).path("/external"));
     }
     pplx::task<json::value> getMangaSearch(int page = 0,int limit = 0,const std::string& q = "", const std::string& type = "",double score = 0.0,double min_score = 0.0,double max_score = 0.0,const std::string& status = "",bool sfw = false,const std::string& genres = "", const std::string& genres_exclude = "", const std::string& order_by = "", const std::string& sort = "", const std::string& letter = "", const std::string& magazines = "", const std::string& start_date = "", const std::string& end_date = "",bool unapproved = false) {
-        std::map<std::string, std::string> params;
-        if (unapproved) params["unapproved"] = "";
-        if (page > 0) params["page"] = std::to_string(page);
-        if (limit > 0) params["limit"] = std::to_string(limit);
-        if (!q.empty()) params["q"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(q)));
-        if (!type.empty()) params["type"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(type)));
-        if (score > 0) params["score"] = std::to_string(score);
-        if (min_score > 0) params["min_score"] = std::to_string(min_score);
-        if (max_score > 0) params["max_score"] = std::to_string(max_score);
-        if (!status.empty()) params["status"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(status)));
-        if (sfw) params["sfw"] = "";
-        if (!genres.empty()) params["genres"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(genres)));
-        if (!genres_exclude.empty()) params["genres_exclude"] = genres_exclude;
-        if (!order_by.empty()) params["order_by"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(order_by)));
-        if (!sort.empty()) params["sort"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(sort)));
-        if (!letter.empty()) params["letter"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(letter)));
-        if (!magazines.empty()) params["magazines"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(magazines)));
-        if (!start_date.empty()) params["start_date"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(start_date)));
-        if (!end_date.empty()) params["end_date"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(end_date)));
-        std::string url = "/manga" + build_query_params(params);
-        return make_api_call(url, "GET");
+        return make_api_call(JikanUrl("/manga")
+            .flag("unapproved", unapproved)
+            .param("page", page)
+            .param("limit", limit)
+            .param("q", q)
+            .param("type", type)
+            .param("score", score)
+            .param("min_score", min_score)
+            .param("max_score", max_score)
+            .param("status", status)
+            .flag("sfw", sfw)
+            .param("genres", genres)
+            .param("genres_exclude", genres_exclude)
+            .param("order_by", order_by)
+            .param("sort", sort)
+            .param("letter", letter)
+            .param("magazines", magazines)
+            .param("start_date", start_date)
+            .param("end_date", end_date));
     }
     pplx::task<json::value> getPeopleSearch(int page = 0,int limit = 0,const std::string& q = "", const std::string& order_by = "", const std::string& sort = "", const std::string& letter = "") {
-        std::map<std::string, std::string> params;
-        if (page > 0) params["page"] = std::to_string(page);
-        if (limit > 0) params["limit"] = std::to_string(limit);
-        if (!q.empty()) params["q"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(q)));
-        if (!order_by.empty()) params["order_by"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(order_by)));
-        if (!sort.empty()) params["sort"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(sort)));
-        if (!letter.empty()) params["letter"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(letter)));
-        std::string url = "/people" + build_query_params(params);
-        return make_api_call(url, "GET");
+        return make_api_call(JikanUrl("/people")
+            .param("page", page)
+            .param("limit", limit)
+            .param("q", q)
+            .param("order_by", order_by)
+            .param("sort", sort)
+            .param("letter", letter));
     }
     pplx::task<json::value> getPersonFullById(int id) {
-        return make_api_call("/people/" + std::to_string(id) + "/full","GET");
+        return make_api_call(JikanUrl("/people").segment(id).path("/full"));
     }
     pplx::task<json::value> getPersonById(int id) {
-        return make_api_call("/people/" + std::to_string(id),"GET");
+        return make_api_call(JikanUrl("/people").segment(id));
     }
     pplx::task<json::value> getPersonAnime(int id) {
-        return make_api_call("/people/" + std::to_string(id) + "/anime","GET");
+        return make_api_call(JikanUrl("/people").segment(id).path("/anime"));
     }
     pplx::task<json::value> getPersonManga(int id) {
-        return make_api_call("/people/" + std::to_string(id) + "/manga","GET");
+        return make_api_call(JikanUrl("/people").segment(id).path("/manga"));
     }
     pplx::task<json::value> getPersonVoices(int id) {
-        return make_api_call("/people/" + std::to_string(id) + "/voices","GET");
+        return make_api_call(JikanUrl("/people").segment(id).path("/voices"));
     }
     pplx::task<json::value> getPersonPictures(int id) {
-        return make_api_call("/people/" + std::to_string(id) + "/pictures","GET");
+        return make_api_call(JikanUrl("/people").segment(id).path("/pictures"));
     }
     pplx::task<json::value> getProducers(int page = 0,int limit = 0,const std::string& q = "", const std::string& order_by = "", const std::string& sort = "", const std::string& letter = "") {
-        std::map<std::string, std::string> params;
-        if (page > 0) params["page"] = std::to_string(page);
-        if (limit > 0) params["limit"] = std::to_string(limit);
-        if (!q.empty()) params["q"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(q)));
-        if (!order_by.empty()) params["order_by"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(order_by)));
-        if (!sort.empty()) params["sort"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(sort)));
-        if (!letter.empty()) params["letter"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(letter)));
-        std::string url = "/producers" + build_query_params(params);
-        return make_api_call(url, "GET");
+        return make_api_call(JikanUrl("/producers")
+            .param("page", page)
+            .param("limit", limit)
+            .param("q", q)
+            .param("order_by", order_by)
+            .param("sort", sort)
+            .param("letter", letter));
     }
     pplx::task<json::value> getProducerFullById(int id) {
-        return make_api_call("/producers/" + std::to_string(id) + "/full","GET");
+        return make_api_call(JikanUrl("/producers").segment(id).path("/full"));
     }
     pplx::task<json::value> getProducerById(int id) {
-        return make_api_call("/producers/" + std::to_string(id),"GET");
+        return make_api_call(JikanUrl("/producers").segment(id));
     }
     pplx::task<json::value> getProducerExternal(int id) {
-        return make_api_call("/producers/" + std::to_string(id) + "/external","GET");
+        return make_api_call(JikanUrl("/producers").segment(id).path("/external"));
     }
     pplx::task<json::value> getRandomAnime() {
-        return make_api_call("/random/anime","GET");
+        return make_api_call(JikanUrl("/random/anime"));
     }
     pplx::task<json::value> getRandomManga() {
-        return make_api_call("/random/manga","GET");
+        return make_api_call(JikanUrl("/random/manga"));
     }
     pplx::task<json::value> getRandomCharacters() {
-        return make_api_call("/random/characters","GET");
+        return make_api_call(JikanUrl("/random/characters"));
     }
     pplx::task<json::value> getRandomPeople() {
-        return make_api_call("/random/people","GET");
+        return make_api_call(JikanUrl("/random/people"));
     }
     pplx::task<json::value> getRandomUsers() {
-        return make_api_call("/random/users","GET");
+        return make_api_call(JikanUrl("/random/users"));
     }
 
     pplx::task<json::value> getRecentAnimeRecommendations(int page=1) {
-        return make_api_call("/recommendations/anime?page=" + std::to_string(page),"GET");
+        return make_api_call(JikanUrl("/recommendations/anime").param("page", page));
     }
     pplx::task<json::value> getRecentMangaRecommendations(int page=1) {
-        return make_api_call("/recommendations/manga?page=" + std::to_string(page),"GET");
+        return make_api_call(JikanUrl("/recommendations/manga").param("page", page));
     }
     pplx::task<json::value> getRecentAnimeReviews(int page=1,bool preliminary=true,bool spoilers=true) {
-        return make_api_call("/reviews/anime?page=" + std::to_string(page) + "&preliminary=" + preliminary + "&spoilers=" + spoilers,"GET");
+        return make_api_call(JikanUrl("/reviews/anime")
+            .param("page", page)
+            .boolean("preliminary", preliminary)
+            .boolean("spoilers", spoilers));
     }
-    pplx::task<json::value> getRecentMangaReviews(int page) {
-        return make_api_call("/reviews/manga?page=" + std::to_string(page) + "&preliminary=" + preliminary + "&spoilers=" + spoilers,"GET");
+    pplx::task<json::value> getRecentMangaReviews(int page=1,bool preliminary=true,bool spoilers=true) {
+        return make_api_call(JikanUrl("/reviews/manga")
+            .param("page", page)
+            .boolean("preliminary", preliminary)
+            .boolean("spoilers", spoilers));
     }
     pplx::task<json::value> getSchedules(int page = 0,int limit = 0,const std::string& filter = "", bool sfw=false,bool kids=false,bool unapproved=false) {
-        std::map<std::string, std::string> params;
-        if (page > 0) params["page"] = std::to_string(page);
-        if (limit > 0) params["limit"] = std::to_string(limit);
-        if (!filter.empty()) params["filter"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(filter)));
-        if (kids) params["kids"] = "true";
-        if (sfw) params["sfw"] = "";
-        if (unapproved) params["unapproved"] = "";
-        std::string url = "/schedules" + build_query_params(params);
-        return make_api_call(url, "GET");
+        return make_api_call(JikanUrl("/schedules")
+            .param("page", page)
+            .param("limit", limit)
+            .param("filter", filter)
+            .flag("kids", kids)
+            .flag("sfw", sfw)
+            .flag("unapproved", unapproved));
     }
     pplx::task<json::value> getUsersSearch(int page = 0,int limit = 0,const std::string& q = "", const std::string& gender = "", const std::string& location = "",int maxAge=0,int minAge=0) {
-        std::map<std::string, std::string> params;
-        if (page > 0) params["page"] = std::to_string(page);
-        if (limit > 0) params["limit"] = std::to_string(limit);
-        if (!q.empty()) params["q"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(q)));
-        if (!gender.empty()) params["gender"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(gender)));
-        if (!location.empty()) params["location"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(location)));
-        if (maxAge > 0) params["maxAge"] = std::to_string(maxAge);
-        if (minAge > 0) params["minAge"] = std::to_string(minAge);
-        std::string url = "/users" + build_query_params(params);
-        return make_api_call(url, "GET");
+        return make_api_call(JikanUrl("/users")
+            .param("page", page)
+            .param("limit", limit)
+            .param("q", q)
+            .param("gender", gender)
+            .param("location", location)
+            .param("maxAge", maxAge)
+            .param("minAge", minAge));
     }
     pplx::task<json::value> getUserById(int id) {
-        return make_api_call("/users/userbyid/" + std::to_string(id),"GET");
+        return make_api_call(JikanUrl("/users/userbyid").segment(id));
     }
     pplx::task<json::value> getUserFullProfile(const std::string& username) {
-        return make_api_call("/users/" + utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(username))) + "/full","GET");
+        return make_api_call(JikanUrl("/users").segment(username).path("/full"));
     }
     pplx::task<json::value> getUserProfile(const std::string& username) {
-        return make_api_call("/users/" + utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(username))),"GET");
+        return make_api_call(JikanUrl("/users").segment(username));
     }
     pplx::task<json::value> getUserStatistics(const std::string& username) {
-        return make_api_call("/users/" + utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(username))) + "/statistics","GET");
+        return make_api_call(JikanUrl("/users").segment(username).path("/statistics"));
     }
     pplx::task<json::value> getUserFavorites(const std::string& username) {
-        return make_api_call("/users/" + utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(username))) + "/favorites","GET");
+        return make_api_call(JikanUrl("/users").segment(username).path("/favorites"));
     }
     pplx::task<json::value> getUserUpdates(const std::string& username) {
-        return make_api_call("/users/" + utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(username))) + "/userupdates","GET");
+        return make_api_call(JikanUrl("/users").segment(username).path("/userupdates"));
     }
     pplx::task<json::value> getUserAbout(const std::string& username) {
-        return make_api_call("/users/" + utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(username))) + "/about","GET");
+        return make_api_call(JikanUrl("/users").segment(username).path("/about"));
     }
     pplx::task<json::value> getUserHistory(const std::string& username) {
-        return make_api_call("/users/" + utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(username))) + "/history","GET");
+        return make_api_call(JikanUrl("/users").segment(username).path("/history"));
     }
-    pplx::task<json::value> getUserFriends(const std::string& username) {
-        return make_api_call("/users/" + utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(username))) + "/friends","GET");
+    pplx::task<json::value> getUserFriends(const std::string& username, int page = 0) {
+        return make_api_call(JikanUrl("/users").segment(username).path("/friends").param("page", page));
     }
-    pplx::task<json::value> getUserReviews(const std::string& username) {
-        return make_api_call("/users/" + utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(username))) + "/reviews","GET");
+    pplx::task<json::value> getUserReviews(const std::string& username, int page = 0) {
+        return make_api_call(JikanUrl("/users").segment(username).path("/reviews").param("page", page));
     }
     pplx::task<json::value> getUserRecommendations(const std::string& username) {
-        return make_api_call("/users/" + utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(username))) + "/recommendations","GET");
+        return make_api_call(JikanUrl("/users").segment(username).path("/recommendations"));
     }
-    pplx::task<json::value> getUserClubs(const std::string& username) {
-        return make_api_call("/users/" + utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(username))) + "/clubs","GET");
+    pplx::task<json::value> getUserClubs(const std::string& username, int page = 0) {
+        return make_api_call(JikanUrl("/users").segment(username).path("/clubs").param("page", page));
     }
     pplx::task<json::value> getUserExternal(const std::string& username) {
-        return make_api_call("/users/" + utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(username))) + "/external","GET");
+        return make_api_call(JikanUrl("/users").segment(username).path("/external"));
     }
 /// User Anime lists and User Manga lists have been discontinued since May 1st, 2022. https://docs.google.com/document/d/1-6H-agSnqa8Mfmw802UYfGQrceIEnAaEh4uCXAPiX5A
-    pplx::task<json::value> getUserAnimelist(const std::string& username) {
-        return make_api_call("/users/" + utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(username))) + "/animelist","GET");
+    pplx::task<json::value> getUserAnimelist(const std::string& username, int page = 0) {
+        return make_api_call(JikanUrl("/users").segment(username).path("/animelist").param("page", page));
     }
-    pplx::task<json::value> getUserMangaList(const std::string& username) {
-        return make_api_call("/users/" + utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(username))) + "/mangalist","GET");
+    pplx::task<json::value> getUserMangaList(const std::string& username, int page = 0) {
+        return make_api_call(JikanUrl("/users").segment(username).path("/mangalist").param("page", page));
     }
 
     pplx::task<json::value> getSeasonNow(int page = 0,int limit = 0,const std::string& filter = "", bool sfw=false,bool continuing=false,bool unapproved=false) {
-        std::map<std::string, std::string> params;
-        if (page > 0) params["page"] = std::to_string(page);
-        if (limit > 0) params["limit"] = std::to_string(limit);
-        if (!filter.empty()) params["filter"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(filter)));
-        if (continuing) params["continuing"] = "";
-        if (sfw) params["sfw"] = "";
-        if (unapproved) params["unapproved"] = "";
-        std::string url = "/seasons/now" + build_query_params(params);
-        return make_api_call(url, "GET");
+        return make_api_call(JikanUrl("/seasons/now")
+            .param("page", page)
+            .param("limit", limit)
+            .param("filter", filter)
+            .flag("continuing", continuing)
+            .flag("sfw", sfw)
+            .flag("unapproved", unapproved));
     }
 
     pplx::task<json::value> getSeason(int year= 0,int season= 0,int page = 0,int limit = 0,const std::string& filter = "", bool sfw=false,bool continuing=false,bool unapproved=false) {
-        std::map<std::string, std::string> params;
-        if (year > 0) params["year"] = std::to_string(year);
-        if (season > 0) params["season"] = std::to_string(season);
-        if (page > 0) params["page"] = std::to_string(page);
-        if (limit > 0) params["limit"] = std::to_string(limit);
-        if (!filter.empty()) params["filter"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(filter)));
-        if (continuing) params["continuing"] = "";
-        if (sfw) params["sfw"] = "";
-        if (unapproved) params["unapproved"] = "";
-        std::string url = "/seasons/" + std::to_string(year) + "/" + std::to_string(season) + build_query_params(params);
-        return make_api_call(url, "GET");
+        return make_api_call(JikanUrl("/seasons")
+            .segment(year)
+            .segment(season)
+            .param("page", page)
+            .param("limit", limit)
+            .param("filter", filter)
+            .flag("continuing", continuing)
+            .flag("sfw", sfw)
+            .flag("unapproved", unapproved));
     }
 
     pplx::task<json::value> getSeasonsList() {
-        return make_api_call("/seasons", "GET");
+        return make_api_call(JikanUrl("/seasons"));
     }
 
     pplx::task<json::value> getSeasonUpcoming(int page = 0,int limit = 0,const std::string& filter = "", bool sfw=false,bool continuing=false,bool unapproved=false) {
-        std::map<std::string, std::string> params;
-        if (page > 0) params["page"] = std::to_string(page);
-        if (limit > 0) params["limit"] = std::to_string(limit);
-        if (!filter.empty()) params["filter"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(filter)));
-        if (continuing) params["continuing"] = "";
-        if (sfw) params["sfw"] = "";
-        if (unapproved) params["unapproved"] = "";
-        std::string url = "/seasons/upcoming" + build_query_params(params);
-        return make_api_call(url, "GET");
-    }
-    pplx::task<json::value> getAnimeSearch(int page = 0,int limit = 0,const std::string& q = "", const std::string& type = "",const std::string& filter = "", const std::string& rating = "",bool sfw = false) {
-        std::map<std::string, std::string> params;
-        if (page > 0) params["page"] = std::to_string(page);
-        if (limit > 0) params["limit"] = std::to_string(limit);
-        if (!type.empty()) params["type"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(type)));
-        if (!filter.empty()) params["filter"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(filter)));
-        if (!rating.empty()) params["rating"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(rating)));
-        if (sfw) params["sfw"] = "";
-        std::string url = "/top/anime"+ build_query_params(params);
-        return make_api_call(url, "GET");
+        return make_api_call(JikanUrl("/seasons/upcoming")
+            .param("page", page)
+            .param("limit", limit)
+            .param("filter", filter)
+            .flag("continuing", continuing)
+            .flag("sfw", sfw)
+            .flag("unapproved", unapproved));
+    }
+    pplx::task<json::value> getTopAnime(int page = 0,int limit = 0,const std::string& q = "", const std::string& type = "",const std::string& filter = "", const std::string& rating = "",bool sfw = false) {
+        return make_api_call(JikanUrl("/top/anime")
+            .param("page", page)
+            .param("limit", limit)
+            .param("type", type)
+            .param("filter", filter)
+            .param("rating", rating)
+            .flag("sfw", sfw));
     }
     pplx::task<json::value> getTopManga(int page = 0,int limit = 0,const std::string& q = "", const std::string& type = "",const std::string& filter = "") {
-        std::map<std::string, std::string> params;
-        if (page > 0) params["page"] = std::to_string(page);
-        if (limit > 0) params["limit"] = std::to_string(limit);
-        if (!type.empty()) params["type"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(type)));
-        if (!filter.empty()) params["filter"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(filter)));
-        std::string url = "/top/manga"+ build_query_params(params);
-        return make_api_call(url, "GET");
+        return make_api_call(JikanUrl("/top/manga")
+            .param("page", page)
+            .param("limit", limit)
+            .param("type", type)
+            .param("filter", filter));
     }
     pplx::task<json::value> getTopPeople(int page = 0,int limit = 0) {
-        std::map<std::string, std::string> params;
-        if (page > 0) params["page"] = std::to_string(page);
-        if (limit > 0) params["limit"] = std::to_string(limit);
-        std::string url = "/top/people"+ build_query_params(params);
-        return make_api_call(url, "GET");
+        return make_api_call(JikanUrl("/top/people")
+            .param("page", page)
+            .param("limit", limit));
     }
     pplx::task<json::value> getTopCharacters(int page = 0,int limit = 0) {
-        std::map<std::string, std::string> params;
-        if (page > 0) params["page"] = std::to_string(page);
-        if (limit > 0) params["limit"] = std::to_string(limit);
-        std::string url = "/top/characters";
-        return make_api_call(url, "GET");
+        return make_api_call(JikanUrl("/top/characters")
+            .param("page", page)
+            .param("limit", limit));
     }
     pplx::task<json::value> getTopReviews(int page = 0,int limit = 0,const std::string& q = "", const std::string& type = "",bool preliminary = false,bool spoilers = false) {
-        std::map<std::string, std::string> params;
-        if (page > 0) params["page"] = std::to_string(page);
-        if (limit > 0) params["limit"] = std::to_string(limit);
-        if (!type.empty()) params["type"] = utility::conversions::to_utf8string(web::uri::encode_data_string(utility::conversions::to_string_t(type)));
-        if (preliminary) params["preliminary"] = preliminary;
-        if (spoilers) params["spoilers"] = spoilers;
-        std::string url = "/top/reviews"+ build_query_params(params);
-        return make_api_call(url, "GET");
+        return make_api_call(JikanUrl("/top/reviews")
+            .param("page", page)
+            .param("limit", limit)
+            .param("type", type)
+            .boolean("preliminary", preliminary)
+            .boolean("spoilers", spoilers));
     }
     pplx::task<json::value> getWatchRecentPromos(int page = 0) {
-        std::map<std::string, std::string> params;
-        if (page > 0) params["page"] = std::to_string(page);
-        std::string url = "/watch/promos"+ build_query_params(params);
-        return make_api_call(url, "GET");
+        return make_api_call(JikanUrl("/watch/promos")
+            .param("page", page));
     }
     pplx::task<json::value> getWatchPopularPromos() {
-        return make_api_call("/watch/promos/popular","GET");
+        return make_api_call(JikanUrl("/watch/promos/popular"));
     }
     pplx::task<json::value> getWatchPopularEpisodes() {
-        return make_api_call("/watch/episodes/popular","GET");
+        return make_api_call(JikanUrl("/watch/episodes/popular"));
     }
     pplx::task<json::value> getWatchRecentEpisodes() {
-        return make_api_call("/watch/episodes","GET");
+        return make_api_call(JikanUrl("/watch/episodes"));
+    }
+
+    // Typed getters decode the response bytes into plain structs without building a json::value;
+    // fields is a mask of the struct's Field values, anything else is skipped while parsing
+    pplx::task<JikanResult<JikanAnime>> getAnimeByIdTyped(int id, uint64_t fields = JikanAnime::All) {
+        return make_typed_call<JikanAnime>(JikanUrl("/anime").segment(id), fields);
+    }
+    pplx::task<JikanResult<JikanAnime>> getAnimeFullByIdTyped(int id, uint64_t fields = JikanAnime::All) {
+        return make_typed_call<JikanAnime>(JikanUrl("/anime").segment(id).path("/full"), fields);
+    }
+    pplx::task<JikanResult<JikanManga>> getMangaByIdTyped(int id, uint64_t fields = JikanManga::All) {
+        return make_typed_call<JikanManga>(JikanUrl("/manga").segment(id), fields);
+    }
+    pplx::task<JikanResult<JikanManga>> getMangaFullByIdTyped(int id, uint64_t fields = JikanManga::All) {
+        return make_typed_call<JikanManga>(JikanUrl("/manga").segment(id).path("/full"), fields);
+    }
+    pplx::task<JikanResult<JikanCharacter>> getCharacterByIdTyped(int id, uint64_t fields = JikanCharacter::All) {
+        return make_typed_call<JikanCharacter>(JikanUrl("/characters").segment(id), fields);
+    }
+    pplx::task<JikanResult<JikanPerson>> getPersonByIdTyped(int id, uint64_t fields = JikanPerson::All) {
+        return make_typed_call<JikanPerson>(JikanUrl("/people").segment(id), fields);
+    }
+    pplx::task<JikanPage<JikanAnime>> getAnimeSearchTyped(int page = 0,int limit = 0,const std::string& q = "", uint64_t fields = JikanAnime::All) {
+        return make_typed_page_call<JikanAnime>(JikanUrl("/anime")
+            .param("page", page)
+            .param("limit", limit)
+            .param("q", q), fields);
+    }
+    pplx::task<JikanPage<JikanManga>> getMangaSearchTyped(int page = 0,int limit = 0,const std::string& q = "", uint64_t fields = JikanManga::All) {
+        return make_typed_page_call<JikanManga>(JikanUrl("/manga")
+            .param("page", page)
+            .param("limit", limit)
+            .param("q", q), fields);
+    }
+    pplx::task<JikanPage<JikanCharacter>> getCharactersSearchTyped(int page = 0,int limit = 0,const std::string& q = "", uint64_t fields = JikanCharacter::All) {
+        return make_typed_page_call<JikanCharacter>(JikanUrl("/characters")
+            .param("page", page)
+            .param("limit", limit)
+            .param("q", q), fields);
+    }
+    pplx::task<JikanPage<JikanPerson>> getPeopleSearchTyped(int page = 0,int limit = 0,const std::string& q = "", uint64_t fields = JikanPerson::All) {
+        return make_typed_page_call<JikanPerson>(JikanUrl("/people")
+            .param("page", page)
+            .param("limit", limit)
+            .param("q", q), fields);
     }
 };
 
@@ -0,0 +1,166 @@
+#ifndef JIKAN_ARENA_H
+#define JIKAN_ARENA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "JikanBuffer.h"
+
+// Monotonic allocator: allocations are bump-pointer carves from large blocks and are only
+// released all together by reset(), which keeps the blocks for the next user.
+// Not synchronized: one thread allocates from an arena at a time.
+class JikanArena {
+private:
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    std::vector<Block> blocks;
+    size_t current = 0;
+    size_t used = 0;
+    size_t next_block_size;
+
+public:
+    explicit JikanArena(size_t first_block_size = 64 * 1024) : next_block_size(first_block_size) {}
+
+    JikanArena(const JikanArena&) = delete;
+    JikanArena& operator=(const JikanArena&) = delete;
+
+    void* allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+        while (current < blocks.size()) {
+            Block& block = blocks[current];
+            size_t offset = (used + align - 1) & ~(align - 1);
+            if (offset + size <= block.size) {
+                used = offset + size;
+                return block.data.get() + offset;
+            }
+            ++current;
+            used = 0;
+        }
+        // Blocks double so a large document needs few of them
+        size_t block_size = std::max(next_block_size, size);
+        next_block_size = block_size * 2;
+        Block block;
+        block.data.reset(new char[block_size]);
+        block.size = block_size;
+        blocks.push_back(std::move(block));
+        current = blocks.size() - 1;
+        // new[] storage is aligned for any fundamental type
+        used = size;
+        return blocks.back().data.get();
+    }
+
+    template <typename T>
+    T* allocate_array(size_t count) {
+        return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    char* copy(const char* data, size_t size) {
+        char* out = static_cast<char*>(allocate(size, 1));
+        if (size > 0) std::copy(data, data + size, out);
+        return out;
+    }
+
+    void reset() {
+        current = 0;
+        used = 0;
+    }
+
+    size_t capacity() const {
+        size_t total = 0;
+        for (const auto& block : blocks) total += block.size;
+        return total;
+    }
+
+    // Keeps the largest block only, for arenas that grew past what the pool retains
+    void shrink() {
+        if (blocks.size() <= 1) return;
+        auto largest = std::max_element(blocks.begin(), blocks.end(), [](const Block& a, const Block& b) {
+            return a.size < b.size;
+        });
+        Block keep = std::move(*largest);
+        blocks.clear();
+        blocks.push_back(std::move(keep));
+        reset();
+    }
+};
+
+// Per-thread free lists of arenas and body strings. Whatever is released goes back to the
+// releasing thread's list, up to a bounded count and size; the rest is freed.
+class JikanArenaPool {
+private:
+    static const size_t max_pooled = 8;
+    static const size_t max_retained_bytes = 8 * 1024 * 1024;
+
+    static std::vector<std::unique_ptr<JikanArena>>& arenas() {
+        static thread_local std::vector<std::unique_ptr<JikanArena>> free_list;
+        return free_list;
+    }
+
+    static std::vector<std::string>& bodies() {
+        static thread_local std::vector<std::string> free_list;
+        return free_list;
+    }
+
+    static void release(JikanArena* arena) {
+        std::unique_ptr<JikanArena> owned(arena);
+        owned->reset();
+        if (owned->capacity() > max_retained_bytes) owned->shrink();
+        auto& free_list = arenas();
+        if (free_list.size() < max_pooled && owned->capacity() <= max_retained_bytes) free_list.push_back(std::move(owned));
+    }
+
+public:
+    // An empty arena that returns to the pool when the last reference goes
+    static std::shared_ptr<JikanArena> acquire() {
+        auto& free_list = arenas();
+        JikanArena* arena = nullptr;
+        if (free_list.empty()) {
+            arena = new JikanArena();
+        } else {
+            arena = free_list.back().release();
+            free_list.pop_back();
+        }
+        return std::shared_ptr<JikanArena>(arena, &JikanArenaPool::release);
+    }
+
+    // An empty string, with capacity left over from an earlier body when one is pooled
+    static std::string acquire_body() {
+        auto& free_list = bodies();
+        if (free_list.empty()) return std::string();
+        std::string body = std::move(free_list.back());
+        free_list.pop_back();
+        body.clear();
+        return body;
+    }
+
+    static void release_body(std::string body) {
+        auto& free_list = bodies();
+        if (free_list.size() < max_pooled && body.capacity() <= max_retained_bytes) free_list.push_back(std::move(body));
+    }
+
+    // Wraps a body so its storage is handed back to the pool once every copy of the buffer is gone.
+    // A body much smaller than the capacity it inherited is copied out and the large string goes
+    // straight back, so a buffer kept for long (e.g. by the cache) holds about its own size.
+    static JikanBuffer buffer(std::string body) {
+        if (body.capacity() > body.size() + body.size() / 4 + 4096) {
+            std::string tight(body.data(), body.size());
+            release_body(std::move(body));
+            body = std::move(tight);
+        }
+        std::string* storage = new std::string(std::move(body));
+        std::shared_ptr<const void> owner(storage, [](std::string* owned) {
+            release_body(std::move(*owned));
+            delete owned;
+        });
+        return JikanBuffer(owner, storage->data(), storage->size());
+    }
+};
+
+#endif
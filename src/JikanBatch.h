@@ -0,0 +1,158 @@
+#ifndef JIKAN_BATCH_H
+#define JIKAN_BATCH_H
+
+#include <cpprest/json.h>
+#include <pplx/pplx.h>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// By-id endpoints that can be fetched in bulk
+enum class JikanEndpointKind {
+    Anime,
+    AnimeFull,
+    AnimeCharacters,
+    AnimeStaff,
+    AnimeRelations,
+    Manga,
+    MangaFull,
+    MangaCharacters,
+    Character,
+    CharacterFull,
+    CharacterVoiceActors,
+    Person,
+    PersonFull,
+    PersonAnime,
+    Producer,
+    ProducerFull,
+    Club
+};
+
+struct JikanBatchFailure {
+    size_t index;
+    int id;
+    web::json::value error;
+};
+
+struct JikanBatchResult {
+    // One entry per requested id in input order, null where the request failed
+    std::vector<web::json::value> results;
+    std::vector<JikanBatchFailure> failures;
+};
+
+// Called once per id as soon as its request finishes; calls are serialized
+typedef std::function<void(size_t index, int id, const web::json::value& result, bool ok)> JikanBatchCallback;
+
+class JikanBatch {
+private:
+    struct State {
+        std::vector<int> ids;
+        std::function<pplx::task<web::json::value>(int)> fetch;
+        JikanBatchCallback on_result;
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> remaining{0};
+        std::mutex callback_mutex;
+        std::exception_ptr callback_error;
+        pplx::task_completion_event<void> done;
+    };
+
+    // Hands one result to the callback; true when the slot it frees should start the next id
+    static bool complete(const std::shared_ptr<State>& state, size_t index, const web::json::value& result, bool ok) {
+        {
+            std::lock_guard<std::mutex> lock(state->callback_mutex);
+            try {
+                if (!state->callback_error) state->on_result(index, state->ids[index], result, ok);
+            } catch (...) {
+                state->callback_error = std::current_exception();
+            }
+        }
+        if (--state->remaining == 0) {
+            if (state->callback_error) {
+                state->done.set_exception(state->callback_error);
+            } else {
+                state->done.set();
+            }
+            return false;
+        }
+        return true;
+    }
+
+    // Starts the next id on one slot. An id whose fetch throws straight away is completed here and
+    // the loop goes on with the next, so a long run of them does not recurse once per id.
+    static void launch(const std::shared_ptr<State>& state) {
+        for (;;) {
+            size_t index = state->next++;
+            if (index >= state->ids.size()) return;
+
+            pplx::task<web::json::value> request;
+            try {
+                request = state->fetch(state->ids[index]);
+            } catch (const std::exception& e) {
+                if (!complete(state, index, error_object(e.what()), false)) return;
+                continue;
+            }
+            request.then([state, index](pplx::task<web::json::value> previousTask) {
+                web::json::value result;
+                bool ok = false;
+                try {
+                    result = previousTask.get();
+                    ok = !result.has_field(U("error"));
+                } catch (const std::exception& e) {
+                    result = error_object(e.what());
+                }
+                if (complete(state, index, result, ok)) launch(state);
+            });
+            return;
+        }
+    }
+
+    static web::json::value error_object(const char* what) {
+        web::json::value error_obj;
+        error_obj[U("error")] = web::json::value::string(U("Exception: ") + utility::conversions::to_string_t(what));
+        error_obj[U("success")] = web::json::value::boolean(false);
+        return error_obj;
+    }
+
+public:
+    // Fetches every id with at most max_in_flight requests outstanding and streams results to on_result
+    static pplx::task<void> run(const std::vector<int>& ids, size_t max_in_flight,
+                                std::function<pplx::task<web::json::value>(int)> fetch, JikanBatchCallback on_result) {
+        auto state = std::make_shared<State>();
+        state->ids = ids;
+        state->fetch = fetch;
+        state->on_result = on_result;
+        state->remaining = ids.size();
+        if (ids.empty()) return pplx::task_from_result();
+
+        size_t workers = std::max<size_t>(1, std::min(max_in_flight, ids.size()));
+        for (size_t i = 0; i < workers; ++i) launch(state);
+        return pplx::create_task(state->done);
+    }
+
+    // Same as run but gathers everything, results keep the order of ids
+    static pplx::task<JikanBatchResult> collect(const std::vector<int>& ids, size_t max_in_flight,
+                                                std::function<pplx::task<web::json::value>(int)> fetch) {
+        auto result = std::make_shared<JikanBatchResult>();
+        result->results.resize(ids.size());
+        return run(ids, max_in_flight, fetch, [result](size_t index, int id, const web::json::value& value, bool ok) {
+            if (ok) {
+                result->results[index] = value;
+            } else {
+                JikanBatchFailure failure;
+                failure.index = index;
+                failure.id = id;
+                failure.error = value;
+                result->failures.push_back(failure);
+            }
+        }).then([result]() {
+            return *result;
+        });
+    }
+};
+
+#endif
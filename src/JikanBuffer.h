@@ -0,0 +1,61 @@
+#ifndef JIKAN_BUFFER_H
+#define JIKAN_BUFFER_H
+
+#include <cpprest/json.h>
+#include <cstddef>
+#include <istream>
+#include <memory>
+#include <streambuf>
+#include <string>
+
+// Read-only bytes shared by reference count. The owner keeps the storage alive,
+// which is either a std::string or a memory-mapped cache segment.
+class JikanBuffer {
+private:
+    std::shared_ptr<const void> owner;
+    const char* bytes = nullptr;
+    size_t length = 0;
+
+public:
+    JikanBuffer() {}
+
+    explicit JikanBuffer(std::string content) {
+        auto storage = std::make_shared<const std::string>(std::move(content));
+        bytes = storage->data();
+        length = storage->size();
+        owner = storage;
+    }
+
+    JikanBuffer(std::shared_ptr<const void> owner, const char* data, size_t size)
+        : owner(std::move(owner)), bytes(data), length(size) {}
+
+    const char* data() const { return bytes; }
+    size_t size() const { return length; }
+    bool empty() const { return length == 0; }
+    explicit operator bool() const { return bytes != nullptr; }
+
+    std::string str() const {
+        return std::string(bytes, length);
+    }
+};
+
+// std::istream over a buffer, lets the json parser read it in place
+class JikanBufferStreambuf : public std::streambuf {
+public:
+    explicit JikanBufferStreambuf(const JikanBuffer& buffer) {
+        char* begin = const_cast<char*>(buffer.data());
+        setg(begin, begin, begin + buffer.size());
+    }
+};
+
+inline web::json::value jikan_parse_json(const JikanBuffer& buffer) {
+#ifdef _UTF16_STRINGS
+    return web::json::value::parse(utility::conversions::to_string_t(buffer.str()));
+#else
+    JikanBufferStreambuf streambuf(buffer);
+    std::istream stream(&streambuf);
+    return web::json::value::parse(stream);
+#endif
+}
+
+#endif
@@ -0,0 +1,284 @@
+#ifndef JIKAN_CACHE_H
+#define JIKAN_CACHE_H
+
+#include <cpprest/json.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "JikanBuffer.h"
+
+struct JikanCacheEntry {
+    // Raw response body as received, shared between the cache and every caller
+    JikanBuffer body;
+    // Parsed once on store. Entries from a tier that only keeps bytes come without it and are
+    // parsed on their first use, see JikanCacheStore::keep_parsed
+    std::shared_ptr<const web::json::value> json;
+    utility::string_t etag;
+    utility::string_t last_modified;
+    std::chrono::system_clock::time_point expires;
+
+    bool fresh() const {
+        return std::chrono::system_clock::now() < expires;
+    }
+    bool revalidatable() const {
+        return !etag.empty() || !last_modified.empty();
+    }
+};
+
+// Storage behind the response cache; implementations must be thread safe
+class JikanCacheStore {
+public:
+    virtual ~JikanCacheStore() {}
+    virtual bool get(const std::string& key, JikanCacheEntry& entry) = 0;
+    virtual void put(const std::string& key, const JikanCacheEntry& entry) = 0;
+    virtual void erase(const std::string& key) = 0;
+    virtual void clear() = 0;
+    // Hands back an entry from get whose json was parsed afterwards. Stores that hold the DOM
+    // keep it from now on; the default is for stores that only keep bytes
+    virtual void keep_parsed(const std::string& key, const JikanCacheEntry& entry) {}
+};
+
+class JikanMemoryCache : public JikanCacheStore {
+private:
+    typedef std::list<std::pair<std::string, JikanCacheEntry>> LruList;
+
+    size_t max_bytes;
+    size_t used_bytes = 0;
+    LruList lru;
+    std::unordered_map<std::string, LruList::iterator> index;
+    std::mutex mutex;
+    std::atomic<uint64_t> evicted{0};
+
+    // The parsed DOM is not measured directly, it is counted as twice the body it came from
+    static size_t cost(const std::string& key, const JikanCacheEntry& entry) {
+        size_t body = entry.body.size();
+        return key.size() + body * (entry.json ? 3 : 1) + sizeof(JikanCacheEntry);
+    }
+
+    void remove(LruList::iterator it) {
+        used_bytes -= cost(it->first, it->second);
+        index.erase(it->first);
+        lru.erase(it);
+    }
+
+public:
+    explicit JikanMemoryCache(size_t max_bytes = 64 * 1024 * 1024) : max_bytes(max_bytes) {}
+
+    bool get(const std::string& key, JikanCacheEntry& entry) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = index.find(key);
+        if (it == index.end()) return false;
+        lru.splice(lru.begin(), lru, it->second);
+        entry = it->second->second;
+        return true;
+    }
+
+    void put(const std::string& key, const JikanCacheEntry& entry) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = index.find(key);
+        if (it != index.end()) remove(it->second);
+
+        size_t size = cost(key, entry);
+        if (size > max_bytes) return;
+        while (used_bytes + size > max_bytes && !lru.empty()) {
+            remove(std::prev(lru.end()));
+            ++evicted;
+        }
+        lru.emplace_front(key, entry);
+        index[key] = lru.begin();
+        used_bytes += size;
+    }
+
+    void erase(const std::string& key) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = index.find(key);
+        if (it != index.end()) remove(it->second);
+    }
+
+    void keep_parsed(const std::string& key, const JikanCacheEntry& entry) override {
+        put(key, entry);
+    }
+
+    void clear() override {
+        std::lock_guard<std::mutex> lock(mutex);
+        lru.clear();
+        index.clear();
+        used_bytes = 0;
+    }
+
+    size_t size_bytes() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return used_bytes;
+    }
+
+    uint64_t evictions() const {
+        return evicted.load();
+    }
+};
+
+// Looks in front first, then in back and promotes what it finds; writes go to both
+class JikanTieredCache : public JikanCacheStore {
+private:
+    std::shared_ptr<JikanCacheStore> front;
+    std::shared_ptr<JikanCacheStore> back;
+
+public:
+    JikanTieredCache(std::shared_ptr<JikanCacheStore> front, std::shared_ptr<JikanCacheStore> back)
+        : front(front), back(back) {}
+
+    bool get(const std::string& key, JikanCacheEntry& entry) override {
+        if (front->get(key, entry)) return true;
+        if (!back->get(key, entry)) return false;
+        front->put(key, entry);
+        return true;
+    }
+
+    void put(const std::string& key, const JikanCacheEntry& entry) override {
+        front->put(key, entry);
+        back->put(key, entry);
+    }
+
+    void erase(const std::string& key) override {
+        front->erase(key);
+        back->erase(key);
+    }
+
+    void clear() override {
+        front->clear();
+        back->clear();
+    }
+
+    // The back only keeps bytes, the DOM goes to the front
+    void keep_parsed(const std::string& key, const JikanCacheEntry& entry) override {
+        front->keep_parsed(key, entry);
+    }
+};
+
+// TTL for every endpoint starting with prefix, the longest matching prefix wins. A zero TTL disables caching.
+struct JikanCacheRule {
+    std::string prefix;
+    std::chrono::seconds ttl;
+};
+
+struct JikanCacheConfig {
+    bool enabled = true;
+    size_t max_memory_bytes = 64 * 1024 * 1024;
+    std::chrono::seconds default_ttl = std::chrono::hours(1);
+    std::vector<JikanCacheRule> rules = {
+        {"/genres", std::chrono::hours(24 * 7)},
+        {"/seasons", std::chrono::hours(24 * 3)},
+        {"/seasons/now", std::chrono::hours(6)},
+        {"/seasons/upcoming", std::chrono::hours(6)},
+        {"/schedules", std::chrono::minutes(5)},
+        {"/watch", std::chrono::minutes(10)},
+        {"/random", std::chrono::seconds(0)},
+    };
+};
+
+struct JikanCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t revalidated = 0;
+    uint64_t stores = 0;
+};
+
+class JikanResponseCache {
+private:
+    JikanCacheConfig config;
+    std::shared_ptr<JikanCacheStore> store;
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+    std::atomic<uint64_t> revalidations{0};
+    std::atomic<uint64_t> stores{0};
+
+public:
+    explicit JikanResponseCache(const JikanCacheConfig& config = JikanCacheConfig(),
+                                std::shared_ptr<JikanCacheStore> store = nullptr)
+        : config(config),
+          store(store ? store : std::make_shared<JikanMemoryCache>(config.max_memory_bytes)) {}
+
+    // Query parameters are sorted so that the same request always maps to the same key. The
+    // backend, see JikanTransport::backend, keeps answers from another server from being served
+    static std::string key(const std::string& backend, const std::string& method, const std::string& endpoint) {
+        size_t query_start = endpoint.find('?');
+        if (query_start == std::string::npos) return backend + " " + method + " " + endpoint;
+
+        std::vector<std::string> params;
+        size_t pos = query_start + 1;
+        while (pos <= endpoint.size()) {
+            size_t amp = endpoint.find('&', pos);
+            if (amp == std::string::npos) amp = endpoint.size();
+            if (amp > pos) params.push_back(endpoint.substr(pos, amp - pos));
+            pos = amp + 1;
+        }
+        std::sort(params.begin(), params.end());
+
+        std::string result = backend + " " + method + " " + endpoint.substr(0, query_start);
+        for (size_t i = 0; i < params.size(); ++i) {
+            result += (i == 0 ? "?" : "&");
+            result += params[i];
+        }
+        return result;
+    }
+
+    std::chrono::seconds ttl(const std::string& endpoint) const {
+        std::string path = endpoint.substr(0, endpoint.find('?'));
+        std::chrono::seconds result = config.default_ttl;
+        size_t best = 0;
+        for (const auto& rule : config.rules) {
+            if (rule.prefix.size() >= best && path.compare(0, rule.prefix.size(), rule.prefix) == 0) {
+                best = rule.prefix.size();
+                result = rule.ttl;
+            }
+        }
+        return result;
+    }
+
+    bool cacheable(const std::string& method, const std::string& endpoint) const {
+        return config.enabled && method == "GET" && ttl(endpoint).count() > 0;
+    }
+
+    bool lookup(const std::string& key, JikanCacheEntry& entry) {
+        return store->get(key, entry);
+    }
+
+    void keep_parsed(const std::string& key, const JikanCacheEntry& entry) {
+        store->keep_parsed(key, entry);
+    }
+
+    void store_entry(const std::string& key, const JikanCacheEntry& entry) {
+        store->put(key, entry);
+        ++stores;
+    }
+
+    void record_hit() { ++hits; }
+    void record_miss() { ++misses; }
+    void record_revalidated() { ++revalidations; }
+
+    void clear() {
+        store->clear();
+    }
+
+    const JikanCacheConfig& get_config() const {
+        return config;
+    }
+
+    JikanCacheStats stats() const {
+        JikanCacheStats result;
+        result.hits = hits.load();
+        result.misses = misses.load();
+        result.revalidated = revalidations.load();
+        result.stores = stores.load();
+        return result;
+    }
+};
+
+#endif
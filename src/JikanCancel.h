@@ -0,0 +1,58 @@
+#ifndef JIKAN_CANCEL_H
+#define JIKAN_CANCEL_H
+
+#include <pplx/pplx.h>
+#include <chrono>
+#include <stdexcept>
+
+struct JikanCallOptions {
+    typedef std::chrono::steady_clock clock;
+
+    // Cancelling drops queued requests at once and aborts the ones already on the wire
+    pplx::cancellation_token cancel = pplx::cancellation_token::none();
+    // Reaching it cancels the call like the token does, max() means no deadline
+    clock::time_point deadline = clock::time_point::max();
+    // Sends the request even when the cache holds a fresh copy; the copy's validators still go along,
+    // so an unchanged entity costs a 304
+    bool revalidate = false;
+
+    static JikanCallOptions within(std::chrono::milliseconds timeout,
+                                   pplx::cancellation_token cancel = pplx::cancellation_token::none()) {
+        JikanCallOptions options;
+        options.cancel = cancel;
+        options.deadline = clock::now() + timeout;
+        return options;
+    }
+
+    bool cancellable() const {
+        return cancel.is_cancelable() || deadline != clock::time_point::max();
+    }
+};
+
+// Options applied to requests started from the current thread while the scope is alive:
+//     JikanCallScope scope(JikanCallOptions::within(std::chrono::seconds(5), source.get_token()));
+//     api.getAnimeFullById(1);
+class JikanCallScope {
+private:
+    JikanCallOptions previous;
+
+public:
+    explicit JikanCallScope(const JikanCallOptions& options) : previous(current()) {
+        current() = options;
+    }
+    ~JikanCallScope() {
+        current() = previous;
+    }
+
+    static JikanCallOptions& current() {
+        static thread_local JikanCallOptions options;
+        return options;
+    }
+};
+
+class JikanDeadlineError : public std::runtime_error {
+public:
+    JikanDeadlineError() : std::runtime_error("Deadline exceeded") {}
+};
+
+#endif
@@ -0,0 +1,122 @@
+#ifndef JIKAN_CLIENT_POOL_H
+#define JIKAN_CLIENT_POOL_H
+
+#include <cpprest/http_client.h>
+#include <pplx/pplx.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "JikanTransport.h"
+
+struct JikanPoolConfig {
+    // Number of long-lived http_client instances, each keeping its own keep-alive connection.
+    size_t pool_size = 4;
+    // A client idle for longer than this is recreated, the server has most likely dropped its socket.
+    std::chrono::seconds idle_timeout = std::chrono::seconds(30);
+};
+
+// Counts http_client objects handed out, not sockets: cpprest opens and reuses the TCP connections
+// underneath a client on its own, and a reused client may still have to reconnect
+struct JikanPoolStats {
+    // Requests that needed a new client, the first on a slot or after idle_timeout
+    uint64_t clients_created = 0;
+    // Requests sent on a client that already existed
+    uint64_t clients_reused = 0;
+};
+
+class JikanClientPool : public JikanTransport, public std::enable_shared_from_this<JikanClientPool> {
+private:
+    struct Slot {
+        std::shared_ptr<web::http::client::http_client> client;
+        size_t in_flight = 0;
+        std::chrono::steady_clock::time_point last_used;
+    };
+
+    utility::string_t base_uri;
+    web::http::client::http_client_config client_config;
+    JikanPoolConfig config;
+    std::mutex mutex;
+    std::vector<Slot> slots;
+    std::atomic<uint64_t> clients_created{0};
+    std::atomic<uint64_t> clients_reused{0};
+
+    std::shared_ptr<web::http::client::http_client> acquire(size_t& index, bool& fresh) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto now = std::chrono::steady_clock::now();
+
+        // Least busy slot first, on ties the most recently used one so warm connections stay warm
+        index = 0;
+        for (size_t i = 1; i < slots.size(); ++i) {
+            const Slot& best = slots[index];
+            const Slot& cur = slots[i];
+            if (cur.in_flight < best.in_flight ||
+                (cur.in_flight == best.in_flight && cur.client && (!best.client || cur.last_used > best.last_used))) {
+                index = i;
+            }
+        }
+
+        Slot& slot = slots[index];
+        bool expired = slot.in_flight == 0 && slot.client && now - slot.last_used > config.idle_timeout;
+        fresh = !slot.client || expired;
+        if (fresh) {
+            slot.client = std::make_shared<web::http::client::http_client>(base_uri, client_config);
+            ++clients_created;
+        } else {
+            ++clients_reused;
+        }
+        ++slot.in_flight;
+        slot.last_used = now;
+        return slot.client;
+    }
+
+    void release(size_t index) {
+        std::lock_guard<std::mutex> lock(mutex);
+        Slot& slot = slots[index];
+        if (slot.in_flight > 0) --slot.in_flight;
+        slot.last_used = std::chrono::steady_clock::now();
+    }
+
+public:
+    JikanClientPool(const utility::string_t& base_uri,
+                    const web::http::client::http_client_config& client_config,
+                    const JikanPoolConfig& config = JikanPoolConfig())
+        : base_uri(base_uri), client_config(client_config), config(config),
+          slots(config.pool_size > 0 ? config.pool_size : 1) {}
+
+    // new_client tells whether the request went out on a freshly created client;
+    // cancelling the token aborts the request and frees the slot
+    pplx::task<web::http::http_response> request(const web::http::http_request& request, bool* new_client = nullptr,
+                                                 pplx::cancellation_token cancel = pplx::cancellation_token::none()) override {
+        size_t index = 0;
+        bool fresh = false;
+        auto client = acquire(index, fresh);
+        if (new_client) *new_client = fresh;
+        auto self = shared_from_this();
+        return client->request(request, cancel)
+            .then([self, index](pplx::task<web::http::http_response> previousTask) {
+                self->release(index);
+                return previousTask;
+            });
+    }
+
+    JikanPoolStats stats() const {
+        JikanPoolStats result;
+        result.clients_created = clients_created.load();
+        result.clients_reused = clients_reused.load();
+        return result;
+    }
+
+    const JikanPoolConfig& get_config() const {
+        return config;
+    }
+
+    std::string backend() const override {
+        return utility::conversions::to_utf8string(base_uri);
+    }
+};
+
+#endif
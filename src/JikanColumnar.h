@@ -0,0 +1,785 @@
+#ifndef JIKAN_COLUMNAR_H
+#define JIKAN_COLUMNAR_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "JikanTypes.h"
+
+// Strings stored end to end in one buffer; identical strings are stored once while building
+class JikanStringArena {
+private:
+    std::string bytes;
+    std::vector<uint32_t> offsets = {0};
+    std::unordered_map<std::string, uint32_t> interned;
+
+public:
+    uint32_t intern(const std::string& value) {
+        auto it = interned.find(value);
+        if (it != interned.end()) return it->second;
+        uint32_t id = static_cast<uint32_t>(offsets.size() - 1);
+        bytes += value;
+        offsets.push_back(static_cast<uint32_t>(bytes.size()));
+        interned.emplace(value, id);
+        return id;
+    }
+
+    const char* data(uint32_t id) const {
+        return bytes.data() + offsets[id];
+    }
+
+    size_t size(uint32_t id) const {
+        return offsets[id + 1] - offsets[id];
+    }
+
+    std::string get(uint32_t id) const {
+        return std::string(data(id), size(id));
+    }
+
+    size_t count() const {
+        return offsets.size() - 1;
+    }
+
+    size_t memory_bytes() const {
+        return bytes.size() + offsets.size() * sizeof(uint32_t);
+    }
+
+    friend class JikanColumnTable;
+};
+
+enum class JikanColumnType : uint8_t {
+    Int = 1,
+    Float = 2,
+    // One dictionary code per row
+    Dict = 3,
+    // Any number of dictionary codes per row, with an inverted index per code
+    MultiDict = 4,
+    // String id into the table's arena
+    Text = 5
+};
+
+class JikanColumnQuery {
+public:
+    enum class Op {
+        Between,
+        Equals,
+        AnyOf,
+        Has
+    };
+
+    struct Predicate {
+        std::string column;
+        Op op;
+        double low;
+        double high;
+        std::vector<std::string> values;
+        // Between excludes low itself
+        bool above;
+    };
+
+    std::vector<Predicate> predicates;
+    std::string order_column;
+    bool descending = true;
+    size_t max_rows = std::numeric_limits<size_t>::max();
+
+    // Inclusive range on a numeric column
+    JikanColumnQuery& between(const std::string& column, double low, double high) {
+        predicates.push_back(Predicate{column, Op::Between, low, high, {}});
+        return *this;
+    }
+
+    JikanColumnQuery& at_least(const std::string& column, double low) {
+        return between(column, low, std::numeric_limits<double>::infinity());
+    }
+
+    // Strictly greater, as in "score > 8"
+    JikanColumnQuery& above(const std::string& column, double low) {
+        predicates.push_back(Predicate{column, Op::Between, low, std::numeric_limits<double>::infinity(), {}, true});
+        return *this;
+    }
+
+    JikanColumnQuery& at_most(const std::string& column, double high) {
+        return between(column, -std::numeric_limits<double>::infinity(), high);
+    }
+
+    // Dictionary column equal to value
+    JikanColumnQuery& equals(const std::string& column, const std::string& value) {
+        predicates.push_back(Predicate{column, Op::Equals, 0, 0, {value}});
+        return *this;
+    }
+
+    JikanColumnQuery& any_of(const std::string& column, const std::vector<std::string>& values) {
+        predicates.push_back(Predicate{column, Op::AnyOf, 0, 0, values});
+        return *this;
+    }
+
+    // Multi-valued column containing value; several has() on one query must all hold
+    JikanColumnQuery& has(const std::string& column, const std::string& value) {
+        predicates.push_back(Predicate{column, Op::Has, 0, 0, {value}});
+        return *this;
+    }
+
+    JikanColumnQuery& order_by(const std::string& column, bool descending_order = true) {
+        order_column = column;
+        descending = descending_order;
+        return *this;
+    }
+
+    JikanColumnQuery& limit(size_t rows) {
+        max_rows = rows;
+        return *this;
+    }
+};
+
+// Column-oriented copy of fetched records for local filtering and sorting.
+// Numeric columns are plain arrays, categorical ones are dictionary codes with posting lists.
+class JikanColumnTable {
+private:
+    enum : uint16_t { no_code = 0xFFFF };
+
+    struct Column {
+        std::string name;
+        JikanColumnType type;
+        std::vector<int32_t> ints;
+        std::vector<float> floats;
+        // Dict: one code per row; MultiDict: codes of every row back to back
+        std::vector<uint16_t> codes;
+        // MultiDict: codes of row i are codes[offsets[i], offsets[i + 1])
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> text;
+        std::vector<std::string> dictionary;
+        std::unordered_map<std::string, uint16_t> lookup;
+        // Rows per dictionary code, ascending
+        std::vector<std::vector<uint32_t>> postings;
+    };
+
+    std::vector<Column> columns;
+    std::map<std::string, size_t> by_name;
+    JikanStringArena arena;
+    uint32_t rows = 0;
+
+    static uint16_t encode(Column& column, const std::string& value) {
+        auto it = column.lookup.find(value);
+        if (it != column.lookup.end()) return it->second;
+        if (column.dictionary.size() >= no_code) throw std::runtime_error("Jikan columnar: dictionary full in " + column.name);
+        uint16_t code = static_cast<uint16_t>(column.dictionary.size());
+        column.dictionary.push_back(value);
+        column.lookup.emplace(value, code);
+        column.postings.emplace_back();
+        return code;
+    }
+
+    static bool find_code(const Column& column, const std::string& value, uint16_t& code) {
+        auto it = column.lookup.find(value);
+        if (it == column.lookup.end()) return false;
+        code = it->second;
+        return true;
+    }
+
+    const Column& column_of(const std::string& name, JikanColumnType type) const {
+        const Column& result = columns[column(name)];
+        if (result.type != type) throw std::runtime_error("Jikan columnar: wrong column type for " + name);
+        return result;
+    }
+
+    Column& last_row_column(size_t index) {
+        if (rows == 0) throw std::runtime_error("Jikan columnar: append_row() first");
+        return columns[index];
+    }
+
+    double numeric(const Column& column, uint32_t row) const {
+        return column.type == JikanColumnType::Float ? column.floats[row] : column.ints[row];
+    }
+
+    static std::vector<uint32_t> intersect(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b) {
+        std::vector<uint32_t> result;
+        result.reserve(std::min(a.size(), b.size()));
+        std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(result));
+        return result;
+    }
+
+    // Tight loops over whole columns so the compiler can vectorize them
+    template <typename T>
+    static void mask_range(const std::vector<T>& values, double low, double high, std::vector<uint8_t>& mask) {
+        const T* v = values.data();
+        uint8_t* m = mask.data();
+        size_t n = mask.size();
+        for (size_t i = 0; i < n; ++i) {
+            m[i] &= static_cast<uint8_t>((v[i] >= low) & (v[i] <= high));
+        }
+    }
+
+    static void mask_codes(const std::vector<uint16_t>& codes, const std::vector<uint8_t>& accepted, std::vector<uint8_t>& mask) {
+        const uint16_t* c = codes.data();
+        uint8_t* m = mask.data();
+        size_t n = mask.size();
+        for (size_t i = 0; i < n; ++i) {
+            m[i] &= c[i] < accepted.size() ? accepted[c[i]] : 0;
+        }
+    }
+
+    // Dictionary codes of the accepted values, one flag per code
+    static std::vector<uint8_t> accepted_codes(const Column& column, const std::vector<std::string>& values) {
+        std::vector<uint8_t> accepted(column.dictionary.size(), 0);
+        for (const auto& value : values) {
+            uint16_t code = 0;
+            if (find_code(column, value, code)) accepted[code] = 1;
+        }
+        return accepted;
+    }
+
+    // Throws unless the predicate can run on the column; both select paths rely on it
+    static void check(const JikanColumnQuery::Predicate& predicate, const Column& column) {
+        bool valid = false;
+        switch (predicate.op) {
+            case JikanColumnQuery::Op::Between:
+                valid = column.type == JikanColumnType::Int || column.type == JikanColumnType::Float;
+                break;
+            case JikanColumnQuery::Op::Equals:
+            case JikanColumnQuery::Op::Has:
+                valid = column.type == JikanColumnType::Dict || column.type == JikanColumnType::MultiDict;
+                break;
+            case JikanColumnQuery::Op::AnyOf:
+                valid = column.type == JikanColumnType::Dict;
+                break;
+        }
+        if (!valid) throw std::runtime_error("Jikan columnar: unsupported predicate on " + predicate.column);
+    }
+
+    // Range bounds as the column's values compare: a float column holds scores narrowed from
+    // double, so the bounds are narrowed the same way and at_least(7.1) keeps a stored 7.1
+    static std::pair<double, double> bounds(const JikanColumnQuery::Predicate& predicate, const Column& column) {
+        const double infinity = std::numeric_limits<double>::infinity();
+        if (column.type == JikanColumnType::Float) {
+            float low = static_cast<float>(predicate.low);
+            if (predicate.above) low = std::nextafter(low, std::numeric_limits<float>::infinity());
+            return std::make_pair(static_cast<double>(low), static_cast<double>(static_cast<float>(predicate.high)));
+        }
+        return std::make_pair(predicate.above ? std::nextafter(predicate.low, infinity) : predicate.low, predicate.high);
+    }
+
+    bool row_matches(const JikanColumnQuery::Predicate& predicate, const Column& column, uint32_t row) const {
+        switch (predicate.op) {
+            case JikanColumnQuery::Op::Between: {
+                double value = numeric(column, row);
+                std::pair<double, double> range = bounds(predicate, column);
+                return value >= range.first && value <= range.second;
+            }
+            case JikanColumnQuery::Op::Equals:
+            case JikanColumnQuery::Op::AnyOf: {
+                uint16_t code = column.codes[row];
+                return code != no_code && std::find(predicate.values.begin(), predicate.values.end(), column.dictionary[code]) != predicate.values.end();
+            }
+            case JikanColumnQuery::Op::Has:
+                return true;
+        }
+        return true;
+    }
+
+    template <typename T>
+    static void write_pod(std::FILE* file, const T& value) {
+        if (std::fwrite(&value, sizeof(T), 1, file) != 1) throw std::runtime_error("Jikan columnar: write failed");
+    }
+
+    template <typename T>
+    static void write_vector(std::FILE* file, const std::vector<T>& values) {
+        write_pod<uint64_t>(file, values.size());
+        if (!values.empty() && std::fwrite(values.data(), sizeof(T), values.size(), file) != values.size()) {
+            throw std::runtime_error("Jikan columnar: write failed");
+        }
+    }
+
+    static void write_string(std::FILE* file, const std::string& value) {
+        write_pod<uint32_t>(file, static_cast<uint32_t>(value.size()));
+        if (!value.empty() && std::fwrite(value.data(), 1, value.size(), file) != value.size()) {
+            throw std::runtime_error("Jikan columnar: write failed");
+        }
+    }
+
+    template <typename T>
+    static void read_pod(std::FILE* file, T& value) {
+        if (std::fread(&value, sizeof(T), 1, file) != 1) throw std::runtime_error("Jikan columnar: truncated snapshot");
+    }
+
+    // Bytes left in the file, so a corrupt length cannot size a buffer past what the file holds
+    static uint64_t remaining(std::FILE* file) {
+        long at = std::ftell(file);
+        if (at < 0 || std::fseek(file, 0, SEEK_END) != 0) throw std::runtime_error("Jikan columnar: cannot read snapshot");
+        long end = std::ftell(file);
+        if (end < 0 || std::fseek(file, at, SEEK_SET) != 0) throw std::runtime_error("Jikan columnar: cannot read snapshot");
+        return end > at ? static_cast<uint64_t>(end - at) : 0;
+    }
+
+    template <typename T>
+    static void read_vector(std::FILE* file, std::vector<T>& values) {
+        uint64_t size = 0;
+        read_pod(file, size);
+        if (size > remaining(file) / sizeof(T)) throw std::runtime_error("Jikan columnar: truncated snapshot");
+        values.resize(static_cast<size_t>(size));
+        if (size > 0 && std::fread(values.data(), sizeof(T), values.size(), file) != values.size()) {
+            throw std::runtime_error("Jikan columnar: truncated snapshot");
+        }
+    }
+
+    static void read_string(std::FILE* file, std::string& value) {
+        uint32_t size = 0;
+        read_pod(file, size);
+        if (size > remaining(file)) throw std::runtime_error("Jikan columnar: truncated snapshot");
+        value.resize(size);
+        if (size > 0 && std::fread(&value[0], 1, size, file) != size) throw std::runtime_error("Jikan columnar: truncated snapshot");
+    }
+
+public:
+    size_t add_column(const std::string& name, JikanColumnType type) {
+        if (by_name.count(name)) throw std::runtime_error("Jikan columnar: duplicate column " + name);
+        if (rows > 0) throw std::runtime_error("Jikan columnar: columns must be added before rows");
+        Column column;
+        column.name = name;
+        column.type = type;
+        if (type == JikanColumnType::MultiDict) column.offsets.push_back(0);
+        columns.push_back(std::move(column));
+        by_name[name] = columns.size() - 1;
+        return columns.size() - 1;
+    }
+
+    size_t column(const std::string& name) const {
+        auto it = by_name.find(name);
+        if (it == by_name.end()) throw std::runtime_error("Jikan columnar: no column " + name);
+        return it->second;
+    }
+
+    // Starts a row with every column at its empty value; the setters fill in the last row
+    uint32_t append_row() {
+        for (auto& column : columns) {
+            switch (column.type) {
+                case JikanColumnType::Int: column.ints.push_back(0); break;
+                case JikanColumnType::Float: column.floats.push_back(0.0f); break;
+                case JikanColumnType::Dict: column.codes.push_back(no_code); break;
+                case JikanColumnType::MultiDict: column.offsets.push_back(column.offsets.back()); break;
+                case JikanColumnType::Text: column.text.push_back(arena.intern(std::string())); break;
+            }
+        }
+        return rows++;
+    }
+
+    void set_int(size_t index, int32_t value) {
+        last_row_column(index).ints.back() = value;
+    }
+
+    void set_float(size_t index, float value) {
+        last_row_column(index).floats.back() = value;
+    }
+
+    void set_text(size_t index, const std::string& value) {
+        last_row_column(index).text.back() = arena.intern(value);
+    }
+
+    void set_value(size_t index, const std::string& value) {
+        Column& column = last_row_column(index);
+        if (value.empty()) return;
+        uint16_t code = encode(column, value);
+        column.codes.back() = code;
+        column.postings[code].push_back(rows - 1);
+    }
+
+    void add_value(size_t index, const std::string& value) {
+        Column& column = last_row_column(index);
+        uint16_t code = encode(column, value);
+        uint32_t begin = column.offsets[rows - 1];
+        // Duplicates within a row would repeat the row in the posting list
+        for (uint32_t i = begin; i < column.codes.size(); ++i) {
+            if (column.codes[i] == code) return;
+        }
+        column.codes.push_back(code);
+        ++column.offsets.back();
+        column.postings[code].push_back(rows - 1);
+    }
+
+    size_t size() const {
+        return rows;
+    }
+
+    int32_t get_int(size_t index, uint32_t row) const {
+        return columns[index].ints[row];
+    }
+
+    float get_float(size_t index, uint32_t row) const {
+        return columns[index].floats[row];
+    }
+
+    std::string get_text(size_t index, uint32_t row) const {
+        return arena.get(columns[index].text[row]);
+    }
+
+    // Value of a Dict column, empty when unset
+    std::string get_value(size_t index, uint32_t row) const {
+        const Column& column = columns[index];
+        uint16_t code = column.codes[row];
+        return code == no_code ? std::string() : column.dictionary[code];
+    }
+
+    std::vector<std::string> get_values(size_t index, uint32_t row) const {
+        const Column& column = columns[index];
+        std::vector<std::string> result;
+        for (uint32_t i = column.offsets[row]; i < column.offsets[row + 1]; ++i) {
+            result.push_back(column.dictionary[column.codes[i]]);
+        }
+        return result;
+    }
+
+    // Distinct values of a dictionary column with their row counts
+    std::vector<std::pair<std::string, size_t>> value_counts(const std::string& name) const {
+        const Column& column = columns[this->column(name)];
+        std::vector<std::pair<std::string, size_t>> result;
+        for (size_t code = 0; code < column.dictionary.size(); ++code) {
+            result.push_back(std::make_pair(column.dictionary[code], column.postings[code].size()));
+        }
+        return result;
+    }
+
+    // Rows matching every predicate, ordered and limited as the query asks.
+    // Posting lists narrow the candidates first; without any, predicates run as whole-column scans.
+    std::vector<uint32_t> select(const JikanColumnQuery& query) const {
+        for (const auto& predicate : query.predicates) check(predicate, columns[column(predicate.column)]);
+        if (!query.order_column.empty()) {
+            JikanColumnType type = columns[column(query.order_column)].type;
+            if (type != JikanColumnType::Int && type != JikanColumnType::Float) {
+                throw std::runtime_error("Jikan columnar: cannot order by " + query.order_column);
+            }
+        }
+
+        std::vector<const std::vector<uint32_t>*> lists;
+        std::vector<bool> indexed(query.predicates.size(), false);
+        for (size_t i = 0; i < query.predicates.size(); ++i) {
+            const auto& predicate = query.predicates[i];
+            const Column& target = columns[column(predicate.column)];
+            bool dictionary = target.type == JikanColumnType::Dict || target.type == JikanColumnType::MultiDict;
+            if (predicate.op == JikanColumnQuery::Op::Has || (predicate.op == JikanColumnQuery::Op::Equals && dictionary)) {
+                uint16_t code = 0;
+                if (!find_code(target, predicate.values.front(), code)) return std::vector<uint32_t>();
+                lists.push_back(&target.postings[code]);
+                indexed[i] = true;
+            }
+        }
+
+        std::vector<uint32_t> result;
+        if (!lists.empty()) {
+            std::sort(lists.begin(), lists.end(), [](const std::vector<uint32_t>* a, const std::vector<uint32_t>* b) {
+                return a->size() < b->size();
+            });
+            result = *lists.front();
+            for (size_t i = 1; i < lists.size() && !result.empty(); ++i) result = intersect(result, *lists[i]);
+
+            for (size_t i = 0; i < query.predicates.size(); ++i) {
+                if (indexed[i]) continue;
+                const auto& predicate = query.predicates[i];
+                const Column& target = columns[column(predicate.column)];
+                result.erase(std::remove_if(result.begin(), result.end(), [&](uint32_t row) {
+                    return !row_matches(predicate, target, row);
+                }), result.end());
+            }
+        } else {
+            std::vector<uint8_t> mask(rows, 1);
+            for (const auto& predicate : query.predicates) {
+                const Column& target = columns[column(predicate.column)];
+                if (predicate.op == JikanColumnQuery::Op::Between) {
+                    std::pair<double, double> range = bounds(predicate, target);
+                    if (target.type == JikanColumnType::Float) {
+                        mask_range(target.floats, range.first, range.second, mask);
+                    } else {
+                        mask_range(target.ints, range.first, range.second, mask);
+                    }
+                } else {
+                    // Only any_of on a Dict column is left unindexed
+                    mask_codes(target.codes, accepted_codes(target, predicate.values), mask);
+                }
+            }
+            result.reserve(rows / 8);
+            for (uint32_t row = 0; row < rows; ++row) {
+                if (mask[row]) result.push_back(row);
+            }
+        }
+
+        if (!query.order_column.empty()) {
+            const Column& key = columns[column(query.order_column)];
+            bool descending = query.descending;
+            auto before = [this, &key, descending](uint32_t a, uint32_t b) {
+                double x = numeric(key, a);
+                double y = numeric(key, b);
+                if (x != y) return descending ? x > y : x < y;
+                return a < b;
+            };
+            if (query.max_rows < result.size()) {
+                std::partial_sort(result.begin(), result.begin() + query.max_rows, result.end(), before);
+            } else {
+                std::sort(result.begin(), result.end(), before);
+            }
+        }
+        if (query.max_rows < result.size()) result.resize(query.max_rows);
+        return result;
+    }
+
+    size_t memory_bytes() const {
+        size_t total = arena.memory_bytes();
+        for (const auto& column : columns) {
+            total += column.ints.size() * sizeof(int32_t) + column.floats.size() * sizeof(float) +
+                     column.codes.size() * sizeof(uint16_t) + column.offsets.size() * sizeof(uint32_t) +
+                     column.text.size() * sizeof(uint32_t);
+            for (const auto& posting : column.postings) total += posting.size() * sizeof(uint32_t);
+        }
+        return total;
+    }
+
+    // Whether a column read from a snapshot fits the table: one value per row, codes inside the
+    // dictionary, text ids inside the arena. Posting lists are only rebuilt from a column that does
+    static bool consistent(const Column& column, uint32_t row_count, size_t strings) {
+        switch (column.type) {
+            case JikanColumnType::Int:
+                return column.ints.size() == row_count;
+            case JikanColumnType::Float:
+                return column.floats.size() == row_count;
+            case JikanColumnType::Text:
+                if (column.text.size() != row_count) return false;
+                for (uint32_t id : column.text) {
+                    if (id >= strings) return false;
+                }
+                return true;
+            case JikanColumnType::Dict:
+                if (column.codes.size() != row_count) return false;
+                for (uint16_t code : column.codes) {
+                    if (code != no_code && code >= column.dictionary.size()) return false;
+                }
+                return true;
+            case JikanColumnType::MultiDict:
+                if (column.offsets.size() != static_cast<size_t>(row_count) + 1 || column.offsets[0] != 0) return false;
+                for (uint32_t row = 0; row < row_count; ++row) {
+                    if (column.offsets[row] > column.offsets[row + 1]) return false;
+                }
+                if (column.offsets.back() != column.codes.size()) return false;
+                for (uint16_t code : column.codes) {
+                    if (code >= column.dictionary.size()) return false;
+                }
+                return true;
+        }
+        return false;
+    }
+
+    // Binary snapshot in host byte order; posting lists are rebuilt on load
+    void save(const std::string& path) const {
+        std::string temporary = path + ".tmp";
+        std::unique_ptr<std::FILE, int (*)(std::FILE*)> file(std::fopen(temporary.c_str(), "wb"), &std::fclose);
+        if (!file) throw std::runtime_error("Jikan columnar: cannot write " + temporary);
+        std::FILE* out = file.get();
+        write_pod<uint32_t>(out, 0x54434B4A);  // "JKCT"
+        write_pod<uint32_t>(out, 1);
+        write_pod<uint32_t>(out, rows);
+        write_pod<uint32_t>(out, static_cast<uint32_t>(columns.size()));
+        write_string(out, arena.bytes);
+        write_vector(out, arena.offsets);
+        for (const auto& column : columns) {
+            write_string(out, column.name);
+            write_pod<uint8_t>(out, static_cast<uint8_t>(column.type));
+            write_vector(out, column.ints);
+            write_vector(out, column.floats);
+            write_vector(out, column.codes);
+            write_vector(out, column.offsets);
+            write_vector(out, column.text);
+            write_pod<uint32_t>(out, static_cast<uint32_t>(column.dictionary.size()));
+            for (const auto& value : column.dictionary) write_string(out, value);
+        }
+        if (std::fflush(out) != 0) throw std::runtime_error("Jikan columnar: cannot write " + temporary);
+        file.reset();
+        if (std::rename(temporary.c_str(), path.c_str()) != 0) throw std::runtime_error("Jikan columnar: cannot replace " + path);
+    }
+
+    static JikanColumnTable load(const std::string& path) {
+        std::unique_ptr<std::FILE, int (*)(std::FILE*)> file(std::fopen(path.c_str(), "rb"), &std::fclose);
+        if (!file) throw std::runtime_error("Jikan columnar: cannot open " + path);
+        std::FILE* in = file.get();
+        uint32_t magic = 0, version = 0, row_count = 0, column_count = 0;
+        read_pod(in, magic);
+        read_pod(in, version);
+        if (magic != 0x54434B4A || version != 1) throw std::runtime_error("Jikan columnar: not a snapshot " + path);
+        read_pod(in, row_count);
+        read_pod(in, column_count);
+
+        JikanColumnTable table;
+        read_string(in, table.arena.bytes);
+        read_vector(in, table.arena.offsets);
+        const auto& strings = table.arena.offsets;
+        if (strings.empty() || strings[0] != 0 || strings.back() != table.arena.bytes.size() ||
+            !std::is_sorted(strings.begin(), strings.end())) {
+            throw std::runtime_error("Jikan columnar: corrupt string arena in " + path);
+        }
+        for (uint32_t i = 0; i < column_count; ++i) {
+            Column column;
+            read_string(in, column.name);
+            if (table.by_name.count(column.name)) throw std::runtime_error("Jikan columnar: duplicate column " + column.name + " in " + path);
+            uint8_t type = 0;
+            read_pod(in, type);
+            if (type < static_cast<uint8_t>(JikanColumnType::Int) || type > static_cast<uint8_t>(JikanColumnType::Text)) {
+                throw std::runtime_error("Jikan columnar: bad column type in " + path);
+            }
+            column.type = static_cast<JikanColumnType>(type);
+            read_vector(in, column.ints);
+            read_vector(in, column.floats);
+            read_vector(in, column.codes);
+            read_vector(in, column.offsets);
+            read_vector(in, column.text);
+            uint32_t dictionary_size = 0;
+            read_pod(in, dictionary_size);
+            if (dictionary_size > no_code) throw std::runtime_error("Jikan columnar: dictionary too large in " + path);
+            column.dictionary.resize(dictionary_size);
+            column.postings.resize(dictionary_size);
+            for (uint32_t code = 0; code < dictionary_size; ++code) {
+                read_string(in, column.dictionary[code]);
+                column.lookup.emplace(column.dictionary[code], static_cast<uint16_t>(code));
+            }
+            if (!consistent(column, row_count, table.arena.count())) {
+                throw std::runtime_error("Jikan columnar: column " + column.name + " does not match the rows in " + path);
+            }
+            if (column.type == JikanColumnType::Dict) {
+                for (uint32_t row = 0; row < column.codes.size(); ++row) {
+                    if (column.codes[row] != no_code) column.postings[column.codes[row]].push_back(row);
+                }
+            } else if (column.type == JikanColumnType::MultiDict) {
+                for (uint32_t row = 0; row + 1 < column.offsets.size(); ++row) {
+                    for (uint32_t k = column.offsets[row]; k < column.offsets[row + 1]; ++k) column.postings[column.codes[k]].push_back(row);
+                }
+            }
+            table.by_name[column.name] = table.columns.size();
+            table.columns.push_back(std::move(column));
+        }
+        table.rows = row_count;
+        return table;
+    }
+};
+
+// Schemas for the typed structs. Genres, themes and demographics share the "genres" column.
+inline JikanColumnTable jikan_anime_table() {
+    JikanColumnTable table;
+    table.add_column("mal_id", JikanColumnType::Int);
+    table.add_column("title", JikanColumnType::Text);
+    table.add_column("title_english", JikanColumnType::Text);
+    table.add_column("type", JikanColumnType::Dict);
+    table.add_column("source", JikanColumnType::Dict);
+    table.add_column("episodes", JikanColumnType::Int);
+    table.add_column("status", JikanColumnType::Dict);
+    table.add_column("rating", JikanColumnType::Dict);
+    table.add_column("score", JikanColumnType::Float);
+    table.add_column("scored_by", JikanColumnType::Int);
+    table.add_column("rank", JikanColumnType::Int);
+    table.add_column("popularity", JikanColumnType::Int);
+    table.add_column("members", JikanColumnType::Int);
+    table.add_column("favorites", JikanColumnType::Int);
+    table.add_column("season", JikanColumnType::Dict);
+    table.add_column("year", JikanColumnType::Int);
+    table.add_column("genres", JikanColumnType::MultiDict);
+    table.add_column("studios", JikanColumnType::MultiDict);
+    table.add_column("producers", JikanColumnType::MultiDict);
+    return table;
+}
+
+inline JikanColumnTable jikan_manga_table() {
+    JikanColumnTable table;
+    table.add_column("mal_id", JikanColumnType::Int);
+    table.add_column("title", JikanColumnType::Text);
+    table.add_column("title_english", JikanColumnType::Text);
+    table.add_column("type", JikanColumnType::Dict);
+    table.add_column("chapters", JikanColumnType::Int);
+    table.add_column("volumes", JikanColumnType::Int);
+    table.add_column("status", JikanColumnType::Dict);
+    table.add_column("score", JikanColumnType::Float);
+    table.add_column("scored_by", JikanColumnType::Int);
+    table.add_column("rank", JikanColumnType::Int);
+    table.add_column("popularity", JikanColumnType::Int);
+    table.add_column("members", JikanColumnType::Int);
+    table.add_column("favorites", JikanColumnType::Int);
+    table.add_column("genres", JikanColumnType::MultiDict);
+    table.add_column("authors", JikanColumnType::MultiDict);
+    table.add_column("serializations", JikanColumnType::MultiDict);
+    return table;
+}
+
+inline JikanColumnTable jikan_character_table() {
+    JikanColumnTable table;
+    table.add_column("mal_id", JikanColumnType::Int);
+    table.add_column("name", JikanColumnType::Text);
+    table.add_column("name_kanji", JikanColumnType::Text);
+    table.add_column("favorites", JikanColumnType::Int);
+    return table;
+}
+
+inline void jikan_append(JikanColumnTable& table, const JikanAnime& anime) {
+    table.append_row();
+    table.set_int(table.column("mal_id"), anime.mal_id);
+    table.set_text(table.column("title"), anime.title);
+    table.set_text(table.column("title_english"), anime.title_english);
+    table.set_value(table.column("type"), anime.type);
+    table.set_value(table.column("source"), anime.source);
+    table.set_int(table.column("episodes"), anime.episodes);
+    table.set_value(table.column("status"), anime.status);
+    table.set_value(table.column("rating"), anime.rating);
+    table.set_float(table.column("score"), static_cast<float>(anime.score));
+    table.set_int(table.column("scored_by"), anime.scored_by);
+    table.set_int(table.column("rank"), anime.rank);
+    table.set_int(table.column("popularity"), anime.popularity);
+    table.set_int(table.column("members"), anime.members);
+    table.set_int(table.column("favorites"), anime.favorites);
+    table.set_value(table.column("season"), anime.season);
+    table.set_int(table.column("year"), anime.year);
+    size_t genres = table.column("genres");
+    for (const auto& ref : anime.genres) table.add_value(genres, ref.name);
+    for (const auto& ref : anime.themes) table.add_value(genres, ref.name);
+    for (const auto& ref : anime.demographics) table.add_value(genres, ref.name);
+    size_t studios = table.column("studios");
+    for (const auto& ref : anime.studios) table.add_value(studios, ref.name);
+    size_t producers = table.column("producers");
+    for (const auto& ref : anime.producers) table.add_value(producers, ref.name);
+}
+
+inline void jikan_append(JikanColumnTable& table, const JikanManga& manga) {
+    table.append_row();
+    table.set_int(table.column("mal_id"), manga.mal_id);
+    table.set_text(table.column("title"), manga.title);
+    table.set_text(table.column("title_english"), manga.title_english);
+    table.set_value(table.column("type"), manga.type);
+    table.set_int(table.column("chapters"), manga.chapters);
+    table.set_int(table.column("volumes"), manga.volumes);
+    table.set_value(table.column("status"), manga.status);
+    table.set_float(table.column("score"), static_cast<float>(manga.score));
+    table.set_int(table.column("scored_by"), manga.scored_by);
+    table.set_int(table.column("rank"), manga.rank);
+    table.set_int(table.column("popularity"), manga.popularity);
+    table.set_int(table.column("members"), manga.members);
+    table.set_int(table.column("favorites"), manga.favorites);
+    size_t genres = table.column("genres");
+    for (const auto& ref : manga.genres) table.add_value(genres, ref.name);
+    for (const auto& ref : manga.themes) table.add_value(genres, ref.name);
+    for (const auto& ref : manga.demographics) table.add_value(genres, ref.name);
+    size_t authors = table.column("authors");
+    for (const auto& ref : manga.authors) table.add_value(authors, ref.name);
+    size_t serializations = table.column("serializations");
+    for (const auto& ref : manga.serializations) table.add_value(serializations, ref.name);
+}
+
+inline void jikan_append(JikanColumnTable& table, const JikanCharacter& character) {
+    table.append_row();
+    table.set_int(table.column("mal_id"), character.mal_id);
+    table.set_text(table.column("name"), character.name);
+    table.set_text(table.column("name_kanji"), character.name_kanji);
+    table.set_int(table.column("favorites"), character.favorites);
+}
+
+#endif
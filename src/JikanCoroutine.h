@@ -0,0 +1,111 @@
+#ifndef JIKAN_COROUTINE_H
+#define JIKAN_COROUTINE_H
+
+#include <pplx/pplx.h>
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+
+#include <coroutine>
+#include <exception>
+#include <utility>
+
+#define JIKAN_HAS_COROUTINES 1
+
+// Lets a coroutine co_await a pplx task; it resumes on the thread that completes the task
+template <typename T>
+class JikanAwaitable {
+private:
+    pplx::task<T> task;
+
+public:
+    explicit JikanAwaitable(pplx::task<T> task) : task(std::move(task)) {}
+
+    bool await_ready() const {
+        return task.is_done();
+    }
+
+    void await_suspend(std::coroutine_handle<> handle) {
+        task.then([handle](pplx::task<T>) { handle.resume(); });
+    }
+
+    T await_resume() {
+        return task.get();
+    }
+};
+
+template <typename T>
+JikanAwaitable<T> jikan_await(pplx::task<T> task) {
+    return JikanAwaitable<T>(std::move(task));
+}
+
+template <typename T>
+class JikanAsync;
+
+template <typename T>
+struct JikanAsyncPromiseBase {
+    pplx::task_completion_event<T> done;
+
+    JikanAsync<T> get_return_object() {
+        return JikanAsync<T>(pplx::create_task(done));
+    }
+    std::suspend_never initial_suspend() noexcept {
+        return {};
+    }
+    std::suspend_never final_suspend() noexcept {
+        return {};
+    }
+    void unhandled_exception() {
+        done.set_exception(std::current_exception());
+    }
+};
+
+template <typename T>
+struct JikanAsyncPromise : JikanAsyncPromiseBase<T> {
+    void return_value(T value) {
+        this->done.set(std::move(value));
+    }
+};
+
+template <>
+struct JikanAsyncPromise<void> : JikanAsyncPromiseBase<void> {
+    void return_void() {
+        this->done.set();
+    }
+};
+
+// Coroutine return type backed by a pplx task, so coroutine and task code mix freely:
+//     JikanAsync<std::string> title(Jikan& api, int id) {
+//         auto anime = co_await api.awaitable(JikanCallOptions::within(std::chrono::seconds(5)),
+//                                             [&] { return api.getAnimeById(id); });
+//         co_return utility::conversions::to_utf8string(anime[U("data")][U("title")].as_string());
+//     }
+template <typename T>
+class JikanAsync {
+private:
+    pplx::task<T> result;
+
+public:
+    typedef JikanAsyncPromise<T> promise_type;
+
+    explicit JikanAsync(pplx::task<T> result) : result(std::move(result)) {}
+
+    pplx::task<T> task() const {
+        return result;
+    }
+
+    bool await_ready() const {
+        return result.is_done();
+    }
+
+    void await_suspend(std::coroutine_handle<> handle) {
+        result.then([handle](pplx::task<T>) { handle.resume(); });
+    }
+
+    T await_resume() {
+        return result.get();
+    }
+};
+
+#endif
+
+#endif
@@ -0,0 +1,451 @@
+#ifndef JIKAN_CRAWLER_H
+#define JIKAN_CRAWLER_H
+
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "Jikan.h"
+
+enum class JikanNodeKind {
+    Anime,
+    Manga,
+    Character,
+    Person
+};
+
+struct JikanNode {
+    JikanNodeKind kind;
+    int mal_id;
+    // Name or title as given by the reference that found the node, empty for seeds
+    std::string name;
+    // Hops from the nearest seed
+    int depth;
+};
+
+struct JikanEdge {
+    enum Type : uint32_t {
+        // anime/manga relations: sequel, adaptation, side story, ...
+        Relation = 1u << 0,
+        // anime or manga to its characters
+        Character = 1u << 1,
+        // anime to staff
+        Staff = 1u << 2,
+        // character to voice actors
+        VoiceActor = 1u << 3,
+        // person to the anime and manga they worked on
+        Work = 1u << 4,
+        // character to the anime and manga it appears in
+        Appearance = 1u << 5,
+        All = ~0u
+    };
+
+    Type type;
+    JikanNodeKind from_kind;
+    int from;
+    JikanNodeKind to_kind;
+    int to;
+    // Relation name, role or position
+    std::string label;
+};
+
+struct JikanCrawlConfig {
+    uint32_t edges = JikanEdge::All;
+    // Nodes this many hops from a seed are emitted but not expanded
+    int max_depth = 2;
+    // Requests the crawl may spend; nodes left unexpanded when it runs out are counted as pruned
+    size_t max_requests = 500;
+    // Zero for no limit
+    size_t max_nodes = 0;
+    size_t max_in_flight = 8;
+    JikanPriority priority = JikanPriority::Background;
+};
+
+struct JikanCrawlReport {
+    uint64_t requests = 0;
+    uint64_t failed = 0;
+    uint64_t nodes = 0;
+    uint64_t edges = 0;
+    // Expansions left in the queue when the budget ran out
+    uint64_t pruned = 0;
+};
+
+// Called one at a time, on whichever thread finished the request
+struct JikanCrawlSink {
+    std::function<void(const JikanNode&)> on_node;
+    std::function<void(const JikanEdge&)> on_edge;
+};
+
+// Visited set split into shards so concurrent completions rarely wait on each other
+class JikanVisitedSet {
+private:
+    static const size_t shard_count = 16;
+
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_set<uint64_t> keys;
+    };
+
+    Shard shards[shard_count];
+
+    Shard& shard_of(uint64_t key) {
+        return shards[((key ^ (key >> 32)) * 0x9E3779B97F4A7C15ull) >> 60];
+    }
+
+public:
+    static uint64_t key(JikanNodeKind kind, int id) {
+        return (static_cast<uint64_t>(kind) << 32) | static_cast<uint32_t>(id);
+    }
+
+    // True when the key was not there before
+    bool insert(uint64_t key) {
+        Shard& shard = shard_of(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.keys.insert(key).second;
+    }
+
+    bool contains(uint64_t key) {
+        Shard& shard = shard_of(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.keys.count(key) > 0;
+    }
+};
+
+// Expands a graph of anime, manga, characters and people from seeds:
+//     JikanCrawlConfig config;
+//     config.edges = JikanEdge::Relation | JikanEdge::Character;
+//     JikanCrawler crawler(api, config);
+//     auto report = crawler.crawl({{JikanNodeKind::Anime, 5114}}, sink).get();
+// Every finished request feeds the queue right away, so the crawl is limited by the rate limit
+// and max_in_flight rather than by depth. Nearer nodes are expanded first when the budget is short.
+class JikanCrawler {
+public:
+    struct Seed {
+        JikanNodeKind kind;
+        int mal_id;
+    };
+
+private:
+    enum class Fetch {
+        AnimeRelations,
+        AnimeCharacters,
+        AnimeStaff,
+        MangaRelations,
+        MangaCharacters,
+        CharacterVoices,
+        CharacterAnime,
+        CharacterManga,
+        PersonAnime,
+        PersonManga
+    };
+
+    struct Work {
+        Fetch fetch;
+        JikanNodeKind kind;
+        int id;
+        int depth;
+    };
+
+    typedef std::function<pplx::task<web::json::value>(int)> Fetcher;
+
+    struct State {
+        JikanCrawlConfig config;
+        // One per Fetch, each carrying the crawl's priority and the caller's call options
+        std::vector<Fetcher> fetchers;
+        JikanCrawlSink sink;
+        JikanVisitedSet visited;
+        // Characters whose voice actors came embedded in an anime character list
+        JikanVisitedSet voiced;
+
+        std::mutex mutex;
+        // One queue per depth, shallow work first
+        std::vector<std::deque<Work>> queues;
+        size_t in_flight = 0;
+        size_t admitted = 0;
+        bool finished = false;
+        JikanCrawlReport report;
+
+        // Serializes the sink
+        std::mutex sink_mutex;
+        std::exception_ptr sink_error;
+        pplx::task_completion_event<JikanCrawlReport> done;
+    };
+
+    Jikan& api;
+    JikanCrawlConfig config;
+
+    static utility::string_t field(const web::json::value& object, const utility::string_t& name) {
+        if (!object.is_object() || !object.has_string_field(name)) return utility::string_t();
+        return object.at(name).as_string();
+    }
+
+    static void emit_node(const std::shared_ptr<State>& state, const JikanNode& node) {
+        std::lock_guard<std::mutex> lock(state->sink_mutex);
+        ++state->report.nodes;
+        if (state->sink_error || !state->sink.on_node) return;
+        try {
+            state->sink.on_node(node);
+        } catch (...) {
+            state->sink_error = std::current_exception();
+        }
+    }
+
+    static void emit_edge(const std::shared_ptr<State>& state, const JikanEdge& edge) {
+        std::lock_guard<std::mutex> lock(state->sink_mutex);
+        ++state->report.edges;
+        if (state->sink_error || !state->sink.on_edge) return;
+        try {
+            state->sink.on_edge(edge);
+        } catch (...) {
+            state->sink_error = std::current_exception();
+        }
+    }
+
+    static void expansions(JikanNodeKind kind, uint32_t edges, std::vector<Fetch>& out) {
+        switch (kind) {
+            case JikanNodeKind::Anime:
+                if (edges & JikanEdge::Relation) out.push_back(Fetch::AnimeRelations);
+                // Voice actors come embedded in the character list, no request per character needed
+                if (edges & (JikanEdge::Character | JikanEdge::VoiceActor)) out.push_back(Fetch::AnimeCharacters);
+                if (edges & JikanEdge::Staff) out.push_back(Fetch::AnimeStaff);
+                break;
+            case JikanNodeKind::Manga:
+                if (edges & JikanEdge::Relation) out.push_back(Fetch::MangaRelations);
+                if (edges & JikanEdge::Character) out.push_back(Fetch::MangaCharacters);
+                break;
+            case JikanNodeKind::Character:
+                if (edges & JikanEdge::VoiceActor) out.push_back(Fetch::CharacterVoices);
+                if (edges & JikanEdge::Appearance) {
+                    out.push_back(Fetch::CharacterAnime);
+                    out.push_back(Fetch::CharacterManga);
+                }
+                break;
+            case JikanNodeKind::Person:
+                if (edges & JikanEdge::Work) {
+                    out.push_back(Fetch::PersonAnime);
+                    out.push_back(Fetch::PersonManga);
+                }
+                break;
+        }
+    }
+
+    // Emits the node the first time it is seen and queues its expansions; false when max_nodes keeps it out of the graph.
+    // Concurrent completions may overshoot max_nodes by a few nodes.
+    static bool visit(const std::shared_ptr<State>& state, JikanNodeKind kind, int id, const std::string& name, int depth) {
+        uint64_t key = JikanVisitedSet::key(kind, id);
+        if (state->config.max_nodes > 0) {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (state->admitted >= state->config.max_nodes) return state->visited.contains(key);
+        }
+        if (!state->visited.insert(key)) return true;
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            ++state->admitted;
+        }
+        emit_node(state, JikanNode{kind, id, name, depth});
+
+        if (depth >= state->config.max_depth) return true;
+        std::vector<Fetch> fetches;
+        expansions(kind, state->config.edges, fetches);
+        std::lock_guard<std::mutex> lock(state->mutex);
+        for (Fetch fetch : fetches) state->queues[depth].push_back(Work{fetch, kind, id, depth});
+        return true;
+    }
+
+    // Follows a reference object ({mal_id, name/title}) and records the edge to it
+    static void link(const std::shared_ptr<State>& state, const Work& work, JikanEdge::Type type,
+                     JikanNodeKind kind, const web::json::value& ref, const utility::string_t& label) {
+        if (!ref.is_object() || !ref.has_field(U("mal_id"))) return;
+        int id = ref.at(U("mal_id")).as_integer();
+        utility::string_t name = field(ref, U("name"));
+        if (name.empty()) name = field(ref, U("title"));
+        if (!visit(state, kind, id, utility::conversions::to_utf8string(name), work.depth + 1)) return;
+        emit_edge(state, JikanEdge{type, work.kind, work.id, kind, id, utility::conversions::to_utf8string(label)});
+    }
+
+    static void parse(const std::shared_ptr<State>& state, const Work& work, const web::json::value& result) {
+        if (!result.has_array_field(U("data"))) return;
+        uint32_t edges = state->config.edges;
+        for (const auto& item : result.at(U("data")).as_array()) {
+            if (!item.is_object()) continue;
+            switch (work.fetch) {
+                case Fetch::AnimeRelations:
+                case Fetch::MangaRelations: {
+                    if (!item.has_array_field(U("entry"))) break;
+                    utility::string_t relation = field(item, U("relation"));
+                    for (const auto& entry : item.at(U("entry")).as_array()) {
+                        JikanNodeKind kind = field(entry, U("type")) == U("manga") ? JikanNodeKind::Manga : JikanNodeKind::Anime;
+                        link(state, work, JikanEdge::Relation, kind, entry, relation);
+                    }
+                    break;
+                }
+                case Fetch::AnimeCharacters:
+                case Fetch::MangaCharacters: {
+                    if (!item.has_field(U("character"))) break;
+                    const auto& character = item.at(U("character"));
+                    if (edges & JikanEdge::Character) {
+                        link(state, work, JikanEdge::Character, JikanNodeKind::Character, character, field(item, U("role")));
+                    }
+                    if ((edges & JikanEdge::VoiceActor) && item.has_array_field(U("voice_actors")) && character.has_field(U("mal_id"))) {
+                        // The character is a node either way, voice actor edges start from it one hop further out
+                        Work voices{Fetch::CharacterVoices, JikanNodeKind::Character, character.at(U("mal_id")).as_integer(), work.depth + 1};
+                        bool expand = voices.depth < state->config.max_depth;
+                        // Marked before the visit so its own voice actor request is never started
+                        if (expand) state->voiced.insert(JikanVisitedSet::key(voices.kind, voices.id));
+                        if (!visit(state, voices.kind, voices.id, utility::conversions::to_utf8string(field(character, U("name"))), voices.depth) || !expand) break;
+                        for (const auto& actor : item.at(U("voice_actors")).as_array()) {
+                            if (actor.is_object() && actor.has_field(U("person"))) {
+                                link(state, voices, JikanEdge::VoiceActor, JikanNodeKind::Person, actor.at(U("person")), field(actor, U("language")));
+                            }
+                        }
+                    }
+                    break;
+                }
+                case Fetch::AnimeStaff: {
+                    if (!item.has_field(U("person"))) break;
+                    utility::string_t positions;
+                    if (item.has_array_field(U("positions"))) {
+                        for (const auto& position : item.at(U("positions")).as_array()) {
+                            if (!position.is_string()) continue;
+                            if (!positions.empty()) positions += U(", ");
+                            positions += position.as_string();
+                        }
+                    }
+                    link(state, work, JikanEdge::Staff, JikanNodeKind::Person, item.at(U("person")), positions);
+                    break;
+                }
+                case Fetch::CharacterVoices:
+                    if (item.has_field(U("person"))) link(state, work, JikanEdge::VoiceActor, JikanNodeKind::Person, item.at(U("person")), field(item, U("language")));
+                    break;
+                case Fetch::CharacterAnime:
+                    if (item.has_field(U("anime"))) link(state, work, JikanEdge::Appearance, JikanNodeKind::Anime, item.at(U("anime")), field(item, U("role")));
+                    break;
+                case Fetch::CharacterManga:
+                    if (item.has_field(U("manga"))) link(state, work, JikanEdge::Appearance, JikanNodeKind::Manga, item.at(U("manga")), field(item, U("role")));
+                    break;
+                case Fetch::PersonAnime:
+                    if (item.has_field(U("anime"))) link(state, work, JikanEdge::Work, JikanNodeKind::Anime, item.at(U("anime")), field(item, U("position")));
+                    break;
+                case Fetch::PersonManga:
+                    if (item.has_field(U("manga"))) link(state, work, JikanEdge::Work, JikanNodeKind::Manga, item.at(U("manga")), field(item, U("position")));
+                    break;
+            }
+        }
+    }
+
+    static pplx::task<web::json::value> request(Jikan& api, Fetch fetch, int id) {
+        switch (fetch) {
+            case Fetch::AnimeRelations: return api.getAnimeRelations(id);
+            case Fetch::AnimeCharacters: return api.getAnimeCharacters(id);
+            case Fetch::AnimeStaff: return api.getAnimeStaff(id);
+            case Fetch::MangaRelations: return api.getMangaRelations(id);
+            case Fetch::MangaCharacters: return api.getMangaCharacters(id);
+            case Fetch::CharacterVoices: return api.getCharacterVoiceActors(id);
+            case Fetch::CharacterAnime: return api.getCharacterAnime(id);
+            case Fetch::CharacterManga: return api.getCharacterManga(id);
+            case Fetch::PersonAnime: return api.getPersonAnime(id);
+            case Fetch::PersonManga: return api.getPersonManga(id);
+        }
+        return api.getAnimeRelations(id);
+    }
+
+    static bool next_work(State& state, Work& work) {
+        for (auto& queue : state.queues) {
+            while (!queue.empty()) {
+                work = queue.front();
+                queue.pop_front();
+                // Already known from an anime character list
+                if (work.fetch == Fetch::CharacterVoices && state.voiced.contains(JikanVisitedSet::key(work.kind, work.id))) continue;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Starts queued work up to max_in_flight; the last completion with nothing left to start ends the crawl
+    static void pump(const std::shared_ptr<State>& state) {
+        std::vector<Work> batch;
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (state->finished) return;
+            Work work;
+            while (state->in_flight < state->config.max_in_flight && state->report.requests < state->config.max_requests &&
+                   next_work(*state, work)) {
+                ++state->in_flight;
+                ++state->report.requests;
+                batch.push_back(work);
+            }
+            if (batch.empty() && state->in_flight == 0) {
+                state->finished = true;
+                for (const auto& queue : state->queues) state->report.pruned += queue.size();
+                std::lock_guard<std::mutex> sink_lock(state->sink_mutex);
+                if (state->sink_error) {
+                    state->done.set_exception(state->sink_error);
+                } else {
+                    state->done.set(state->report);
+                }
+                return;
+            }
+        }
+
+        for (const auto& work : batch) {
+            pplx::task<web::json::value> task;
+            try {
+                task = state->fetchers[static_cast<size_t>(work.fetch)](work.id);
+            } catch (const std::exception& e) {
+                task = pplx::task_from_exception<web::json::value>(std::runtime_error(e.what()));
+            }
+            task.then([state, work](pplx::task<web::json::value> previousTask) {
+                bool ok = false;
+                try {
+                    web::json::value result = previousTask.get();
+                    ok = !result.has_field(U("error"));
+                    if (ok) parse(state, work, result);
+                } catch (const std::exception&) {
+                    ok = false;
+                }
+                {
+                    std::lock_guard<std::mutex> lock(state->mutex);
+                    --state->in_flight;
+                    if (!ok) ++state->report.failed;
+                }
+                pump(state);
+            });
+        }
+    }
+
+public:
+    JikanCrawler(Jikan& api, const JikanCrawlConfig& config = JikanCrawlConfig()) : api(api), config(config) {}
+
+    // Completes once the queue is drained or the request budget is spent. The Jikan object must outlive the crawl.
+    pplx::task<JikanCrawlReport> crawl(const std::vector<Seed>& seeds, JikanCrawlSink sink) {
+        auto state = std::make_shared<State>();
+        state->config = config;
+        {
+            // Most requests are started from completions on pool threads, which see the caller's
+            // deadline and cancellation only through in_caller_scope
+            JikanPriorityScope priority(config.priority);
+            Jikan* target = &api;
+            for (int fetch = 0; fetch <= static_cast<int>(Fetch::PersonManga); ++fetch) {
+                state->fetchers.push_back(Jikan::in_caller_scope([target, fetch](int id) {
+                    return request(*target, static_cast<Fetch>(fetch), id);
+                }));
+            }
+        }
+        if (state->config.max_in_flight == 0) state->config.max_in_flight = 1;
+        state->sink = std::move(sink);
+        state->queues.resize(config.max_depth > 0 ? config.max_depth : 1);
+        for (const auto& seed : seeds) visit(state, seed.kind, seed.mal_id, std::string(), 0);
+        auto result = pplx::create_task(state->done);
+        pump(state);
+        return result;
+    }
+};
+
+#endif
@@ -0,0 +1,538 @@
+#ifndef JIKAN_DISK_CACHE_H
+#define JIKAN_DISK_CACHE_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "JikanCache.h"
+
+struct JikanDiskCacheConfig {
+    std::string directory;
+    // A new segment is started once the active one grows past this size
+    size_t segment_bytes = 64 * 1024 * 1024;
+    // Expired entries stay on disk this long so they can still be revalidated with their ETag
+    std::chrono::seconds stale_retention = std::chrono::hours(24 * 7);
+    // Sealed segments with less live data than this share of their size are rewritten
+    double compact_ratio = 0.5;
+    // Bytes of sealed segments each put walks through while a rewrite is pending, so the cost
+    // of compaction is spread over the puts that follow a new segment
+    size_t compact_step_bytes = 1024 * 1024;
+    bool sync_writes = false;
+};
+
+struct JikanDiskCacheStats {
+    size_t entries = 0;
+    size_t segments = 0;
+    uint64_t disk_bytes = 0;
+    uint64_t live_bytes = 0;
+    uint64_t compactions = 0;
+};
+
+inline uint32_t jikan_crc32(const char* data, size_t size, uint32_t crc = 0) {
+    static const struct Table {
+        uint32_t values[256];
+        Table() {
+            for (uint32_t i = 0; i < 256; ++i) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                values[i] = c;
+            }
+        }
+    } table;
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table.values[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+inline uint64_t jikan_hash64(const std::string& value) {
+    uint64_t hash = 1469598103934665603ull;
+    for (unsigned char c : value) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Append-only segment files with an in-memory hash index rebuilt from record headers on startup.
+// Bodies are served straight from the mapped segments.
+//
+// Record layout, native byte order:
+//     u32 magic, u32 flags, u32 key_size, u32 etag_size, u32 last_modified_size, u32 body_crc,
+//     u64 body_size, i64 expires (unix seconds), u32 header_crc, then key, etag, last_modified, body
+class JikanDiskCache : public JikanCacheStore {
+private:
+    static const uint32_t record_magic = 0x314B434A;
+    static const uint32_t flag_tombstone = 1;
+    static const size_t header_size = 44;
+
+    struct Mapping {
+        void* address = nullptr;
+        size_t size = 0;
+        ~Mapping() {
+            if (address) munmap(address, size);
+        }
+    };
+
+    struct Segment {
+        int fd = -1;
+        uint64_t size = 0;
+        uint64_t live = 0;
+        std::shared_ptr<const Mapping> mapping;
+    };
+
+    struct Location {
+        uint32_t segment;
+        uint64_t offset;
+        uint64_t size;
+        int64_t expires;
+        bool verified;
+    };
+
+    struct Header {
+        uint32_t magic;
+        uint32_t flags;
+        uint32_t key_size;
+        uint32_t etag_size;
+        uint32_t last_modified_size;
+        uint32_t body_crc;
+        uint64_t body_size;
+        int64_t expires;
+        uint32_t header_crc;
+
+        uint64_t record_size() const {
+            return header_size + key_size + etag_size + last_modified_size + body_size;
+        }
+    };
+
+    JikanDiskCacheConfig config;
+    std::mutex mutex;
+    std::map<uint32_t, Segment> segments;
+    std::unordered_map<uint64_t, Location> index;
+    uint32_t active = 0;
+    uint64_t compactions = 0;
+    // Sealed segments waiting to be rewritten, the first one is walked from compact_offset on
+    std::deque<uint32_t> compact_queue;
+    uint64_t compact_offset = 0;
+
+    static int64_t to_unix(std::chrono::system_clock::time_point time) {
+        return std::chrono::duration_cast<std::chrono::seconds>(time.time_since_epoch()).count();
+    }
+
+    static void encode(const Header& header, char* out) {
+        std::memcpy(out, &header.magic, 4);
+        std::memcpy(out + 4, &header.flags, 4);
+        std::memcpy(out + 8, &header.key_size, 4);
+        std::memcpy(out + 12, &header.etag_size, 4);
+        std::memcpy(out + 16, &header.last_modified_size, 4);
+        std::memcpy(out + 20, &header.body_crc, 4);
+        std::memcpy(out + 24, &header.body_size, 8);
+        std::memcpy(out + 32, &header.expires, 8);
+        std::memcpy(out + 40, &header.header_crc, 4);
+    }
+
+    static Header decode(const char* in) {
+        Header header;
+        std::memcpy(&header.magic, in, 4);
+        std::memcpy(&header.flags, in + 4, 4);
+        std::memcpy(&header.key_size, in + 8, 4);
+        std::memcpy(&header.etag_size, in + 12, 4);
+        std::memcpy(&header.last_modified_size, in + 16, 4);
+        std::memcpy(&header.body_crc, in + 20, 4);
+        std::memcpy(&header.body_size, in + 24, 8);
+        std::memcpy(&header.expires, in + 32, 8);
+        std::memcpy(&header.header_crc, in + 40, 4);
+        return header;
+    }
+
+    // Covers the fixed fields and the strings, not the body, so a rebuild never has to read bodies
+    static uint32_t header_checksum(const char* header, const char* strings, size_t strings_size) {
+        return jikan_crc32(strings, strings_size, jikan_crc32(header, 40));
+    }
+
+    std::string segment_path(uint32_t id) const {
+        char name[32];
+        std::snprintf(name, sizeof(name), "segment-%08u.jkc", id);
+        return config.directory + "/" + name;
+    }
+
+    static std::shared_ptr<const Mapping> map_file(int fd, uint64_t size) {
+        auto mapping = std::make_shared<Mapping>();
+        if (size > 0) {
+            void* address = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+            if (address != MAP_FAILED) {
+                mapping->address = address;
+                mapping->size = size;
+            }
+        }
+        return mapping;
+    }
+
+    // The active segment keeps growing, it is remapped when a read goes past the current mapping
+    const Mapping* mapped(Segment& segment, uint64_t end) {
+        if (!segment.mapping || segment.mapping->size < end) {
+            segment.mapping = map_file(segment.fd, segment.size);
+        }
+        return segment.mapping->size >= end ? segment.mapping.get() : nullptr;
+    }
+
+    void open_segment(uint32_t id) {
+        Segment segment;
+        segment.fd = ::open(segment_path(id).c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (segment.fd < 0) throw std::runtime_error("Jikan disk cache: cannot open " + segment_path(id));
+        struct stat info;
+        if (fstat(segment.fd, &info) == 0) segment.size = static_cast<uint64_t>(info.st_size);
+        segments[id] = segment;
+    }
+
+    void drop_location(const Location& location) {
+        auto it = segments.find(location.segment);
+        if (it != segments.end()) it->second.live -= std::min(it->second.live, location.size);
+    }
+
+    // Replays every record of a segment into the index; a torn or corrupt tail is cut off
+    void scan_segment(uint32_t id) {
+        Segment& segment = segments[id];
+        const Mapping* mapping = mapped(segment, segment.size);
+        const char* base = mapping ? static_cast<const char*>(mapping->address) : nullptr;
+
+        uint64_t offset = 0;
+        while (base && offset + header_size <= segment.size) {
+            Header header = decode(base + offset);
+            uint64_t strings = uint64_t(header.key_size) + header.etag_size + header.last_modified_size;
+            if (header.magic != record_magic || offset + header.record_size() > segment.size ||
+                header.header_crc != header_checksum(base + offset, base + offset + header_size, strings)) {
+                break;
+            }
+
+            std::string key(base + offset + header_size, header.key_size);
+            uint64_t hash = jikan_hash64(key);
+            auto existing = index.find(hash);
+            if (existing != index.end()) {
+                drop_location(existing->second);
+                index.erase(existing);
+            }
+            if (!(header.flags & flag_tombstone)) {
+                Location location = {id, offset, header.record_size(), header.expires, false};
+                index[hash] = location;
+                segment.live += location.size;
+            }
+            offset += header.record_size();
+        }
+
+        if (offset < segment.size) {
+            if (ftruncate(segment.fd, static_cast<off_t>(offset)) == 0) {
+                segment.size = offset;
+                segment.mapping.reset();
+            }
+        }
+    }
+
+    void open_directory() {
+        ::mkdir(config.directory.c_str(), 0755);
+        DIR* dir = ::opendir(config.directory.c_str());
+        if (!dir) throw std::runtime_error("Jikan disk cache: cannot open directory " + config.directory);
+
+        std::vector<uint32_t> ids;
+        while (struct dirent* item = ::readdir(dir)) {
+            unsigned id = 0;
+            char tail = 0;
+            if (std::sscanf(item->d_name, "segment-%8u.jk%c", &id, &tail) == 2 && tail == 'c') {
+                ids.push_back(id);
+            }
+        }
+        ::closedir(dir);
+        std::sort(ids.begin(), ids.end());
+
+        for (uint32_t id : ids) {
+            open_segment(id);
+            scan_segment(id);
+        }
+        active = ids.empty() ? 1 : ids.back();
+        if (ids.empty()) open_segment(active);
+    }
+
+    void roll_if_needed(uint64_t incoming) {
+        Segment& current = segments[active];
+        if (current.size == 0 || current.size + incoming <= config.segment_bytes) return;
+        if (config.sync_writes) fdatasync(current.fd);
+        ++active;
+        open_segment(active);
+    }
+
+    // Appends a record to the active segment and returns its location
+    bool append(const struct iovec* parts, int count, uint64_t size, Location& location) {
+        roll_if_needed(size);
+        Segment& segment = segments[active];
+        ssize_t written = ::writev(segment.fd, parts, count);
+        if (written < 0 || static_cast<uint64_t>(written) != size) {
+            if (ftruncate(segment.fd, static_cast<off_t>(segment.size)) != 0) {
+                // the next rebuild cuts the torn record off
+            }
+            return false;
+        }
+        if (config.sync_writes) fdatasync(segment.fd);
+        location.segment = active;
+        location.offset = segment.size;
+        location.size = size;
+        location.verified = true;
+        segment.size += size;
+        return true;
+    }
+
+    bool write_record(const std::string& key, uint32_t flags, const JikanCacheEntry& entry) {
+        std::string etag = utility::conversions::to_utf8string(entry.etag);
+        std::string last_modified = utility::conversions::to_utf8string(entry.last_modified);
+        std::string strings = key + etag + last_modified;
+
+        Header header;
+        header.magic = record_magic;
+        header.flags = flags;
+        header.key_size = static_cast<uint32_t>(key.size());
+        header.etag_size = static_cast<uint32_t>(etag.size());
+        header.last_modified_size = static_cast<uint32_t>(last_modified.size());
+        header.body_crc = jikan_crc32(entry.body.data(), entry.body.size());
+        header.body_size = entry.body.size();
+        header.expires = to_unix(entry.expires);
+        header.header_crc = 0;
+
+        char raw[header_size];
+        encode(header, raw);
+        header.header_crc = header_checksum(raw, strings.data(), strings.size());
+        encode(header, raw);
+
+        struct iovec parts[3];
+        parts[0].iov_base = raw;
+        parts[0].iov_len = header_size;
+        parts[1].iov_base = const_cast<char*>(strings.data());
+        parts[1].iov_len = strings.size();
+        parts[2].iov_base = const_cast<char*>(entry.body.data());
+        parts[2].iov_len = entry.body.size();
+
+        uint64_t hash = jikan_hash64(key);
+        auto existing = index.find(hash);
+        if (existing != index.end()) {
+            drop_location(existing->second);
+            index.erase(existing);
+        }
+
+        Location location;
+        if (!append(parts, 3, header.record_size(), location)) return false;
+        if (!(flags & flag_tombstone)) {
+            location.expires = header.expires;
+            index[hash] = location;
+            segments[location.segment].live += location.size;
+        }
+        return true;
+    }
+
+    bool garbage(const Location& location, int64_t now) const {
+        return location.expires + config.stale_retention.count() < now;
+    }
+
+    void close_segment(uint32_t id) {
+        auto it = segments.find(id);
+        if (it == segments.end()) return;
+        ::close(it->second.fd);
+        ::unlink(segment_path(id).c_str());
+        segments.erase(it);
+    }
+
+    // Queues the sealed segments that are mostly dead and not queued yet
+    void pick_compactions() {
+        for (const auto& item : segments) {
+            const Segment& segment = item.second;
+            if (item.first == active || segment.live >= segment.size * config.compact_ratio) continue;
+            if (std::find(compact_queue.begin(), compact_queue.end(), item.first) == compact_queue.end()) {
+                compact_queue.push_back(item.first);
+            }
+        }
+    }
+
+    // Walks up to budget bytes of the queued segments in record order. A record the index still
+    // points at is copied to the active segment; once a segment is walked to its end it is deleted
+    void compact_step(uint64_t budget) {
+        int64_t now = to_unix(std::chrono::system_clock::now());
+        while (budget > 0 && !compact_queue.empty()) {
+            uint32_t id = compact_queue.front();
+            auto found = segments.find(id);
+            if (found == segments.end() || id == active) {
+                compact_queue.pop_front();
+                compact_offset = 0;
+                continue;
+            }
+            Segment& segment = found->second;
+            const Mapping* mapping = mapped(segment, segment.size);
+            const char* base = mapping ? static_cast<const char*>(mapping->address) : nullptr;
+
+            // Sealed segments were checked record by record when they were scanned or written
+            while (base && budget > 0 && compact_offset + header_size <= segment.size) {
+                Header header = decode(base + compact_offset);
+                uint64_t size = header.record_size();
+                if (compact_offset + size > segment.size) break;
+                if (!(header.flags & flag_tombstone)) {
+                    auto it = index.find(jikan_hash64(std::string(base + compact_offset + header_size, header.key_size)));
+                    if (it != index.end() && it->second.segment == id && it->second.offset == compact_offset) {
+                        relocate(it, base, now);
+                    }
+                }
+                compact_offset += size;
+                budget -= std::min(budget, size);
+            }
+            if (base && budget == 0 && compact_offset + header_size <= segment.size) return;
+
+            if (!base) {
+                // Nothing can be copied out of a segment that cannot be mapped, its entries go with it
+                for (auto it = index.begin(); it != index.end();) {
+                    it = it->second.segment == id ? index.erase(it) : std::next(it);
+                }
+            }
+            close_segment(id);
+            compact_queue.pop_front();
+            compact_offset = 0;
+            ++compactions;
+        }
+    }
+
+    // Records are copied byte for byte, their checksums stay valid
+    void relocate(std::unordered_map<uint64_t, Location>::iterator it, const char* base, int64_t now) {
+        Location& location = it->second;
+        if (garbage(location, now)) {
+            index.erase(it);
+            return;
+        }
+        struct iovec part;
+        part.iov_base = const_cast<char*>(base + location.offset);
+        part.iov_len = location.size;
+        Location moved;
+        if (append(&part, 1, location.size, moved)) {
+            moved.expires = location.expires;
+            moved.verified = location.verified;
+            location = moved;
+            segments[moved.segment].live += moved.size;
+        } else {
+            index.erase(it);
+        }
+    }
+
+public:
+    explicit JikanDiskCache(const JikanDiskCacheConfig& config) : config(config) {
+        if (this->config.directory.empty()) throw std::invalid_argument("Jikan disk cache: directory is empty");
+        open_directory();
+    }
+
+    ~JikanDiskCache() {
+        for (auto& item : segments) {
+            if (config.sync_writes) fdatasync(item.second.fd);
+            ::close(item.second.fd);
+        }
+    }
+
+    JikanDiskCache(const JikanDiskCache&) = delete;
+    JikanDiskCache& operator=(const JikanDiskCache&) = delete;
+
+    bool get(const std::string& key, JikanCacheEntry& entry) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = index.find(jikan_hash64(key));
+        if (it == index.end()) return false;
+
+        Location& location = it->second;
+        if (garbage(location, to_unix(std::chrono::system_clock::now()))) return false;
+
+        Segment& segment = segments[location.segment];
+        const Mapping* mapping = mapped(segment, location.offset + location.size);
+        if (!mapping) return false;
+
+        const char* record = static_cast<const char*>(mapping->address) + location.offset;
+        Header header = decode(record);
+        const char* strings = record + header_size;
+        if (header.key_size != key.size() || key.compare(0, key.size(), strings, header.key_size) != 0) return false;
+
+        const char* body = strings + header.key_size + header.etag_size + header.last_modified_size;
+        if (!location.verified) {
+            if (jikan_crc32(body, header.body_size) != header.body_crc) {
+                drop_location(location);
+                index.erase(it);
+                return false;
+            }
+            location.verified = true;
+        }
+
+        entry.body = JikanBuffer(segment.mapping, body, header.body_size);
+        entry.json.reset();
+        entry.etag = utility::conversions::to_string_t(std::string(strings + header.key_size, header.etag_size));
+        entry.last_modified = utility::conversions::to_string_t(
+            std::string(strings + header.key_size + header.etag_size, header.last_modified_size));
+        entry.expires = std::chrono::system_clock::time_point(std::chrono::seconds(header.expires));
+        return true;
+    }
+
+    void put(const std::string& key, const JikanCacheEntry& entry) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        uint32_t before = active;
+        write_record(key, 0, entry);
+        if (active != before) pick_compactions();
+        if (!compact_queue.empty()) compact_step(config.compact_step_bytes);
+    }
+
+    void erase(const std::string& key) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (index.find(jikan_hash64(key)) == index.end()) return;
+        write_record(key, flag_tombstone, JikanCacheEntry());
+    }
+
+    void clear() override {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<uint32_t> ids;
+        for (const auto& item : segments) ids.push_back(item.first);
+        for (uint32_t id : ids) close_segment(id);
+        index.clear();
+        compact_queue.clear();
+        compact_offset = 0;
+        ++active;
+        open_segment(active);
+    }
+
+    // Rewrites every sealed segment that is mostly dead at once. Puts do the same a step at a
+    // time after each new segment, see compact_step_bytes
+    void compact() {
+        std::lock_guard<std::mutex> lock(mutex);
+        pick_compactions();
+        compact_step(UINT64_MAX);
+    }
+
+    JikanDiskCacheStats stats() {
+        std::lock_guard<std::mutex> lock(mutex);
+        JikanDiskCacheStats result;
+        result.entries = index.size();
+        result.segments = segments.size();
+        for (const auto& item : segments) {
+            result.disk_bytes += item.second.size;
+            result.live_bytes += item.second.live;
+        }
+        result.compactions = compactions;
+        return result;
+    }
+};
+
+#endif
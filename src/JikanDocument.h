@@ -0,0 +1,240 @@
+#ifndef JIKAN_DOCUMENT_H
+#define JIKAN_DOCUMENT_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "JikanArena.h"
+#include "JikanBuffer.h"
+#include "JikanJsonReader.h"
+
+// One parsed value. Children of a container sit next to each other in the arena;
+// strings without escapes point straight into the response body.
+struct JikanJsonNode {
+    enum Type : uint8_t {
+        Null = 0,
+        Bool,
+        Number,
+        String,
+        Array,
+        Object
+    };
+
+    Type type;
+    bool boolean;
+    // Element or member count, or string length
+    uint32_t size;
+    // Member name when the node belongs to an object, raw as in the input
+    const char* key;
+    uint32_t key_size;
+    union {
+        double number;
+        const char* string;
+        const JikanJsonNode* children;
+    };
+};
+
+// Read-only handle on a node; missing members and out of range elements read as null
+class JikanJsonView {
+private:
+    const JikanJsonNode* node;
+
+    static const JikanJsonNode* null_node() {
+        static const JikanJsonNode null = JikanJsonNode();
+        return &null;
+    }
+
+public:
+    JikanJsonView(const JikanJsonNode* node = nullptr) : node(node ? node : null_node()) {}
+
+    JikanJsonNode::Type type() const { return node->type; }
+    bool is_null() const { return node->type == JikanJsonNode::Null; }
+    bool is_bool() const { return node->type == JikanJsonNode::Bool; }
+    bool is_number() const { return node->type == JikanJsonNode::Number; }
+    bool is_string() const { return node->type == JikanJsonNode::String; }
+    bool is_array() const { return node->type == JikanJsonNode::Array; }
+    bool is_object() const { return node->type == JikanJsonNode::Object; }
+
+    // Elements, members or string bytes
+    size_t size() const {
+        return node->type >= JikanJsonNode::String ? node->size : 0;
+    }
+
+    // Element of an array, or member of an object by position
+    JikanJsonView operator[](size_t index) const {
+        if ((node->type != JikanJsonNode::Array && node->type != JikanJsonNode::Object) || index >= node->size) return JikanJsonView();
+        return JikanJsonView(node->children + index);
+    }
+
+    JikanJsonView operator[](const char* key) const {
+        if (node->type != JikanJsonNode::Object) return JikanJsonView();
+        size_t key_size = std::strlen(key);
+        for (uint32_t i = 0; i < node->size; ++i) {
+            const JikanJsonNode& member = node->children[i];
+            if (member.key_size == key_size && std::memcmp(member.key, key, key_size) == 0) return JikanJsonView(&member);
+        }
+        return JikanJsonView();
+    }
+
+    JikanJsonView operator[](const std::string& key) const {
+        return (*this)[key.c_str()];
+    }
+
+    bool has_field(const char* key) const {
+        return !(*this)[key].is_null();
+    }
+
+    std::string key() const {
+        return node->key ? std::string(node->key, node->key_size) : std::string();
+    }
+
+    // Valid while the document lives
+    const char* string_data() const {
+        return node->type == JikanJsonNode::String ? node->string : "";
+    }
+
+    std::string as_string() const {
+        return node->type == JikanJsonNode::String ? std::string(node->string, node->size) : std::string();
+    }
+
+    double as_double(double fallback = 0.0) const {
+        return node->type == JikanJsonNode::Number ? node->number : fallback;
+    }
+
+    int64_t as_integer(int64_t fallback = 0) const {
+        return node->type == JikanJsonNode::Number ? static_cast<int64_t>(node->number) : fallback;
+    }
+
+    bool as_bool(bool fallback = false) const {
+        return node->type == JikanJsonNode::Bool ? node->boolean : fallback;
+    }
+};
+
+// A response body parsed into an arena. Dropping the document releases every node at once and
+// hands the arena back to the pool; documents parsed into one shared arena go together.
+class JikanDocument {
+private:
+    static const int max_depth = 256;
+
+    JikanBuffer body;
+    std::shared_ptr<JikanArena> arena;
+    const JikanJsonNode* root_node = nullptr;
+
+    // Children under construction, shared by every nesting level and reused between documents
+    static std::vector<JikanJsonNode>& stack() {
+        static thread_local std::vector<JikanJsonNode> nodes;
+        return nodes;
+    }
+
+    static const JikanJsonNode* finish_container(JikanArena& arena, size_t base) {
+        auto& nodes = stack();
+        size_t count = nodes.size() - base;
+        JikanJsonNode* children = arena.allocate_array<JikanJsonNode>(count > 0 ? count : 1);
+        std::copy(nodes.begin() + base, nodes.end(), children);
+        nodes.resize(base);
+        return children;
+    }
+
+    static void parse_value(JikanJsonReader& reader, JikanArena& arena, std::string& scratch, JikanJsonNode& node, int depth) {
+        if (depth > max_depth) throw std::runtime_error("Jikan json: nesting too deep");
+        char c = reader.peek_value();
+        if (c == '{') {
+            size_t base = stack().size();
+            reader.begin_object();
+            const char* key = nullptr;
+            size_t key_size = 0;
+            while (reader.next_key(key, key_size)) {
+                JikanJsonNode member = JikanJsonNode();
+                member.key = key;
+                member.key_size = static_cast<uint32_t>(key_size);
+                parse_value(reader, arena, scratch, member, depth + 1);
+                stack().push_back(member);
+            }
+            node.type = JikanJsonNode::Object;
+            node.size = static_cast<uint32_t>(stack().size() - base);
+            node.children = finish_container(arena, base);
+        } else if (c == '[') {
+            size_t base = stack().size();
+            reader.begin_array();
+            while (reader.next_element()) {
+                JikanJsonNode element = JikanJsonNode();
+                parse_value(reader, arena, scratch, element, depth + 1);
+                stack().push_back(element);
+            }
+            node.type = JikanJsonNode::Array;
+            node.size = static_cast<uint32_t>(stack().size() - base);
+            node.children = finish_container(arena, base);
+        } else if (c == '"') {
+            const char* begin = nullptr;
+            size_t size = 0;
+            bool escaped = false;
+            reader.read_raw_string(begin, size, escaped);
+            node.type = JikanJsonNode::String;
+            if (escaped) {
+                scratch.clear();
+                reader.unescape_string(begin, size, scratch);
+                node.string = arena.copy(scratch.data(), scratch.size());
+                node.size = static_cast<uint32_t>(scratch.size());
+            } else {
+                node.string = begin;
+                node.size = static_cast<uint32_t>(size);
+            }
+        } else if (c == 't' || c == 'f') {
+            node.type = JikanJsonNode::Bool;
+            node.boolean = reader.read_bool();
+        } else if (c == 'n') {
+            reader.skip_value();
+            node.type = JikanJsonNode::Null;
+        } else {
+            node.type = JikanJsonNode::Number;
+            node.number = reader.read_double();
+        }
+    }
+
+public:
+    JikanDocument() {}
+
+    // Parses body into arena; pass one arena to several parses to release a whole batch in one step.
+    // The arena is not locked, so parses sharing one must not run concurrently.
+    static JikanDocument parse(const JikanBuffer& body, std::shared_ptr<JikanArena> arena = JikanArenaPool::acquire()) {
+        JikanDocument document;
+        document.body = body;
+        document.arena = std::move(arena);
+        JikanJsonNode* root = document.arena->allocate_array<JikanJsonNode>(1);
+        *root = JikanJsonNode();
+        JikanJsonReader reader(body.data(), body.size());
+        static thread_local std::string scratch;
+        size_t base = stack().size();
+        try {
+            parse_value(reader, *document.arena, scratch, *root, 0);
+        } catch (...) {
+            stack().resize(base);
+            throw;
+        }
+        document.root_node = root;
+        return document;
+    }
+
+    JikanJsonView root() const {
+        return JikanJsonView(root_node);
+    }
+
+    JikanJsonView operator[](const char* key) const {
+        return root()[key];
+    }
+
+    const JikanBuffer& bytes() const {
+        return body;
+    }
+
+    const std::shared_ptr<JikanArena>& memory() const {
+        return arena;
+    }
+};
+
+#endif
@@ -0,0 +1,453 @@
+#ifndef JIKAN_EXPORT_H
+#define JIKAN_EXPORT_H
+
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Jikan.h"
+
+enum class JikanUserList {
+    Friends,
+    History,
+    Reviews,
+    Clubs,
+    // Discontinued by MyAnimeList in May 2022, kept for mirrors that still serve them
+    AnimeList,
+    MangaList
+};
+
+enum class JikanExportFormat {
+    // One object per line: {"username":..,"list":..,"page":..,"item":{..}}
+    Ndjson,
+    // username,list,page,mal_id,name,date,item with the item as a json cell
+    Csv
+};
+
+struct JikanExportConfig {
+    std::vector<JikanUserList> lists = {JikanUserList::Friends, JikanUserList::History};
+    JikanExportFormat format = JikanExportFormat::Ndjson;
+    // Page requests outstanding across all users; the rate limiter still has the last word
+    size_t max_in_flight = 8;
+    // Output is handed to the sink whenever this much has piled up
+    size_t buffer_bytes = 256 * 1024;
+    // Where finished pages are remembered between runs; empty keeps progress in memory
+    std::string checkpoint_path;
+    size_t checkpoint_every = 50;
+    bool csv_header = true;
+    JikanPriority priority = JikanPriority::Background;
+};
+
+struct JikanExportReport {
+    uint64_t users = 0;
+    uint64_t pages = 0;
+    uint64_t rows = 0;
+    uint64_t failed_pages = 0;
+    // Pages the checkpoint already had
+    uint64_t skipped_pages = 0;
+};
+
+// Exports paged user lists for many users at once:
+//     JikanExportConfig config;
+//     config.checkpoint_path = "users.export";
+//     JikanUserExporter exporter(api, config);
+//     auto report = exporter.run(usernames, std::make_shared<JikanFdSink>(fd)).get();
+// Once a user's first page reports how many pages there are, the rest are fetched side by side.
+// Rows reach the sink before their page is checkpointed, so a crash can repeat a page but never lose one.
+class JikanUserExporter {
+private:
+    struct Job {
+        std::string username;
+        JikanUserList list;
+        int page;
+    };
+
+    // Progress of one user's list: pages done so far and the page count once known
+    struct Progress {
+        std::set<int> done;
+        int last_page = 0;
+    };
+
+    typedef std::pair<std::string, JikanUserList> Key;
+
+    struct State {
+        Jikan* api;
+        JikanExportConfig config;
+        std::shared_ptr<JikanSink> sink;
+
+        std::mutex mutex;
+        std::deque<Job> queue;
+        size_t in_flight = 0;
+        bool finished = false;
+        size_t since_checkpoint = 0;
+        JikanExportReport report;
+        std::map<Key, Progress> progress;
+
+        // Serializes the sink, and the checkpoint file after it
+        std::mutex output_mutex;
+        std::mutex checkpoint_mutex;
+        std::string buffer;
+        std::exception_ptr output_error;
+        pplx::task_completion_event<JikanExportReport> done;
+    };
+
+    Jikan& api;
+    JikanExportConfig config;
+    std::map<Key, Progress> progress;
+
+    static const char* list_name(JikanUserList list) {
+        switch (list) {
+            case JikanUserList::Friends: return "friends";
+            case JikanUserList::History: return "history";
+            case JikanUserList::Reviews: return "reviews";
+            case JikanUserList::Clubs: return "clubs";
+            case JikanUserList::AnimeList: return "animelist";
+            case JikanUserList::MangaList: return "mangalist";
+        }
+        return "friends";
+    }
+
+    static bool parse_list(const std::string& name, JikanUserList& list) {
+        static const JikanUserList all[] = {JikanUserList::Friends, JikanUserList::History, JikanUserList::Reviews,
+                                            JikanUserList::Clubs, JikanUserList::AnimeList, JikanUserList::MangaList};
+        for (JikanUserList candidate : all) {
+            if (name == list_name(candidate)) {
+                list = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool paged(JikanUserList list) {
+        return list != JikanUserList::History;
+    }
+
+    static pplx::task<web::json::value> request(Jikan& api, const Job& job) {
+        switch (job.list) {
+            case JikanUserList::Friends: return api.getUserFriends(job.username, job.page);
+            case JikanUserList::History: return api.getUserHistory(job.username);
+            case JikanUserList::Reviews: return api.getUserReviews(job.username, job.page);
+            case JikanUserList::Clubs: return api.getUserClubs(job.username, job.page);
+            case JikanUserList::AnimeList: return api.getUserAnimelist(job.username, job.page);
+            case JikanUserList::MangaList: return api.getUserMangaList(job.username, job.page);
+        }
+        return api.getUserFriends(job.username, job.page);
+    }
+
+    static std::string utf8(const web::json::value& value) {
+        return utility::conversions::to_utf8string(value.serialize());
+    }
+
+    static std::string csv_cell(const std::string& value) {
+        if (value.find_first_of(",\"\n\r") == std::string::npos) return value;
+        std::string quoted = "\"";
+        for (char c : value) {
+            if (c == '"') quoted += '"';
+            quoted += c;
+        }
+        quoted += '"';
+        return quoted;
+    }
+
+    // The thing a list item is about: the entry of history and reviews, the user of a friend, the club itself
+    static const web::json::value& subject(const web::json::value& item) {
+        if (item.has_field(U("entry"))) return item.at(U("entry"));
+        if (item.has_field(U("user"))) return item.at(U("user"));
+        return item;
+    }
+
+    static std::string text_field(const web::json::value& object, const utility::string_t& name) {
+        if (!object.is_object() || !object.has_field(name)) return std::string();
+        const auto& value = object.at(name);
+        if (value.is_string()) return utility::conversions::to_utf8string(value.as_string());
+        if (value.is_null()) return std::string();
+        return utf8(value);
+    }
+
+    static void format_row(const JikanExportConfig& config, const Job& job, const web::json::value& item, std::string& out) {
+        if (config.format == JikanExportFormat::Ndjson) {
+            web::json::value line = web::json::value::object();
+            line[U("username")] = web::json::value::string(utility::conversions::to_string_t(job.username));
+            line[U("list")] = web::json::value::string(utility::conversions::to_string_t(list_name(job.list)));
+            line[U("page")] = web::json::value::number(job.page);
+            line[U("item")] = item;
+            out += utf8(line);
+            out += '\n';
+            return;
+        }
+        const auto& about = subject(item);
+        std::string name = text_field(about, U("name"));
+        if (name.empty()) name = text_field(about, U("title"));
+        if (name.empty()) name = text_field(about, U("username"));
+        std::string date = text_field(item, U("date"));
+        if (date.empty()) date = text_field(item, U("last_online"));
+        out += csv_cell(job.username) + ',' + list_name(job.list) + ',' + std::to_string(job.page) + ',' +
+               csv_cell(text_field(about, U("mal_id"))) + ',' + csv_cell(name) + ',' + csv_cell(date) + ',' +
+               csv_cell(utf8(item)) + '\n';
+    }
+
+    enum class Flush { IfFull, Now, Finish };
+
+    static void write(const std::shared_ptr<State>& state, const std::string& rows, Flush flush) {
+        std::lock_guard<std::mutex> lock(state->output_mutex);
+        if (state->output_error) return;
+        state->buffer += rows;
+        if (flush == Flush::IfFull && state->buffer.size() < state->config.buffer_bytes) return;
+        try {
+            if (!state->buffer.empty()) state->sink->write(state->buffer.data(), state->buffer.size());
+            if (flush == Flush::Finish) state->sink->finish();
+        } catch (...) {
+            state->output_error = std::current_exception();
+        }
+        state->buffer.clear();
+    }
+
+    // Queues the pages of a list the checkpoint does not have yet; called with the state mutex held
+    static void queue_pages(State& state, const Key& key, int from, int to) {
+        const Progress& known = state.progress[key];
+        for (int page = from; page <= to; ++page) {
+            if (known.done.count(page)) {
+                ++state.report.skipped_pages;
+                continue;
+            }
+            state.queue.push_back(Job{key.first, key.second, page});
+        }
+    }
+
+    static int last_page(const web::json::value& result) {
+        if (!result.has_object_field(U("pagination"))) return 1;
+        const auto& pagination = result.at(U("pagination"));
+        if (pagination.has_number_field(U("last_visible_page"))) return std::max(1, pagination.at(U("last_visible_page")).as_integer());
+        bool more = pagination.has_boolean_field(U("has_next_page")) && pagination.at(U("has_next_page")).as_bool();
+        return more ? 2 : 1;
+    }
+
+    static void finish_page(const std::shared_ptr<State>& state, const Job& job, const web::json::value& result, bool ok) {
+        std::string rows;
+        size_t count = 0;
+        if (ok && result.has_array_field(U("data"))) {
+            for (const auto& item : result.at(U("data")).as_array()) {
+                format_row(state->config, job, item, rows);
+                ++count;
+            }
+        }
+        if (ok) write(state, rows, Flush::IfFull);
+
+        bool save_now = false;
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            --state->in_flight;
+            if (!ok) {
+                ++state->report.failed_pages;
+            } else {
+                ++state->report.pages;
+                state->report.rows += count;
+                Key key(job.username, job.list);
+                Progress& progress = state->progress[key];
+                if (job.page == 1 && paged(job.list)) {
+                    // Further pages are only known now; without a page count the next one is probed
+                    progress.last_page = last_page(result);
+                    queue_pages(*state, key, 2, progress.last_page);
+                } else if (job.page >= progress.last_page && paged(job.list) && count > 0 &&
+                           result.has_object_field(U("pagination")) &&
+                           result.at(U("pagination")).has_boolean_field(U("has_next_page")) &&
+                           result.at(U("pagination")).at(U("has_next_page")).as_bool()) {
+                    progress.last_page = job.page + 1;
+                    queue_pages(*state, key, job.page + 1, job.page + 1);
+                }
+                progress.done.insert(job.page);
+                if (++state->since_checkpoint >= state->config.checkpoint_every) {
+                    state->since_checkpoint = 0;
+                    save_now = true;
+                }
+            }
+        }
+        if (save_now) {
+            try {
+                checkpoint(state, Flush::Now);
+            } catch (...) {
+                // A failed save only costs progress; the final one reports the error
+            }
+        }
+        pump(state);
+    }
+
+    static void checkpoint(const std::shared_ptr<State>& state, Flush flush) {
+        std::lock_guard<std::mutex> order(state->checkpoint_mutex);
+        // Snapshot first: finish_page buffers a page's rows before marking it done, so the flush below
+        // puts out the rows of every page in the snapshot. A page marked done after the snapshot is
+        // fetched again after a crash instead of being lost.
+        std::map<Key, Progress> snapshot;
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            snapshot = state->progress;
+        }
+        write(state, std::string(), flush);
+        {
+            // Rows that never reached the sink must not be checkpointed as done
+            std::lock_guard<std::mutex> lock(state->output_mutex);
+            if (state->output_error) return;
+        }
+        save(state->config.checkpoint_path, snapshot);
+    }
+
+    static void pump(const std::shared_ptr<State>& state) {
+        std::vector<Job> batch;
+        bool finished = false;
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (state->finished) return;
+            while (state->in_flight < state->config.max_in_flight && !state->queue.empty()) {
+                batch.push_back(state->queue.front());
+                state->queue.pop_front();
+                ++state->in_flight;
+            }
+            if (batch.empty() && state->in_flight == 0) finished = state->finished = true;
+        }
+        if (finished) {
+            try {
+                checkpoint(state, Flush::Finish);
+            } catch (...) {
+                state->done.set_exception(std::current_exception());
+                return;
+            }
+            std::lock_guard<std::mutex> lock(state->output_mutex);
+            if (state->output_error) {
+                state->done.set_exception(state->output_error);
+            } else {
+                state->done.set(state->report);
+            }
+            return;
+        }
+
+        for (const auto& job : batch) {
+            pplx::task<web::json::value> task;
+            try {
+                JikanPriorityScope scope(state->config.priority);
+                task = request(*state->api, job);
+            } catch (const std::exception& e) {
+                task = pplx::task_from_exception<web::json::value>(std::runtime_error(e.what()));
+            }
+            task.then([state, job](pplx::task<web::json::value> previousTask) {
+                web::json::value result;
+                bool ok = false;
+                try {
+                    result = previousTask.get();
+                    ok = !result.has_field(U("error"));
+                } catch (const std::exception&) {
+                    ok = false;
+                }
+                finish_page(state, job, result, ok);
+            });
+        }
+    }
+
+    // Text file, written to a temporary name and renamed over the old one
+    static void save(const std::string& path, const std::map<Key, Progress>& progress) {
+        if (path.empty()) return;
+        std::string temporary = path + ".tmp";
+        {
+            std::ofstream out(temporary, std::ios::trunc);
+            if (!out) throw std::runtime_error("Jikan export: cannot write " + temporary);
+            out << "jikan-export 1\n";
+            for (const auto& item : progress) {
+                out << "list " << list_name(item.first.second) << ' ' << item.first.first << ' ' << item.second.last_page;
+                for (int page : item.second.done) out << ' ' << page;
+                out << '\n';
+            }
+            out.flush();
+            if (!out) throw std::runtime_error("Jikan export: cannot write " + temporary);
+        }
+        if (std::rename(temporary.c_str(), path.c_str()) != 0) throw std::runtime_error("Jikan export: cannot replace " + path);
+    }
+
+    void load() {
+        if (config.checkpoint_path.empty()) return;
+        std::ifstream in(config.checkpoint_path);
+        if (!in) return;
+        std::string line;
+        if (!std::getline(in, line) || line != "jikan-export 1") return;
+        while (std::getline(in, line)) {
+            std::istringstream fields(line);
+            std::string type, name, username;
+            int last = 0;
+            fields >> type >> name >> username >> last;
+            JikanUserList list;
+            if (!fields || type != "list" || !parse_list(name, list)) continue;
+            Progress& entry = progress[Key(username, list)];
+            entry.last_page = last;
+            int page = 0;
+            while (fields >> page) entry.done.insert(page);
+        }
+    }
+
+public:
+    JikanUserExporter(Jikan& api, const JikanExportConfig& config = JikanExportConfig()) : api(api), config(config) {
+        load();
+    }
+
+    // Usernames from the /users search, for building a cohort
+    static std::vector<std::string> search_users(Jikan& api, const std::string& query, int max_pages = 1) {
+        std::vector<std::string> usernames;
+        for (int page = 1; page <= max_pages; ++page) {
+            web::json::value result = api.getUsersSearch(page, 0, query).get();
+            if (!result.has_array_field(U("data"))) break;
+            for (const auto& user : result.at(U("data")).as_array()) {
+                if (user.has_string_field(U("username"))) usernames.push_back(utility::conversions::to_utf8string(user.at(U("username")).as_string()));
+            }
+            if (!result.has_object_field(U("pagination")) || !result.at(U("pagination")).has_boolean_field(U("has_next_page")) ||
+                !result.at(U("pagination")).at(U("has_next_page")).as_bool()) {
+                break;
+            }
+        }
+        return usernames;
+    }
+
+    // Completes when every list of every user is written or has failed; failed pages are retried by the next run.
+    // The Jikan object and the exporter must outlive the task.
+    pplx::task<JikanExportReport> run(const std::vector<std::string>& usernames, std::shared_ptr<JikanSink> sink) {
+        auto state = std::make_shared<State>();
+        state->api = &api;
+        state->config = config;
+        if (state->config.max_in_flight == 0) state->config.max_in_flight = 1;
+        state->sink = std::move(sink);
+        state->progress = progress;
+        state->report.users = usernames.size();
+
+        if (config.format == JikanExportFormat::Csv && config.csv_header) {
+            state->buffer = "username,list,page,mal_id,name,date,item\n";
+        }
+        for (const auto& username : usernames) {
+            for (JikanUserList list : config.lists) {
+                Key key(username, list);
+                const Progress& known = state->progress[key];
+                if (known.done.count(1) && known.last_page > 0) {
+                    // First page already done: the rest of the pages are known from the checkpoint
+                    queue_pages(*state, key, 1, known.last_page);
+                } else {
+                    queue_pages(*state, key, 1, 1);
+                }
+            }
+        }
+
+        auto self_progress = &progress;
+        auto result = pplx::create_task(state->done).then([state, self_progress](JikanExportReport report) {
+            *self_progress = state->progress;
+            return report;
+        });
+        pump(state);
+        return result;
+    }
+};
+
+#endif
@@ -0,0 +1,355 @@
+#ifndef JIKAN_JSON_READER_H
+#define JIKAN_JSON_READER_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <locale.h>
+#ifdef __APPLE__
+#include <xlocale.h>
+#endif
+
+// Pull parser over raw UTF-8 JSON. Nothing is allocated unless a string value is read,
+// values the caller does not ask for are skipped by scanning.
+class JikanJsonReader {
+private:
+    const char* pos;
+    const char* end;
+    // Whether the container being read has not produced an element yet
+    bool first = true;
+
+    static locale_t c_locale() {
+        static locale_t locale = newlocale(LC_ALL_MASK, "C", static_cast<locale_t>(0));
+        return locale;
+    }
+
+    [[noreturn]] void fail(const char* what) const {
+        throw std::runtime_error(std::string("Jikan json: ") + what);
+    }
+
+    void skip_ws() {
+        while (pos < end && (*pos == ' ' || *pos == '\n' || *pos == '\r' || *pos == '\t')) ++pos;
+    }
+
+    char peek() {
+        skip_ws();
+        if (pos >= end) fail("unexpected end of input");
+        return *pos;
+    }
+
+    void expect(char c) {
+        if (peek() != c) fail("unexpected character");
+        ++pos;
+    }
+
+    void expect_literal(const char* literal) {
+        size_t size = std::strlen(literal);
+        if (static_cast<size_t>(end - pos) < size || std::memcmp(pos, literal, size) != 0) fail("bad literal");
+        pos += size;
+    }
+
+    static void append_utf8(std::string& out, uint32_t code) {
+        if (code < 0x80) {
+            out += static_cast<char>(code);
+        } else if (code < 0x800) {
+            out += static_cast<char>(0xC0 | (code >> 6));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else if (code < 0x10000) {
+            out += static_cast<char>(0xE0 | (code >> 12));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (code >> 18));
+            out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+    }
+
+    uint32_t read_hex4() {
+        if (end - pos < 4) fail("bad unicode escape");
+        uint32_t code = 0;
+        for (int i = 0; i < 4; ++i) {
+            char c = *pos++;
+            code <<= 4;
+            if (c >= '0' && c <= '9') code |= c - '0';
+            else if (c >= 'a' && c <= 'f') code |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') code |= c - 'A' + 10;
+            else fail("bad unicode escape");
+        }
+        return code;
+    }
+
+    // Leaves pos after the closing quote; returns the raw bytes between the quotes
+    void scan_string(const char*& begin, size_t& size, bool& escaped) {
+        expect('"');
+        begin = pos;
+        escaped = false;
+        while (pos < end && *pos != '"') {
+            if (*pos == '\\') {
+                escaped = true;
+                ++pos;
+            }
+            ++pos;
+        }
+        if (pos >= end) fail("unterminated string");
+        size = static_cast<size_t>(pos - begin);
+        ++pos;
+    }
+
+    void unescape(const char* begin, size_t size, std::string& out) {
+        const char* saved = pos;
+        const char* saved_end = end;
+        pos = begin;
+        end = begin + size;
+        while (pos < end) {
+            char c = *pos++;
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            char e = *pos++;
+            switch (e) {
+                case 'n': out += '\n'; break;
+                case 't': out += '\t'; break;
+                case 'r': out += '\r'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'u': {
+                    uint32_t code = read_hex4();
+                    if (code >= 0xD800 && code < 0xDC00 && end - pos >= 6 && pos[0] == '\\' && pos[1] == 'u') {
+                        pos += 2;
+                        uint32_t low = read_hex4();
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    append_utf8(out, code);
+                    break;
+                }
+                default: out += e; break;
+            }
+        }
+        pos = saved;
+        end = saved_end;
+    }
+
+public:
+    JikanJsonReader(const char* data, size_t size) : pos(data), end(data + size) {}
+
+    bool at_null() {
+        return peek() == 'n';
+    }
+
+    bool is_object() {
+        return peek() == '{';
+    }
+
+    bool is_array() {
+        return peek() == '[';
+    }
+
+    void begin_object() {
+        expect('{');
+        skip_ws();
+        first = true;
+    }
+
+    // Next key of the current object, false at its closing brace. Keys are returned unescaped
+    // in place, which is fine for the ASCII keys the API uses.
+    bool next_key(const char*& key, size_t& size) {
+        skip_ws();
+        if (peek() == '}') {
+            ++pos;
+            first = false;
+            return false;
+        }
+        if (!first) expect(',');
+        first = false;
+        bool escaped = false;
+        scan_string(key, size, escaped);
+        expect(':');
+        return true;
+    }
+
+    void begin_array() {
+        expect('[');
+        first = true;
+    }
+
+    // True while the current array has another element to read
+    bool next_element() {
+        if (peek() == ']') {
+            ++pos;
+            first = false;
+            return false;
+        }
+        if (!first) expect(',');
+        first = false;
+        return true;
+    }
+
+    // First character of the next value: '{', '[', '"', 't', 'f', 'n', or the start of a number
+    char peek_value() {
+        return peek();
+    }
+
+    // String value left as it is in the input; when escaped is set, unescape_string gives its text
+    void read_raw_string(const char*& begin, size_t& size, bool& escaped) {
+        scan_string(begin, size, escaped);
+    }
+
+    void unescape_string(const char* begin, size_t size, std::string& out) {
+        unescape(begin, size, out);
+    }
+
+    std::string read_string() {
+        std::string out;
+        read_string(out);
+        return out;
+    }
+
+    // Null reads as an empty string
+    void read_string(std::string& out) {
+        out.clear();
+        if (at_null()) {
+            expect_literal("null");
+            return;
+        }
+        const char* begin = nullptr;
+        size_t size = 0;
+        bool escaped = false;
+        scan_string(begin, size, escaped);
+        if (escaped) {
+            out.reserve(size);
+            unescape(begin, size, out);
+        } else {
+            out.assign(begin, size);
+        }
+    }
+
+    // Null reads as fallback
+    double read_double(double fallback = 0.0) {
+        if (at_null()) {
+            expect_literal("null");
+            return fallback;
+        }
+        // The token is copied out and converted in the C locale, so the result is correctly rounded
+        // and a decimal comma in the process locale does not matter
+        const char* begin = pos;
+        if (*pos == '-') ++pos;
+        if (pos >= end || *pos < '0' || *pos > '9') fail("bad number");
+        while (pos < end && *pos >= '0' && *pos <= '9') ++pos;
+        if (pos < end && *pos == '.') {
+            ++pos;
+            while (pos < end && *pos >= '0' && *pos <= '9') ++pos;
+        }
+        size_t size = static_cast<size_t>(pos - begin);
+        // Clamped far past the double range, so an exponent of any length ends in zero or infinity
+        int exponent = 0;
+        if (pos < end && (*pos == 'e' || *pos == 'E')) {
+            ++pos;
+            bool negative_exponent = false;
+            if (pos < end && (*pos == '+' || *pos == '-')) negative_exponent = *pos++ == '-';
+            if (pos >= end || *pos < '0' || *pos > '9') fail("bad number");
+            while (pos < end && *pos >= '0' && *pos <= '9') {
+                if (exponent < 100000) exponent = exponent * 10 + (*pos - '0');
+                ++pos;
+            }
+            if (negative_exponent) exponent = -exponent;
+        }
+        // Numbers in API answers are short; only a very long mantissa goes to the heap
+        char local[64];
+        std::string spill;
+        char* buffer = local;
+        if (size + 16 > sizeof(local)) {
+            spill.resize(size + 16);
+            buffer = &spill[0];
+        }
+        std::memcpy(buffer, begin, size);
+        std::snprintf(buffer + size, 16, "e%d", exponent);
+        return strtod_l(buffer, nullptr, c_locale());
+    }
+
+    int64_t read_int(int64_t fallback = 0) {
+        if (at_null()) {
+            expect_literal("null");
+            return fallback;
+        }
+        bool negative = false;
+        if (*pos == '-') {
+            negative = true;
+            ++pos;
+        }
+        if (pos >= end || *pos < '0' || *pos > '9') fail("bad number");
+        int64_t value = 0;
+        while (pos < end && *pos >= '0' && *pos <= '9') value = value * 10 + (*pos++ - '0');
+        // A fractional or exponent part is dropped
+        if (pos < end && (*pos == '.' || *pos == 'e' || *pos == 'E')) {
+            ++pos;
+            while (pos < end && ((*pos >= '0' && *pos <= '9') || *pos == '+' || *pos == '-' || *pos == 'e' || *pos == 'E')) ++pos;
+        }
+        return negative ? -value : value;
+    }
+
+    bool read_bool(bool fallback = false) {
+        char c = peek();
+        if (c == 't') {
+            expect_literal("true");
+            return true;
+        }
+        if (c == 'f') {
+            expect_literal("false");
+            return false;
+        }
+        expect_literal("null");
+        return fallback;
+    }
+
+    void skip_value() {
+        char c = peek();
+        if (c == '"') {
+            const char* begin = nullptr;
+            size_t size = 0;
+            bool escaped = false;
+            scan_string(begin, size, escaped);
+            return;
+        }
+        if (c == '{' || c == '[') {
+            int depth = 0;
+            while (pos < end) {
+                char d = *pos;
+                if (d == '"') {
+                    const char* begin = nullptr;
+                    size_t size = 0;
+                    bool escaped = false;
+                    scan_string(begin, size, escaped);
+                    continue;
+                }
+                ++pos;
+                if (d == '{' || d == '[') {
+                    ++depth;
+                } else if (d == '}' || d == ']') {
+                    if (--depth == 0) {
+                        first = false;
+                        return;
+                    }
+                }
+            }
+            fail("unterminated container");
+        }
+        // number, true, false or null
+        while (pos < end && *pos != ',' && *pos != '}' && *pos != ']' &&
+               *pos != ' ' && *pos != '\n' && *pos != '\r' && *pos != '\t') {
+            ++pos;
+        }
+    }
+
+    static bool key_is(const char* key, size_t size, const char* name) {
+        return std::strlen(name) == size && std::memcmp(key, name, size) == 0;
+    }
+};
+
+#endif
@@ -0,0 +1,350 @@
+#ifndef JIKAN_METRICS_H
+#define JIKAN_METRICS_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct JikanHistogramSnapshot {
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t p50 = 0;
+    uint64_t p90 = 0;
+    uint64_t p99 = 0;
+    uint64_t max = 0;
+};
+
+// Log-linear buckets in the spirit of HdrHistogram: 8 sub-buckets per power of two, about 12% precision.
+// Recording is a handful of relaxed atomic increments.
+class JikanHistogram {
+public:
+    static const int bucket_count = 62 * 8;
+
+private:
+    std::atomic<uint64_t> counts[bucket_count];
+    std::atomic<uint64_t> total{0};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> largest{0};
+
+    static int log2(uint64_t value) {
+#if defined(__GNUC__)
+        return 63 - __builtin_clzll(value);
+#else
+        int result = 0;
+        while (value >>= 1) ++result;
+        return result;
+#endif
+    }
+
+public:
+    JikanHistogram() {
+        for (auto& count : counts) count.store(0, std::memory_order_relaxed);
+    }
+
+    static int index(uint64_t value) {
+        if (value < 8) return static_cast<int>(value);
+        int exponent = log2(value);
+        int mantissa = static_cast<int>((value >> (exponent - 3)) & 7);
+        return (exponent - 2) * 8 + mantissa;
+    }
+
+    // Largest value that still falls into bucket i
+    static uint64_t upper_bound(int i) {
+        if (i < 8) return static_cast<uint64_t>(i);
+        int exponent = i / 8 + 2;
+        uint64_t mantissa = static_cast<uint64_t>(i % 8);
+        return ((8 + mantissa + 1) << (exponent - 3)) - 1;
+    }
+
+    void record(uint64_t value) {
+        counts[index(value)].fetch_add(1, std::memory_order_relaxed);
+        total.fetch_add(1, std::memory_order_relaxed);
+        sum.fetch_add(value, std::memory_order_relaxed);
+        uint64_t seen = largest.load(std::memory_order_relaxed);
+        while (value > seen && !largest.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    uint64_t count_at(int i) const {
+        return counts[i].load(std::memory_order_relaxed);
+    }
+
+    uint64_t count() const {
+        return total.load(std::memory_order_relaxed);
+    }
+
+    JikanHistogramSnapshot snapshot() const {
+        JikanHistogramSnapshot result;
+        uint64_t buckets[bucket_count];
+        for (int i = 0; i < bucket_count; ++i) {
+            buckets[i] = counts[i].load(std::memory_order_relaxed);
+            result.count += buckets[i];
+        }
+        result.sum = sum.load(std::memory_order_relaxed);
+        result.max = largest.load(std::memory_order_relaxed);
+
+        uint64_t seen = 0;
+        const double quantiles[3] = {0.5, 0.9, 0.99};
+        uint64_t* targets[3] = {&result.p50, &result.p90, &result.p99};
+        int next = 0;
+        for (int i = 0; i < bucket_count && next < 3; ++i) {
+            seen += buckets[i];
+            while (next < 3 && result.count > 0 && seen >= quantiles[next] * result.count) {
+                *targets[next++] = std::min(upper_bound(i), result.max);
+            }
+        }
+        return result;
+    }
+};
+
+// One finished request as seen by make_api_call
+struct JikanRequestTrace {
+    typedef std::chrono::steady_clock clock;
+
+    std::string endpoint;
+    clock::time_point started;
+    // Waiting for the rate limiter, summed over the attempts; retry backoffs are not part of it
+    clock::duration queue_wait = clock::duration::zero();
+    clock::time_point dispatched;
+    clock::time_point first_byte;
+    clock::time_point finished;
+    int status = 0;
+    uint64_t bytes = 0;
+    // The request needed a new pooled http_client; cpprest does not report socket reuse
+    bool new_client = false;
+};
+
+struct JikanEndpointSnapshot {
+    std::string endpoint;
+    uint64_t requests = 0;
+    uint64_t status_2xx = 0;
+    uint64_t status_3xx = 0;
+    uint64_t status_4xx = 0;
+    uint64_t status_5xx = 0;
+    uint64_t failures = 0;
+    uint64_t bytes = 0;
+    uint64_t new_clients = 0;
+    // Latencies in microseconds
+    JikanHistogramSnapshot queue_wait;
+    JikanHistogramSnapshot first_byte;
+    JikanHistogramSnapshot total;
+    JikanHistogramSnapshot response_bytes;
+};
+
+class JikanMetrics {
+private:
+    struct Series {
+        std::string endpoint;
+        JikanHistogram queue_wait;
+        JikanHistogram first_byte;
+        JikanHistogram total;
+        JikanHistogram response_bytes;
+        std::atomic<uint64_t> requests{0};
+        std::atomic<uint64_t> status_2xx{0};
+        std::atomic<uint64_t> status_3xx{0};
+        std::atomic<uint64_t> status_4xx{0};
+        std::atomic<uint64_t> status_5xx{0};
+        std::atomic<uint64_t> failures{0};
+        std::atomic<uint64_t> bytes{0};
+        std::atomic<uint64_t> new_clients{0};
+
+        explicit Series(const std::string& endpoint) : endpoint(endpoint) {}
+    };
+
+    // Open addressing over endpoint templates; slots are only ever filled, so lookups need no lock
+    static const size_t slot_count = 512;
+    std::atomic<Series*> slots[slot_count];
+
+    Series* series(const std::string& endpoint) {
+        size_t start = std::hash<std::string>()(endpoint) % slot_count;
+        for (size_t probe = 0; probe < slot_count; ++probe) {
+            std::atomic<Series*>& slot = slots[(start + probe) % slot_count];
+            Series* current = slot.load(std::memory_order_acquire);
+            if (!current) {
+                Series* created = new Series(endpoint);
+                if (slot.compare_exchange_strong(current, created, std::memory_order_acq_rel)) return created;
+                delete created;
+            }
+            if (current->endpoint == endpoint) return current;
+        }
+        return nullptr;
+    }
+
+    static uint64_t micros(JikanRequestTrace::clock::duration duration) {
+        auto count = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+        return count > 0 ? static_cast<uint64_t>(count) : 0;
+    }
+
+    // Label values escape backslash, double quote and newline, as the exposition format asks
+    static std::string label(const std::string& value) {
+        std::string result;
+        result.reserve(value.size());
+        for (char c : value) {
+            if (c == '\\') result += "\\\\";
+            else if (c == '"') result += "\\\"";
+            else if (c == '\n') result += "\\n";
+            else result += c;
+        }
+        return result;
+    }
+
+    static void prometheus_histogram(std::string& out, const char* name, const std::string& endpoint,
+                                     const JikanHistogram& histogram, double scale, const std::vector<double>& bounds) {
+        char line[512];
+        std::string escaped = label(endpoint);
+        uint64_t cumulative = 0;
+        int bucket = 0;
+        for (double bound : bounds) {
+            while (bucket < JikanHistogram::bucket_count && JikanHistogram::upper_bound(bucket) * scale <= bound) {
+                cumulative += histogram.count_at(bucket++);
+            }
+            std::snprintf(line, sizeof(line), "%s_bucket{endpoint=\"%s\",le=\"%g\"} %llu\n",
+                          name, escaped.c_str(), bound, static_cast<unsigned long long>(cumulative));
+            out += line;
+        }
+        JikanHistogramSnapshot snapshot = histogram.snapshot();
+        std::snprintf(line, sizeof(line), "%s_bucket{endpoint=\"%s\",le=\"+Inf\"} %llu\n%s_sum{endpoint=\"%s\"} %g\n%s_count{endpoint=\"%s\"} %llu\n",
+                      name, escaped.c_str(), static_cast<unsigned long long>(snapshot.count),
+                      name, escaped.c_str(), snapshot.sum * scale,
+                      name, escaped.c_str(), static_cast<unsigned long long>(snapshot.count));
+        out += line;
+    }
+
+public:
+    JikanMetrics() {
+        for (auto& slot : slots) slot.store(nullptr, std::memory_order_relaxed);
+    }
+
+    ~JikanMetrics() {
+        for (auto& slot : slots) delete slot.load();
+    }
+
+    JikanMetrics(const JikanMetrics&) = delete;
+    JikanMetrics& operator=(const JikanMetrics&) = delete;
+
+    // "/anime/5114/characters?page=2" -> "/anime/{id}/characters"
+    static std::string endpoint_template(const std::string& endpoint) {
+        std::string path = endpoint.substr(0, endpoint.find('?'));
+        std::string result;
+        size_t segment = 0;
+        std::string first;
+        size_t pos = 0;
+        while (pos < path.size()) {
+            size_t slash = path.find('/', pos + 1);
+            if (slash == std::string::npos) slash = path.size();
+            std::string part = path.substr(pos + 1, slash - pos - 1);
+            bool numeric = !part.empty() && part.find_first_not_of("0123456789") == std::string::npos;
+
+            if (segment == 0) first = part;
+            if (first == "seasons" && numeric && segment == 1) part = "{year}";
+            else if (first == "seasons" && numeric && segment == 2) part = "{season}";
+            else if (numeric) part = "{id}";
+            else if (first == "users" && segment == 1 && part != "userbyid") part = "{username}";
+
+            result += "/" + part;
+            pos = slash;
+            ++segment;
+        }
+        return result.empty() ? "/" : result;
+    }
+
+    void record(const JikanRequestTrace& trace) {
+        Series* target = series(trace.endpoint);
+        if (!target) return;
+
+        ++target->requests;
+        if (trace.status >= 200 && trace.status < 300) ++target->status_2xx;
+        else if (trace.status >= 300 && trace.status < 400) ++target->status_3xx;
+        else if (trace.status >= 400 && trace.status < 500) ++target->status_4xx;
+        else if (trace.status >= 500) ++target->status_5xx;
+        else ++target->failures;
+        if (trace.new_client) ++target->new_clients;
+        target->bytes += trace.bytes;
+
+        if (trace.dispatched > trace.started) target->queue_wait.record(micros(trace.queue_wait));
+        if (trace.first_byte > trace.dispatched) target->first_byte.record(micros(trace.first_byte - trace.dispatched));
+        target->total.record(micros(trace.finished - trace.started));
+        target->response_bytes.record(trace.bytes);
+    }
+
+    std::vector<JikanEndpointSnapshot> snapshot() const {
+        std::vector<JikanEndpointSnapshot> result;
+        for (const auto& slot : slots) {
+            const Series* current = slot.load(std::memory_order_acquire);
+            if (!current) continue;
+            JikanEndpointSnapshot item;
+            item.endpoint = current->endpoint;
+            item.requests = current->requests.load();
+            item.status_2xx = current->status_2xx.load();
+            item.status_3xx = current->status_3xx.load();
+            item.status_4xx = current->status_4xx.load();
+            item.status_5xx = current->status_5xx.load();
+            item.failures = current->failures.load();
+            item.bytes = current->bytes.load();
+            item.new_clients = current->new_clients.load();
+            item.queue_wait = current->queue_wait.snapshot();
+            item.first_byte = current->first_byte.snapshot();
+            item.total = current->total.snapshot();
+            item.response_bytes = current->response_bytes.snapshot();
+            result.push_back(item);
+        }
+        return result;
+    }
+
+    // Prometheus text exposition format, every family grouped under its TYPE line
+    std::string prometheus() const {
+        static const std::vector<double> seconds = {0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30};
+        std::vector<const Series*> all;
+        for (const auto& slot : slots) {
+            const Series* current = slot.load(std::memory_order_acquire);
+            if (current) all.push_back(current);
+        }
+
+        std::string out;
+        char line[512];
+        out += "# TYPE jikan_requests_total counter\n";
+        for (const Series* current : all) {
+            const char* classes[5] = {"2xx", "3xx", "4xx", "5xx", "error"};
+            uint64_t counts[5] = {current->status_2xx.load(), current->status_3xx.load(), current->status_4xx.load(),
+                                  current->status_5xx.load(), current->failures.load()};
+            for (int i = 0; i < 5; ++i) {
+                std::snprintf(line, sizeof(line), "jikan_requests_total{endpoint=\"%s\",status=\"%s\"} %llu\n",
+                              label(current->endpoint).c_str(), classes[i], static_cast<unsigned long long>(counts[i]));
+                out += line;
+            }
+        }
+        out += "# TYPE jikan_response_bytes_total counter\n";
+        for (const Series* current : all) {
+            std::snprintf(line, sizeof(line), "jikan_response_bytes_total{endpoint=\"%s\"} %llu\n",
+                          label(current->endpoint).c_str(), static_cast<unsigned long long>(current->bytes.load()));
+            out += line;
+        }
+        out += "# TYPE jikan_new_clients_total counter\n";
+        for (const Series* current : all) {
+            std::snprintf(line, sizeof(line), "jikan_new_clients_total{endpoint=\"%s\"} %llu\n",
+                          label(current->endpoint).c_str(), static_cast<unsigned long long>(current->new_clients.load()));
+            out += line;
+        }
+        out += "# TYPE jikan_request_duration_seconds histogram\n";
+        for (const Series* current : all) {
+            prometheus_histogram(out, "jikan_request_duration_seconds", current->endpoint, current->total, 1e-6, seconds);
+        }
+        out += "# TYPE jikan_queue_wait_seconds histogram\n";
+        for (const Series* current : all) {
+            prometheus_histogram(out, "jikan_queue_wait_seconds", current->endpoint, current->queue_wait, 1e-6, seconds);
+        }
+        out += "# TYPE jikan_first_byte_seconds histogram\n";
+        for (const Series* current : all) {
+            prometheus_histogram(out, "jikan_first_byte_seconds", current->endpoint, current->first_byte, 1e-6, seconds);
+        }
+        return out;
+    }
+};
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef JIKAN_MOCK_SERVER_H
+#define JIKAN_MOCK_SERVER_H
+
+#include <cpprest/http_listener.h>
+#include <memory>
+#include <string>
+
+#include "JikanReplay.h"
+
+// Serves recorded fixtures over loopback HTTP, with the same fault injection as JikanReplayTransport.
+// Point a Jikan at it to exercise the real connection pool without touching api.jikan.moe:
+//     JikanMockServer server("http://127.0.0.1:8089/v4", std::make_shared<JikanFixtureStore>("fixtures"));
+//     server.start();
+//     api.set_api_base(server.base());
+class JikanMockServer {
+private:
+    std::string address;
+    std::shared_ptr<JikanReplayTransport> replay;
+    web::http::experimental::listener::http_listener listener;
+    bool running = false;
+
+public:
+    JikanMockServer(const std::string& address, std::shared_ptr<JikanFixtureStore> store,
+                    const JikanFaultConfig& faults = JikanFaultConfig())
+        : address(address),
+          replay(std::make_shared<JikanReplayTransport>(std::move(store), faults)),
+          listener(utility::conversions::to_string_t(address)) {
+        auto replay = this->replay;
+        listener.support([replay](web::http::http_request request) {
+            std::string key = JikanFixtureStore::key(utility::conversions::to_utf8string(request.method()),
+                                                     utility::conversions::to_utf8string(request.relative_uri().to_string()));
+            replay->respond(key).then([request](pplx::task<web::http::http_response> previousTask) {
+                try {
+                    request.reply(previousTask.get());
+                } catch (const std::exception&) {
+                    request.reply(web::http::status_codes::InternalError);
+                }
+            });
+        });
+    }
+
+    ~JikanMockServer() {
+        try {
+            if (running) stop();
+        } catch (const std::exception&) {
+        }
+    }
+
+    JikanMockServer(const JikanMockServer&) = delete;
+    JikanMockServer& operator=(const JikanMockServer&) = delete;
+
+    void start() {
+        listener.open().wait();
+        running = true;
+    }
+
+    void stop() {
+        listener.close().wait();
+        running = false;
+    }
+
+    const std::string& base() const {
+        return address;
+    }
+
+    JikanReplayStats stats() const {
+        return replay->stats();
+    }
+};
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef JIKAN_PAGER_H
+#define JIKAN_PAGER_H
+
+#include <cpprest/json.h>
+#include <pplx/pplx.h>
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+// Requests one page of a paged endpoint, pages are numbered from 1
+typedef std::function<pplx::task<web::json::value>(int page)> JikanPageFetcher;
+
+// Walks every page of a paged endpoint. The next page is requested as soon as the current one
+// arrives, so at most one page is held besides the one the caller is working on.
+// A stream has a single consumer: wait for one next_page_async() before calling it again.
+class JikanPageStream {
+private:
+    struct State {
+        JikanPageFetcher fetch;
+        int next = 1;
+        bool has_pending = false;
+        pplx::task<web::json::value> pending;
+        web::json::value error;
+    };
+
+    std::shared_ptr<State> state;
+
+    static bool has_next_page(const web::json::value& page) {
+        if (!page.has_field(U("pagination"))) return false;
+        const auto& pagination = page.at(U("pagination"));
+        return pagination.has_field(U("has_next_page")) && pagination.at(U("has_next_page")).as_bool() &&
+               page.has_field(U("data")) && page.at(U("data")).size() > 0;
+    }
+
+    static void request(const std::shared_ptr<State>& state) {
+        state->pending = state->fetch(state->next++);
+        state->has_pending = true;
+    }
+
+    static pplx::task<web::json::value> next(std::shared_ptr<State> state) {
+        if (!state->has_pending) return pplx::task_from_result(web::json::value::null());
+        state->has_pending = false;
+        return state->pending.then([state](web::json::value page) {
+            if (page.has_field(U("error"))) {
+                state->error = page;
+                return web::json::value::null();
+            }
+            if (has_next_page(page)) request(state);
+            return page;
+        });
+    }
+
+    static pplx::task<size_t> each_item(std::shared_ptr<State> state, std::function<bool(const web::json::value&)> on_item,
+                                        std::shared_ptr<size_t> count) {
+        return next(state).then([state, on_item, count](web::json::value page) -> pplx::task<size_t> {
+            if (page.is_null() || !page.has_field(U("data"))) return pplx::task_from_result(*count);
+            for (const auto& item : page.at(U("data")).as_array()) {
+                ++*count;
+                if (!on_item(item)) {
+                    state->has_pending = false;
+                    return pplx::task_from_result(*count);
+                }
+            }
+            return each_item(state, on_item, count);
+        });
+    }
+
+public:
+    explicit JikanPageStream(JikanPageFetcher fetch, int first_page = 1) : state(std::make_shared<State>()) {
+        state->fetch = fetch;
+        state->next = first_page > 0 ? first_page : 1;
+        request(state);
+    }
+
+    // Next page, or a null value once the last page was returned or a request failed
+    pplx::task<web::json::value> next_page_async() {
+        return next(state);
+    }
+
+    bool next_page(web::json::value& page) {
+        page = next(state).get();
+        return !page.is_null();
+    }
+
+    // Calls on_item for every entry of every page's "data" until it returns false; resolves to the number of items seen
+    pplx::task<size_t> for_each_item_async(std::function<bool(const web::json::value&)> on_item) {
+        return each_item(state, on_item, std::make_shared<size_t>(0));
+    }
+
+    size_t for_each_item(std::function<bool(const web::json::value&)> on_item) {
+        return for_each_item_async(on_item).get();
+    }
+
+    // The error object of the request that ended the stream early, null if it ran to the last page
+    const web::json::value& last_error() const {
+        return state->error;
+    }
+};
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef JIKAN_QUOTA_H
+#define JIKAN_QUOTA_H
+
+#include <chrono>
+
+// A request budget shared with other clients, consulted by the scheduler on top of its own rate limit
+class JikanQuota {
+public:
+    virtual ~JikanQuota() {}
+
+    // Takes one permit when one is free and it is this client's turn, and returns zero.
+    // Otherwise nothing is taken and the result is how long to wait before asking again.
+    virtual std::chrono::steady_clock::duration acquire() = 0;
+
+    // Passes a 429's Retry-After on, so every client sharing the budget pauses
+    virtual void throttle(std::chrono::milliseconds retry_after) = 0;
+};
+
+#endif
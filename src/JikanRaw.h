@@ -0,0 +1,128 @@
+#ifndef JIKAN_RAW_H
+#define JIKAN_RAW_H
+
+#include <pplx/pplx.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include <unistd.h>
+
+#include "JikanBuffer.h"
+
+// Receives a response body in chunks
+class JikanSink {
+public:
+    virtual ~JikanSink() {}
+    virtual void write(const char* data, size_t size) = 0;
+    // Called once after the last chunk
+    virtual void finish() {}
+};
+
+// Writes to a file descriptor the caller owns, e.g. a socket to a proxied client
+class JikanFdSink : public JikanSink {
+private:
+    int fd;
+
+public:
+    explicit JikanFdSink(int fd) : fd(fd) {}
+
+    void write(const char* data, size_t size) override {
+        while (size > 0) {
+            ssize_t written = ::write(fd, data, size);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error(std::string("Jikan sink: write failed: ") + std::strerror(errno));
+            }
+            data += written;
+            size -= static_cast<size_t>(written);
+        }
+    }
+};
+
+// Appends to a string the caller owns; it must outlive the call
+class JikanStringSink : public JikanSink {
+private:
+    std::string& out;
+
+public:
+    explicit JikanStringSink(std::string& out) : out(out) {}
+
+    void write(const char* data, size_t size) override {
+        out.append(data, size);
+    }
+};
+
+class JikanCallbackSink : public JikanSink {
+private:
+    std::function<void(const char*, size_t)> on_chunk;
+    std::function<void()> on_finish;
+
+public:
+    explicit JikanCallbackSink(std::function<void(const char*, size_t)> on_chunk, std::function<void()> on_finish = nullptr)
+        : on_chunk(std::move(on_chunk)), on_finish(std::move(on_finish)) {}
+
+    void write(const char* data, size_t size) override {
+        on_chunk(data, size);
+    }
+
+    void finish() override {
+        if (on_finish) on_finish();
+    }
+};
+
+// While alive, json getters called on this thread skip the DOM and hand their body to the scope;
+// what they return themselves is a null json value. Used by Jikan::raw.
+class JikanRawScope {
+private:
+    JikanRawScope* previous;
+    bool captured = false;
+    pplx::task<JikanBuffer> body;
+
+public:
+    JikanRawScope() : previous(current()) {
+        current() = this;
+    }
+    ~JikanRawScope() {
+        current() = previous;
+    }
+
+    JikanRawScope(const JikanRawScope&) = delete;
+    JikanRawScope& operator=(const JikanRawScope&) = delete;
+
+    static JikanRawScope*& current() {
+        static thread_local JikanRawScope* scope = nullptr;
+        return scope;
+    }
+
+    // Only the first request of the call is captured, later ones build their DOM as usual
+    bool capturing() const {
+        return !captured;
+    }
+
+    void capture(const pplx::task<JikanBuffer>& task) {
+        body = task;
+        captured = true;
+    }
+
+    pplx::task<JikanBuffer> result() const {
+        if (!captured) return pplx::task_from_exception<JikanBuffer>(std::logic_error("Jikan raw: the call made no request"));
+        return body;
+    }
+};
+
+// Writes body to sink in chunk-sized pieces and returns the byte count
+inline size_t jikan_write_chunks(const JikanBuffer& body, JikanSink& sink, size_t chunk_size) {
+    if (chunk_size == 0) chunk_size = body.size();
+    for (size_t offset = 0; offset < body.size(); offset += chunk_size) {
+        sink.write(body.data() + offset, std::min(chunk_size, body.size() - offset));
+    }
+    sink.finish();
+    return body.size();
+}
+
+#endif
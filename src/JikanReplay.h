@@ -0,0 +1,300 @@
+#ifndef JIKAN_REPLAY_H
+#define JIKAN_REPLAY_H
+
+#include <cpprest/http_client.h>
+#include <pplx/pplx.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "JikanDiskCache.h"
+#include "JikanRetry.h"
+#include "JikanTransport.h"
+
+// One recorded response
+struct JikanFixture {
+    web::http::status_code status = 200;
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::string body;
+
+    web::http::http_response response() const {
+        web::http::http_response result(status);
+        for (const auto& header : headers) {
+            result.headers().add(utility::conversions::to_string_t(header.first), utility::conversions::to_string_t(header.second));
+        }
+        result.set_body(body, "application/json");
+        return result;
+    }
+
+    // Content-Type and Content-Length are set again from the body on replay
+    static JikanFixture from(const web::http::http_response& response, std::string body) {
+        JikanFixture fixture;
+        fixture.status = response.status_code();
+        for (const auto& header : response.headers()) {
+            std::string name = utility::conversions::to_utf8string(header.first);
+            if (name == "Content-Type" || name == "Content-Length") continue;
+            fixture.headers.push_back(std::make_pair(name, utility::conversions::to_utf8string(header.second)));
+        }
+        fixture.body = std::move(body);
+        return fixture;
+    }
+
+    // Shaped like the api's own error objects
+    static JikanFixture error(web::http::status_code status, const std::string& type, const std::string& message) {
+        JikanFixture fixture;
+        fixture.status = status;
+        fixture.body = "{\"status\":" + std::to_string(status) + ",\"type\":\"" + type + "\",\"message\":\"" + message + "\"}";
+        return fixture;
+    }
+};
+
+// Fixtures on disk, one file per request named after the hash of "METHOD /path?query".
+//
+// File layout, text up to the body:
+//     jikan-fixture 1
+//     GET /anime/1
+//     200
+//     <header count>
+//     Name: value        (one line per header)
+//     <body size>
+//     body bytes
+class JikanFixtureStore {
+private:
+    std::string directory;
+    std::mutex mutex;
+    std::unordered_map<std::string, JikanFixture> loaded;
+
+    std::string path_for(const std::string& key) const {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.fixture", static_cast<unsigned long long>(jikan_hash64(key)));
+        return directory + "/" + name;
+    }
+
+    bool read(const std::string& key, JikanFixture& fixture) const {
+        std::ifstream in(path_for(key), std::ios::binary);
+        if (!in) return false;
+        std::string line;
+        if (!std::getline(in, line) || line != "jikan-fixture 1") return false;
+        // Another key with the same hash
+        if (!std::getline(in, line) || line != key) return false;
+        size_t header_count = 0;
+        size_t body_size = 0;
+        if (!std::getline(in, line)) return false;
+        fixture.status = static_cast<web::http::status_code>(std::stoi(line));
+        if (!std::getline(in, line)) return false;
+        header_count = std::stoul(line);
+        for (size_t i = 0; i < header_count; ++i) {
+            if (!std::getline(in, line)) return false;
+            size_t colon = line.find(": ");
+            if (colon == std::string::npos) continue;
+            fixture.headers.push_back(std::make_pair(line.substr(0, colon), line.substr(colon + 2)));
+        }
+        if (!std::getline(in, line)) return false;
+        body_size = std::stoul(line);
+        fixture.body.resize(body_size);
+        if (body_size > 0 && !in.read(&fixture.body[0], body_size)) return false;
+        return true;
+    }
+
+public:
+    explicit JikanFixtureStore(const std::string& directory) : directory(directory) {
+        ::mkdir(directory.c_str(), 0755);
+    }
+
+    static std::string key(const web::http::http_request& request) {
+        return key(utility::conversions::to_utf8string(request.method()), utility::conversions::to_utf8string(request.request_uri().to_string()));
+    }
+
+    static std::string key(const std::string& method, const std::string& uri) {
+        return method + " " + uri;
+    }
+
+    bool load(const std::string& key, JikanFixture& fixture) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = loaded.find(key);
+            if (it != loaded.end()) {
+                fixture = it->second;
+                return true;
+            }
+        }
+        JikanFixture result;
+        if (!read(key, result)) return false;
+        std::lock_guard<std::mutex> lock(mutex);
+        loaded[key] = result;
+        fixture = result;
+        return true;
+    }
+
+    // Written to a temporary name and renamed, a reader never sees half a fixture
+    void save(const std::string& key, const JikanFixture& fixture) {
+        std::string path = path_for(key);
+        std::string temporary = path + ".tmp";
+        {
+            std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+            if (!out) throw std::runtime_error("Jikan fixtures: cannot write " + temporary);
+            out << "jikan-fixture 1\n" << key << '\n' << fixture.status << '\n' << fixture.headers.size() << '\n';
+            for (const auto& header : fixture.headers) out << header.first << ": " << header.second << '\n';
+            out << fixture.body.size() << '\n';
+            out.write(fixture.body.data(), fixture.body.size());
+            out.flush();
+            if (!out) throw std::runtime_error("Jikan fixtures: cannot write " + temporary);
+        }
+        if (std::rename(temporary.c_str(), path.c_str()) != 0) throw std::runtime_error("Jikan fixtures: cannot replace " + path);
+        std::lock_guard<std::mutex> lock(mutex);
+        loaded[key] = fixture;
+    }
+
+    const std::string& get_directory() const {
+        return directory;
+    }
+};
+
+// Passes requests to another transport and saves every usable answer as a fixture.
+// Only 2xx and 404 answers are recorded. A 304 belongs to a cache the replay may not have,
+// and 429 and 5xx answers are a bad moment a replay should not inherit.
+class JikanRecordingTransport : public JikanTransport {
+private:
+    std::shared_ptr<JikanTransport> inner;
+    std::shared_ptr<JikanFixtureStore> store;
+
+public:
+    JikanRecordingTransport(std::shared_ptr<JikanTransport> inner, std::shared_ptr<JikanFixtureStore> store)
+        : inner(std::move(inner)), store(std::move(store)) {}
+
+    static bool recordable(web::http::status_code status) {
+        return (status >= 200 && status < 300) || status == 404;
+    }
+
+    pplx::task<web::http::http_response> request(const web::http::http_request& request, bool* new_client,
+                                                 pplx::cancellation_token cancel) override {
+        auto store = this->store;
+        std::string key = JikanFixtureStore::key(request);
+        return inner->request(request, new_client, cancel).then([store, key](web::http::http_response response) {
+            return response.extract_utf8string(true).then([store, key, response](std::string body) {
+                JikanFixture fixture = JikanFixture::from(response, std::move(body));
+                if (recordable(fixture.status)) store->save(key, fixture);
+                return fixture.response();
+            });
+        });
+    }
+
+    // The answers are the real server's
+    std::string backend() const override {
+        return inner->backend();
+    }
+};
+
+struct JikanFaultConfig {
+    // Added to every response, plus a uniformly random share of jitter
+    std::chrono::milliseconds latency = std::chrono::milliseconds(0);
+    std::chrono::milliseconds jitter = std::chrono::milliseconds(0);
+    // Body transfer rate, zero for no limit
+    double bytes_per_second = 0.0;
+    // Shares of requests answered with 503 or with 429 and Retry-After instead of their fixture
+    double error_rate = 0.0;
+    double throttle_rate = 0.0;
+    std::chrono::seconds retry_after = std::chrono::seconds(1);
+    // The same seed injects the same faults in the same order
+    uint64_t seed = 1;
+};
+
+struct JikanReplayStats {
+    uint64_t served = 0;
+    uint64_t missing = 0;
+    uint64_t injected_errors = 0;
+    uint64_t injected_throttles = 0;
+};
+
+// Answers from fixtures with the configured latency, bandwidth and faults; nothing goes to the network.
+// A request without a fixture gets a 404 error object.
+class JikanReplayTransport : public JikanTransport {
+private:
+    std::shared_ptr<JikanFixtureStore> store;
+    JikanFaultConfig faults;
+    std::shared_ptr<JikanTimer> timer;
+    std::mutex mutex;
+    std::mt19937_64 random;
+    std::atomic<uint64_t> served{0};
+    std::atomic<uint64_t> missing{0};
+    std::atomic<uint64_t> injected_errors{0};
+    std::atomic<uint64_t> injected_throttles{0};
+
+    double uniform() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return std::uniform_real_distribution<double>(0.0, 1.0)(random);
+    }
+
+    std::chrono::milliseconds delay_for(size_t body_bytes) {
+        double ms = static_cast<double>(faults.latency.count());
+        if (faults.jitter.count() > 0) ms += uniform() * faults.jitter.count();
+        if (faults.bytes_per_second > 0.0) ms += body_bytes * 1000.0 / faults.bytes_per_second;
+        return std::chrono::milliseconds(static_cast<long long>(ms));
+    }
+
+public:
+    JikanReplayTransport(std::shared_ptr<JikanFixtureStore> store, const JikanFaultConfig& faults = JikanFaultConfig())
+        : store(std::move(store)), faults(faults), timer(std::make_shared<JikanTimer>()), random(faults.seed) {}
+
+    // Response for a fixture key, also used by the loopback mock server
+    pplx::task<web::http::http_response> respond(const std::string& key,
+                                                 pplx::cancellation_token cancel = pplx::cancellation_token::none()) {
+        JikanFixture fixture;
+        if (!store->load(key, fixture)) {
+            ++missing;
+            fixture = JikanFixture::error(404, "ReplayMissing", "No fixture for " + key);
+        } else {
+            ++served;
+        }
+
+        double roll = (faults.error_rate > 0.0 || faults.throttle_rate > 0.0) ? uniform() : 1.0;
+        if (roll < faults.throttle_rate) {
+            ++injected_throttles;
+            fixture = JikanFixture::error(429, "RateLimitException", "Injected rate limit");
+            fixture.headers.push_back(std::make_pair("Retry-After", std::to_string(faults.retry_after.count())));
+        } else if (roll < faults.throttle_rate + faults.error_rate) {
+            ++injected_errors;
+            fixture = JikanFixture::error(503, "ServiceUnavailableException", "Injected failure");
+        }
+
+        auto delay = delay_for(fixture.body.size());
+        if (delay.count() == 0) return pplx::task_from_result(fixture.response());
+        return timer->after(delay, cancel).then([fixture]() {
+            return fixture.response();
+        });
+    }
+
+    pplx::task<web::http::http_response> request(const web::http::http_request& request, bool* new_client,
+                                                 pplx::cancellation_token cancel) override {
+        if (new_client) *new_client = false;
+        return respond(JikanFixtureStore::key(request), cancel);
+    }
+
+    std::string backend() const override {
+        return "replay " + store->get_directory();
+    }
+
+    JikanReplayStats stats() const {
+        JikanReplayStats result;
+        result.served = served.load();
+        result.missing = missing.load();
+        result.injected_errors = injected_errors.load();
+        result.injected_throttles = injected_throttles.load();
+        return result;
+    }
+};
+
+#endif
@@ -0,0 +1,382 @@
+#ifndef JIKAN_RETRY_H
+#define JIKAN_RETRY_H
+
+#include <cpprest/http_client.h>
+#include <pplx/pplx.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Completes tasks after a delay; one thread serves every pending delay
+class JikanTimer {
+private:
+    typedef std::chrono::steady_clock clock;
+    // Due time plus a sequence number, so a cancelled wait can find its own entry
+    typedef std::pair<clock::time_point, uint64_t> Key;
+
+    // Shared with the worker and with cancellation callbacks, which may outlive the timer
+    struct Queue {
+        std::mutex mutex;
+        std::condition_variable wakeup;
+        std::map<Key, pplx::task_completion_event<void>> pending;
+        uint64_t next_seq = 0;
+        bool stopping = false;
+    };
+
+    std::shared_ptr<Queue> queue = std::make_shared<Queue>();
+    std::thread worker;
+
+    static void run(const std::shared_ptr<Queue>& queue) {
+        std::unique_lock<std::mutex> lock(queue->mutex);
+        while (!queue->stopping) {
+            if (queue->pending.empty()) {
+                queue->wakeup.wait(lock);
+                continue;
+            }
+            auto first = queue->pending.begin();
+            if (clock::now() < first->first.first) {
+                queue->wakeup.wait_until(lock, first->first.first);
+                continue;
+            }
+            auto done = first->second;
+            queue->pending.erase(first);
+            lock.unlock();
+            done.set();
+            lock.lock();
+        }
+        for (auto& item : queue->pending) {
+            item.second.set_exception(std::runtime_error("Jikan timer stopped"));
+        }
+        queue->pending.clear();
+    }
+
+public:
+    JikanTimer() {
+        auto shared = queue;
+        worker = std::thread([shared]() { run(shared); });
+    }
+
+    ~JikanTimer() {
+        {
+            std::lock_guard<std::mutex> lock(queue->mutex);
+            queue->stopping = true;
+        }
+        queue->wakeup.notify_all();
+        if (worker.get_id() == std::this_thread::get_id()) {
+            worker.detach();
+        } else if (worker.joinable()) {
+            worker.join();
+        }
+    }
+
+    JikanTimer(const JikanTimer&) = delete;
+    JikanTimer& operator=(const JikanTimer&) = delete;
+
+    // Cancelling the token fails the wait with task_canceled straight away and drops its entry;
+    // the callback on the token is removed again once the wait is over either way
+    pplx::task<void> after(std::chrono::milliseconds delay, pplx::cancellation_token cancel = pplx::cancellation_token::none()) {
+        pplx::task_completion_event<void> done;
+        Key key;
+        {
+            std::lock_guard<std::mutex> lock(queue->mutex);
+            key = Key(clock::now() + delay, queue->next_seq++);
+            queue->pending.insert(std::make_pair(key, done));
+        }
+        queue->wakeup.notify_one();
+        if (!cancel.is_cancelable()) return pplx::create_task(done);
+
+        std::weak_ptr<Queue> weak = queue;
+        auto registration = cancel.register_callback([weak, key, done]() {
+            if (auto shared = weak.lock()) {
+                std::lock_guard<std::mutex> lock(shared->mutex);
+                shared->pending.erase(key);
+            }
+            done.set_exception(pplx::task_canceled());
+        });
+        return pplx::create_task(done).then([cancel, registration](pplx::task<void> previousTask) {
+            cancel.deregister_callback(registration);
+            previousTask.get();
+        });
+    }
+
+    // Waits not yet due or cancelled
+    size_t waiting() {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        return queue->pending.size();
+    }
+};
+
+struct JikanRetryPolicy {
+    // Total attempts including the first one, 1 disables retries
+    int max_attempts;
+    std::chrono::milliseconds base_delay;
+    std::chrono::milliseconds max_delay;
+
+    JikanRetryPolicy(int max_attempts = 1,
+                     std::chrono::milliseconds base_delay = std::chrono::milliseconds(500),
+                     std::chrono::milliseconds max_delay = std::chrono::milliseconds(30000))
+        : max_attempts(max_attempts), base_delay(base_delay), max_delay(max_delay) {}
+};
+
+struct JikanCircuitConfig {
+    // Outcomes of the last window requests decide whether the circuit opens
+    size_t window = 20;
+    size_t min_requests = 10;
+    double failure_ratio = 0.5;
+    // How long an open circuit fails fast before a single probe request is let through
+    std::chrono::milliseconds open_for = std::chrono::milliseconds(30000);
+};
+
+struct JikanRetryConfig {
+    JikanRetryPolicy server_errors = JikanRetryPolicy(4, std::chrono::milliseconds(500), std::chrono::milliseconds(30000));
+    JikanRetryPolicy network_errors = JikanRetryPolicy(3, std::chrono::milliseconds(250), std::chrono::milliseconds(10000));
+    // Any other 4xx is final, the request itself is wrong
+    JikanRetryPolicy client_errors = JikanRetryPolicy(1);
+    // Overall budget of one call including every retry, zero for none
+    std::chrono::milliseconds deadline = std::chrono::milliseconds(120000);
+    JikanCircuitConfig circuit;
+};
+
+enum class JikanCircuitState {
+    Closed,
+    Open,
+    HalfOpen
+};
+
+struct JikanRetryStats {
+    uint64_t retries = 0;
+    uint64_t exhausted = 0;
+    uint64_t short_circuited = 0;
+    JikanCircuitState circuit = JikanCircuitState::Closed;
+};
+
+class JikanCircuitOpenError : public std::runtime_error {
+public:
+    JikanCircuitOpenError() : std::runtime_error("Circuit open: upstream is failing") {}
+};
+
+class JikanCircuitBreaker {
+private:
+    typedef std::chrono::steady_clock clock;
+
+    JikanCircuitConfig config;
+    std::mutex mutex;
+    JikanCircuitState state = JikanCircuitState::Closed;
+    std::vector<bool> outcomes;
+    size_t next_slot = 0;
+    size_t failures = 0;
+    bool probing = false;
+    clock::time_point open_until;
+
+    void reset_window() {
+        outcomes.clear();
+        next_slot = 0;
+        failures = 0;
+    }
+
+public:
+    explicit JikanCircuitBreaker(const JikanCircuitConfig& config = JikanCircuitConfig()) : config(config) {}
+
+    // False while open; once open_for has passed exactly one probe is allowed, and probe is set for it
+    bool allow(bool* probe = nullptr) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (probe) *probe = false;
+        if (state == JikanCircuitState::Closed) return true;
+        if (state == JikanCircuitState::Open) {
+            if (clock::now() < open_until) return false;
+            state = JikanCircuitState::HalfOpen;
+            probing = false;
+        }
+        if (probing) return false;
+        probing = true;
+        if (probe) *probe = true;
+        return true;
+    }
+
+    // Ends a probe whose outcome says nothing about upstream (a 429, a cancellation, a local error),
+    // so the next request may probe instead of the circuit staying half open for good
+    void release_probe() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (state == JikanCircuitState::HalfOpen) probing = false;
+    }
+
+    void record(bool success) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (state == JikanCircuitState::HalfOpen) {
+            probing = false;
+            if (success) {
+                state = JikanCircuitState::Closed;
+                reset_window();
+            } else {
+                state = JikanCircuitState::Open;
+                open_until = clock::now() + config.open_for;
+            }
+            return;
+        }
+        if (state == JikanCircuitState::Open) return;
+
+        size_t window = std::max<size_t>(1, config.window);
+        if (outcomes.size() < window) {
+            outcomes.push_back(success);
+        } else {
+            if (!outcomes[next_slot]) --failures;
+            outcomes[next_slot] = success;
+            next_slot = (next_slot + 1) % window;
+        }
+        if (!success) ++failures;
+
+        if (outcomes.size() >= config.min_requests &&
+            static_cast<double>(failures) / outcomes.size() >= config.failure_ratio) {
+            state = JikanCircuitState::Open;
+            open_until = clock::now() + config.open_for;
+            reset_window();
+        }
+    }
+
+    JikanCircuitState current() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return state;
+    }
+};
+
+// Resends failed requests with exponential backoff and full jitter, behind a circuit breaker
+class JikanRetryEngine : public std::enable_shared_from_this<JikanRetryEngine> {
+private:
+    typedef std::chrono::steady_clock clock;
+    typedef std::function<pplx::task<web::http::http_response>()> Sender;
+
+    JikanRetryConfig config;
+    JikanCircuitBreaker breaker;
+    std::shared_ptr<JikanTimer> timer;
+    std::atomic<uint64_t> retries{0};
+    std::atomic<uint64_t> exhausted{0};
+    std::atomic<uint64_t> short_circuited{0};
+
+    // Uniform in [0, min(max_delay, base_delay * 2^attempt)]
+    static std::chrono::milliseconds backoff(const JikanRetryPolicy& policy, int attempt) {
+        static thread_local std::mt19937_64 random(std::random_device{}());
+        double ceiling = static_cast<double>(policy.base_delay.count()) * static_cast<double>(1ull << std::min(attempt, 30));
+        ceiling = std::min(ceiling, static_cast<double>(policy.max_delay.count()));
+        std::uniform_real_distribution<double> jitter(0.0, std::max(ceiling, 0.0));
+        return std::chrono::milliseconds(static_cast<long long>(jitter(random)));
+    }
+
+    const JikanRetryPolicy& policy_for(web::http::status_code code) const {
+        return code >= 500 ? config.server_errors : config.client_errors;
+    }
+
+    // Waits the backoff and resends, or returns false when attempts or the deadline are used up
+    bool retry_later(const JikanRetryPolicy& policy, int attempt, clock::time_point deadline, Sender send,
+                     pplx::cancellation_token cancel, pplx::task<web::http::http_response>& next) {
+        if (cancel.is_canceled()) return false;
+        if (attempt + 1 >= policy.max_attempts) {
+            if (policy.max_attempts > 1) ++exhausted;
+            return false;
+        }
+        auto delay = backoff(policy, attempt);
+        if (deadline != clock::time_point::max() && clock::now() + delay >= deadline) {
+            ++exhausted;
+            return false;
+        }
+        ++retries;
+        auto self = shared_from_this();
+        next = timer->after(delay, cancel).then([self, send, attempt, deadline, cancel]() {
+            return self->attempt(send, attempt + 1, deadline, cancel);
+        });
+        return true;
+    }
+
+    pplx::task<web::http::http_response> attempt(Sender send, int attempt, clock::time_point deadline, pplx::cancellation_token cancel) {
+        if (cancel.is_canceled()) {
+            return pplx::task_from_exception<web::http::http_response>(pplx::task_canceled());
+        }
+        bool probe = false;
+        if (!breaker.allow(&probe)) {
+            ++short_circuited;
+            return pplx::task_from_exception<web::http::http_response>(JikanCircuitOpenError());
+        }
+
+        auto self = shared_from_this();
+        pplx::task<web::http::http_response> sent;
+        try {
+            sent = send();
+        } catch (...) {
+            // Failed before anything reached the network
+            if (probe) breaker.release_probe();
+            return pplx::task_from_exception<web::http::http_response>(std::current_exception());
+        }
+        return sent.then([self, send, attempt, deadline, cancel, probe](pplx::task<web::http::http_response> previousTask)
+                             -> pplx::task<web::http::http_response> {
+            web::http::http_response response;
+            try {
+                response = previousTask.get();
+            } catch (const JikanCircuitOpenError&) {
+                if (probe) self->breaker.release_probe();
+                throw;
+            } catch (const pplx::task_canceled&) {
+                // Given up by the caller, says nothing about upstream health
+                if (probe) self->breaker.release_probe();
+                throw;
+            } catch (...) {
+                self->breaker.record(false);
+                pplx::task<web::http::http_response> next;
+                if (self->retry_later(self->config.network_errors, attempt, deadline, send, cancel, next)) return next;
+                throw;
+            }
+
+            auto code = response.status_code();
+            // 429 is the scheduler's business and says nothing about upstream health
+            bool upstream_failed = code >= 500;
+            if (code != 429) {
+                self->breaker.record(!upstream_failed);
+            } else if (probe) {
+                self->breaker.release_probe();
+            }
+            if (code >= 400 && code != 429) {
+                pplx::task<web::http::http_response> next;
+                if (self->retry_later(self->policy_for(code), attempt, deadline, send, cancel, next)) return next;
+            }
+            return pplx::task_from_result(response);
+        });
+    }
+
+public:
+    // Backoffs wait on timer, so engines can share one timer thread; by default the engine starts its own
+    explicit JikanRetryEngine(const JikanRetryConfig& config = JikanRetryConfig(), std::shared_ptr<JikanTimer> timer = nullptr)
+        : config(config), breaker(config.circuit), timer(timer ? timer : std::make_shared<JikanTimer>()) {}
+
+    // The earlier of the configured budget and the caller's own deadline bounds the retries
+    pplx::task<web::http::http_response> run(Sender send,
+                                             pplx::cancellation_token cancel = pplx::cancellation_token::none(),
+                                             clock::time_point caller_deadline = clock::time_point::max()) {
+        auto deadline = caller_deadline;
+        if (config.deadline.count() > 0) deadline = std::min(deadline, clock::now() + config.deadline);
+        return attempt(send, 0, deadline, cancel);
+    }
+
+    const JikanRetryConfig& get_config() const {
+        return config;
+    }
+
+    JikanRetryStats stats() {
+        JikanRetryStats result;
+        result.retries = retries.load();
+        result.exhausted = exhausted.load();
+        result.short_circuited = short_circuited.load();
+        result.circuit = breaker.current();
+        return result;
+    }
+};
+
+#endif
@@ -0,0 +1,395 @@
+#ifndef JIKAN_SCHEDULER_H
+#define JIKAN_SCHEDULER_H
+
+#include <cpprest/http_client.h>
+#include <pplx/pplx.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "JikanQuota.h"
+
+enum class JikanPriority {
+    Interactive = 0,
+    Normal = 1,
+    Background = 2
+};
+
+// Jikan allows about 3 requests per second and 60 per minute, both windows are enforced
+struct JikanRateLimit {
+    double per_second = 3.0;
+    double per_minute = 60.0;
+    // How many times a request answered with 429 is put back into the queue before the error is returned
+    int max_throttle_retries = 3;
+};
+
+// Both windows must allow some requests: the token buckets divide by them
+inline void jikan_check_rate_limit(const JikanRateLimit& limit) {
+    if (!(limit.per_second > 0.0) || !(limit.per_minute > 0.0)) {
+        throw std::invalid_argument("Jikan rate limit: per_second and per_minute must be positive");
+    }
+}
+
+struct JikanSchedulerStats {
+    size_t queue_depth = 0;
+    uint64_t dispatched = 0;
+    uint64_t throttled = 0;
+    uint64_t cancelled = 0;
+    double total_wait_ms = 0.0;
+    double max_wait_ms = 0.0;
+};
+
+// Priority applied to requests started from the current thread while the scope is alive:
+//     JikanPriorityScope scope(JikanPriority::Background);
+//     api.getAnimeFullById(1);
+class JikanPriorityScope {
+private:
+    JikanPriority previous;
+
+public:
+    explicit JikanPriorityScope(JikanPriority priority) : previous(current()) {
+        current() = priority;
+    }
+    ~JikanPriorityScope() {
+        current() = previous;
+    }
+
+    static JikanPriority& current() {
+        static thread_local JikanPriority priority = JikanPriority::Normal;
+        return priority;
+    }
+};
+
+class JikanScheduler {
+private:
+    typedef std::chrono::steady_clock clock;
+    typedef std::function<pplx::task<web::http::http_response>()> Sender;
+
+    // Whoever claims the ticket first, the dispatcher or a cancellation, completes it
+    struct Ticket {
+        std::atomic<bool> claimed{false};
+        Sender send;
+        pplx::task_completion_event<web::http::http_response> done;
+    };
+
+    struct Job {
+        JikanPriority priority;
+        uint64_t seq;
+        clock::time_point enqueued;
+        std::shared_ptr<Ticket> ticket;
+    };
+
+    struct JobOrder {
+        bool operator()(const Job& a, const Job& b) const {
+            if (a.priority != b.priority) return a.priority > b.priority;
+            return a.seq > b.seq;
+        }
+    };
+
+    // Everything the worker touches. The worker holds its own reference: a scheduler released from
+    // inside a send runs its destructor on the worker, which then detaches and finishes with this
+    struct State {
+        JikanRateLimit limit;
+        std::mutex mutex;
+        std::condition_variable wakeup;
+        std::priority_queue<Job, std::vector<Job>, JobOrder> queue;
+        uint64_t next_seq = 0;
+        // Cancelled jobs still sitting in the heap; they are skipped when they surface or dropped by compact()
+        size_t tombstones = 0;
+        bool stopping = false;
+
+        double second_tokens;
+        double minute_tokens;
+        clock::time_point last_refill;
+        clock::time_point paused_until;
+
+        // Host-wide budget asked for a permit after the local buckets agree
+        std::shared_ptr<JikanQuota> quota;
+
+        JikanSchedulerStats counters;
+
+        explicit State(const JikanRateLimit& limit)
+            : limit(limit), second_tokens(limit.per_second), minute_tokens(limit.per_minute),
+              last_refill(clock::now()), paused_until(clock::now()) {}
+
+        void refill(clock::time_point now) {
+            double elapsed = std::chrono::duration<double>(now - last_refill).count();
+            last_refill = now;
+            second_tokens = std::min(limit.per_second, second_tokens + elapsed * limit.per_second);
+            minute_tokens = std::min(limit.per_minute, minute_tokens + elapsed * limit.per_minute / 60.0);
+        }
+
+        // Time until both buckets hold a whole token
+        clock::duration until_next_token() const {
+            double wait = 0.0;
+            if (second_tokens < 1.0) wait = std::max(wait, (1.0 - second_tokens) / limit.per_second);
+            if (minute_tokens < 1.0) wait = std::max(wait, (1.0 - minute_tokens) * 60.0 / limit.per_minute);
+            return std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(wait));
+        }
+
+        void drop_tombstone() {
+            if (tombstones > 0) --tombstones;
+        }
+
+        // Pops cancelled jobs off the top of the heap
+        void skip_cancelled() {
+            while (!queue.empty() && queue.top().ticket->claimed) {
+                queue.pop();
+                drop_tombstone();
+            }
+        }
+
+        // Rebuilds the heap without cancelled jobs; called with the mutex held
+        void compact() {
+            std::vector<Job> live;
+            live.reserve(queue.size() - std::min(tombstones, queue.size()));
+            while (!queue.empty()) {
+                if (!queue.top().ticket->claimed) live.push_back(queue.top());
+                queue.pop();
+            }
+            queue = std::priority_queue<Job, std::vector<Job>, JobOrder>(JobOrder(), std::move(live));
+            tombstones = 0;
+        }
+
+        // The cancelled send closure is released right away, the heap entry left behind is a few words
+        void cancelled(const std::shared_ptr<Ticket>& ticket) {
+            ticket->send = nullptr;
+            ticket->done.set_exception(pplx::task_canceled());
+            std::lock_guard<std::mutex> lock(mutex);
+            ++counters.cancelled;
+            ++tombstones;
+            if (tombstones > 32 && tombstones * 2 > queue.size()) compact();
+        }
+    };
+
+    std::shared_ptr<State> state;
+    std::thread worker;
+
+    static void launch(const std::shared_ptr<Ticket>& ticket) {
+        Sender send = std::move(ticket->send);
+        ticket->send = nullptr;
+        auto done = ticket->done;
+        try {
+            send().then([done](pplx::task<web::http::http_response> previousTask) {
+                try {
+                    done.set(previousTask.get());
+                } catch (...) {
+                    done.set_exception(std::current_exception());
+                }
+            });
+        } catch (...) {
+            done.set_exception(std::current_exception());
+        }
+    }
+
+    static void run(const std::shared_ptr<State>& state) {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        while (!state->stopping) {
+            state->skip_cancelled();
+            if (state->queue.empty()) {
+                state->wakeup.wait(lock);
+                continue;
+            }
+
+            auto now = clock::now();
+            state->refill(now);
+            if (now < state->paused_until) {
+                state->wakeup.wait_until(lock, state->paused_until);
+                continue;
+            }
+            auto wait = state->until_next_token();
+            if (wait > clock::duration::zero()) {
+                state->wakeup.wait_until(lock, now + wait);
+                continue;
+            }
+            if (auto quota = state->quota) {
+                // A shared quota may block on other processes, schedule and cancel must not wait for that
+                lock.unlock();
+                wait = quota->acquire();
+                lock.lock();
+                if (wait > clock::duration::zero()) {
+                    state->wakeup.wait_until(lock, now + wait);
+                    continue;
+                }
+                if (state->stopping) break;
+                // Jobs cancelled while the lock was down must not take the permit
+                state->skip_cancelled();
+                if (state->queue.empty()) continue;
+            }
+
+            Job job = state->queue.top();
+            state->queue.pop();
+            if (job.ticket->claimed.exchange(true)) {
+                // Cancelled between the check above and now, no local token is spent on it
+                state->drop_tombstone();
+                continue;
+            }
+            state->second_tokens -= 1.0;
+            state->minute_tokens -= 1.0;
+
+            double waited = std::chrono::duration<double, std::milli>(now - job.enqueued).count();
+            ++state->counters.dispatched;
+            state->counters.total_wait_ms += waited;
+            state->counters.max_wait_ms = std::max(state->counters.max_wait_ms, waited);
+
+            lock.unlock();
+            launch(job.ticket);
+            lock.lock();
+        }
+
+        while (!state->queue.empty()) {
+            Job job = state->queue.top();
+            state->queue.pop();
+            if (job.ticket->claimed.exchange(true)) continue;
+            job.ticket->send = nullptr;
+            lock.unlock();
+            job.ticket->done.set_exception(std::runtime_error("Jikan scheduler stopped"));
+            lock.lock();
+        }
+    }
+
+public:
+    explicit JikanScheduler(const JikanRateLimit& limit = JikanRateLimit()) {
+        jikan_check_rate_limit(limit);
+        state = std::make_shared<State>(limit);
+        auto shared = state;
+        worker = std::thread([shared]() { run(shared); });
+    }
+
+    ~JikanScheduler() {
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->stopping = true;
+        }
+        state->wakeup.notify_all();
+        if (worker.get_id() == std::this_thread::get_id()) {
+            worker.detach();
+        } else if (worker.joinable()) {
+            worker.join();
+        }
+    }
+
+    JikanScheduler(const JikanScheduler&) = delete;
+    JikanScheduler& operator=(const JikanScheduler&) = delete;
+
+    // Queues send and starts it once the rate limit allows; the returned task follows the one send produces.
+    // Cancelling the token while the job waits fails it with task_canceled without using a rate limit token.
+    pplx::task<web::http::http_response> schedule(JikanPriority priority, Sender send,
+                                                  pplx::cancellation_token cancel = pplx::cancellation_token::none()) {
+        if (cancel.is_canceled()) return pplx::task_from_exception<web::http::http_response>(pplx::task_canceled());
+
+        auto ticket = std::make_shared<Ticket>();
+        ticket->send = std::move(send);
+        auto result = pplx::create_task(ticket->done);
+
+        Job job;
+        job.priority = priority;
+        job.enqueued = clock::now();
+        job.ticket = ticket;
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            job.seq = state->next_seq++;
+            state->queue.push(job);
+        }
+        state->wakeup.notify_one();
+
+        if (!cancel.is_cancelable()) return result;
+        // Runs at once if the token is already cancelled
+        std::weak_ptr<State> weak = state;
+        auto registration = cancel.register_callback([weak, ticket]() {
+            if (ticket->claimed.exchange(true)) return;
+            if (auto shared = weak.lock()) {
+                shared->cancelled(ticket);
+            } else {
+                ticket->send = nullptr;
+                ticket->done.set_exception(pplx::task_canceled());
+            }
+        });
+        // A long-lived token would otherwise keep every finished ticket alive
+        return result.then([cancel, registration](pplx::task<web::http::http_response> previousTask) {
+            cancel.deregister_callback(registration);
+            return previousTask.get();
+        });
+    }
+
+    // Called on 429: nothing is dispatched until the server's Retry-After has passed
+    void throttle(std::chrono::milliseconds retry_after) {
+        std::shared_ptr<JikanQuota> shared;
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            shared = state->quota;
+            auto until = clock::now() + retry_after;
+            if (until > state->paused_until) state->paused_until = until;
+            state->second_tokens = std::min(state->second_tokens, 0.0);
+            ++state->counters.throttled;
+        }
+        if (shared) shared->throttle(retry_after);
+        state->wakeup.notify_all();
+    }
+
+    void set_quota(std::shared_ptr<JikanQuota> shared) {
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->quota = std::move(shared);
+        }
+        state->wakeup.notify_all();
+    }
+
+    // Throws std::invalid_argument for a limit that is not positive; the old limit stays in force
+    void set_rate_limit(const JikanRateLimit& new_limit) {
+        jikan_check_rate_limit(new_limit);
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->refill(clock::now());
+            state->limit = new_limit;
+            state->second_tokens = std::min(state->second_tokens, new_limit.per_second);
+            state->minute_tokens = std::min(state->minute_tokens, new_limit.per_minute);
+        }
+        state->wakeup.notify_all();
+    }
+
+    JikanRateLimit rate_limit() {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        return state->limit;
+    }
+
+    JikanSchedulerStats stats() {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        JikanSchedulerStats result = state->counters;
+        result.queue_depth = state->queue.size() - std::min(state->tombstones, state->queue.size());
+        return result;
+    }
+
+    // Retry-After is either delta-seconds or an HTTP-date
+    static std::chrono::milliseconds retry_after(const web::http::http_response& response) {
+        auto it = response.headers().find(U("Retry-After"));
+        if (it != response.headers().end()) {
+            const utility::string_t& value = it->second;
+            try {
+                size_t used = 0;
+                long seconds = std::stol(utility::conversions::to_utf8string(value), &used);
+                if (used > 0 && seconds >= 0) return std::chrono::milliseconds(seconds * 1000);
+            } catch (const std::exception&) {
+            }
+            auto date = utility::datetime::from_string(value, utility::datetime::RFC_1123);
+            auto now = utility::datetime::utc_now();
+            if (date.is_initialized() && date.to_interval() > now.to_interval()) {
+                // datetime intervals are in 100ns ticks
+                return std::chrono::milliseconds((date.to_interval() - now.to_interval()) / 10000);
+            }
+        }
+        return std::chrono::milliseconds(1000);
+    }
+};
+
+#endif
@@ -0,0 +1,323 @@
+#ifndef JIKAN_SEASON_BOARD_H
+#define JIKAN_SEASON_BOARD_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Jikan.h"
+
+// The fields the views are sorted and filtered on, plus what a listing shows
+struct JikanSeasonEntry {
+    int mal_id = 0;
+    std::string title;
+    std::string type;
+    std::string image_url;
+    // Zero when not scored yet
+    double score = 0.0;
+    int members = 0;
+    int episodes = 0;
+    bool airing = false;
+    // Monday is 0; unknown_day when the broadcast day is not announced
+    int broadcast_day = 7;
+    // "HH:MM" in Japan time, empty when unknown
+    std::string broadcast_time;
+};
+
+// One published set of views. Never changed after publication; a refresh builds a new one.
+struct JikanSeasonSnapshot {
+    static const int unknown_day = 7;
+
+    uint64_t generation = 0;
+    std::chrono::system_clock::time_point built_at;
+    // This season, most members first
+    std::vector<JikanSeasonEntry> airing;
+    // This season's scored entries, best first
+    std::vector<JikanSeasonEntry> top_rated;
+    // Next season, most members first
+    std::vector<JikanSeasonEntry> upcoming;
+    // Weekly schedule by broadcast day, then time, most members first within a slot
+    std::vector<JikanSeasonEntry> schedule[unknown_day + 1];
+
+    // Today's broadcasts; the day turns over at midnight Japan time, as broadcast days do
+    const std::vector<JikanSeasonEntry>& today() const {
+        return on(std::chrono::system_clock::now());
+    }
+
+    // Broadcasts of the Japan day that time falls on
+    const std::vector<JikanSeasonEntry>& on(std::chrono::system_clock::time_point time) const {
+        std::time_t japan = std::chrono::system_clock::to_time_t(time) + 9 * 3600;
+        // 1970-01-01 was a Thursday, day 3 counting from Monday
+        int day = static_cast<int>((japan / 86400 + 3) % 7);
+        return schedule[day];
+    }
+};
+
+struct JikanSeasonBoardConfig {
+    std::chrono::seconds interval = std::chrono::seconds(600);
+    // Pages requested per refresh, which fixes its cost at the sum of the three
+    int season_pages = 2;
+    int upcoming_pages = 1;
+    int schedule_pages = 3;
+    int page_limit = 25;
+    bool sfw = false;
+    JikanPriority priority = JikanPriority::Background;
+};
+
+struct JikanSeasonBoardStats {
+    uint64_t generation = 0;
+    uint64_t refreshes = 0;
+    // Refreshes where a section failed and kept its previous view
+    uint64_t partial_refreshes = 0;
+    uint64_t requests = 0;
+    double last_refresh_ms = 0.0;
+};
+
+// Keeps "airing now", "this season" and "today's schedule" views in memory and rebuilds them in the
+// background every interval:
+//     JikanSeasonBoard board(api);
+//     board.start();
+//     for (const auto& entry : board.snapshot()->today()) ...
+// A refresh builds the new snapshot on the side and publishes it with one pointer store, so
+// readers never wait for it and never see half of one. Readers keep a per-thread copy of the
+// pointer and only touch the shared one after a new generation is published, which makes a
+// read an atomic load and a compare in the common case.
+class JikanSeasonBoard {
+private:
+    Jikan& api;
+    JikanSeasonBoardConfig config;
+    // Tells boards apart in the per-thread reader caches, where an address could be reused
+    const uint64_t id;
+
+    std::shared_ptr<const JikanSeasonSnapshot> published;
+    std::atomic<uint64_t> generation{0};
+
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    bool stopping = false;
+    std::thread worker;
+    // Serializes refreshes started by the worker and by callers
+    std::mutex refresh_mutex;
+    JikanSeasonBoardStats counters;
+
+    struct ReaderCache {
+        uint64_t board = 0;
+        uint64_t generation = 0;
+        std::shared_ptr<const JikanSeasonSnapshot> snapshot;
+    };
+
+    static uint64_t next_id() {
+        static std::atomic<uint64_t> ids{0};
+        return ++ids;
+    }
+
+    static int day_index(const std::string& day) {
+        static const char* days[] = {"Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday", "Sunday"};
+        for (int i = 0; i < 7; ++i) {
+            // Jikan writes the plural, "Mondays"
+            if (day.compare(0, std::string(days[i]).size(), days[i]) == 0) return i;
+        }
+        return JikanSeasonSnapshot::unknown_day;
+    }
+
+    static std::string text(const web::json::value& object, const utility::string_t& name) {
+        if (!object.has_string_field(name)) return std::string();
+        return utility::conversions::to_utf8string(object.at(name).as_string());
+    }
+
+    static JikanSeasonEntry entry(const web::json::value& item) {
+        JikanSeasonEntry result;
+        if (item.has_number_field(U("mal_id"))) result.mal_id = item.at(U("mal_id")).as_integer();
+        result.title = text(item, U("title"));
+        result.type = text(item, U("type"));
+        if (item.has_number_field(U("score"))) result.score = item.at(U("score")).as_double();
+        if (item.has_number_field(U("members"))) result.members = item.at(U("members")).as_integer();
+        if (item.has_number_field(U("episodes"))) result.episodes = item.at(U("episodes")).as_integer();
+        if (item.has_boolean_field(U("airing"))) result.airing = item.at(U("airing")).as_bool();
+        if (item.has_object_field(U("broadcast"))) {
+            const auto& broadcast = item.at(U("broadcast"));
+            result.broadcast_day = day_index(text(broadcast, U("day")));
+            result.broadcast_time = text(broadcast, U("time"));
+        }
+        if (item.has_object_field(U("images")) && item.at(U("images")).has_object_field(U("jpg"))) {
+            result.image_url = text(item.at(U("images")).at(U("jpg")), U("image_url"));
+        }
+        return result;
+    }
+
+    // Up to pages pages of one feed, stopping early at the last one; false if any page failed
+    template <typename Fetch>
+    bool collect(Fetch fetch, int pages, std::vector<JikanSeasonEntry>& out) {
+        std::set<int> seen;
+        for (int page = 1; page <= pages; ++page) {
+            web::json::value result;
+            try {
+                JikanPriorityScope scope(config.priority);
+                result = fetch(page).get();
+            } catch (const std::exception&) {
+                ++counters.requests;
+                return false;
+            }
+            ++counters.requests;
+            if (!result.has_array_field(U("data"))) return false;
+            for (const auto& item : result.at(U("data")).as_array()) {
+                JikanSeasonEntry parsed = entry(item);
+                // Listings shift while they are paged, so an entry can show up on two pages
+                if (parsed.mal_id > 0 && seen.insert(parsed.mal_id).second) out.push_back(std::move(parsed));
+            }
+            if (!result.has_object_field(U("pagination")) || !result.at(U("pagination")).has_boolean_field(U("has_next_page")) ||
+                !result.at(U("pagination")).at(U("has_next_page")).as_bool()) {
+                break;
+            }
+        }
+        return true;
+    }
+
+    static void by_members(std::vector<JikanSeasonEntry>& entries) {
+        std::stable_sort(entries.begin(), entries.end(), [](const JikanSeasonEntry& a, const JikanSeasonEntry& b) {
+            return a.members > b.members;
+        });
+    }
+
+    void publish(std::shared_ptr<const JikanSeasonSnapshot> snapshot) {
+        std::atomic_store(&published, std::move(snapshot));
+        generation.fetch_add(1, std::memory_order_release);
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stopping) {
+            lock.unlock();
+            refresh();
+            lock.lock();
+            auto next = std::chrono::steady_clock::now() + config.interval;
+            while (!stopping && std::chrono::steady_clock::now() < next) wakeup.wait_until(lock, next);
+        }
+    }
+
+public:
+    JikanSeasonBoard(Jikan& api, const JikanSeasonBoardConfig& config = JikanSeasonBoardConfig())
+        : api(api), config(config), id(next_id()), published(std::make_shared<JikanSeasonSnapshot>()) {}
+
+    ~JikanSeasonBoard() {
+        stop();
+    }
+
+    JikanSeasonBoard(const JikanSeasonBoard&) = delete;
+    JikanSeasonBoard& operator=(const JikanSeasonBoard&) = delete;
+
+    // Refreshes now and then every interval on a background thread
+    void start() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (worker.joinable()) return;
+        stopping = false;
+        worker = std::thread([this]() { run(); });
+    }
+
+    // Waits for a refresh in progress to finish
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeup.notify_all();
+        if (worker.joinable()) worker.join();
+    }
+
+    // Builds and publishes a new snapshot. A section whose requests fail keeps its previous view,
+    // so a bad refresh leaves the board as it was; returns whether every section was refreshed.
+    bool refresh() {
+        std::lock_guard<std::mutex> lock(refresh_mutex);
+        auto started = std::chrono::steady_clock::now();
+        auto previous = std::atomic_load(&published);
+        auto next = std::make_shared<JikanSeasonSnapshot>();
+        int limit = config.page_limit;
+        bool sfw = config.sfw;
+
+        std::vector<JikanSeasonEntry> season;
+        bool season_ok = collect([this, limit, sfw](int page) { return api.getSeasonNow(page, limit, "", sfw); },
+                                 config.season_pages, season);
+        if (season_ok) {
+            by_members(season);
+            next->airing = season;
+            for (const auto& item : season) {
+                if (item.score > 0.0) next->top_rated.push_back(item);
+            }
+            std::stable_sort(next->top_rated.begin(), next->top_rated.end(), [](const JikanSeasonEntry& a, const JikanSeasonEntry& b) {
+                return a.score > b.score;
+            });
+        } else {
+            next->airing = previous->airing;
+            next->top_rated = previous->top_rated;
+        }
+
+        std::vector<JikanSeasonEntry> upcoming;
+        bool upcoming_ok = collect([this, limit, sfw](int page) { return api.getSeasonUpcoming(page, limit, "", sfw); },
+                                   config.upcoming_pages, upcoming);
+        if (upcoming_ok) {
+            by_members(upcoming);
+            next->upcoming = std::move(upcoming);
+        } else {
+            next->upcoming = previous->upcoming;
+        }
+
+        std::vector<JikanSeasonEntry> scheduled;
+        bool schedule_ok = collect([this, limit, sfw](int page) { return api.getSchedules(page, limit, "", sfw); },
+                                   config.schedule_pages, scheduled);
+        if (!schedule_ok) {
+            for (int day = 0; day <= JikanSeasonSnapshot::unknown_day; ++day) next->schedule[day] = previous->schedule[day];
+        } else {
+            by_members(scheduled);
+            for (auto& item : scheduled) next->schedule[item.broadcast_day].push_back(std::move(item));
+            for (auto& day : next->schedule) {
+                // Empty times sort last within the day
+                std::stable_sort(day.begin(), day.end(), [](const JikanSeasonEntry& a, const JikanSeasonEntry& b) {
+                    if (a.broadcast_time.empty() != b.broadcast_time.empty()) return b.broadcast_time.empty();
+                    return a.broadcast_time < b.broadcast_time;
+                });
+            }
+        }
+
+        bool complete = season_ok && upcoming_ok && schedule_ok;
+        next->generation = previous->generation + 1;
+        next->built_at = std::chrono::system_clock::now();
+        publish(std::move(next));
+
+        ++counters.refreshes;
+        if (!complete) ++counters.partial_refreshes;
+        counters.last_refresh_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+        return complete;
+    }
+
+    // The latest snapshot, never null; before the first refresh it is empty with generation 0.
+    // Holding the pointer keeps that snapshot alive however many refreshes follow.
+    std::shared_ptr<const JikanSeasonSnapshot> snapshot() const {
+        static thread_local ReaderCache cache;
+        uint64_t current = generation.load(std::memory_order_acquire);
+        if (cache.board != id || cache.generation != current || !cache.snapshot) {
+            cache.snapshot = std::atomic_load(&published);
+            cache.board = id;
+            cache.generation = current;
+        }
+        return cache.snapshot;
+    }
+
+    JikanSeasonBoardStats stats() {
+        std::lock_guard<std::mutex> lock(refresh_mutex);
+        JikanSeasonBoardStats result = counters;
+        result.generation = generation.load(std::memory_order_acquire);
+        return result;
+    }
+};
+
+#endif
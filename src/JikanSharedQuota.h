@@ -0,0 +1,330 @@
+#ifndef JIKAN_SHARED_QUOTA_H
+#define JIKAN_SHARED_QUOTA_H
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "JikanQuota.h"
+#include "JikanScheduler.h"
+
+struct JikanSharedQuotaConfig {
+    // Backing file, mapped by every process on the host that shares the budget
+    std::string path = "/tmp/jikan.quota";
+    // Host-wide limit; only the process that creates the file sets it, later ones use what is there
+    JikanRateLimit limit;
+    // Share of the budget relative to the other processes while they all have requests waiting
+    double weight = 1.0;
+};
+
+struct JikanSharedQuotaStats {
+    // Processes holding a slot, this one included
+    size_t processes = 0;
+    // Permits granted host-wide and to this process
+    uint64_t granted = 0;
+    uint64_t granted_here = 0;
+    // Slots of dead processes reclaimed and locks recovered from a process that died holding them
+    uint64_t reclaimed_slots = 0;
+    uint64_t recovered_locks = 0;
+    JikanRateLimit limit;
+};
+
+// Token buckets in a shared file mapping, so several processes with their own Jikan instances
+// stay under one per-IP limit together:
+//     api.set_quota(std::make_shared<JikanSharedQuota>());
+// Turns follow start-time fair queuing: every permit adds 1/weight to the taker's virtual time, and
+// among the processes waiting, the one with the lowest virtual time goes next. A process that
+// comes back after being idle starts from the current virtual time and gets no credit for the pause.
+// The lock is a robust mutex, so a process killed while holding it does not wedge the others,
+// and slots of processes that are gone are reclaimed when a slot is needed.
+class JikanSharedQuota : public JikanQuota {
+private:
+    static const uint32_t magic = 0x4a4b5154; // "JKQT"
+    static const uint32_t version = 1;
+    static const int max_slots = 64;
+
+    typedef std::chrono::steady_clock clock;
+
+    struct Slot {
+        // Zero when free
+        int32_t pid;
+        // Tells a reclaimed slot from ours when pids repeat, e.g. across pid namespaces
+        uint64_t owner;
+        double weight;
+        double virtual_time;
+        // The process counts as waiting until then
+        int64_t waiting_until;
+        uint64_t granted;
+    };
+
+    struct Segment {
+        uint32_t magic;
+        uint32_t version;
+        pthread_mutex_t mutex;
+        double per_second;
+        double per_minute;
+        double second_tokens;
+        double minute_tokens;
+        int64_t last_refill;
+        int64_t paused_until;
+        // Start tag of the last permit granted
+        double virtual_clock;
+        uint64_t granted;
+        uint64_t reclaimed_slots;
+        uint64_t recovered_locks;
+        Slot slots[max_slots];
+    };
+
+    // How long a waiting mark outlives the wait it was set for
+    static const int64_t waiting_slack = 50 * 1000 * 1000;
+    // Retry interval of a process whose turn it is not, while the one whose turn it is comes to take it
+    static const int64_t turn_poll = 5 * 1000 * 1000;
+
+    JikanSharedQuotaConfig config;
+    int fd = -1;
+    Segment* segment = nullptr;
+    int slot = -1;
+    uint64_t owner = 0;
+
+    // Nanoseconds of CLOCK_MONOTONIC, which every process on the host shares
+    static int64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now().time_since_epoch()).count();
+    }
+
+    class Lock {
+    private:
+        Segment* segment;
+
+    public:
+        explicit Lock(Segment* segment) : segment(segment) {
+            int result = pthread_mutex_lock(&segment->mutex);
+            if (result == EOWNERDEAD) {
+                // The holder died mid-update; the fields are plain numbers the next refill clamps back into range
+                pthread_mutex_consistent(&segment->mutex);
+                ++segment->recovered_locks;
+            } else if (result != 0) {
+                throw std::runtime_error("Jikan shared quota: cannot lock");
+            }
+        }
+        ~Lock() {
+            pthread_mutex_unlock(&segment->mutex);
+        }
+    };
+
+    void initialize(const JikanRateLimit& limit) {
+        std::memset(segment, 0, sizeof(Segment));
+        pthread_mutexattr_t attributes;
+        pthread_mutexattr_init(&attributes);
+        pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+        pthread_mutex_init(&segment->mutex, &attributes);
+        pthread_mutexattr_destroy(&attributes);
+        segment->per_second = limit.per_second;
+        segment->per_minute = limit.per_minute;
+        segment->second_tokens = limit.per_second;
+        segment->minute_tokens = limit.per_minute;
+        segment->last_refill = now_ns();
+        segment->version = version;
+        segment->magic = magic;
+    }
+
+    static bool alive(const Slot& entry) {
+        return entry.pid != 0 && (kill(entry.pid, 0) == 0 || errno != ESRCH);
+    }
+
+    // Called with the lock held
+    void claim_slot() {
+        int free_slot = -1;
+        for (int i = 0; i < max_slots; ++i) {
+            Slot& entry = segment->slots[i];
+            if (entry.pid != 0 && !alive(entry)) {
+                entry.pid = 0;
+                ++segment->reclaimed_slots;
+            }
+            if (entry.pid == 0 && free_slot < 0) free_slot = i;
+        }
+        if (free_slot < 0) throw std::runtime_error("Jikan shared quota: all " + std::to_string(max_slots) + " slots are taken");
+        Slot& entry = segment->slots[free_slot];
+        std::memset(&entry, 0, sizeof(Slot));
+        entry.pid = static_cast<int32_t>(getpid());
+        entry.owner = owner;
+        entry.weight = config.weight > 0.0 ? config.weight : 1.0;
+        entry.virtual_time = segment->virtual_clock;
+        slot = free_slot;
+    }
+
+    Slot& own_slot() {
+        if (slot < 0 || segment->slots[slot].owner != owner || segment->slots[slot].pid != static_cast<int32_t>(getpid())) {
+            claim_slot();
+        }
+        return segment->slots[slot];
+    }
+
+    void refill(int64_t now) {
+        double elapsed = std::max(0.0, (now - segment->last_refill) / 1e9);
+        segment->last_refill = now;
+        segment->second_tokens = std::min(segment->per_second, segment->second_tokens + elapsed * segment->per_second);
+        segment->minute_tokens = std::min(segment->per_minute, segment->minute_tokens + elapsed * segment->per_minute / 60.0);
+    }
+
+    int64_t until_next_token() const {
+        double wait = 0.0;
+        if (segment->second_tokens < 1.0) wait = std::max(wait, (1.0 - segment->second_tokens) / segment->per_second);
+        if (segment->minute_tokens < 1.0) wait = std::max(wait, (1.0 - segment->minute_tokens) * 60.0 / segment->per_minute);
+        return static_cast<int64_t>(wait * 1e9);
+    }
+
+    // Whether a waiting process other than this one is ahead in virtual time
+    bool someone_ahead(const Slot& self, int64_t now) const {
+        for (int i = 0; i < max_slots; ++i) {
+            const Slot& entry = segment->slots[i];
+            if (i == slot || entry.pid == 0 || entry.waiting_until < now) continue;
+            if (entry.virtual_time < self.virtual_time) return true;
+        }
+        return false;
+    }
+
+    void release() {
+        munmap(segment, sizeof(Segment));
+        segment = nullptr;
+        ::close(fd);
+        fd = -1;
+    }
+
+public:
+    explicit JikanSharedQuota(const JikanSharedQuotaConfig& config = JikanSharedQuotaConfig()) : config(config) {
+        jikan_check_rate_limit(config.limit);
+        std::random_device random;
+        owner = (static_cast<uint64_t>(random()) << 32) ^ random() ^ static_cast<uint64_t>(getpid());
+        if (owner == 0) owner = 1;
+
+        fd = ::open(config.path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+        if (fd < 0) throw std::runtime_error("Jikan shared quota: cannot open " + config.path);
+        // The file lock only orders creation; the mutex inside the mapping guards everything after
+        flock(fd, LOCK_EX);
+        struct stat info;
+        bool fresh = fstat(fd, &info) == 0 && info.st_size < static_cast<off_t>(sizeof(Segment));
+        if (fresh && ftruncate(fd, sizeof(Segment)) != 0) {
+            flock(fd, LOCK_UN);
+            ::close(fd);
+            throw std::runtime_error("Jikan shared quota: cannot size " + config.path);
+        }
+        void* address = mmap(nullptr, sizeof(Segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (address == MAP_FAILED) {
+            flock(fd, LOCK_UN);
+            ::close(fd);
+            throw std::runtime_error("Jikan shared quota: cannot map " + config.path);
+        }
+        segment = static_cast<Segment*>(address);
+        if (fresh || segment->magic != magic) initialize(config.limit);
+        flock(fd, LOCK_UN);
+        if (segment->version != version) {
+            release();
+            throw std::runtime_error("Jikan shared quota: " + config.path + " has another layout");
+        }
+
+        try {
+            Lock lock(segment);
+            claim_slot();
+        } catch (...) {
+            // The destructor does not run for a constructor that throws
+            release();
+            throw;
+        }
+    }
+
+    ~JikanSharedQuota() {
+        if (!segment) return;
+        {
+            Lock lock(segment);
+            Slot& entry = segment->slots[slot];
+            if (entry.owner == owner) entry.pid = 0;
+        }
+        release();
+    }
+
+    JikanSharedQuota(const JikanSharedQuota&) = delete;
+    JikanSharedQuota& operator=(const JikanSharedQuota&) = delete;
+
+    clock::duration acquire() override {
+        Lock lock(segment);
+        int64_t now = now_ns();
+        Slot& self = own_slot();
+        // Coming back from idle: queue at the current virtual time instead of spending saved up credit
+        if (self.waiting_until < now) self.virtual_time = std::max(self.virtual_time, segment->virtual_clock);
+
+        int64_t wait = 0;
+        refill(now);
+        if (now < segment->paused_until) {
+            wait = segment->paused_until - now;
+        } else if ((wait = until_next_token()) == 0 && someone_ahead(self, now)) {
+            wait = turn_poll;
+        }
+        if (wait > 0) {
+            self.waiting_until = now + wait + waiting_slack;
+            return std::chrono::duration_cast<clock::duration>(std::chrono::nanoseconds(wait));
+        }
+
+        segment->second_tokens -= 1.0;
+        segment->minute_tokens -= 1.0;
+        segment->virtual_clock = self.virtual_time;
+        self.virtual_time += 1.0 / self.weight;
+        self.waiting_until = 0;
+        ++self.granted;
+        ++segment->granted;
+        return clock::duration::zero();
+    }
+
+    void throttle(std::chrono::milliseconds retry_after) override {
+        Lock lock(segment);
+        int64_t until = now_ns() + std::chrono::duration_cast<std::chrono::nanoseconds>(retry_after).count();
+        segment->paused_until = std::max(segment->paused_until, until);
+        segment->second_tokens = std::min(segment->second_tokens, 0.0);
+    }
+
+    void set_weight(double weight) {
+        Lock lock(segment);
+        own_slot().weight = weight > 0.0 ? weight : 1.0;
+    }
+
+    // Changes the limit for every process sharing the file
+    void set_rate_limit(const JikanRateLimit& limit) {
+        jikan_check_rate_limit(limit);
+        Lock lock(segment);
+        refill(now_ns());
+        segment->per_second = limit.per_second;
+        segment->per_minute = limit.per_minute;
+        segment->second_tokens = std::min(segment->second_tokens, limit.per_second);
+        segment->minute_tokens = std::min(segment->minute_tokens, limit.per_minute);
+    }
+
+    JikanSharedQuotaStats stats() {
+        Lock lock(segment);
+        JikanSharedQuotaStats result;
+        for (int i = 0; i < max_slots; ++i) {
+            if (segment->slots[i].pid != 0 && alive(segment->slots[i])) ++result.processes;
+        }
+        result.granted = segment->granted;
+        result.granted_here = own_slot().granted;
+        result.reclaimed_slots = segment->reclaimed_slots;
+        result.recovered_locks = segment->recovered_locks;
+        result.limit.per_second = segment->per_second;
+        result.limit.per_minute = segment->per_minute;
+        return result;
+    }
+};
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef JIKAN_SINGLE_FLIGHT_H
+#define JIKAN_SINGLE_FLIGHT_H
+
+#include <pplx/pplx.h>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+struct JikanSingleFlightStats {
+    uint64_t started = 0;
+    uint64_t coalesced = 0;
+    size_t in_flight = 0;
+};
+
+// Identical requests started while one is already running share its task instead of sending their own
+template <typename T>
+class JikanSingleFlight : public std::enable_shared_from_this<JikanSingleFlight<T>> {
+private:
+    std::mutex mutex;
+    std::unordered_map<std::string, pplx::task<T>> in_flight;
+    std::atomic<uint64_t> started{0};
+    std::atomic<uint64_t> coalesced{0};
+
+    void finish(const std::string& key) {
+        std::lock_guard<std::mutex> lock(mutex);
+        in_flight.erase(key);
+    }
+
+public:
+    pplx::task<T> run(const std::string& key, const std::function<pplx::task<T>()>& start) {
+        // The shared task is registered before start() runs, so callers racing with a fast completion still join it
+        pplx::task_completion_event<T> done;
+        pplx::task<T> shared(done);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = in_flight.find(key);
+            if (it != in_flight.end()) {
+                ++coalesced;
+                return it->second;
+            }
+            in_flight[key] = shared;
+            ++started;
+        }
+
+        auto self = this->shared_from_this();
+        try {
+            start().then([self, key, done](pplx::task<T> previousTask) {
+                self->finish(key);
+                try {
+                    done.set(previousTask.get());
+                } catch (...) {
+                    done.set_exception(std::current_exception());
+                }
+            });
+        } catch (...) {
+            finish(key);
+            done.set_exception(std::current_exception());
+        }
+        return shared;
+    }
+
+    JikanSingleFlightStats stats() {
+        JikanSingleFlightStats result;
+        result.started = started.load();
+        result.coalesced = coalesced.load();
+        std::lock_guard<std::mutex> lock(mutex);
+        result.in_flight = in_flight.size();
+        return result;
+    }
+};
+
+#endif
@@ -0,0 +1,330 @@
+#ifndef JIKAN_SYNC_H
+#define JIKAN_SYNC_H
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Jikan.h"
+
+enum class JikanSyncKind {
+    Anime,
+    Manga
+};
+
+struct JikanSyncConfig {
+    // Where progress is kept between runs; empty keeps everything in memory
+    std::string checkpoint_path;
+    // Upper bound of pages walked per paged feed
+    int max_feed_pages = 20;
+    // Search orderings walked as change feeds, newest additions first by default
+    std::vector<std::pair<std::string, std::string>> search_orders = {{"start_date", "desc"}};
+    int search_pages = 4;
+    bool include_manga = true;
+    size_t max_in_flight = 4;
+    // Fields left out of the content hash; these counters move every day and would mark everything changed
+    std::vector<std::string> ignored_fields = {"members", "favorites", "scored_by", "popularity", "rank"};
+    // Checkpoint after this many fetched entities
+    size_t checkpoint_every = 200;
+    // Runs in a row an entity may fail before it is dropped from pending; a 404 drops it at once
+    int max_fetch_attempts = 3;
+};
+
+struct JikanSyncReport {
+    // Requests spent walking change feeds
+    uint64_t feed_requests = 0;
+    // Entities the feeds pointed at, and those skipped because their feed copy was unchanged
+    uint64_t candidates = 0;
+    uint64_t skipped = 0;
+    // Full documents fetched, split by outcome
+    uint64_t fetched = 0;
+    uint64_t changed = 0;
+    uint64_t unchanged = 0;
+    uint64_t failed = 0;
+    // Pending entities given up on, gone upstream or failing max_fetch_attempts runs in a row
+    uint64_t dropped = 0;
+    // Entities known to the mirror after the run; a naive crawl fetches every one of them
+    uint64_t known_entities = 0;
+    uint64_t naive_requests = 0;
+    uint64_t requests_saved = 0;
+    bool resumed = false;
+};
+
+// Called for every entity whose full document changed since the last sync, one call at a time
+typedef std::function<void(JikanSyncKind kind, int id, const web::json::value& data)> JikanSyncSink;
+
+// Keeps a mirror current by only refetching entities that change feeds point at:
+//     JikanSyncConfig config;
+//     config.checkpoint_path = "mirror.sync";
+//     JikanSync sync(api, config);
+//     auto report = sync.run([](JikanSyncKind kind, int id, const json::value& data) { store(kind, id, data); });
+class JikanSync {
+private:
+    struct Record {
+        // Hash of the entity as embedded in list feeds, zero when never seen there
+        uint64_t summary = 0;
+        // Hash of the full document
+        uint64_t full = 0;
+    };
+
+    typedef std::pair<JikanSyncKind, int> Key;
+
+    Jikan& api;
+    JikanSyncConfig config;
+    std::map<Key, Record> records;
+    // Entities found by discovery and not fetched yet, with the number of runs whose fetch failed;
+    // non-empty after a crash mid-run
+    std::map<Key, int> pending;
+    // Entities already fetched by the current run, so a failure counts once per run
+    std::set<Key> attempted;
+    JikanSyncReport progress;
+
+    uint64_t content_hash(const web::json::value& data) const {
+        web::json::value copy = data;
+        if (copy.is_object()) {
+            for (const auto& field : config.ignored_fields) {
+                copy.erase(utility::conversions::to_string_t(field));
+            }
+        }
+        return jikan_hash64(utility::conversions::to_utf8string(copy.serialize()));
+    }
+
+    static bool failed(const web::json::value& page) {
+        return !page.is_object() || page.has_field(U("error"));
+    }
+
+    static bool has_next_page(const web::json::value& page) {
+        if (!page.has_object_field(U("pagination"))) return false;
+        const auto& pagination = page.at(U("pagination"));
+        return pagination.has_field(U("has_next_page")) && pagination.at(U("has_next_page")).as_bool();
+    }
+
+    // Feed items either are the entity itself (season, schedule, search) or point at it through "entry"
+    void discover_item(JikanSyncKind kind, const web::json::value& item) {
+        if (!item.is_object()) return;
+        if (item.has_field(U("entry"))) {
+            const auto& entry = item.at(U("entry"));
+            if (entry.is_array()) {
+                for (const auto& inner : entry.as_array()) discover_ref(kind, inner);
+            } else {
+                discover_ref(kind, entry);
+            }
+            return;
+        }
+        if (!item.has_field(U("mal_id"))) return;
+        Key key(kind, item.at(U("mal_id")).as_integer());
+        uint64_t summary = content_hash(item);
+        ++progress.candidates;
+        auto it = records.find(key);
+        if (it != records.end() && it->second.full != 0 && it->second.summary == summary) {
+            ++progress.skipped;
+            return;
+        }
+        records[key].summary = summary;
+        pending.insert(std::make_pair(key, 0));
+    }
+
+    void discover_ref(JikanSyncKind kind, const web::json::value& ref) {
+        if (!ref.is_object() || !ref.has_field(U("mal_id"))) return;
+        ++progress.candidates;
+        pending.insert(std::make_pair(Key(kind, ref.at(U("mal_id")).as_integer()), 0));
+    }
+
+    void discover_page(JikanSyncKind kind, const web::json::value& page) {
+        if (!page.has_array_field(U("data"))) return;
+        for (const auto& item : page.at(U("data")).as_array()) discover_item(kind, item);
+    }
+
+    void walk(JikanSyncKind kind, int max_pages, const std::function<pplx::task<web::json::value>(int)>& fetch) {
+        for (int page = 1; page <= max_pages; ++page) {
+            web::json::value result = fetch(page).get();
+            ++progress.feed_requests;
+            if (failed(result)) return;
+            discover_page(kind, result);
+            if (!has_next_page(result)) return;
+        }
+    }
+
+    void discover() {
+        Jikan& api = this->api;
+        ++progress.feed_requests;
+        discover_page(JikanSyncKind::Anime, api.getWatchRecentEpisodes().get());
+
+        walk(JikanSyncKind::Anime, config.max_feed_pages, [&api](int page) {
+            return api.getSeasonNow(page, 25);
+        });
+        walk(JikanSyncKind::Anime, config.max_feed_pages, [&api](int page) {
+            return api.getSchedules(page, 25);
+        });
+        walk(JikanSyncKind::Anime, config.max_feed_pages, [&api](int page) {
+            return api.getRecentAnimeReviews(page);
+        });
+        for (const auto& order : config.search_orders) {
+            walk(JikanSyncKind::Anime, config.search_pages, [&api, &order](int page) {
+                return api.getAnimeSearch(page, 25, "", "", 0.0, 0.0, 0.0, "", "", false, "", "", order.first, order.second);
+            });
+        }
+
+        if (!config.include_manga) return;
+        walk(JikanSyncKind::Manga, config.max_feed_pages, [&api](int page) {
+            return api.getRecentMangaReviews(page);
+        });
+        for (const auto& order : config.search_orders) {
+            walk(JikanSyncKind::Manga, config.search_pages, [&api, &order](int page) {
+                return api.getMangaSearch(page, 25, "", "", 0.0, 0.0, 0.0, "", false, "", "", order.first, order.second);
+            });
+        }
+    }
+
+    static bool not_found(const web::json::value& result) {
+        return result.has_string_field(U("error")) && result.at(U("error")).as_string() == U("HTTP Error: 404");
+    }
+
+    void fetch_pending(JikanSyncKind kind, const JikanSyncSink& on_change) {
+        std::vector<int> ids;
+        for (const auto& item : pending) {
+            if (item.first.first == kind && attempted.insert(item.first).second) ids.push_back(item.first.second);
+        }
+        if (ids.empty()) return;
+
+        size_t since_checkpoint = 0;
+        JikanEndpointKind endpoint = kind == JikanSyncKind::Anime ? JikanEndpointKind::AnimeFull : JikanEndpointKind::MangaFull;
+        api.getManyById(endpoint, ids, [this, kind, &on_change, &since_checkpoint](size_t, int id, const web::json::value& result, bool ok) {
+            Key key(kind, id);
+            ++progress.fetched;
+            if (!ok || !result.has_field(U("data"))) {
+                ++progress.failed;
+                // Anything else stays pending and is retried by the next run
+                if (not_found(result) || ++pending[key] >= config.max_fetch_attempts) {
+                    pending.erase(key);
+                    ++progress.dropped;
+                }
+                return;
+            }
+            const auto& data = result.at(U("data"));
+            uint64_t full = content_hash(data);
+            Record& record = records[key];
+            if (record.full != full) {
+                on_change(kind, id, data);
+                record.full = full;
+                ++progress.changed;
+            } else {
+                ++progress.unchanged;
+            }
+            pending.erase(key);
+            if (++since_checkpoint >= config.checkpoint_every) {
+                since_checkpoint = 0;
+                save();
+            }
+        }, config.max_in_flight).wait();
+    }
+
+    void fetch_all(const JikanSyncSink& on_change) {
+        fetch_pending(JikanSyncKind::Anime, on_change);
+        fetch_pending(JikanSyncKind::Manga, on_change);
+        save();
+    }
+
+    static char kind_code(JikanSyncKind kind) {
+        return kind == JikanSyncKind::Anime ? 'a' : 'm';
+    }
+
+    // Text file, written to a temporary name and renamed over the old one so a crash never leaves half a file
+    void save() const {
+        if (config.checkpoint_path.empty()) return;
+        std::string temporary = config.checkpoint_path + ".tmp";
+        {
+            std::ofstream out(temporary, std::ios::trunc);
+            if (!out) throw std::runtime_error("Jikan sync: cannot write " + temporary);
+            out << "jikan-sync 1\n";
+            for (const auto& item : records) {
+                out << "record " << kind_code(item.first.first) << ' ' << item.first.second << ' '
+                    << std::hex << item.second.summary << ' ' << item.second.full << std::dec << '\n';
+            }
+            for (const auto& item : pending) {
+                out << "pending " << kind_code(item.first.first) << ' ' << item.first.second << ' ' << item.second << '\n';
+            }
+            out.flush();
+            if (!out) throw std::runtime_error("Jikan sync: cannot write " + temporary);
+        }
+        if (std::rename(temporary.c_str(), config.checkpoint_path.c_str()) != 0) {
+            throw std::runtime_error("Jikan sync: cannot replace " + config.checkpoint_path);
+        }
+    }
+
+    void load() {
+        if (config.checkpoint_path.empty()) return;
+        std::ifstream in(config.checkpoint_path);
+        if (!in) return;
+        std::string line;
+        if (!std::getline(in, line) || line != "jikan-sync 1") return;
+        while (std::getline(in, line)) {
+            std::istringstream fields(line);
+            std::string type;
+            char code = 0;
+            int id = 0;
+            fields >> type >> code >> id;
+            if (!fields) continue;
+            Key key(code == 'm' ? JikanSyncKind::Manga : JikanSyncKind::Anime, id);
+            if (type == "record") {
+                Record record;
+                fields >> std::hex >> record.summary >> record.full;
+                if (fields) records[key] = record;
+            } else if (type == "pending") {
+                int failures = 0;
+                fields >> failures;
+                pending[key] = fields ? failures : 0;
+            }
+        }
+    }
+
+public:
+    JikanSync(Jikan& api, const JikanSyncConfig& config = JikanSyncConfig()) : api(api), config(config) {
+        load();
+    }
+
+    // Hashes of entities already mirrored by other means, so the first run does not report them as changed
+    void seed(JikanSyncKind kind, int id, const web::json::value& data) {
+        records[Key(kind, id)].full = content_hash(data);
+    }
+
+    // Finds probably-changed entities, fetches only those and hands changed documents to on_change.
+    // Pending work left in the checkpoint is fetched first, then the feeds are walked as in any run.
+    // Every request asks the server: cached copies are revalidated, never answered from memory.
+    JikanSyncReport run(const JikanSyncSink& on_change) {
+        progress = JikanSyncReport();
+        attempted.clear();
+        progress.resumed = !pending.empty();
+        JikanCallOptions options = JikanCallScope::current();
+        options.revalidate = true;
+        JikanCallScope scope(options);
+
+        if (progress.resumed) fetch_all(on_change);
+        discover();
+        save();
+        fetch_all(on_change);
+
+        progress.known_entities = records.size();
+        progress.naive_requests = records.size();
+        uint64_t spent = progress.feed_requests + progress.fetched;
+        progress.requests_saved = progress.naive_requests > spent ? progress.naive_requests - spent : 0;
+        return progress;
+    }
+
+    pplx::task<JikanSyncReport> run_async(JikanSyncSink on_change) {
+        return pplx::create_task([this, on_change]() { return run(on_change); });
+    }
+
+    size_t pending_count() const {
+        return pending.size();
+    }
+};
+
+#endif
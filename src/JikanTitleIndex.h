@@ -0,0 +1,342 @@
+#ifndef JIKAN_TITLE_INDEX_H
+#define JIKAN_TITLE_INDEX_H
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Jikan.h"
+
+enum class JikanTitleKind {
+    Anime,
+    Manga
+};
+
+struct JikanTitleMatch {
+    JikanTitleKind kind = JikanTitleKind::Anime;
+    // Zero when nothing matched
+    int mal_id = 0;
+    // Main title of the entry and the name the query matched, which may be a synonym
+    std::string title;
+    std::string matched;
+    // Dice coefficient of the trigram sets, 1 for identical names
+    double score = 0.0;
+    // Whether a search request was needed to settle it
+    bool searched = false;
+};
+
+// Trigram inverted index over the titles, synonyms and English/Japanese names of anime and manga.
+// Names are lowercased and punctuation becomes spaces before trigrams are taken, so spacing,
+// case and small misspellings cost a few shared trigrams instead of the whole match.
+class JikanTitleIndex {
+private:
+    struct Entry {
+        JikanTitleKind kind;
+        int mal_id;
+        std::string title;
+        std::set<std::string> names;
+    };
+
+    std::vector<Entry> entries;
+    std::map<std::pair<JikanTitleKind, int>, uint32_t> entry_ids;
+    // Per name, side by side so scoring reads flat arrays
+    std::vector<uint32_t> name_entry;
+    std::vector<uint16_t> name_trigrams;
+    std::vector<std::string> name_text;
+    std::unordered_map<uint32_t, std::vector<uint32_t>> postings;
+
+    // Counters for one query, kept per thread and cleared through the touched list
+    struct Scratch {
+        std::vector<uint16_t> common;
+        std::vector<uint32_t> touched;
+        std::vector<float> entry_score;
+        std::vector<uint32_t> entry_name;
+        std::vector<uint32_t> entries_touched;
+        std::vector<uint32_t> trigrams;
+    };
+
+    static Scratch& scratch() {
+        static thread_local Scratch buffers;
+        return buffers;
+    }
+
+    static void trigrams(const std::string& normalized, std::vector<uint32_t>& out) {
+        out.clear();
+        std::string padded = " " + normalized + " ";
+        for (size_t i = 0; i + 3 <= padded.size(); ++i) {
+            out.push_back(static_cast<uint32_t>(static_cast<unsigned char>(padded[i])) << 16 |
+                          static_cast<uint32_t>(static_cast<unsigned char>(padded[i + 1])) << 8 |
+                          static_cast<uint32_t>(static_cast<unsigned char>(padded[i + 2])));
+        }
+        std::sort(out.begin(), out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+    }
+
+    static void add_name(std::vector<std::string>& names, const web::json::value& value) {
+        if (value.is_string() && !value.as_string().empty()) names.push_back(utility::conversions::to_utf8string(value.as_string()));
+    }
+
+public:
+    // Lowercase ASCII, every other ASCII character but digits becomes a space, runs of spaces collapse;
+    // UTF-8 sequences are kept as they are so Japanese names index by their bytes
+    static std::string normalize(const std::string& title) {
+        std::string out;
+        out.reserve(title.size());
+        bool space = true;
+        for (char c : title) {
+            unsigned char byte = static_cast<unsigned char>(c);
+            if (byte >= 'A' && byte <= 'Z') byte = static_cast<unsigned char>(byte - 'A' + 'a');
+            bool keep = byte >= 0x80 || (byte >= 'a' && byte <= 'z') || (byte >= '0' && byte <= '9');
+            if (keep) {
+                out += static_cast<char>(byte);
+                space = false;
+            } else if (!space) {
+                out += ' ';
+                space = true;
+            }
+        }
+        if (!out.empty() && out.back() == ' ') out.pop_back();
+        return out;
+    }
+
+    // Adds name as one of the names of an entry; the first call for an entry sets its main title
+    void add(JikanTitleKind kind, int mal_id, const std::string& title, const std::string& name) {
+        std::string normalized = normalize(name);
+        if (normalized.empty() || mal_id <= 0) return;
+        auto key = std::make_pair(kind, mal_id);
+        auto it = entry_ids.find(key);
+        if (it == entry_ids.end()) {
+            it = entry_ids.emplace(key, static_cast<uint32_t>(entries.size())).first;
+            entries.push_back(Entry{kind, mal_id, title, {}});
+        }
+        Entry& entry = entries[it->second];
+        if (!entry.names.insert(normalized).second) return;
+
+        std::vector<uint32_t> grams;
+        trigrams(normalized, grams);
+        uint32_t id = static_cast<uint32_t>(name_entry.size());
+        name_entry.push_back(it->second);
+        name_trigrams.push_back(static_cast<uint16_t>(std::min<size_t>(grams.size(), 0xFFFF)));
+        name_text.push_back(name);
+        for (uint32_t gram : grams) postings[gram].push_back(id);
+    }
+
+    // Adds every name of a getAnimeFullById/getMangaFullById (or search result) entry; a whole response works too
+    void add(JikanTitleKind kind, const web::json::value& value) {
+        const web::json::value& data = value.has_object_field(U("data")) ? value.at(U("data")) : value;
+        if (!data.has_number_field(U("mal_id"))) return;
+        int mal_id = data.at(U("mal_id")).as_integer();
+        std::vector<std::string> names;
+        if (data.has_field(U("title"))) add_name(names, data.at(U("title")));
+        if (data.has_field(U("title_english"))) add_name(names, data.at(U("title_english")));
+        if (data.has_field(U("title_japanese"))) add_name(names, data.at(U("title_japanese")));
+        if (data.has_array_field(U("title_synonyms"))) {
+            for (const auto& synonym : data.at(U("title_synonyms")).as_array()) add_name(names, synonym);
+        }
+        if (data.has_array_field(U("titles"))) {
+            for (const auto& title : data.at(U("titles")).as_array()) {
+                if (title.has_field(U("title"))) add_name(names, title.at(U("title")));
+            }
+        }
+        if (names.empty()) return;
+        for (const auto& name : names) add(kind, mal_id, names.front(), name);
+    }
+
+    // Best matches of query among entries of kind, one per entry, highest score first
+    std::vector<JikanTitleMatch> search(const std::string& query, JikanTitleKind kind, size_t limit = 5) const {
+        return find(query, kind, limit, nullptr);
+    }
+
+    // The same, counting only the entries whose mal_id is in among
+    std::vector<JikanTitleMatch> search(const std::string& query, JikanTitleKind kind, size_t limit, const std::set<int>& among) const {
+        return find(query, kind, limit, &among);
+    }
+
+    size_t entry_count() const {
+        return entries.size();
+    }
+
+    size_t name_count() const {
+        return name_entry.size();
+    }
+
+private:
+    std::vector<JikanTitleMatch> find(const std::string& query, JikanTitleKind kind, size_t limit, const std::set<int>* among) const {
+        std::vector<JikanTitleMatch> matches;
+        Scratch& s = scratch();
+        trigrams(normalize(query), s.trigrams);
+        if (s.trigrams.empty() || limit == 0) return matches;
+        if (s.common.size() < name_entry.size()) s.common.resize(name_entry.size(), 0);
+        if (s.entry_score.size() < entries.size()) {
+            s.entry_score.resize(entries.size(), -1.0f);
+            s.entry_name.resize(entries.size(), 0);
+        }
+
+        for (uint32_t gram : s.trigrams) {
+            auto it = postings.find(gram);
+            if (it == postings.end()) continue;
+            for (uint32_t id : it->second) {
+                if (s.common[id]++ == 0) s.touched.push_back(id);
+            }
+        }
+
+        float query_size = static_cast<float>(s.trigrams.size());
+        for (uint32_t id : s.touched) {
+            uint32_t entry = name_entry[id];
+            float score = 2.0f * s.common[id] / (query_size + name_trigrams[id]);
+            s.common[id] = 0;
+            if (entries[entry].kind != kind) continue;
+            if (among && !among->count(entries[entry].mal_id)) continue;
+            if (s.entry_score[entry] < 0.0f) s.entries_touched.push_back(entry);
+            if (score > s.entry_score[entry]) {
+                s.entry_score[entry] = score;
+                s.entry_name[entry] = id;
+            }
+        }
+        s.touched.clear();
+
+        size_t count = std::min(limit, s.entries_touched.size());
+        std::partial_sort(s.entries_touched.begin(), s.entries_touched.begin() + count, s.entries_touched.end(),
+                          [&s](uint32_t a, uint32_t b) { return s.entry_score[a] > s.entry_score[b]; });
+        for (size_t i = 0; i < count; ++i) {
+            uint32_t entry = s.entries_touched[i];
+            JikanTitleMatch match;
+            match.kind = entries[entry].kind;
+            match.mal_id = entries[entry].mal_id;
+            match.title = entries[entry].title;
+            match.matched = name_text[s.entry_name[entry]];
+            match.score = s.entry_score[entry];
+            matches.push_back(match);
+        }
+        for (uint32_t entry : s.entries_touched) s.entry_score[entry] = -1.0f;
+        s.entries_touched.clear();
+        return matches;
+    }
+};
+
+struct JikanTitleResolverConfig {
+    // A local match is taken when it scores at least this and leads the next entry by min_margin
+    double min_score = 0.6;
+    double min_margin = 0.1;
+    // Ask the search endpoint when the local index is not sure; its results are added to the index
+    bool search_fallback = true;
+    int search_limit = 10;
+};
+
+struct JikanTitleResolverStats {
+    uint64_t local = 0;
+    uint64_t searched = 0;
+    uint64_t remembered = 0;
+    uint64_t unresolved = 0;
+};
+
+// Maps free-form titles to MAL ids, from the local index when it is confident and from
+// getAnimeSearch/getMangaSearch otherwise. Search answers are remembered per normalized title,
+// so a title repeated in the input costs one successful search at most; a failed search is
+// tried again the next time the title comes up.
+//     JikanTitleResolver resolver(api);
+//     resolver.add(JikanTitleKind::Anime, api.getAnimeFullById(5114).get());
+//     auto match = resolver.resolve("fullmetal alchemist brotherhod").get();
+class JikanTitleResolver {
+private:
+    struct State {
+        std::mutex mutex;
+        JikanTitleIndex index;
+        std::map<std::pair<JikanTitleKind, std::string>, JikanTitleMatch> remembered;
+        JikanTitleResolverStats counters;
+    };
+
+    Jikan& api;
+    JikanTitleResolverConfig config;
+    std::shared_ptr<State> state = std::make_shared<State>();
+
+    static bool confident(const std::vector<JikanTitleMatch>& matches, const JikanTitleResolverConfig& config) {
+        if (matches.empty() || matches[0].score < config.min_score) return false;
+        return matches.size() == 1 || matches[0].score - matches[1].score >= config.min_margin;
+    }
+
+public:
+    JikanTitleResolver(Jikan& api, const JikanTitleResolverConfig& config = JikanTitleResolverConfig()) : api(api), config(config) {}
+
+    void add(JikanTitleKind kind, const web::json::value& value) {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->index.add(kind, value);
+    }
+
+    void add(JikanTitleKind kind, int mal_id, const std::string& title, const std::string& name) {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->index.add(kind, mal_id, title, name);
+    }
+
+    // Local matches only, nothing is requested
+    std::vector<JikanTitleMatch> search(const std::string& query, JikanTitleKind kind = JikanTitleKind::Anime, size_t limit = 5) {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        return state->index.search(query, kind, limit);
+    }
+
+    // A match with mal_id 0 means neither the index nor the search found the title
+    pplx::task<JikanTitleMatch> resolve(const std::string& query, JikanTitleKind kind = JikanTitleKind::Anime) {
+        auto key = std::make_pair(kind, JikanTitleIndex::normalize(query));
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            // The index comes first: titles added since a remembered miss may answer it now
+            auto matches = state->index.search(query, kind, 2);
+            if (confident(matches, config)) {
+                ++state->counters.local;
+                return pplx::task_from_result(matches[0]);
+            }
+            auto it = state->remembered.find(key);
+            if (it != state->remembered.end()) {
+                ++state->counters.remembered;
+                return pplx::task_from_result(it->second);
+            }
+            if (!config.search_fallback) {
+                ++state->counters.unresolved;
+                return pplx::task_from_result(JikanTitleMatch());
+            }
+        }
+
+        auto request = kind == JikanTitleKind::Anime ? api.getAnimeSearch(1, config.search_limit, query)
+                                                     : api.getMangaSearch(1, config.search_limit, query);
+        auto shared = state;
+        double min_score = config.min_score;
+        return request.then([shared, min_score, key, query, kind](web::json::value result) {
+            std::lock_guard<std::mutex> lock(shared->mutex);
+            // Errors (429, 5xx, cancellation) come back without data and are not remembered
+            bool answered = result.has_array_field(U("data"));
+            std::set<int> found;
+            if (answered) {
+                for (const auto& item : result.at(U("data")).as_array()) {
+                    shared->index.add(kind, item);
+                    if (item.has_number_field(U("mal_id"))) found.insert(item.at(U("mal_id")).as_integer());
+                }
+            }
+            // Only entries the search returned can win here: an indexed entry the search passed over
+            // was not confident locally and is no better now. Among those the best name has to clear min_score.
+            auto matches = shared->index.search(query, kind, 1, found);
+            JikanTitleMatch match;
+            if (!matches.empty() && matches[0].score >= min_score) {
+                match = matches[0];
+                match.searched = true;
+                ++shared->counters.searched;
+            } else {
+                ++shared->counters.unresolved;
+            }
+            if (answered) shared->remembered[key] = match;
+            return match;
+        });
+    }
+
+    JikanTitleResolverStats stats() {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        return state->counters;
+    }
+};
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef JIKAN_TRANSPORT_H
+#define JIKAN_TRANSPORT_H
+
+#include <cpprest/http_client.h>
+#include <pplx/pplx.h>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Carries one request to the api and brings its response back. The connection pool is the default;
+// record and replay transports stand in for it in tests and benchmarks.
+class JikanTransport {
+private:
+    uint64_t instance;
+
+    static uint64_t next_instance() {
+        static std::atomic<uint64_t> next{0};
+        return ++next;
+    }
+
+public:
+    JikanTransport() : instance(next_instance()) {}
+    virtual ~JikanTransport() {}
+
+    // Names where the answers come from; the response cache keeps answers of different backends apart.
+    // Unless a transport says otherwise, each transport object is a backend of its own
+    virtual std::string backend() const {
+        return "transport " + std::to_string(instance);
+    }
+
+    // new_client, when given, is set to whether the request needed a new http_client; whether the
+    // client opened a new socket for it is not visible through cpprest
+    virtual pplx::task<web::http::http_response> request(const web::http::http_request& request, bool* new_client,
+                                                         pplx::cancellation_token cancel) = 0;
+};
+
+#endif
@@ -0,0 +1,441 @@
+#ifndef JIKAN_TYPES_H
+#define JIKAN_TYPES_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "JikanBuffer.h"
+#include "JikanJsonReader.h"
+
+// Plain structs for the core endpoints, decoded straight from the response bytes without a json::value DOM.
+// Each struct has a Field mask; groups that are not requested are skipped while scanning.
+
+// Genre, studio, producer, author, magazine... as the API lists them
+struct JikanNamedRef {
+    int mal_id = 0;
+    std::string type;
+    std::string name;
+};
+
+struct JikanPagination {
+    int last_visible_page = 0;
+    bool has_next_page = false;
+    int current_page = 0;
+    int items_count = 0;
+    int items_total = 0;
+    int items_per_page = 0;
+};
+
+struct JikanAnime {
+    enum Field : uint64_t {
+        MalId = 1ull << 0,
+        Url = 1ull << 1,
+        Titles = 1ull << 2,
+        Image = 1ull << 3,
+        Type = 1ull << 4,
+        Source = 1ull << 5,
+        Episodes = 1ull << 6,
+        Status = 1ull << 7,
+        Duration = 1ull << 8,
+        Rating = 1ull << 9,
+        Score = 1ull << 10,
+        Ranking = 1ull << 11,
+        Season = 1ull << 12,
+        Synopsis = 1ull << 13,
+        Genres = 1ull << 14,
+        Studios = 1ull << 15,
+        Producers = 1ull << 16,
+        All = ~0ull
+    };
+
+    int mal_id = 0;
+    std::string url;
+    std::string image_url;
+    std::string title;
+    std::string title_english;
+    std::string title_japanese;
+    std::vector<std::string> title_synonyms;
+    std::string type;
+    std::string source;
+    int episodes = 0;
+    std::string status;
+    bool airing = false;
+    std::string duration;
+    std::string rating;
+    double score = 0.0;
+    int scored_by = 0;
+    int rank = 0;
+    int popularity = 0;
+    int members = 0;
+    int favorites = 0;
+    std::string season;
+    int year = 0;
+    std::string synopsis;
+    std::vector<JikanNamedRef> genres;
+    std::vector<JikanNamedRef> themes;
+    std::vector<JikanNamedRef> demographics;
+    std::vector<JikanNamedRef> studios;
+    std::vector<JikanNamedRef> producers;
+};
+
+struct JikanManga {
+    enum Field : uint64_t {
+        MalId = 1ull << 0,
+        Url = 1ull << 1,
+        Titles = 1ull << 2,
+        Image = 1ull << 3,
+        Type = 1ull << 4,
+        Chapters = 1ull << 5,
+        Status = 1ull << 6,
+        Score = 1ull << 7,
+        Ranking = 1ull << 8,
+        Synopsis = 1ull << 9,
+        Genres = 1ull << 10,
+        Authors = 1ull << 11,
+        Serializations = 1ull << 12,
+        All = ~0ull
+    };
+
+    int mal_id = 0;
+    std::string url;
+    std::string image_url;
+    std::string title;
+    std::string title_english;
+    std::string title_japanese;
+    std::vector<std::string> title_synonyms;
+    std::string type;
+    int chapters = 0;
+    int volumes = 0;
+    std::string status;
+    bool publishing = false;
+    double score = 0.0;
+    int scored_by = 0;
+    int rank = 0;
+    int popularity = 0;
+    int members = 0;
+    int favorites = 0;
+    std::string synopsis;
+    std::vector<JikanNamedRef> genres;
+    std::vector<JikanNamedRef> themes;
+    std::vector<JikanNamedRef> demographics;
+    std::vector<JikanNamedRef> authors;
+    std::vector<JikanNamedRef> serializations;
+};
+
+struct JikanCharacter {
+    enum Field : uint64_t {
+        MalId = 1ull << 0,
+        Url = 1ull << 1,
+        Names = 1ull << 2,
+        Image = 1ull << 3,
+        Favorites = 1ull << 4,
+        About = 1ull << 5,
+        All = ~0ull
+    };
+
+    int mal_id = 0;
+    std::string url;
+    std::string image_url;
+    std::string name;
+    std::string name_kanji;
+    std::vector<std::string> nicknames;
+    int favorites = 0;
+    std::string about;
+};
+
+struct JikanPerson {
+    enum Field : uint64_t {
+        MalId = 1ull << 0,
+        Url = 1ull << 1,
+        Names = 1ull << 2,
+        Image = 1ull << 3,
+        Birthday = 1ull << 4,
+        Favorites = 1ull << 5,
+        About = 1ull << 6,
+        All = ~0ull
+    };
+
+    int mal_id = 0;
+    std::string url;
+    std::string website_url;
+    std::string image_url;
+    std::string name;
+    std::string given_name;
+    std::string family_name;
+    std::vector<std::string> alternate_names;
+    std::string birthday;
+    int favorites = 0;
+    std::string about;
+};
+
+// Mirrors the json error object: success is false and error holds the message when the request failed
+template <typename T>
+struct JikanResult {
+    T data;
+    bool success = true;
+    std::string error;
+};
+
+template <typename T>
+struct JikanPage {
+    std::vector<T> data;
+    JikanPagination pagination;
+    bool success = true;
+    std::string error;
+};
+
+namespace jikan_decode {
+
+inline bool key_is(const char* key, size_t size, const char* name) {
+    return JikanJsonReader::key_is(key, size, name);
+}
+
+inline int read_int(JikanJsonReader& in) {
+    return static_cast<int>(in.read_int());
+}
+
+inline void read_strings(JikanJsonReader& in, std::vector<std::string>& out) {
+    out.clear();
+    if (!in.is_array()) {
+        in.skip_value();
+        return;
+    }
+    in.begin_array();
+    while (in.next_element()) {
+        out.push_back(in.read_string());
+    }
+}
+
+inline void read_refs(JikanJsonReader& in, std::vector<JikanNamedRef>& out) {
+    out.clear();
+    if (!in.is_array()) {
+        in.skip_value();
+        return;
+    }
+    in.begin_array();
+    while (in.next_element()) {
+        if (!in.is_object()) {
+            in.skip_value();
+            continue;
+        }
+        JikanNamedRef ref;
+        const char* key = nullptr;
+        size_t size = 0;
+        in.begin_object();
+        while (in.next_key(key, size)) {
+            if (key_is(key, size, "mal_id")) ref.mal_id = read_int(in);
+            else if (key_is(key, size, "type")) in.read_string(ref.type);
+            else if (key_is(key, size, "name")) in.read_string(ref.name);
+            else in.skip_value();
+        }
+        out.push_back(ref);
+    }
+}
+
+// images.jpg.image_url
+inline void read_image(JikanJsonReader& in, std::string& out) {
+    if (!in.is_object()) {
+        in.skip_value();
+        return;
+    }
+    const char* key = nullptr;
+    size_t size = 0;
+    in.begin_object();
+    while (in.next_key(key, size)) {
+        if (!key_is(key, size, "jpg") || !in.is_object()) {
+            in.skip_value();
+            continue;
+        }
+        in.begin_object();
+        while (in.next_key(key, size)) {
+            if (key_is(key, size, "image_url")) in.read_string(out);
+            else in.skip_value();
+        }
+    }
+}
+
+inline void read_pagination(JikanJsonReader& in, JikanPagination& out) {
+    if (!in.is_object()) {
+        in.skip_value();
+        return;
+    }
+    const char* key = nullptr;
+    size_t size = 0;
+    in.begin_object();
+    while (in.next_key(key, size)) {
+        if (key_is(key, size, "last_visible_page")) out.last_visible_page = read_int(in);
+        else if (key_is(key, size, "has_next_page")) out.has_next_page = in.read_bool();
+        else if (key_is(key, size, "current_page")) out.current_page = read_int(in);
+        else if (key_is(key, size, "items") && in.is_object()) {
+            in.begin_object();
+            while (in.next_key(key, size)) {
+                if (key_is(key, size, "count")) out.items_count = read_int(in);
+                else if (key_is(key, size, "total")) out.items_total = read_int(in);
+                else if (key_is(key, size, "per_page")) out.items_per_page = read_int(in);
+                else in.skip_value();
+            }
+        }
+        else in.skip_value();
+    }
+}
+
+} // namespace jikan_decode
+
+// Reads one value of the current key into out, or skips it
+template <typename T>
+struct JikanDecoder;
+
+template <>
+struct JikanDecoder<JikanAnime> {
+    static void field(JikanJsonReader& in, const char* key, size_t size, JikanAnime& out, uint64_t fields) {
+        using namespace jikan_decode;
+        if (key_is(key, size, "mal_id") && (fields & JikanAnime::MalId)) out.mal_id = read_int(in);
+        else if (key_is(key, size, "url") && (fields & JikanAnime::Url)) in.read_string(out.url);
+        else if (key_is(key, size, "images") && (fields & JikanAnime::Image)) read_image(in, out.image_url);
+        else if (key_is(key, size, "title") && (fields & JikanAnime::Titles)) in.read_string(out.title);
+        else if (key_is(key, size, "title_english") && (fields & JikanAnime::Titles)) in.read_string(out.title_english);
+        else if (key_is(key, size, "title_japanese") && (fields & JikanAnime::Titles)) in.read_string(out.title_japanese);
+        else if (key_is(key, size, "title_synonyms") && (fields & JikanAnime::Titles)) read_strings(in, out.title_synonyms);
+        else if (key_is(key, size, "type") && (fields & JikanAnime::Type)) in.read_string(out.type);
+        else if (key_is(key, size, "source") && (fields & JikanAnime::Source)) in.read_string(out.source);
+        else if (key_is(key, size, "episodes") && (fields & JikanAnime::Episodes)) out.episodes = read_int(in);
+        else if (key_is(key, size, "status") && (fields & JikanAnime::Status)) in.read_string(out.status);
+        else if (key_is(key, size, "airing") && (fields & JikanAnime::Status)) out.airing = in.read_bool();
+        else if (key_is(key, size, "duration") && (fields & JikanAnime::Duration)) in.read_string(out.duration);
+        else if (key_is(key, size, "rating") && (fields & JikanAnime::Rating)) in.read_string(out.rating);
+        else if (key_is(key, size, "score") && (fields & JikanAnime::Score)) out.score = in.read_double();
+        else if (key_is(key, size, "scored_by") && (fields & JikanAnime::Score)) out.scored_by = read_int(in);
+        else if (key_is(key, size, "rank") && (fields & JikanAnime::Ranking)) out.rank = read_int(in);
+        else if (key_is(key, size, "popularity") && (fields & JikanAnime::Ranking)) out.popularity = read_int(in);
+        else if (key_is(key, size, "members") && (fields & JikanAnime::Ranking)) out.members = read_int(in);
+        else if (key_is(key, size, "favorites") && (fields & JikanAnime::Ranking)) out.favorites = read_int(in);
+        else if (key_is(key, size, "season") && (fields & JikanAnime::Season)) in.read_string(out.season);
+        else if (key_is(key, size, "year") && (fields & JikanAnime::Season)) out.year = read_int(in);
+        else if (key_is(key, size, "synopsis") && (fields & JikanAnime::Synopsis)) in.read_string(out.synopsis);
+        else if (key_is(key, size, "genres") && (fields & JikanAnime::Genres)) read_refs(in, out.genres);
+        else if (key_is(key, size, "themes") && (fields & JikanAnime::Genres)) read_refs(in, out.themes);
+        else if (key_is(key, size, "demographics") && (fields & JikanAnime::Genres)) read_refs(in, out.demographics);
+        else if (key_is(key, size, "studios") && (fields & JikanAnime::Studios)) read_refs(in, out.studios);
+        else if (key_is(key, size, "producers") && (fields & JikanAnime::Producers)) read_refs(in, out.producers);
+        else in.skip_value();
+    }
+};
+
+template <>
+struct JikanDecoder<JikanManga> {
+    static void field(JikanJsonReader& in, const char* key, size_t size, JikanManga& out, uint64_t fields) {
+        using namespace jikan_decode;
+        if (key_is(key, size, "mal_id") && (fields & JikanManga::MalId)) out.mal_id = read_int(in);
+        else if (key_is(key, size, "url") && (fields & JikanManga::Url)) in.read_string(out.url);
+        else if (key_is(key, size, "images") && (fields & JikanManga::Image)) read_image(in, out.image_url);
+        else if (key_is(key, size, "title") && (fields & JikanManga::Titles)) in.read_string(out.title);
+        else if (key_is(key, size, "title_english") && (fields & JikanManga::Titles)) in.read_string(out.title_english);
+        else if (key_is(key, size, "title_japanese") && (fields & JikanManga::Titles)) in.read_string(out.title_japanese);
+        else if (key_is(key, size, "title_synonyms") && (fields & JikanManga::Titles)) read_strings(in, out.title_synonyms);
+        else if (key_is(key, size, "type") && (fields & JikanManga::Type)) in.read_string(out.type);
+        else if (key_is(key, size, "chapters") && (fields & JikanManga::Chapters)) out.chapters = read_int(in);
+        else if (key_is(key, size, "volumes") && (fields & JikanManga::Chapters)) out.volumes = read_int(in);
+        else if (key_is(key, size, "status") && (fields & JikanManga::Status)) in.read_string(out.status);
+        else if (key_is(key, size, "publishing") && (fields & JikanManga::Status)) out.publishing = in.read_bool();
+        else if (key_is(key, size, "score") && (fields & JikanManga::Score)) out.score = in.read_double();
+        else if (key_is(key, size, "scored_by") && (fields & JikanManga::Score)) out.scored_by = read_int(in);
+        else if (key_is(key, size, "rank") && (fields & JikanManga::Ranking)) out.rank = read_int(in);
+        else if (key_is(key, size, "popularity") && (fields & JikanManga::Ranking)) out.popularity = read_int(in);
+        else if (key_is(key, size, "members") && (fields & JikanManga::Ranking)) out.members = read_int(in);
+        else if (key_is(key, size, "favorites") && (fields & JikanManga::Ranking)) out.favorites = read_int(in);
+        else if (key_is(key, size, "synopsis") && (fields & JikanManga::Synopsis)) in.read_string(out.synopsis);
+        else if (key_is(key, size, "genres") && (fields & JikanManga::Genres)) read_refs(in, out.genres);
+        else if (key_is(key, size, "themes") && (fields & JikanManga::Genres)) read_refs(in, out.themes);
+        else if (key_is(key, size, "demographics") && (fields & JikanManga::Genres)) read_refs(in, out.demographics);
+        else if (key_is(key, size, "authors") && (fields & JikanManga::Authors)) read_refs(in, out.authors);
+        else if (key_is(key, size, "serializations") && (fields & JikanManga::Serializations)) read_refs(in, out.serializations);
+        else in.skip_value();
+    }
+};
+
+template <>
+struct JikanDecoder<JikanCharacter> {
+    static void field(JikanJsonReader& in, const char* key, size_t size, JikanCharacter& out, uint64_t fields) {
+        using namespace jikan_decode;
+        if (key_is(key, size, "mal_id") && (fields & JikanCharacter::MalId)) out.mal_id = read_int(in);
+        else if (key_is(key, size, "url") && (fields & JikanCharacter::Url)) in.read_string(out.url);
+        else if (key_is(key, size, "images") && (fields & JikanCharacter::Image)) read_image(in, out.image_url);
+        else if (key_is(key, size, "name") && (fields & JikanCharacter::Names)) in.read_string(out.name);
+        else if (key_is(key, size, "name_kanji") && (fields & JikanCharacter::Names)) in.read_string(out.name_kanji);
+        else if (key_is(key, size, "nicknames") && (fields & JikanCharacter::Names)) read_strings(in, out.nicknames);
+        else if (key_is(key, size, "favorites") && (fields & JikanCharacter::Favorites)) out.favorites = read_int(in);
+        else if (key_is(key, size, "about") && (fields & JikanCharacter::About)) in.read_string(out.about);
+        else in.skip_value();
+    }
+};
+
+template <>
+struct JikanDecoder<JikanPerson> {
+    static void field(JikanJsonReader& in, const char* key, size_t size, JikanPerson& out, uint64_t fields) {
+        using namespace jikan_decode;
+        if (key_is(key, size, "mal_id") && (fields & JikanPerson::MalId)) out.mal_id = read_int(in);
+        else if (key_is(key, size, "url") && (fields & JikanPerson::Url)) in.read_string(out.url);
+        else if (key_is(key, size, "website_url") && (fields & JikanPerson::Url)) in.read_string(out.website_url);
+        else if (key_is(key, size, "images") && (fields & JikanPerson::Image)) read_image(in, out.image_url);
+        else if (key_is(key, size, "name") && (fields & JikanPerson::Names)) in.read_string(out.name);
+        else if (key_is(key, size, "given_name") && (fields & JikanPerson::Names)) in.read_string(out.given_name);
+        else if (key_is(key, size, "family_name") && (fields & JikanPerson::Names)) in.read_string(out.family_name);
+        else if (key_is(key, size, "alternate_names") && (fields & JikanPerson::Names)) read_strings(in, out.alternate_names);
+        else if (key_is(key, size, "birthday") && (fields & JikanPerson::Birthday)) in.read_string(out.birthday);
+        else if (key_is(key, size, "favorites") && (fields & JikanPerson::Favorites)) out.favorites = read_int(in);
+        else if (key_is(key, size, "about") && (fields & JikanPerson::About)) in.read_string(out.about);
+        else in.skip_value();
+    }
+};
+
+template <typename T>
+void jikan_decode_object(JikanJsonReader& in, T& out, uint64_t fields) {
+    if (!in.is_object()) {
+        in.skip_value();
+        return;
+    }
+    const char* key = nullptr;
+    size_t size = 0;
+    in.begin_object();
+    while (in.next_key(key, size)) {
+        JikanDecoder<T>::field(in, key, size, out, fields);
+    }
+}
+
+// {"data": {...}} as returned by the by-id endpoints
+template <typename T>
+void jikan_decode_document(const JikanBuffer& body, T& out, uint64_t fields = ~0ull) {
+    JikanJsonReader in(body.data(), body.size());
+    const char* key = nullptr;
+    size_t size = 0;
+    in.begin_object();
+    while (in.next_key(key, size)) {
+        if (jikan_decode::key_is(key, size, "data")) jikan_decode_object(in, out, fields);
+        else in.skip_value();
+    }
+}
+
+// {"pagination": {...}, "data": [...]} as returned by search and list endpoints
+template <typename T>
+void jikan_decode_page(const JikanBuffer& body, JikanPage<T>& out, uint64_t fields = ~0ull) {
+    JikanJsonReader in(body.data(), body.size());
+    const char* key = nullptr;
+    size_t size = 0;
+    in.begin_object();
+    while (in.next_key(key, size)) {
+        if (jikan_decode::key_is(key, size, "pagination")) {
+            jikan_decode::read_pagination(in, out.pagination);
+        } else if (jikan_decode::key_is(key, size, "data") && in.is_array()) {
+            in.begin_array();
+            while (in.next_element()) {
+                out.data.push_back(T());
+                jikan_decode_object(in, out.data.back(), fields);
+            }
+        } else {
+            in.skip_value();
+        }
+    }
+}
+
+#endif
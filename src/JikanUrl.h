@@ -0,0 +1,133 @@
+#ifndef JIKAN_URL_H
+#define JIKAN_URL_H
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+// Request target built into one buffer. Paths and parameter names are literals known at compile time,
+// values are percent-encoded exactly once while they are appended:
+//     JikanUrl("/anime").segment(5114).path("/characters")
+//     JikanUrl("/anime").param("page", 2).param("q", "fullmetal alchemist")
+class JikanUrl {
+private:
+    // Room for a typical query string so most urls never grow the buffer
+    static const size_t query_reserve = 96;
+
+    std::string buffer;
+    char separator = '?';
+
+    static bool unreserved(unsigned char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+               c == '-' || c == '_' || c == '.' || c == '~';
+    }
+
+    void encode(const std::string& value) {
+        static const char hex[] = "0123456789ABCDEF";
+        for (unsigned char c : value) {
+            if (unreserved(c)) {
+                buffer += static_cast<char>(c);
+            } else {
+                buffer += '%';
+                buffer += hex[c >> 4];
+                buffer += hex[c & 0x0F];
+            }
+        }
+    }
+
+    void number(long long value) {
+        char digits[24];
+        int size = std::snprintf(digits, sizeof(digits), "%lld", value);
+        buffer.append(digits, static_cast<size_t>(size));
+    }
+
+    void key(const char* name) {
+        buffer += separator;
+        separator = '&';
+        buffer += name;
+    }
+
+public:
+    template <size_t N>
+    explicit JikanUrl(const char (&base)[N]) {
+        buffer.reserve(N - 1 + query_reserve);
+        buffer.append(base, N - 1);
+    }
+
+    // Literal path piece such as "/full"
+    template <size_t N>
+    JikanUrl& path(const char (&piece)[N]) {
+        buffer.append(piece, N - 1);
+        return *this;
+    }
+
+    JikanUrl& segment(long long value) {
+        buffer += '/';
+        number(value);
+        return *this;
+    }
+
+    JikanUrl& segment(const std::string& value) {
+        buffer += '/';
+        encode(value);
+        return *this;
+    }
+
+    // Empty strings and non-positive numbers mean "not set" and are left out
+    JikanUrl& param(const char* name, const std::string& value) {
+        if (value.empty()) return *this;
+        key(name);
+        buffer += '=';
+        encode(value);
+        return *this;
+    }
+
+    JikanUrl& param(const char* name, int value) {
+        if (value <= 0) return *this;
+        key(name);
+        buffer += '=';
+        number(value);
+        return *this;
+    }
+
+    // Two decimals at most, written by hand so the locale cannot turn the point into a comma
+    JikanUrl& param(const char* name, double value) {
+        if (value <= 0) return *this;
+        long long hundredths = static_cast<long long>(value * 100.0 + 0.5);
+        key(name);
+        buffer += '=';
+        number(hundredths / 100);
+        int fraction = static_cast<int>(hundredths % 100);
+        if (fraction != 0) {
+            buffer += '.';
+            buffer += static_cast<char>('0' + fraction / 10);
+            if (fraction % 10 != 0) buffer += static_cast<char>('0' + fraction % 10);
+        }
+        return *this;
+    }
+
+    // Sent as name=true only when set, unset flags are left to the API default
+    JikanUrl& flag(const char* name, bool set) {
+        if (!set) return *this;
+        key(name);
+        buffer += "=true";
+        return *this;
+    }
+
+    // Always sent as true or false
+    JikanUrl& boolean(const char* name, bool value) {
+        key(name);
+        buffer += value ? "=true" : "=false";
+        return *this;
+    }
+
+    const std::string& str() const {
+        return buffer;
+    }
+
+    operator const std::string&() const {
+        return buffer;
+    }
+};
+
+#endif
@@ -0,0 +1,137 @@
+#ifndef JIKAN_TEST_H
+#define JIKAN_TEST_H
+
+#include <atomic>
+#include <cstdio>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Jikan.h"
+
+// Just enough of a test runner for the ctest targets: every JIKAN_TEST in a file runs in order,
+// a failed JIKAN_CHECK is reported with its line and makes the executable exit non-zero
+struct JikanTestRegistry {
+    static std::vector<std::pair<std::string, std::function<void()>>>& tests() {
+        static std::vector<std::pair<std::string, std::function<void()>>> all;
+        return all;
+    }
+
+    static int& failures() {
+        static int count = 0;
+        return count;
+    }
+
+    JikanTestRegistry(const char* name, std::function<void()> test) {
+        tests().push_back(std::make_pair(std::string(name), std::move(test)));
+    }
+
+    static int run() {
+        for (const auto& test : tests()) {
+            int before = failures();
+            try {
+                test.second();
+            } catch (const std::exception& e) {
+                std::fprintf(stderr, "%s: unexpected exception: %s\n", test.first.c_str(), e.what());
+                ++failures();
+            } catch (...) {
+                std::fprintf(stderr, "%s: unexpected exception\n", test.first.c_str());
+                ++failures();
+            }
+            std::printf("%s %s\n", failures() == before ? "ok  " : "FAIL", test.first.c_str());
+        }
+        return failures() == 0 ? 0 : 1;
+    }
+};
+
+#define JIKAN_TEST(name)                                            \
+    static void name();                                             \
+    static JikanTestRegistry name##_registered(#name, &name);       \
+    static void name()
+
+#define JIKAN_CHECK(condition)                                                                  \
+    do {                                                                                        \
+        if (!(condition)) {                                                                     \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            ++JikanTestRegistry::failures();                                                    \
+        }                                                                                       \
+    } while (0)
+
+// What JikanTestTransport sends back for one request; an empty body is left unset, and a
+// hanging answer never comes unless the request's token is cancelled
+struct JikanTestAnswer {
+    web::http::status_code status = 200;
+    std::string body;
+    bool hang = false;
+    // The answer is held back until this completes, so tests can keep requests in flight
+    pplx::task<void> after = pplx::task_from_result();
+
+    JikanTestAnswer(web::http::status_code status = 200, std::string body = std::string()) : status(status), body(std::move(body)) {}
+
+    static JikanTestAnswer json(std::string body) {
+        return JikanTestAnswer(200, std::move(body));
+    }
+
+    static JikanTestAnswer hanging() {
+        JikanTestAnswer answer;
+        answer.hang = true;
+        return answer;
+    }
+};
+
+// The upstream every test talks to: counts requests and answers each with respond(path, query),
+// which by default is a 200 with an empty object
+class JikanTestTransport : public JikanTransport {
+public:
+    typedef std::function<JikanTestAnswer(const std::string& path, const std::string& query)> Responder;
+
+    std::atomic<int> requests{0};
+    Responder respond;
+
+    explicit JikanTestTransport(Responder respond = [](const std::string&, const std::string&) { return JikanTestAnswer::json("{}"); })
+        : respond(std::move(respond)) {}
+
+    pplx::task<web::http::http_response> request(const web::http::http_request& request, bool* new_client,
+                                                 pplx::cancellation_token cancel) override {
+        if (new_client) *new_client = false;
+        ++requests;
+        JikanTestAnswer answer = respond(utility::conversions::to_utf8string(request.request_uri().path()),
+                                         utility::conversions::to_utf8string(request.request_uri().query()));
+        if (answer.hang) {
+            pplx::task_completion_event<web::http::http_response> never;
+            if (cancel.is_cancelable()) {
+                cancel.register_callback([never]() { never.set_exception(pplx::task_canceled()); });
+            }
+            return pplx::create_task(never);
+        }
+        web::http::http_response response(answer.status);
+        if (!answer.body.empty()) response.set_body(answer.body, "application/json");
+        return answer.after.then([response]() { return response; });
+    }
+};
+
+// Lifts the rate limit far above anything a test sends
+inline void jikan_test_unlimited(Jikan& api) {
+    JikanRateLimit unlimited;
+    unlimited.per_second = 1000.0;
+    unlimited.per_minute = 60000.0;
+    api.set_rate_limit(unlimited);
+}
+
+// Same, and puts transport in front of the api
+inline std::shared_ptr<JikanTestTransport> jikan_test_upstream(Jikan& api, std::shared_ptr<JikanTestTransport> transport =
+                                                                                std::make_shared<JikanTestTransport>()) {
+    jikan_test_unlimited(api);
+    api.set_transport(transport);
+    return transport;
+}
+
+#define JIKAN_TEST_MAIN() \
+    int main() {          \
+        return JikanTestRegistry::run(); \
+    }
+
+#endif
@@ -0,0 +1,40 @@
+#include <stdexcept>
+#include <vector>
+
+#include "JikanBatch.h"
+#include "JikanTest.h"
+
+using web::json::value;
+
+JIKAN_TEST(results_keep_the_order_of_ids_and_failures_are_listed) {
+    auto result = JikanBatch::collect({5, 6, 7, 8}, 2, [](int id) {
+        return pplx::create_task([id]() {
+            value item;
+            if (id == 7) {
+                item[U("error")] = value::string(U("HTTP Error: 404"));
+            } else {
+                item[U("mal_id")] = value::number(id);
+            }
+            return item;
+        });
+    }).get();
+    JIKAN_CHECK(result.results.size() == 4);
+    JIKAN_CHECK(result.results[0].at(U("mal_id")).as_integer() == 5);
+    JIKAN_CHECK(result.results[3].at(U("mal_id")).as_integer() == 8);
+    JIKAN_CHECK(result.results[2].is_null());
+    JIKAN_CHECK(result.failures.size() == 1 && result.failures[0].id == 7 && result.failures[0].index == 2);
+}
+
+JIKAN_TEST(fetches_that_throw_at_once_do_not_grow_the_stack) {
+    // Deep enough to overflow the stack if every failed id started the next one recursively
+    std::vector<int> ids(500000);
+    for (size_t i = 0; i < ids.size(); ++i) ids[i] = static_cast<int>(i);
+    size_t failed = 0;
+    JikanBatch::run(ids, 1, [](int) -> pplx::task<value> { throw std::runtime_error("no transport"); },
+                    [&failed](size_t, int, const value& result, bool ok) {
+                        if (!ok && result.has_field(U("error"))) ++failed;
+                    }).wait();
+    JIKAN_CHECK(failed == ids.size());
+}
+
+JIKAN_TEST_MAIN()
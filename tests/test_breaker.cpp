@@ -0,0 +1,222 @@
+#include <chrono>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <unistd.h>
+
+#include "JikanRetry.h"
+#include "JikanTest.h"
+
+using web::http::http_response;
+
+static JikanCircuitConfig quick_circuit() {
+    JikanCircuitConfig config;
+    config.window = 4;
+    config.min_requests = 2;
+    config.failure_ratio = 0.5;
+    config.open_for = std::chrono::milliseconds(20);
+    return config;
+}
+
+static void trip(JikanCircuitBreaker& breaker) {
+    breaker.record(false);
+    breaker.record(false);
+}
+
+JIKAN_TEST(opens_after_failures_and_probes_once) {
+    JikanCircuitBreaker breaker(quick_circuit());
+    trip(breaker);
+    JIKAN_CHECK(breaker.current() == JikanCircuitState::Open);
+    JIKAN_CHECK(!breaker.allow());
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    bool probe = false;
+    JIKAN_CHECK(breaker.allow(&probe));
+    JIKAN_CHECK(probe);
+    JIKAN_CHECK(breaker.current() == JikanCircuitState::HalfOpen);
+    JIKAN_CHECK(!breaker.allow(&probe));
+    JIKAN_CHECK(!probe);
+
+    breaker.record(true);
+    JIKAN_CHECK(breaker.current() == JikanCircuitState::Closed);
+    JIKAN_CHECK(breaker.allow());
+}
+
+JIKAN_TEST(released_probe_lets_the_next_request_probe) {
+    JikanCircuitBreaker breaker(quick_circuit());
+    trip(breaker);
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    JIKAN_CHECK(breaker.allow());
+    breaker.release_probe();
+    bool probe = false;
+    JIKAN_CHECK(breaker.allow(&probe));
+    JIKAN_CHECK(probe);
+    JIKAN_CHECK(breaker.current() == JikanCircuitState::HalfOpen);
+}
+
+JIKAN_TEST(failed_probe_reopens) {
+    JikanCircuitBreaker breaker(quick_circuit());
+    trip(breaker);
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    JIKAN_CHECK(breaker.allow());
+    breaker.record(false);
+    JIKAN_CHECK(breaker.current() == JikanCircuitState::Open);
+    JIKAN_CHECK(!breaker.allow());
+}
+
+// An engine whose circuit is open and due for a probe
+static std::shared_ptr<JikanRetryEngine> tripped_engine() {
+    JikanRetryConfig config;
+    config.server_errors = JikanRetryPolicy(1);
+    config.network_errors = JikanRetryPolicy(1);
+    config.circuit = quick_circuit();
+    auto engine = std::make_shared<JikanRetryEngine>(config);
+    for (int i = 0; i < 2; ++i) {
+        engine->run([]() { return pplx::task_from_result(http_response(500)); }).wait();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    return engine;
+}
+
+static bool closes_on_next_success(const std::shared_ptr<JikanRetryEngine>& engine) {
+    auto response = engine->run([]() { return pplx::task_from_result(http_response(200)); }).get();
+    return response.status_code() == 200 && engine->stats().circuit == JikanCircuitState::Closed;
+}
+
+JIKAN_TEST(throttled_probe_does_not_wedge_the_circuit) {
+    auto engine = tripped_engine();
+    JIKAN_CHECK(engine->stats().circuit == JikanCircuitState::Open);
+    auto response = engine->run([]() { return pplx::task_from_result(http_response(429)); }).get();
+    JIKAN_CHECK(response.status_code() == 429);
+    JIKAN_CHECK(closes_on_next_success(engine));
+}
+
+JIKAN_TEST(cancelled_probe_does_not_wedge_the_circuit) {
+    auto engine = tripped_engine();
+    bool cancelled = false;
+    try {
+        engine->run([]() { return pplx::task_from_exception<http_response>(pplx::task_canceled()); }).get();
+    } catch (const pplx::task_canceled&) {
+        cancelled = true;
+    }
+    JIKAN_CHECK(cancelled);
+    JIKAN_CHECK(closes_on_next_success(engine));
+}
+
+JIKAN_TEST(probe_that_throws_before_sending_does_not_wedge_the_circuit) {
+    auto engine = tripped_engine();
+    bool thrown = false;
+    try {
+        engine->run([]() -> pplx::task<http_response> { throw std::runtime_error("no transport"); }).get();
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    JIKAN_CHECK(thrown);
+    JIKAN_CHECK(closes_on_next_success(engine));
+}
+
+// Titles 1 to count recorded as fixtures
+static std::string write_fixtures(int count) {
+    std::string directory = "jikan-test-faults-" + std::to_string(getpid());
+    std::system(("rm -rf " + directory).c_str());
+    JikanFixtureStore store(directory);
+    for (int id = 1; id <= count; ++id) {
+        JikanFixture fixture;
+        fixture.body = "{\"data\":{\"mal_id\":" + std::to_string(id) + "}}";
+        store.save(JikanFixtureStore::key("GET", "/anime/" + std::to_string(id)), fixture);
+    }
+    return directory;
+}
+
+static JikanRetryConfig quick_retries(int attempts) {
+    JikanRetryConfig config;
+    config.server_errors = JikanRetryPolicy(attempts, std::chrono::milliseconds(1), std::chrono::milliseconds(4));
+    return config;
+}
+
+JIKAN_TEST(injected_failures_are_retried_until_attempts_run_out) {
+    std::string directory = write_fixtures(100);
+    Jikan api;
+    jikan_test_unlimited(api);
+    JikanRetryConfig config = quick_retries(4);
+    // Stays closed at this error rate, so every failure is either retried or final
+    config.circuit.failure_ratio = 0.9;
+    api.set_retry_config(config);
+    JikanFaultConfig faults;
+    faults.error_rate = 0.3;
+    faults.seed = 7;
+    auto replay = api.replay_fixtures(directory, faults);
+
+    int answered = 0;
+    for (int id = 1; id <= 100; ++id) {
+        json::value result = api.getAnimeById(id).get();
+        if (!result.has_field(U("error"))) {
+            JIKAN_CHECK(result.at(U("data")).at(U("mal_id")).as_integer() == id);
+            ++answered;
+        }
+    }
+    JikanRetryStats stats = api.retry_stats();
+    JikanReplayStats replayed = replay->stats();
+    JIKAN_CHECK(replayed.injected_errors > 0);
+    JIKAN_CHECK(stats.circuit == JikanCircuitState::Closed);
+    JIKAN_CHECK(stats.retries + stats.exhausted == replayed.injected_errors);
+    JIKAN_CHECK(replayed.served == 100 + stats.retries);
+    JIKAN_CHECK(answered == 100 - static_cast<int>(stats.exhausted));
+    // Four attempts at 30% leave hardly any call failing for good
+    JIKAN_CHECK(answered >= 95);
+    JIKAN_CHECK(api.timer_waiting() == 0);
+    std::system(("rm -rf " + directory).c_str());
+}
+
+JIKAN_TEST(backoffs_wait_on_the_shared_timer_and_leave_with_their_call) {
+    std::string directory = write_fixtures(1);
+    Jikan api;
+    jikan_test_unlimited(api);
+    JikanRetryConfig config;
+    config.server_errors = JikanRetryPolicy(2, std::chrono::hours(1), std::chrono::hours(1));
+    config.deadline = std::chrono::milliseconds(0);
+    api.set_retry_config(config);
+    JikanFaultConfig faults;
+    faults.error_rate = 1.0;
+    auto replay = api.replay_fixtures(directory, faults);
+
+    pplx::cancellation_token_source source;
+    JikanCallOptions options;
+    options.cancel = source.get_token();
+    auto call = api.with_options(options, [&api]() { return api.getAnimeById(1); });
+    for (int i = 0; i < 2000 && api.timer_waiting() == 0; ++i) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    // The call has no deadline, so its one entry on the timer is the backoff
+    JIKAN_CHECK(replay->stats().injected_errors == 1);
+    JIKAN_CHECK(api.timer_waiting() == 1);
+    source.cancel();
+    JIKAN_CHECK(call.get().at(U("error")).as_string() == U("Cancelled"));
+    JIKAN_CHECK(api.timer_waiting() == 0);
+    std::system(("rm -rf " + directory).c_str());
+}
+
+JIKAN_TEST(a_failing_upstream_opens_the_circuit) {
+    std::string directory = write_fixtures(20);
+    Jikan api;
+    jikan_test_unlimited(api);
+    JikanRetryConfig config = quick_retries(1);
+    config.circuit.window = 10;
+    config.circuit.min_requests = 5;
+    config.circuit.failure_ratio = 0.5;
+    config.circuit.open_for = std::chrono::hours(1);
+    api.set_retry_config(config);
+    JikanFaultConfig faults;
+    faults.error_rate = 1.0;
+    auto replay = api.replay_fixtures(directory, faults);
+
+    for (int id = 1; id <= 20; ++id) JIKAN_CHECK(api.getAnimeById(id).get().has_field(U("error")));
+    JikanRetryStats stats = api.retry_stats();
+    JIKAN_CHECK(stats.circuit == JikanCircuitState::Open);
+    // Five failures open it, the other fifteen calls never reach the transport
+    JIKAN_CHECK(replay->stats().injected_errors == 5);
+    JIKAN_CHECK(stats.short_circuited == 15);
+    std::system(("rm -rf " + directory).c_str());
+}
+
+JIKAN_TEST_MAIN()
@@ -0,0 +1,134 @@
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "JikanArena.h"
+#include "JikanCache.h"
+#include "JikanTest.h"
+
+static JikanCacheEntry entry_of(const std::string& body) {
+    JikanCacheEntry entry;
+    entry.body = JikanBuffer(body);
+    entry.expires = std::chrono::system_clock::now() + std::chrono::hours(1);
+    return entry;
+}
+
+JIKAN_TEST(memory_cache_stays_under_its_bound) {
+    const size_t bound = 64 * 1024;
+    JikanMemoryCache cache(bound);
+    for (int i = 0; i < 100; ++i) {
+        cache.put("/anime/" + std::to_string(i), entry_of(std::string(4096, 'x')));
+        JIKAN_CHECK(cache.size_bytes() <= bound);
+    }
+    JIKAN_CHECK(cache.evictions() > 0);
+    JikanCacheEntry found;
+    JIKAN_CHECK(cache.get("/anime/99", found));
+    JIKAN_CHECK(!cache.get("/anime/0", found));
+}
+
+JIKAN_TEST(least_recently_used_goes_first) {
+    JikanMemoryCache cache(3 * (4096 + 256 + sizeof(JikanCacheEntry)));
+    cache.put("a", entry_of(std::string(4096, 'a')));
+    cache.put("b", entry_of(std::string(4096, 'b')));
+    cache.put("c", entry_of(std::string(4096, 'c')));
+    JikanCacheEntry found;
+    JIKAN_CHECK(cache.get("a", found));
+    cache.put("d", entry_of(std::string(4096, 'd')));
+    JIKAN_CHECK(cache.get("a", found));
+    JIKAN_CHECK(!cache.get("b", found));
+}
+
+JIKAN_TEST(small_body_does_not_pin_a_large_pooled_string) {
+    // Leaves a 1 MB string in this thread's body pool, as a large earlier response would
+    std::string large = JikanArenaPool::acquire_body();
+    large.reserve(1024 * 1024);
+    JikanArenaPool::release_body(std::move(large));
+
+    std::string body = JikanArenaPool::acquire_body();
+    JIKAN_CHECK(body.capacity() >= 1024 * 1024);
+    body = "{\"data\":[]}";
+    JikanBuffer buffer = JikanArenaPool::buffer(std::move(body));
+    JIKAN_CHECK(buffer.str() == "{\"data\":[]}");
+    // The large string went back to the pool rather than into the buffer
+    std::string reused = JikanArenaPool::acquire_body();
+    JIKAN_CHECK(reused.capacity() >= 1024 * 1024);
+}
+
+// Keeps bytes only, as the disk cache does
+class BytesOnlyStore : public JikanCacheStore {
+private:
+    std::mutex mutex;
+    std::map<std::string, JikanCacheEntry> entries;
+
+public:
+    bool get(const std::string& key, JikanCacheEntry& entry) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(key);
+        if (it == entries.end()) return false;
+        entry = it->second;
+        return true;
+    }
+    void put(const std::string& key, const JikanCacheEntry& entry) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries[key] = entry;
+        entries[key].json.reset();
+    }
+    void erase(const std::string& key) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.erase(key);
+    }
+    void clear() override {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.clear();
+    }
+};
+
+class CountingFront : public JikanMemoryCache {
+public:
+    std::atomic<int> parsed{0};
+
+    void keep_parsed(const std::string& key, const JikanCacheEntry& entry) override {
+        if (entry.json) ++parsed;
+        JikanMemoryCache::keep_parsed(key, entry);
+    }
+};
+
+JIKAN_TEST(entries_from_a_bytes_only_tier_are_parsed_once) {
+    Jikan api;
+    auto upstream = jikan_test_upstream(api);
+    upstream->respond = [](const std::string&, const std::string&) { return JikanTestAnswer::json("{\"data\":{\"mal_id\":1}}"); };
+    auto front = std::make_shared<CountingFront>();
+    api.set_cache_config(JikanCacheConfig(), std::make_shared<JikanTieredCache>(front, std::make_shared<BytesOnlyStore>()));
+    JIKAN_CHECK(api.getAnimeById(1).get().at(U("data")).at(U("mal_id")).as_integer() == 1);
+    // As after a restart: only the bytes tier still has the answer
+    front->clear();
+    for (int i = 0; i < 3; ++i) JIKAN_CHECK(api.getAnimeById(1).get().at(U("data")).at(U("mal_id")).as_integer() == 1);
+    JIKAN_CHECK(front->parsed == 1);
+    JIKAN_CHECK(upstream->requests == 1);
+}
+
+JIKAN_TEST(another_backend_does_not_get_the_old_answers) {
+    Jikan api;
+    auto first = jikan_test_upstream(api);
+    first->respond = [](const std::string&, const std::string&) { return JikanTestAnswer::json("{\"from\":\"first\"}"); };
+    JIKAN_CHECK(api.getAnimeById(1).get().at(U("from")).as_string() == U("first"));
+    auto second = jikan_test_upstream(api);
+    second->respond = [](const std::string&, const std::string&) { return JikanTestAnswer::json("{\"from\":\"second\"}"); };
+    JIKAN_CHECK(api.getAnimeById(1).get().at(U("from")).as_string() == U("second"));
+    JIKAN_CHECK(second->requests == 1);
+    // Back on the first one its answer is still cached
+    api.set_transport(first);
+    JIKAN_CHECK(api.getAnimeById(1).get().at(U("from")).as_string() == U("first"));
+    JIKAN_CHECK(first->requests == 1);
+}
+
+JIKAN_TEST(keys_name_the_server) {
+    JIKAN_CHECK(JikanResponseCache::key("https://api.jikan.moe/v4", "GET", "/anime?q=a&page=2") ==
+                "https://api.jikan.moe/v4 GET /anime?page=2&q=a");
+    JIKAN_CHECK(JikanResponseCache::key("http://127.0.0.1:8080/v4", "GET", "/anime/1") !=
+                JikanResponseCache::key("https://api.jikan.moe/v4", "GET", "/anime/1"));
+    JikanClientPool pool(U("http://127.0.0.1:8080/v4"), web::http::client::http_client_config());
+    JIKAN_CHECK(pool.backend() == "http://127.0.0.1:8080/v4");
+}
+
+JIKAN_TEST_MAIN()
@@ -0,0 +1,99 @@
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Jikan.h"
+#include "JikanTest.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static std::string error_of(const web::json::value& result) {
+    if (!result.has_string_field(U("error"))) return std::string();
+    return utility::conversions::to_utf8string(result.at(U("error")).as_string());
+}
+
+// Never answers; fails with task_canceled once the request's token is cancelled
+static void hang(Jikan& api) {
+    jikan_test_upstream(api)->respond = [](const std::string&, const std::string&) { return JikanTestAnswer::hanging(); };
+}
+
+JIKAN_TEST(cancelled_wait_leaves_the_timer_at_once) {
+    JikanTimer timer;
+    pplx::cancellation_token_source source;
+    auto wait = timer.after(std::chrono::hours(1), source.get_token());
+    JIKAN_CHECK(timer.waiting() == 1);
+    source.cancel();
+    bool cancelled = false;
+    try {
+        wait.get();
+    } catch (const pplx::task_canceled&) {
+        cancelled = true;
+    }
+    JIKAN_CHECK(cancelled);
+    JIKAN_CHECK(timer.waiting() == 0);
+}
+
+JIKAN_TEST(timer_fires_and_forgets_the_wait) {
+    JikanTimer timer;
+    pplx::cancellation_token_source source;
+    timer.after(std::chrono::milliseconds(5), source.get_token()).get();
+    JIKAN_CHECK(timer.waiting() == 0);
+    // Cancelling after the wait is over touches nothing
+    source.cancel();
+    JIKAN_CHECK(timer.waiting() == 0);
+}
+
+JIKAN_TEST(deadline_ends_a_hanging_call) {
+    Jikan api;
+    hang(api);
+    auto started = Clock::now();
+    auto result = api.with_options(JikanCallOptions::within(std::chrono::milliseconds(50)), [&api]() {
+        return api.getAnimeById(1);
+    }).get();
+    JIKAN_CHECK(error_of(result).find("Deadline exceeded") != std::string::npos);
+    JIKAN_CHECK(Clock::now() - started < std::chrono::seconds(2));
+}
+
+JIKAN_TEST(cancelling_the_token_ends_a_call_with_a_deadline) {
+    Jikan api;
+    hang(api);
+    pplx::cancellation_token_source source;
+    auto call = api.with_options(JikanCallOptions::within(std::chrono::hours(1), source.get_token()), [&api]() {
+        return api.getAnimeById(2);
+    });
+    source.cancel();
+    JIKAN_CHECK(error_of(call.get()) == "Cancelled");
+}
+
+JIKAN_TEST(cancelling_ten_thousand_queued_calls_empties_the_queue_and_the_timer) {
+    Jikan api;
+    jikan_test_upstream(api);
+    // Nothing is dispatched while the test runs, every call stays in the rate limiter's queue
+    JikanRateLimit trickle;
+    trickle.per_second = 0.001;
+    trickle.per_minute = 0.06;
+    api.set_rate_limit(trickle);
+    pplx::cancellation_token_source source;
+    std::vector<pplx::task<web::json::value>> calls;
+    auto options = JikanCallOptions::within(std::chrono::hours(1), source.get_token());
+    for (int id = 1; id <= 10000; ++id) {
+        calls.push_back(api.with_options(options, [&api, id]() { return api.getAnimeById(id); }));
+    }
+    auto until = Clock::now() + std::chrono::seconds(10);
+    while (api.scheduler_stats().queue_depth < 10000 && Clock::now() < until) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    JIKAN_CHECK(api.scheduler_stats().queue_depth == 10000);
+    JIKAN_CHECK(api.timer_waiting() == 10000);
+
+    source.cancel();
+    JIKAN_CHECK(api.scheduler_stats().queue_depth == 0);
+    JIKAN_CHECK(api.timer_waiting() == 0);
+    JIKAN_CHECK(api.scheduler_stats().cancelled == 10000);
+    size_t cancelled = 0;
+    for (auto& call : calls) {
+        if (error_of(call.get()) == "Cancelled") ++cancelled;
+    }
+    JIKAN_CHECK(cancelled == calls.size());
+}
+
+JIKAN_TEST_MAIN()
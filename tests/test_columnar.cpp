@@ -0,0 +1,232 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "JikanColumnar.h"
+#include "JikanTest.h"
+
+static const char* types[] = {"TV", "Movie", "OVA", "ONA"};
+static const char* genres[] = {"Action", "Drama", "Comedy", "Romance", "Sci-Fi"};
+
+struct Row {
+    float score;
+    int members;
+    std::string type;
+    std::vector<std::string> genres;
+};
+
+// Rows kept beside the table so every query can be checked against a plain scan
+struct Fixture {
+    JikanColumnTable table;
+    std::vector<Row> rows;
+
+    Fixture() {
+        table.add_column("score", JikanColumnType::Float);
+        table.add_column("members", JikanColumnType::Int);
+        table.add_column("type", JikanColumnType::Dict);
+        table.add_column("genres", JikanColumnType::MultiDict);
+        table.add_column("title", JikanColumnType::Text);
+        std::srand(7);
+        for (int i = 0; i < 2000; ++i) {
+            Row row;
+            // Scores on the 0.01 grid MAL uses, so bounds often hit stored values exactly
+            row.score = static_cast<float>((std::rand() % 1000) / 100.0);
+            row.members = std::rand() % 100000;
+            row.type = i % 17 == 0 ? std::string() : types[std::rand() % 4];
+            for (int g = 0; g < 5; ++g) {
+                if (std::rand() % 3 == 0) row.genres.push_back(genres[g]);
+            }
+            add(row, "title " + std::to_string(i));
+        }
+    }
+
+    void add(const Row& row, const std::string& title) {
+        table.append_row();
+        table.set_float(table.column("score"), row.score);
+        table.set_int(table.column("members"), row.members);
+        table.set_value(table.column("type"), row.type);
+        for (const auto& genre : row.genres) table.add_value(table.column("genres"), genre);
+        table.set_text(table.column("title"), title);
+        rows.push_back(row);
+    }
+};
+
+static bool contains(const std::vector<std::string>& values, const std::string& value) {
+    for (const auto& item : values) {
+        if (item == value) return true;
+    }
+    return false;
+}
+
+JIKAN_TEST(select_matches_a_plain_scan) {
+    Fixture fixture;
+    for (int round = 0; round < 200; ++round) {
+        double low = (std::rand() % 1000) / 100.0;
+        double high = low + (std::rand() % 300) / 100.0;
+        int members = std::rand() % 100000;
+        std::string genre = genres[std::rand() % 5];
+        std::vector<std::string> accepted = {types[std::rand() % 4], types[std::rand() % 4]};
+
+        JikanColumnQuery query;
+        query.between("score", low, high).at_least("members", members).any_of("type", accepted);
+        // Half the queries go through the posting lists, the others through the column scans
+        if (round % 2) query.has("genres", genre);
+
+        std::vector<uint32_t> expected;
+        for (uint32_t row = 0; row < fixture.rows.size(); ++row) {
+            const Row& r = fixture.rows[row];
+            bool match = r.score >= static_cast<float>(low) && r.score <= static_cast<float>(high) && r.members >= members &&
+                         contains(accepted, r.type) && (round % 2 == 0 || contains(r.genres, genre));
+            if (match) expected.push_back(row);
+        }
+        JIKAN_CHECK(fixture.table.select(query) == expected);
+    }
+}
+
+JIKAN_TEST(float_bounds_keep_the_stored_value) {
+    Fixture fixture;
+    Row row;
+    row.score = static_cast<float>(7.1);
+    row.members = 1;
+    row.type = "TV";
+    fixture.add(row, "exact");
+    row.score = static_cast<float>(8.3);
+    fixture.add(row, "exact");
+    uint32_t low_row = static_cast<uint32_t>(fixture.rows.size() - 2);
+    uint32_t high_row = low_row + 1;
+
+    auto selected = [&fixture](const JikanColumnQuery& query, uint32_t row) {
+        std::vector<uint32_t> rows = fixture.table.select(query);
+        return std::find(rows.begin(), rows.end(), row) != rows.end();
+    };
+    JIKAN_CHECK(selected(JikanColumnQuery().at_least("score", 7.1), low_row));
+    JIKAN_CHECK(selected(JikanColumnQuery().at_most("score", 8.3), high_row));
+    JIKAN_CHECK(selected(JikanColumnQuery().between("score", 7.1, 8.3), low_row));
+    JIKAN_CHECK(selected(JikanColumnQuery().between("score", 7.1, 8.3), high_row));
+    JIKAN_CHECK(!selected(JikanColumnQuery().above("score", 7.1), low_row));
+    JIKAN_CHECK(selected(JikanColumnQuery().above("score", 7.0), low_row));
+    // Same through the posting-list path
+    JIKAN_CHECK(selected(JikanColumnQuery().equals("type", "TV").at_least("score", 7.1), low_row));
+    JIKAN_CHECK(!selected(JikanColumnQuery().equals("type", "TV").above("score", 7.1), low_row));
+}
+
+static bool rejected(const Fixture& fixture, const JikanColumnQuery& query) {
+    try {
+        fixture.table.select(query);
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+JIKAN_TEST(mismatched_predicates_throw_on_both_paths) {
+    Fixture fixture;
+    JIKAN_CHECK(rejected(fixture, JikanColumnQuery().any_of("genres", {"Action"})));
+    JIKAN_CHECK(rejected(fixture, JikanColumnQuery().has("genres", "Action").any_of("genres", {"Action"})));
+    JIKAN_CHECK(rejected(fixture, JikanColumnQuery().between("type", 0, 1)));
+    JIKAN_CHECK(rejected(fixture, JikanColumnQuery().has("genres", "Action").between("type", 0, 1)));
+    JIKAN_CHECK(rejected(fixture, JikanColumnQuery().has("genres", "Action").between("title", 0, 1)));
+    JIKAN_CHECK(rejected(fixture, JikanColumnQuery().equals("title", "title 1")));
+    JIKAN_CHECK(rejected(fixture, JikanColumnQuery().any_of("score", {"7"})));
+    JIKAN_CHECK(rejected(fixture, JikanColumnQuery().order_by("type")));
+    JIKAN_CHECK(!rejected(fixture, JikanColumnQuery().equals("genres", "Action").order_by("score")));
+}
+
+JIKAN_TEST(a_saved_snapshot_loads_back) {
+    Fixture fixture;
+    std::string path = "jikan-test-columnar-" + std::to_string(getpid());
+    fixture.table.save(path);
+    JikanColumnTable loaded = JikanColumnTable::load(path);
+    std::remove(path.c_str());
+    JikanColumnQuery query = JikanColumnQuery().equals("type", "TV").has("genres", "Drama").at_least("score", 5.0);
+    JIKAN_CHECK(loaded.size() == fixture.table.size());
+    JIKAN_CHECK(loaded.select(query) == fixture.table.select(query));
+    JIKAN_CHECK(loaded.get_text(loaded.column("title"), 1999) == "title 1999");
+}
+
+// Snapshot written field by field, so each test can break one thing in it
+struct Snapshot {
+    std::string bytes;
+
+    template <typename T>
+    Snapshot& pod(T value) {
+        bytes.append(reinterpret_cast<const char*>(&value), sizeof(T));
+        return *this;
+    }
+
+    Snapshot& text(const std::string& value) {
+        pod<uint32_t>(static_cast<uint32_t>(value.size()));
+        bytes += value;
+        return *this;
+    }
+
+    template <typename T>
+    Snapshot& vector(const std::vector<T>& values, uint64_t size) {
+        pod<uint64_t>(size);
+        for (T value : values) pod<T>(value);
+        return *this;
+    }
+
+    template <typename T>
+    Snapshot& vector(const std::vector<T>& values) {
+        return vector(values, values.size());
+    }
+
+    // Header and an empty string arena
+    static Snapshot table(uint32_t rows) {
+        Snapshot result;
+        result.pod<uint32_t>(0x54434B4A).pod<uint32_t>(1).pod<uint32_t>(rows).pod<uint32_t>(1);
+        result.text("").vector(std::vector<uint32_t>{0});
+        return result;
+    }
+
+    // One dictionary column, "type", with the values A and B
+    Snapshot& column(JikanColumnType type, const std::vector<uint16_t>& codes, const std::vector<uint32_t>& offsets, uint64_t code_count) {
+        text("type").pod<uint8_t>(static_cast<uint8_t>(type));
+        vector(std::vector<int32_t>()).vector(std::vector<float>()).vector(codes, code_count).vector(offsets).vector(std::vector<uint32_t>());
+        pod<uint32_t>(2).text("A").text("B");
+        return *this;
+    }
+
+    bool loads() const {
+        std::string path = "jikan-test-snapshot-" + std::to_string(getpid());
+        std::FILE* file = std::fopen(path.c_str(), "wb");
+        std::fwrite(bytes.data(), 1, bytes.size(), file);
+        std::fclose(file);
+        bool result = true;
+        try {
+            JikanColumnTable::load(path);
+        } catch (const std::runtime_error&) {
+            result = false;
+        }
+        std::remove(path.c_str());
+        return result;
+    }
+};
+
+JIKAN_TEST(corrupt_snapshots_are_rejected_before_use) {
+    const uint16_t none = 0xFFFF;
+    JIKAN_CHECK(Snapshot::table(3).column(JikanColumnType::Dict, {0, 1, none}, {}, 3).loads());
+    // A code past the dictionary would index a missing posting list
+    JIKAN_CHECK(!Snapshot::table(3).column(JikanColumnType::Dict, {0, 7, none}, {}, 3).loads());
+    // Fewer codes than rows
+    JIKAN_CHECK(!Snapshot::table(3).column(JikanColumnType::Dict, {0, 1}, {}, 2).loads());
+    // A length far beyond the file must not be allocated
+    JIKAN_CHECK(!Snapshot::table(3).column(JikanColumnType::Dict, {0, 1, none}, {}, uint64_t(1) << 40).loads());
+
+    JIKAN_CHECK(Snapshot::table(2).column(JikanColumnType::MultiDict, {0, 1, 1}, {0, 2, 3}, 3).loads());
+    // Offsets running past the codes, going backwards, or not one per row plus one
+    JIKAN_CHECK(!Snapshot::table(2).column(JikanColumnType::MultiDict, {0, 1, 1}, {0, 2, 9}, 3).loads());
+    JIKAN_CHECK(!Snapshot::table(2).column(JikanColumnType::MultiDict, {0, 1, 1}, {0, 3, 2}, 3).loads());
+    JIKAN_CHECK(!Snapshot::table(2).column(JikanColumnType::MultiDict, {0, 1, 1}, {0, 3}, 3).loads());
+    JIKAN_CHECK(!Snapshot::table(2).column(JikanColumnType::MultiDict, {0, 1, none}, {0, 2, 3}, 3).loads());
+    JIKAN_CHECK(!Snapshot::table(2).column(static_cast<JikanColumnType>(9), {0, 1}, {}, 2).loads());
+}
+
+JIKAN_TEST_MAIN()
@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <cstdlib>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "JikanCrawler.h"
+#include "JikanTest.h"
+
+// A small recorded graph: anime 1 has a sequel (anime 2) and an adaptation (manga 3); its one
+// character comes with a voice actor; anime 2 points back at anime 1
+static std::string write_fixtures() {
+    std::string directory = "jikan-test-crawl-" + std::to_string(getpid());
+    std::system(("rm -rf " + directory).c_str());
+    JikanFixtureStore store(directory);
+    auto save = [&store](const std::string& path, const std::string& body) {
+        JikanFixture fixture;
+        fixture.body = body;
+        store.save(JikanFixtureStore::key("GET", path), fixture);
+    };
+    save("/anime/1/relations",
+         "{\"data\":[{\"relation\":\"Sequel\",\"entry\":[{\"mal_id\":2,\"type\":\"anime\",\"name\":\"Two\"}]},"
+         "{\"relation\":\"Adaptation\",\"entry\":[{\"mal_id\":3,\"type\":\"manga\",\"name\":\"Three\"}]}]}");
+    save("/anime/2/relations", "{\"data\":[{\"relation\":\"Prequel\",\"entry\":[{\"mal_id\":1,\"type\":\"anime\",\"name\":\"One\"}]}]}");
+    save("/manga/3/relations", "{\"data\":[]}");
+    save("/anime/1/characters",
+         "{\"data\":[{\"character\":{\"mal_id\":10,\"name\":\"Hero\"},\"role\":\"Main\","
+         "\"voice_actors\":[{\"person\":{\"mal_id\":20,\"name\":\"Actor\"},\"language\":\"Japanese\"}]}]}");
+    save("/anime/2/characters", "{\"data\":[]}");
+    save("/manga/3/characters", "{\"data\":[]}");
+    return directory;
+}
+
+struct Graph {
+    std::mutex mutex;
+    std::set<std::string> nodes;
+    std::vector<std::string> edges;
+
+    static std::string name(JikanNodeKind kind, int id) {
+        static const char* kinds[] = {"anime", "manga", "character", "person"};
+        return std::string(kinds[static_cast<int>(kind)]) + "/" + std::to_string(id);
+    }
+
+    JikanCrawlSink sink() {
+        JikanCrawlSink result;
+        result.on_node = [this](const JikanNode& node) {
+            std::lock_guard<std::mutex> lock(mutex);
+            nodes.insert(name(node.kind, node.mal_id));
+        };
+        result.on_edge = [this](const JikanEdge& edge) {
+            std::lock_guard<std::mutex> lock(mutex);
+            edges.push_back(name(edge.from_kind, edge.from) + " " + edge.label + " " + name(edge.to_kind, edge.to));
+        };
+        return result;
+    }
+
+    bool has_edge(const std::string& edge) {
+        return std::find(edges.begin(), edges.end(), edge) != edges.end();
+    }
+};
+
+JIKAN_TEST(relations_are_followed_once_per_node) {
+    std::string directory = write_fixtures();
+    Jikan api;
+    jikan_test_unlimited(api);
+    api.replay_fixtures(directory);
+    JikanCrawlConfig config;
+    config.edges = JikanEdge::Relation;
+    Graph graph;
+    auto report = JikanCrawler(api, config).crawl({{JikanNodeKind::Anime, 1}}, graph.sink()).get();
+    JIKAN_CHECK(graph.nodes == std::set<std::string>({"anime/1", "anime/2", "manga/3"}));
+    JIKAN_CHECK(graph.has_edge("anime/1 Sequel anime/2"));
+    JIKAN_CHECK(graph.has_edge("anime/1 Adaptation manga/3"));
+    JIKAN_CHECK(graph.has_edge("anime/2 Prequel anime/1"));
+    // The seed and both depth-1 nodes are expanded once each, depth 2 is the limit
+    JIKAN_CHECK(report.requests == 3);
+    JIKAN_CHECK(report.failed == 0);
+    JIKAN_CHECK(report.nodes == 3);
+    std::system(("rm -rf " + directory).c_str());
+}
+
+JIKAN_TEST(embedded_voice_actors_save_the_character_request) {
+    std::string directory = write_fixtures();
+    Jikan api;
+    jikan_test_unlimited(api);
+    api.replay_fixtures(directory);
+    JikanCrawlConfig config;
+    config.edges = JikanEdge::Character | JikanEdge::VoiceActor;
+    config.max_depth = 3;
+    Graph graph;
+    auto report = JikanCrawler(api, config).crawl({{JikanNodeKind::Anime, 1}}, graph.sink()).get();
+    JIKAN_CHECK(graph.has_edge("anime/1 Main character/10"));
+    JIKAN_CHECK(graph.has_edge("character/10 Japanese person/20"));
+    // /anime/1/characters only: no /characters/10/voices, people are not expanded without Work edges
+    JIKAN_CHECK(report.requests == 1);
+    JIKAN_CHECK(report.failed == 0);
+    std::system(("rm -rf " + directory).c_str());
+}
+
+JIKAN_TEST(a_spent_budget_prunes_the_rest) {
+    std::string directory = write_fixtures();
+    Jikan api;
+    jikan_test_unlimited(api);
+    api.replay_fixtures(directory);
+    JikanCrawlConfig config;
+    config.edges = JikanEdge::Relation | JikanEdge::Character;
+    config.max_requests = 2;
+    config.max_in_flight = 1;
+    Graph graph;
+    auto report = JikanCrawler(api, config).crawl({{JikanNodeKind::Anime, 1}}, graph.sink()).get();
+    JIKAN_CHECK(report.requests == 2);
+    JIKAN_CHECK(report.pruned > 0);
+    std::system(("rm -rf " + directory).c_str());
+}
+
+JIKAN_TEST(requests_from_completions_keep_the_callers_cancellation) {
+    Jikan api;
+    pplx::cancellation_token_source source;
+    auto upstream = jikan_test_upstream(api);
+    // The caller gives up while the seed's answer is on its way back
+    upstream->respond = [&source](const std::string& path, const std::string&) {
+        if (path.find("/anime/1/relations") != std::string::npos) {
+            source.cancel();
+            return JikanTestAnswer::json("{\"data\":[{\"relation\":\"Sequel\",\"entry\":[{\"mal_id\":2,\"type\":\"anime\",\"name\":\"Two\"}]}]}");
+        }
+        return JikanTestAnswer::json("{\"data\":[]}");
+    };
+    JikanCrawlConfig config;
+    config.edges = JikanEdge::Relation;
+    Graph graph;
+    auto report = api.with_options(JikanCallOptions::within(std::chrono::hours(1), source.get_token()), [&api, &config, &graph]() {
+        return JikanCrawler(api, config).crawl({{JikanNodeKind::Anime, 1}}, graph.sink());
+    }).get();
+    // anime/2 was found, but its expansion started from a pool thread under the cancelled token
+    JIKAN_CHECK(graph.nodes.count("anime/2") == 1);
+    JIKAN_CHECK(report.requests == 2);
+    JIKAN_CHECK(report.failed >= 1);
+    JIKAN_CHECK(upstream->requests == 1);
+}
+
+JIKAN_TEST_MAIN()
@@ -0,0 +1,134 @@
+#include <cstdlib>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "JikanDiskCache.h"
+#include "JikanTest.h"
+
+static JikanCacheEntry entry_of(const std::string& body) {
+    JikanCacheEntry entry;
+    entry.body = JikanBuffer(body);
+    entry.etag = U("\"etag\"");
+    entry.expires = std::chrono::system_clock::now() + std::chrono::hours(1);
+    return entry;
+}
+
+static JikanDiskCacheConfig config_in(const std::string& name) {
+    JikanDiskCacheConfig config;
+    config.directory = "jikan-test-disk-" + name + "-" + std::to_string(getpid());
+    std::system(("rm -rf " + config.directory).c_str());
+    return config;
+}
+
+static std::string first_segment(const JikanDiskCacheConfig& config) {
+    return config.directory + "/segment-00000001.jkc";
+}
+
+static off_t file_size(const std::string& path) {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 ? info.st_size : -1;
+}
+
+static std::string body_of(JikanDiskCache& cache, const std::string& key) {
+    JikanCacheEntry found;
+    return cache.get(key, found) ? found.body.str() : std::string("<missing>");
+}
+
+JIKAN_TEST(warm_restart_serves_every_entry) {
+    auto config = config_in("warm");
+    {
+        JikanDiskCache cache(config);
+        for (int i = 0; i < 500; ++i) cache.put("/anime/" + std::to_string(i), entry_of("body " + std::to_string(i)));
+        // A later write of a key replaces the earlier one after the restart too
+        cache.put("/anime/7", entry_of("seven again"));
+        cache.erase("/anime/8");
+    }
+    JikanDiskCache cache(config);
+    JIKAN_CHECK(cache.stats().entries == 499);
+    JIKAN_CHECK(body_of(cache, "/anime/0") == "body 0");
+    JIKAN_CHECK(body_of(cache, "/anime/499") == "body 499");
+    JIKAN_CHECK(body_of(cache, "/anime/7") == "seven again");
+    JIKAN_CHECK(body_of(cache, "/anime/8") == "<missing>");
+    JikanCacheEntry found;
+    JIKAN_CHECK(cache.get("/anime/1", found) && found.etag == U("\"etag\""));
+    std::system(("rm -rf " + config.directory).c_str());
+}
+
+JIKAN_TEST(rebuild_cuts_a_truncated_record_off) {
+    auto config = config_in("truncated");
+    {
+        JikanDiskCache cache(config);
+        cache.put("a", entry_of(std::string(1000, 'a')));
+        cache.put("b", entry_of(std::string(1000, 'b')));
+    }
+    // A crash in the middle of writing b's body
+    off_t full = file_size(first_segment(config));
+    JIKAN_CHECK(truncate(first_segment(config).c_str(), full - 300) == 0);
+    {
+        JikanDiskCache cache(config);
+        JIKAN_CHECK(cache.stats().entries == 1);
+        JIKAN_CHECK(body_of(cache, "a") == std::string(1000, 'a'));
+        JIKAN_CHECK(body_of(cache, "b") == "<missing>");
+        // The torn tail is gone, so a new record is not appended behind it
+        JIKAN_CHECK(file_size(first_segment(config)) < full - 300);
+        cache.put("c", entry_of("c"));
+    }
+    JikanDiskCache cache(config);
+    JIKAN_CHECK(cache.stats().entries == 2);
+    JIKAN_CHECK(body_of(cache, "c") == "c");
+    std::system(("rm -rf " + config.directory).c_str());
+}
+
+JIKAN_TEST(rebuild_stops_at_garbage_and_checks_bodies_on_first_read) {
+    auto config = config_in("crashed");
+    {
+        JikanDiskCache cache(config);
+        cache.put("a", entry_of(std::string(1000, 'a')));
+        cache.put("b", entry_of(std::string(1000, 'b')));
+    }
+    off_t full = file_size(first_segment(config));
+    int fd = open(first_segment(config).c_str(), O_WRONLY);
+    // Flips a byte in the middle of b's body, then leaves half a header of noise behind it
+    JIKAN_CHECK(pwrite(fd, "x", 1, full - 500) == 1);
+    JIKAN_CHECK(pwrite(fd, "noise noise noise", 17, full) == 17);
+    close(fd);
+
+    JikanDiskCache cache(config);
+    JIKAN_CHECK(file_size(first_segment(config)) == full);
+    // Headers are intact, so b is indexed until its body checksum fails on the first read
+    JIKAN_CHECK(cache.stats().entries == 2);
+    JIKAN_CHECK(body_of(cache, "a") == std::string(1000, 'a'));
+    JIKAN_CHECK(body_of(cache, "b") == "<missing>");
+    JIKAN_CHECK(cache.stats().entries == 1);
+    std::system(("rm -rf " + config.directory).c_str());
+}
+
+JIKAN_TEST(puts_compact_sealed_segments_a_step_at_a_time) {
+    auto config = config_in("compact");
+    config.segment_bytes = 64 * 1024;
+    config.compact_step_bytes = 8 * 1024;
+    JikanDiskCache cache(config);
+    // 40 keys rewritten over and over leave every sealed segment mostly dead
+    for (int round = 0; round < 50; ++round) {
+        for (int i = 0; i < 40; ++i) cache.put("/anime/" + std::to_string(i), entry_of(std::to_string(round) + std::string(500, 'x')));
+    }
+    JikanDiskCacheStats stats = cache.stats();
+    JIKAN_CHECK(stats.compactions > 0);
+    JIKAN_CHECK(stats.entries == 40);
+    // 50 rounds wrote over 1 MB; without compaction it would all still be on disk
+    JIKAN_CHECK(stats.disk_bytes < 4 * config.segment_bytes);
+    bool all_latest = true;
+    for (int i = 0; i < 40; ++i) all_latest = all_latest && body_of(cache, "/anime/" + std::to_string(i)) == "49" + std::string(500, 'x');
+    JIKAN_CHECK(all_latest);
+
+    cache.compact();
+    JikanDiskCache reopened(config);
+    JIKAN_CHECK(reopened.stats().entries == 40);
+    JIKAN_CHECK(body_of(reopened, "/anime/39") == "49" + std::string(500, 'x'));
+    std::system(("rm -rf " + config.directory).c_str());
+}
+
+JIKAN_TEST_MAIN()
@@ -0,0 +1,105 @@
+#include <cmath>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+#include "JikanDocument.h"
+#include "JikanTest.h"
+
+// Counts heap allocations so the pooled parse path can be held to its budget
+static size_t allocations = 0;
+void* operator new(size_t size) {
+    ++allocations;
+    void* memory = std::malloc(size ? size : 1);
+    if (!memory) throw std::bad_alloc();
+    return memory;
+}
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+void operator delete(void* memory, size_t) noexcept {
+    std::free(memory);
+}
+
+static const std::string anime =
+    "{\"data\":{\"mal_id\":5114,\"title\":\"Fullmetal \\\"Alchemist\\\" \\u00e9\",\"score\":9.1,\"airing\":false,"
+    "\"aired\":null,\"genres\":[{\"mal_id\":1,\"name\":\"Action\"},{\"mal_id\":2,\"name\":\"Adventure\"}],"
+    "\"empty\":[],\"nothing\":{}}}";
+
+JIKAN_TEST(reads_every_kind_of_value) {
+    auto document = JikanDocument::parse(JikanBuffer(anime));
+    auto data = document["data"];
+    JIKAN_CHECK(data["mal_id"].as_integer() == 5114);
+    JIKAN_CHECK(data["title"].as_string() == "Fullmetal \"Alchemist\" \xc3\xa9");
+    JIKAN_CHECK(data["score"].as_double() > 9.09 && data["score"].as_double() < 9.11);
+    JIKAN_CHECK(data["airing"].is_bool() && !data["airing"].as_bool(true));
+    JIKAN_CHECK(data["aired"].is_null());
+    JIKAN_CHECK(data["genres"].size() == 2);
+    JIKAN_CHECK(data["genres"][1]["name"].as_string() == "Adventure");
+    JIKAN_CHECK(data["empty"].is_array() && data["empty"].size() == 0);
+    JIKAN_CHECK(data["nothing"].is_object() && data["nothing"].size() == 0);
+    JIKAN_CHECK(data["missing"]["deeper"].is_null());
+    JIKAN_CHECK(data[size_t(0)].key() == "mal_id");
+}
+
+JIKAN_TEST(rejects_truncated_input) {
+    bool thrown = false;
+    try {
+        JikanDocument::parse(JikanBuffer(std::string("{\"a\":[1,2")));
+    } catch (const std::exception&) {
+        thrown = true;
+    }
+    JIKAN_CHECK(thrown);
+}
+
+JIKAN_TEST(numbers_are_correctly_rounded) {
+    auto parsed = JikanDocument::parse(JikanBuffer(std::string(
+        "[0.1,9.87,0.3e1,-2.5E-3,1.7976931348623157e308,2.2250738585072014e-308,123456789012345678901234567890,1e999999999,1e-999999999]")));
+    auto document = parsed.root();
+    JIKAN_CHECK(document[size_t(0)].as_double() == 0.1);
+    JIKAN_CHECK(document[size_t(1)].as_double() == 9.87);
+    JIKAN_CHECK(document[size_t(2)].as_double() == 3.0);
+    JIKAN_CHECK(document[size_t(3)].as_double() == -2.5e-3);
+    JIKAN_CHECK(document[size_t(4)].as_double() == 1.7976931348623157e308);
+    JIKAN_CHECK(document[size_t(5)].as_double() == 2.2250738585072014e-308);
+    JIKAN_CHECK(document[size_t(6)].as_double() == 123456789012345678901234567890.0);
+    // Out of range exponents end at once instead of looping once per unit
+    JIKAN_CHECK(std::isinf(document[size_t(7)].as_double()));
+    JIKAN_CHECK(document[size_t(8)].as_double() == 0.0);
+}
+
+JIKAN_TEST(warm_pool_parses_without_per_node_allocations) {
+    JikanBuffer body(anime);
+    // Warms the thread's arena pool and scratch stack
+    JikanDocument::parse(body);
+    size_t before = allocations;
+    const int documents = 1000;
+    for (int i = 0; i < documents; ++i) {
+        auto document = JikanDocument::parse(body);
+        JIKAN_CHECK(document["data"]["mal_id"].as_integer() == 5114);
+    }
+    // The shared_ptr control block of the pooled arena is the only allocation left
+    double per_document = static_cast<double>(allocations - before) / documents;
+    std::printf("allocations per document: %.2f\n", per_document);
+    JIKAN_CHECK(per_document <= 1.0);
+}
+
+JIKAN_TEST(documents_in_one_arena_live_together) {
+    JikanBuffer body(anime);
+    auto arena = JikanArenaPool::acquire();
+    auto first = JikanDocument::parse(body, arena);
+    auto second = JikanDocument::parse(body, arena);
+    JIKAN_CHECK(first.memory() == second.memory());
+    JIKAN_CHECK(first["data"]["title"].as_string() == second["data"]["title"].as_string());
+}
+
+JIKAN_TEST(released_bodies_keep_their_capacity_in_the_pool) {
+    std::string body = JikanArenaPool::acquire_body();
+    body.assign(4096, 'x');
+    { JikanBuffer pooled = JikanArenaPool::buffer(std::move(body)); }
+    std::string again = JikanArenaPool::acquire_body();
+    JIKAN_CHECK(again.empty());
+    JIKAN_CHECK(again.capacity() >= 4096);
+}
+
+JIKAN_TEST_MAIN()
@@ -0,0 +1,116 @@
+#include <cstdio>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <unistd.h>
+
+#include "JikanExport.h"
+#include "JikanTest.h"
+
+enum { friend_pages = 6, friends_per_page = 3 };
+
+// /users/{name}/friends with friend_pages pages of friends_per_page friends each
+static JikanTestAnswer friends(const std::string&, const std::string& query) {
+    int page = 1;
+    std::sscanf(query.c_str(), "page=%d", &page);
+    std::string body = "{\"data\":[";
+    for (int i = 0; i < friends_per_page; ++i) {
+        if (i > 0) body += ",";
+        body += "{\"user\":{\"username\":\"f" + std::to_string(page * 100 + i) + "\"}}";
+    }
+    body += "],\"pagination\":{\"last_visible_page\":" + std::to_string(friend_pages) + ",\"has_next_page\":" +
+            (page < friend_pages ? "true" : "false") + "}}";
+    return JikanTestAnswer::json(body);
+}
+
+// Collects the (page, friend) pairs of every line written, and fails once it has taken fail_after writes
+class RowSink : public JikanSink {
+public:
+    std::mutex mutex;
+    std::set<std::pair<int, std::string>> rows;
+    int writes = 0;
+    int fail_after;
+
+    explicit RowSink(int fail_after = -1) : fail_after(fail_after) {}
+
+    void write(const char* data, size_t size) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (fail_after >= 0 && writes >= fail_after) throw std::runtime_error("disk full");
+        ++writes;
+        std::string chunk(data, size);
+        size_t start = 0;
+        for (size_t end; (end = chunk.find('\n', start)) != std::string::npos; start = end + 1) {
+            auto line = web::json::value::parse(utility::conversions::to_string_t(chunk.substr(start, end - start)));
+            rows.insert(std::make_pair(line.at(U("page")).as_integer(),
+                                       utility::conversions::to_utf8string(line.at(U("item")).at(U("user")).at(U("username")).as_string())));
+        }
+    }
+};
+
+static void fast(Jikan& api) {
+    jikan_test_upstream(api)->respond = friends;
+}
+
+JIKAN_TEST(resumed_export_loses_no_page) {
+    std::string path = "jikan-test-export-" + std::to_string(getpid()) + ".checkpoint";
+    std::remove(path.c_str());
+    Jikan api;
+    fast(api);
+    JikanExportConfig config;
+    config.lists = {JikanUserList::Friends};
+    config.checkpoint_path = path;
+    config.checkpoint_every = 1;
+    config.buffer_bytes = 1;
+    config.max_in_flight = 2;
+
+    auto failing = std::make_shared<RowSink>(2);
+    bool failed = false;
+    JikanUserExporter exporter(api, config);
+    try {
+        exporter.run({"alice"}, failing).get();
+    } catch (const std::runtime_error&) {
+        failed = true;
+    }
+    JIKAN_CHECK(failed);
+
+    auto resumed = std::make_shared<RowSink>();
+    JikanUserExporter again(api, config);
+    JikanExportReport report = again.run({"alice"}, resumed).get();
+    JIKAN_CHECK(report.failed_pages == 0);
+
+    std::set<std::pair<int, std::string>> all = failing->rows;
+    all.insert(resumed->rows.begin(), resumed->rows.end());
+    JIKAN_CHECK(all.size() == friend_pages * friends_per_page);
+    // Only pages that reached the sink may be skipped
+    JIKAN_CHECK(report.skipped_pages <= static_cast<uint64_t>(failing->writes));
+    std::remove(path.c_str());
+}
+
+JIKAN_TEST(finished_export_resumes_to_nothing) {
+    std::string path = "jikan-test-export-done-" + std::to_string(getpid()) + ".checkpoint";
+    std::remove(path.c_str());
+    Jikan api;
+    fast(api);
+    JikanExportConfig config;
+    config.lists = {JikanUserList::Friends};
+    config.checkpoint_path = path;
+
+    auto first = std::make_shared<RowSink>();
+    JikanUserExporter exporter(api, config);
+    JikanExportReport report = exporter.run({"bob"}, first).get();
+    JIKAN_CHECK(report.pages == friend_pages);
+    JIKAN_CHECK(first->rows.size() == friend_pages * friends_per_page);
+
+    auto second = std::make_shared<RowSink>();
+    JikanUserExporter again(api, config);
+    report = again.run({"bob"}, second).get();
+    JIKAN_CHECK(report.pages == 0);
+    JIKAN_CHECK(report.skipped_pages == friend_pages);
+    JIKAN_CHECK(second->rows.empty());
+    std::remove(path.c_str());
+}
+
+JIKAN_TEST_MAIN()
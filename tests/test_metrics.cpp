@@ -0,0 +1,95 @@
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Jikan.h"
+#include "JikanTest.h"
+
+static void fast(Jikan& api) {
+    jikan_test_upstream(api)->respond = [](const std::string&, const std::string&) {
+        return JikanTestAnswer::json("{\"data\":{\"mal_id\":1}}");
+    };
+}
+
+static uint64_t requests(const Jikan& api) {
+    uint64_t total = 0;
+    for (const auto& endpoint : api.metrics_snapshot()) total += endpoint.requests;
+    return total;
+}
+
+JIKAN_TEST(requests_are_counted_and_reset) {
+    Jikan api;
+    fast(api);
+    // /random is never cached, so every call goes to the transport
+    for (int i = 0; i < 5; ++i) api.getRandomAnime().wait();
+    JIKAN_CHECK(requests(api) == 5);
+    api.reset_metrics();
+    JIKAN_CHECK(requests(api) == 0);
+    api.getRandomAnime().wait();
+    JIKAN_CHECK(requests(api) == 1);
+}
+
+// Meant for a ThreadSanitizer build as much as for the plain one: members are swapped while fetches read them
+JIKAN_TEST(settings_can_change_while_requests_run) {
+    Jikan api;
+    fast(api);
+    std::atomic<bool> stop{false};
+    std::atomic<int> failed{0};
+    std::vector<std::thread> callers;
+    for (int t = 0; t < 4; ++t) {
+        callers.emplace_back([&api, &stop, &failed]() {
+            while (!stop) {
+                if (api.getRandomAnime().get().has_field(U("error"))) ++failed;
+            }
+        });
+    }
+    for (int i = 0; i < 200; ++i) {
+        api.reset_metrics();
+        api.set_retry_config(JikanRetryConfig());
+        api.set_cache_config(JikanCacheConfig());
+        fast(api);
+        api.metrics_snapshot();
+    }
+    stop = true;
+    for (auto& caller : callers) caller.join();
+    JIKAN_CHECK(failed == 0);
+}
+
+JIKAN_TEST(queue_wait_leaves_out_retry_backoffs) {
+    Jikan api;
+    std::atomic<int> calls{0};
+    jikan_test_upstream(api)->respond = [&calls](const std::string&, const std::string&) {
+        return ++calls < 3 ? JikanTestAnswer(503) : JikanTestAnswer::json("{\"data\":{\"mal_id\":1}}");
+    };
+    JikanRetryConfig config;
+    config.server_errors = JikanRetryPolicy(3, std::chrono::milliseconds(200), std::chrono::milliseconds(400));
+    api.set_retry_config(config);
+    JIKAN_CHECK(!api.getAnimeById(1).get().has_field(U("error")));
+    JIKAN_CHECK(calls == 3);
+    auto endpoints = api.metrics_snapshot();
+    JIKAN_CHECK(endpoints.size() == 1);
+    // Nothing else is queued, so the three waits for the rate limiter add up to almost nothing
+    JIKAN_CHECK(endpoints[0].queue_wait.count == 1);
+    JIKAN_CHECK(endpoints[0].queue_wait.max < 50000);
+}
+
+JIKAN_TEST(prometheus_labels_are_escaped) {
+    JikanMetrics metrics;
+    JikanRequestTrace trace;
+    trace.endpoint = "/users/a\"b\\c\nd";
+    trace.started = JikanRequestTrace::clock::now();
+    trace.dispatched = trace.started + std::chrono::milliseconds(1);
+    trace.first_byte = trace.dispatched;
+    trace.finished = trace.dispatched;
+    trace.status = 200;
+    metrics.record(trace);
+    std::string text = metrics.prometheus();
+    JIKAN_CHECK(text.find("jikan_requests_total{endpoint=\"/users/a\\\"b\\\\c\\nd\",status=\"2xx\"} 1\n") != std::string::npos);
+    JIKAN_CHECK(text.find("jikan_queue_wait_seconds_count{endpoint=\"/users/a\\\"b\\\\c\\nd\"} 1\n") != std::string::npos);
+    // Every sample stays on one line
+    JIKAN_CHECK(text.find("\nd\"") == std::string::npos);
+}
+
+JIKAN_TEST_MAIN()
@@ -0,0 +1,136 @@
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "JikanSharedQuota.h"
+#include "JikanTest.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static JikanSharedQuotaConfig quota_config(const char* name, double per_second) {
+    JikanSharedQuotaConfig config;
+    config.path = "jikan-test-" + std::string(name) + "-" + std::to_string(getpid()) + ".quota";
+    std::remove(config.path.c_str());
+    config.limit.per_second = per_second;
+    config.limit.per_minute = per_second * 60.0;
+    return config;
+}
+
+static size_t open_descriptors() {
+    size_t count = 0;
+    if (DIR* directory = opendir("/proc/self/fd")) {
+        while (readdir(directory)) ++count;
+        closedir(directory);
+    }
+    return count;
+}
+
+// Takes permits until for has passed, sleeping as acquire() asks; returns how many it got
+static uint64_t drain(JikanSharedQuota& quota, std::chrono::milliseconds for_how_long) {
+    uint64_t permits = 0;
+    auto end = Clock::now() + for_how_long;
+    while (Clock::now() < end) {
+        auto wait = quota.acquire();
+        if (wait == Clock::duration::zero()) {
+            ++permits;
+        } else {
+            std::this_thread::sleep_for(wait);
+        }
+    }
+    return permits;
+}
+
+JIKAN_TEST(failed_construction_leaves_no_mapping_or_descriptor) {
+    JikanSharedQuotaConfig config = quota_config("full", 10.0);
+    std::vector<std::unique_ptr<JikanSharedQuota>> holders;
+    bool full = false;
+    size_t before = 0;
+    for (int i = 0; i < 100 && !full; ++i) {
+        before = open_descriptors();
+        try {
+            holders.emplace_back(new JikanSharedQuota(config));
+        } catch (const std::runtime_error&) {
+            full = true;
+        }
+    }
+    JIKAN_CHECK(full);
+    JIKAN_CHECK(holders.size() == 64);
+    JIKAN_CHECK(open_descriptors() == before);
+    // A freed slot can be claimed again
+    holders.pop_back();
+    holders.emplace_back(new JikanSharedQuota(config));
+    holders.clear();
+    std::remove(config.path.c_str());
+}
+
+JIKAN_TEST(processes_share_one_budget_by_weight) {
+    const double per_second = 40.0;
+    const std::chrono::milliseconds run_for(2000);
+    JikanSharedQuotaConfig config = quota_config("fork", per_second);
+    const double weights[] = {1.0, 1.0, 2.0};
+    const int children = 3;
+    JikanSharedQuota creator(config);
+    // Spend the opening burst here so the children split only the refill
+    while (creator.acquire() == Clock::duration::zero()) {
+    }
+
+    // Children hold their slots and wait on start, so nobody gets a head start
+    int start[2];
+    JIKAN_CHECK(pipe(start) == 0);
+    int pipes[children][2];
+    pid_t pids[children];
+    for (int i = 0; i < children; ++i) {
+        JIKAN_CHECK(pipe(pipes[i]) == 0);
+        pids[i] = fork();
+        if (pids[i] == 0) {
+            close(pipes[i][0]);
+            close(start[1]);
+            JikanSharedQuotaConfig own = config;
+            own.weight = weights[i];
+            uint64_t permits = 0;
+            {
+                JikanSharedQuota quota(own);
+                char go;
+                if (read(start[0], &go, 1) != 0) _exit(1);
+                permits = drain(quota, run_for);
+            }
+            ssize_t written = write(pipes[i][1], &permits, sizeof(permits));
+            _exit(written == sizeof(permits) ? 0 : 1);
+        }
+        close(pipes[i][1]);
+    }
+    close(start[0]);
+    close(start[1]);
+
+    uint64_t got[children] = {};
+    uint64_t total = 0;
+    for (int i = 0; i < children; ++i) {
+        JIKAN_CHECK(read(pipes[i][0], &got[i], sizeof(got[i])) == sizeof(got[i]));
+        close(pipes[i][0]);
+        int status = 0;
+        waitpid(pids[i], &status, 0);
+        JIKAN_CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+        total += got[i];
+    }
+    std::printf("     permits by process: %llu %llu %llu\n", static_cast<unsigned long long>(got[0]),
+                static_cast<unsigned long long>(got[1]), static_cast<unsigned long long>(got[2]));
+
+    // One bucket for everyone: the refill over the run, never a budget per process
+    double budget = per_second * run_for.count() / 1000.0;
+    JIKAN_CHECK(total <= static_cast<uint64_t>(budget * 1.2));
+    JIKAN_CHECK(total >= static_cast<uint64_t>(budget * 0.7));
+    // Every process gets its turn, the heavier one about twice as often
+    JIKAN_CHECK(got[0] > total / 8 && got[1] > total / 8);
+    JIKAN_CHECK(got[2] > got[0] + got[0] / 2 && got[2] > got[1] + got[1] / 2);
+    std::remove(config.path.c_str());
+}
+
+JIKAN_TEST_MAIN()
@@ -0,0 +1,90 @@
+#include <cstdlib>
+#include <string>
+
+#include <unistd.h>
+
+#include "JikanReplay.h"
+#include "JikanTest.h"
+
+using web::http::http_request;
+
+static std::string fixture_directory(const char* name) {
+    std::string directory = "jikan-test-" + std::string(name) + "-" + std::to_string(getpid());
+    std::system(("rm -rf " + directory).c_str());
+    return directory;
+}
+
+static http_request get(const std::string& uri) {
+    http_request request(web::http::methods::GET);
+    request.set_request_uri(web::uri(utility::conversions::to_string_t(uri)));
+    return request;
+}
+
+// Answers every request with one canned status and body
+static std::shared_ptr<JikanTestTransport> canned(web::http::status_code status, const std::string& body) {
+    return std::make_shared<JikanTestTransport>([status, body](const std::string&, const std::string&) {
+        return JikanTestAnswer(status, body);
+    });
+}
+
+JIKAN_TEST(fixture_store_round_trips) {
+    std::string directory = fixture_directory("store");
+    JikanFixture fixture;
+    fixture.status = 200;
+    fixture.headers.push_back(std::make_pair("ETag", "\"abc\""));
+    fixture.body = std::string("{\"data\":{\"mal_id\":1}}\n\0binary", 29);
+    {
+        JikanFixtureStore store(directory);
+        store.save("GET /anime/1", fixture);
+    }
+    JikanFixtureStore reopened(directory);
+    JikanFixture loaded;
+    JIKAN_CHECK(reopened.load("GET /anime/1", loaded));
+    JIKAN_CHECK(loaded.status == 200);
+    JIKAN_CHECK(loaded.headers.size() == 1 && loaded.headers[0].second == "\"abc\"");
+    JIKAN_CHECK(loaded.body == fixture.body);
+    JIKAN_CHECK(!reopened.load("GET /anime/2", loaded));
+}
+
+JIKAN_TEST(only_usable_answers_are_recordable) {
+    JIKAN_CHECK(JikanRecordingTransport::recordable(200));
+    JIKAN_CHECK(JikanRecordingTransport::recordable(404));
+    JIKAN_CHECK(!JikanRecordingTransport::recordable(304));
+    JIKAN_CHECK(!JikanRecordingTransport::recordable(429));
+    JIKAN_CHECK(!JikanRecordingTransport::recordable(503));
+}
+
+JIKAN_TEST(revalidation_does_not_overwrite_a_recorded_body) {
+    auto store = std::make_shared<JikanFixtureStore>(fixture_directory("record"));
+    JikanRecordingTransport first(canned(200, "{\"data\":{\"mal_id\":1}}"), store);
+    JIKAN_CHECK(first.request(get("/anime/1"), nullptr, pplx::cancellation_token::none()).get().status_code() == 200);
+    JikanRecordingTransport revalidated(canned(304, ""), store);
+    JIKAN_CHECK(revalidated.request(get("/anime/1"), nullptr, pplx::cancellation_token::none()).get().status_code() == 304);
+
+    JikanReplayTransport replay(store);
+    auto response = replay.request(get("/anime/1"), nullptr, pplx::cancellation_token::none()).get();
+    JIKAN_CHECK(response.status_code() == 200);
+    JIKAN_CHECK(response.extract_utf8string(true).get() == "{\"data\":{\"mal_id\":1}}");
+}
+
+JIKAN_TEST(replay_reports_missing_fixtures_and_injects_faults) {
+    auto store = std::make_shared<JikanFixtureStore>(fixture_directory("replay"));
+    JikanFixture fixture;
+    fixture.body = "{}";
+    store->save(JikanFixtureStore::key("GET", "/anime/1"), fixture);
+
+    JikanReplayTransport replay(store);
+    JIKAN_CHECK(replay.respond("GET /anime/1").get().status_code() == 200);
+    JIKAN_CHECK(replay.respond("GET /anime/2").get().status_code() == 404);
+    JIKAN_CHECK(replay.stats().served == 1 && replay.stats().missing == 1);
+
+    JikanFaultConfig faults;
+    faults.throttle_rate = 1.0;
+    JikanReplayTransport throttled(store, faults);
+    auto response = throttled.respond("GET /anime/1").get();
+    JIKAN_CHECK(response.status_code() == 429);
+    JIKAN_CHECK(response.headers().has(U("Retry-After")));
+    JIKAN_CHECK(throttled.stats().injected_throttles == 1);
+}
+
+JIKAN_TEST_MAIN()
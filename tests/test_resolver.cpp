@@ -0,0 +1,82 @@
+#include <atomic>
+#include <string>
+
+#include "JikanTest.h"
+#include "JikanTitleIndex.h"
+
+static const std::string no_results = "{\"data\":[],\"pagination\":{\"has_next_page\":false}}";
+
+// Answers /anime searches with status, and with body when that is 200
+struct Fixture {
+    Jikan api;
+    std::shared_ptr<JikanTestTransport> upstream = jikan_test_upstream(api);
+    web::http::status_code status = 200;
+    std::string body = no_results;
+
+    Fixture() {
+        upstream->respond = [this](const std::string&, const std::string&) {
+            return status == 200 ? JikanTestAnswer::json(body) : JikanTestAnswer(status);
+        };
+        JikanRetryConfig retry;
+        retry.server_errors = JikanRetryPolicy(1);
+        api.set_retry_config(retry);
+    }
+};
+
+JIKAN_TEST(confident_local_match_needs_no_request) {
+    Fixture fixture;
+    JikanTitleResolver resolver(fixture.api);
+    resolver.add(JikanTitleKind::Anime, 5114, "Fullmetal Alchemist: Brotherhood", "Fullmetal Alchemist: Brotherhood");
+    resolver.add(JikanTitleKind::Anime, 1, "Cowboy Bebop", "Cowboy Bebop");
+    JIKAN_CHECK(resolver.resolve("fullmetal alchemist brotherhod").get().mal_id == 5114);
+    JIKAN_CHECK(fixture.upstream->requests == 0);
+    JIKAN_CHECK(resolver.stats().local == 1);
+}
+
+JIKAN_TEST(failed_search_is_tried_again) {
+    Fixture fixture;
+    JikanTitleResolver resolver(fixture.api);
+    fixture.status = 503;
+    JIKAN_CHECK(resolver.resolve("Cowboy Bebop").get().mal_id == 0);
+    JIKAN_CHECK(fixture.upstream->requests == 1);
+
+    fixture.status = 200;
+    fixture.body = "{\"data\":[{\"mal_id\":1,\"title\":\"Cowboy Bebop\"}],\"pagination\":{\"has_next_page\":false}}";
+    JikanTitleMatch match = resolver.resolve("Cowboy Bebop").get();
+    JIKAN_CHECK(match.mal_id == 1 && match.searched);
+    JIKAN_CHECK(fixture.upstream->requests == 2);
+}
+
+JIKAN_TEST(answered_search_miss_is_remembered) {
+    Fixture fixture;
+    JikanTitleResolver resolver(fixture.api);
+    JIKAN_CHECK(resolver.resolve("no such title").get().mal_id == 0);
+    JIKAN_CHECK(resolver.resolve("No such title!").get().mal_id == 0);
+    JIKAN_CHECK(fixture.upstream->requests == 1);
+    JIKAN_CHECK(resolver.stats().remembered == 1);
+}
+
+JIKAN_TEST(search_fallback_picks_among_the_search_results) {
+    Fixture fixture;
+    JikanTitleResolver resolver(fixture.api);
+    // Two indexed entries tie on the query, so the index is not confident and the search decides
+    resolver.add(JikanTitleKind::Anime, 900, "Cowboy Bebop", "Cowboy Bebop");
+    resolver.add(JikanTitleKind::Anime, 901, "Cowboy Bebop!", "Cowboy Bebop!");
+    fixture.body = "{\"data\":[{\"mal_id\":1,\"title\":\"Cowboy Bebop (TV)\"}],\"pagination\":{\"has_next_page\":false}}";
+    JikanTitleMatch match = resolver.resolve("Cowboy Bebop").get();
+    JIKAN_CHECK(match.mal_id == 1 && match.searched);
+    JIKAN_CHECK(fixture.upstream->requests == 1);
+}
+
+JIKAN_TEST(local_miss_without_fallback_is_not_remembered) {
+    Fixture fixture;
+    JikanTitleResolverConfig config;
+    config.search_fallback = false;
+    JikanTitleResolver resolver(fixture.api, config);
+    JIKAN_CHECK(resolver.resolve("Cowboy Bebop").get().mal_id == 0);
+    resolver.add(JikanTitleKind::Anime, 1, "Cowboy Bebop", "Cowboy Bebop");
+    JIKAN_CHECK(resolver.resolve("Cowboy Bebop").get().mal_id == 1);
+    JIKAN_CHECK(fixture.upstream->requests == 0);
+}
+
+JIKAN_TEST_MAIN()
@@ -0,0 +1,91 @@
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+#include "JikanScheduler.h"
+#include "JikanTest.h"
+
+using web::http::http_response;
+
+typedef std::chrono::steady_clock Clock;
+
+static JikanRateLimit unlimited() {
+    JikanRateLimit limit;
+    limit.per_second = 1000.0;
+    limit.per_minute = 60000.0;
+    return limit;
+}
+
+// Holds every permit for a while before granting it, like a shared quota waiting on another process
+class SlowQuota : public JikanQuota {
+public:
+    std::atomic<int> acquiring{0};
+
+    std::chrono::steady_clock::duration acquire() override {
+        ++acquiring;
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        return std::chrono::steady_clock::duration::zero();
+    }
+
+    void throttle(std::chrono::milliseconds) override {}
+};
+
+JIKAN_TEST(scheduler_released_inside_a_send_lets_its_worker_finish) {
+    auto scheduler = std::make_shared<JikanScheduler>(unlimited());
+    auto holder = std::make_shared<std::shared_ptr<JikanScheduler>>(scheduler);
+    std::weak_ptr<JikanScheduler> weak = scheduler;
+    auto released = std::make_shared<std::atomic<bool>>(false);
+    // The send drops the last reference, so the destructor runs on the worker
+    auto done = scheduler->schedule(JikanPriority::Normal, [holder, released]() {
+        while (!*released) std::this_thread::yield();
+        holder->reset();
+        return pplx::task_from_result(http_response(200));
+    });
+    scheduler.reset();
+    *released = true;
+    JIKAN_CHECK(done.get().status_code() == 200);
+    JIKAN_CHECK(weak.expired());
+}
+
+JIKAN_TEST(limits_that_are_not_positive_are_refused) {
+    JikanRateLimit zero;
+    zero.per_second = 0.0;
+    bool refused = false;
+    try {
+        JikanScheduler scheduler(zero);
+    } catch (const std::invalid_argument&) {
+        refused = true;
+    }
+    JIKAN_CHECK(refused);
+
+    JikanScheduler scheduler(unlimited());
+    JikanRateLimit no_minute = unlimited();
+    no_minute.per_minute = -1.0;
+    refused = false;
+    try {
+        scheduler.set_rate_limit(no_minute);
+    } catch (const std::invalid_argument&) {
+        refused = true;
+    }
+    JIKAN_CHECK(refused);
+    JIKAN_CHECK(scheduler.rate_limit().per_minute == 60000.0);
+}
+
+JIKAN_TEST(a_slow_quota_does_not_hold_the_scheduler_lock) {
+    auto quota = std::make_shared<SlowQuota>();
+    JikanScheduler scheduler(unlimited());
+    scheduler.set_quota(quota);
+    auto first = scheduler.schedule(JikanPriority::Normal, []() { return pplx::task_from_result(http_response(200)); });
+    while (quota->acquiring == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    // The worker is inside acquire(): queueing and reading stats must not wait for it
+    auto started = Clock::now();
+    auto second = scheduler.schedule(JikanPriority::Normal, []() { return pplx::task_from_result(http_response(200)); });
+    JIKAN_CHECK(scheduler.stats().queue_depth >= 1);
+    JIKAN_CHECK(Clock::now() - started < std::chrono::milliseconds(100));
+    JIKAN_CHECK(first.get().status_code() == 200);
+    JIKAN_CHECK(second.get().status_code() == 200);
+}
+
+JIKAN_TEST_MAIN()
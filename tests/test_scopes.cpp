@@ -0,0 +1,114 @@
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+#include "Jikan.h"
+#include "JikanTest.h"
+
+using web::json::value;
+
+struct SeenScope {
+    JikanPriority priority;
+    JikanCallOptions::clock::time_point deadline;
+};
+
+// Records the scopes each request starts under; answers on a pool thread, so later requests are
+// started from continuations
+class ScopeRecorder {
+public:
+    std::mutex mutex;
+    std::vector<SeenScope> seen;
+
+    pplx::task<value> fetch(int page, int last_page) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            seen.push_back(SeenScope{JikanPriorityScope::current(), JikanCallScope::current().deadline});
+        }
+        return pplx::create_task([page, last_page]() {
+            value result;
+            result[U("data")] = value::array(1);
+            result[U("data")][0] = value::number(page);
+            result[U("pagination")][U("has_next_page")] = value::boolean(page < last_page);
+            return result;
+        });
+    }
+
+    bool all_under(JikanPriority priority, JikanCallOptions::clock::time_point deadline) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& scope : seen) {
+            if (scope.priority != priority || scope.deadline != deadline) return false;
+        }
+        return !seen.empty();
+    }
+};
+
+JIKAN_TEST(batch_launches_keep_the_callers_scopes) {
+    ScopeRecorder recorder;
+    auto options = JikanCallOptions::within(std::chrono::seconds(30));
+    pplx::task<void> batch;
+    {
+        JikanPriorityScope priority(JikanPriority::Background);
+        JikanCallScope call(options);
+        batch = JikanBatch::run({1, 2, 3, 4, 5}, 1, Jikan::in_caller_scope([&recorder](int id) { return recorder.fetch(id, 0); }),
+                                [](size_t, int, const value&, bool) {});
+    }
+    batch.wait();
+    JIKAN_CHECK(recorder.seen.size() == 5);
+    JIKAN_CHECK(recorder.all_under(JikanPriority::Background, options.deadline));
+    JIKAN_CHECK(JikanPriorityScope::current() == JikanPriority::Normal);
+}
+
+JIKAN_TEST(page_stream_requests_keep_the_callers_scopes) {
+    ScopeRecorder recorder;
+    auto options = JikanCallOptions::within(std::chrono::seconds(30));
+    Jikan api;
+    size_t items = 0;
+    {
+        JikanPriorityScope priority(JikanPriority::Background);
+        JikanCallScope call(options);
+        auto pages = api.paginate([&recorder](int page) { return recorder.fetch(page, 4); });
+        items = pages.for_each_item([](const value&) { return true; });
+    }
+    JIKAN_CHECK(items == 4);
+    JIKAN_CHECK(recorder.seen.size() == 4);
+    JIKAN_CHECK(recorder.all_under(JikanPriority::Background, options.deadline));
+}
+
+JIKAN_TEST(raw_captures_the_first_getter_and_sends_one_request_each) {
+    Jikan api;
+    auto upstream = jikan_test_upstream(api);
+    upstream->respond = [](const std::string& path, const std::string&) {
+        return JikanTestAnswer::json("{\"path\":\"" + path + "\"}");
+    };
+    web::json::value second;
+    auto body = api.raw([&api, &second]() {
+        api.getAnimeById(1);
+        second = api.getMangaById(2).get();
+        return second;
+    }).get();
+    JIKAN_CHECK(body.str().find("/anime/1") != std::string::npos);
+    JIKAN_CHECK(utility::conversions::to_utf8string(second.at(U("path")).as_string()).find("/manga/2") != std::string::npos);
+    JIKAN_CHECK(upstream->requests == 2);
+}
+
+JIKAN_TEST(raw_reports_a_call_without_a_request_through_its_task) {
+    Jikan api;
+    jikan_test_upstream(api);
+    pplx::task<JikanBuffer> body;
+    bool thrown = false;
+    try {
+        body = api.raw([]() { return 0; });
+    } catch (...) {
+        thrown = true;
+    }
+    JIKAN_CHECK(!thrown);
+    bool failed = false;
+    try {
+        body.get();
+    } catch (const std::logic_error&) {
+        failed = true;
+    }
+    JIKAN_CHECK(failed);
+}
+
+JIKAN_TEST_MAIN()
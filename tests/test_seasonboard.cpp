@@ -0,0 +1,130 @@
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "JikanSeasonBoard.h"
+#include "JikanTest.h"
+
+// Answers the three feeds the board reads; every refresh sees the titles of the current round,
+// and a feed named in failing answers 404 instead
+struct Feeds {
+    std::atomic<int> round{1};
+    std::string failing;
+    std::shared_ptr<JikanTestTransport> upstream;
+
+    static std::string item(int id, int members, const std::string& day, const std::string& time) {
+        return "{\"mal_id\":" + std::to_string(id) + ",\"title\":\"Title " + std::to_string(id) + "\",\"members\":" + std::to_string(members) +
+               ",\"score\":" + std::to_string(id % 10) + ".5,\"broadcast\":{\"day\":\"" + day + "\",\"time\":\"" + time + "\"}}";
+    }
+
+    explicit Feeds(Jikan& api) : upstream(jikan_test_upstream(api)) {
+        // Every refresh must reach the feeds
+        JikanCacheConfig uncached;
+        uncached.enabled = false;
+        api.set_cache_config(uncached);
+        upstream->respond = [this](const std::string& path, const std::string&) {
+            if (!failing.empty() && path.find(failing) != std::string::npos) return JikanTestAnswer(404, "{\"status\":404}");
+            int base = round * 100;
+            std::string data;
+            if (path.find("/seasons/now") != std::string::npos) {
+                data = item(base + 1, 500, "Mondays", "23:00") + "," + item(base + 2, 900, "Tuesdays", "01:30");
+            } else if (path.find("/seasons/upcoming") != std::string::npos) {
+                data = item(base + 50, 10, "", "");
+            } else {
+                data = item(base + 1, 500, "Mondays", "23:00") + "," + item(base + 3, 800, "Mondays", "22:00") + "," +
+                       item(base + 2, 900, "Tuesdays", "01:30") + "," + item(base + 4, 100, "", "");
+            }
+            return JikanTestAnswer::json("{\"data\":[" + data + "],\"pagination\":{\"has_next_page\":false}}");
+        };
+    }
+};
+
+// 2024-01-01 was a Monday
+static std::chrono::system_clock::time_point utc(int day_of_january_2024, int hour, int minute) {
+    return std::chrono::system_clock::from_time_t(1704067200 + (day_of_january_2024 - 1) * 86400 + hour * 3600 + minute * 60);
+}
+
+JIKAN_TEST(a_refresh_publishes_a_new_generation) {
+    Jikan api;
+    Feeds feeds(api);
+    JikanSeasonBoard board(api);
+    JIKAN_CHECK(board.snapshot()->generation == 0);
+    JIKAN_CHECK(board.refresh());
+    auto first = board.snapshot();
+    JIKAN_CHECK(first->generation == 1);
+    JIKAN_CHECK(first->airing.size() == 2);
+    JIKAN_CHECK(first->airing[0].mal_id == 102);
+    JIKAN_CHECK(first->upcoming.size() == 1 && first->upcoming[0].mal_id == 150);
+
+    feeds.round = 2;
+    JIKAN_CHECK(board.refresh());
+    auto second = board.snapshot();
+    JIKAN_CHECK(second->generation == 2);
+    JIKAN_CHECK(second->airing[0].mal_id == 202);
+    // A reader holding the old snapshot still sees it whole
+    JIKAN_CHECK(first->airing[0].mal_id == 102);
+    JIKAN_CHECK(board.stats().refreshes == 2);
+    JIKAN_CHECK(board.stats().partial_refreshes == 0);
+}
+
+JIKAN_TEST(a_failing_section_keeps_its_previous_view) {
+    Jikan api;
+    Feeds feeds(api);
+    JikanSeasonBoard board(api);
+    JIKAN_CHECK(board.refresh());
+    feeds.round = 2;
+    feeds.failing = "/seasons/upcoming";
+    JIKAN_CHECK(!board.refresh());
+    auto snapshot = board.snapshot();
+    JIKAN_CHECK(snapshot->generation == 2);
+    JIKAN_CHECK(snapshot->airing[0].mal_id == 202);
+    JIKAN_CHECK(snapshot->upcoming.size() == 1 && snapshot->upcoming[0].mal_id == 150);
+    JIKAN_CHECK(board.stats().partial_refreshes == 1);
+}
+
+JIKAN_TEST(readers_on_other_threads_pick_up_a_new_generation) {
+    Jikan api;
+    Feeds feeds(api);
+    JikanSeasonBoard board(api);
+    JIKAN_CHECK(board.refresh());
+    std::atomic<bool> saw_first{false};
+    std::atomic<bool> go_on{false};
+    uint64_t later = 0;
+    int later_top = 0;
+    std::thread reader([&]() {
+        // The first read fills this thread's cached pointer, the second must notice it is stale
+        saw_first = board.snapshot()->generation == 1;
+        while (!go_on) std::this_thread::yield();
+        auto snapshot = board.snapshot();
+        later = snapshot->generation;
+        later_top = snapshot->airing[0].mal_id;
+    });
+    while (!saw_first) std::this_thread::yield();
+    feeds.round = 3;
+    JIKAN_CHECK(board.refresh());
+    go_on = true;
+    reader.join();
+    JIKAN_CHECK(later == 2);
+    JIKAN_CHECK(later_top == 302);
+}
+
+JIKAN_TEST(the_day_turns_over_at_midnight_in_japan) {
+    Jikan api;
+    Feeds feeds(api);
+    JikanSeasonBoard board(api);
+    JIKAN_CHECK(board.refresh());
+    auto snapshot = board.snapshot();
+    // Monday slots by time: 22:00 before 23:00
+    JIKAN_CHECK(snapshot->schedule[0].size() == 2);
+    JIKAN_CHECK(snapshot->schedule[0][0].mal_id == 103);
+    JIKAN_CHECK(snapshot->schedule[JikanSeasonSnapshot::unknown_day].size() == 1);
+    // Monday 14:59 UTC is 23:59 in Japan, a minute later it is Tuesday there
+    JIKAN_CHECK(&snapshot->on(utc(1, 14, 59)) == &snapshot->schedule[0]);
+    JIKAN_CHECK(&snapshot->on(utc(1, 15, 0)) == &snapshot->schedule[1]);
+    JIKAN_CHECK(snapshot->on(utc(1, 15, 0))[0].mal_id == 102);
+    // Sunday evening UTC is already Monday in Japan
+    JIKAN_CHECK(&snapshot->on(utc(7, 20, 0)) == &snapshot->schedule[0]);
+}
+
+JIKAN_TEST_MAIN()
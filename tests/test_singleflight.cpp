@@ -0,0 +1,78 @@
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Jikan.h"
+#include "JikanTest.h"
+
+enum { keys = 20, threads = 8, calls_per_thread = 1000 };
+
+// Counts requests per path and holds every answer until the gate opens, so all duplicates of a
+// key are started while its first request is still in flight
+struct GatedUpstream {
+    std::mutex mutex;
+    std::map<std::string, int> per_path;
+    pplx::task_completion_event<void> gate;
+    std::shared_ptr<JikanTestTransport> transport;
+
+    explicit GatedUpstream(Jikan& api) : transport(jikan_test_upstream(api)) {
+        pplx::task<void> opened(gate);
+        transport->respond = [this, opened](const std::string& path, const std::string&) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                ++per_path[path];
+            }
+            JikanTestAnswer answer = JikanTestAnswer::json("{\"data\":{\"mal_id\":" + path.substr(path.rfind('/') + 1) + "}}");
+            answer.after = opened;
+            return answer;
+        };
+    }
+};
+
+JIKAN_TEST(thousands_of_duplicates_send_one_request_per_key) {
+    Jikan api;
+    GatedUpstream upstream(api);
+    std::vector<std::vector<pplx::task<web::json::value>>> results(threads);
+    std::vector<std::thread> callers;
+    for (int t = 0; t < threads; ++t) {
+        callers.emplace_back([&api, &results, t]() {
+            for (int i = 0; i < calls_per_thread; ++i) results[t].push_back(api.getAnimeById(1 + (i + t) % keys));
+        });
+    }
+    for (auto& caller : callers) caller.join();
+    upstream.gate.set();
+
+    bool all_right = true;
+    for (int t = 0; t < threads; ++t) {
+        for (int i = 0; i < calls_per_thread; ++i) {
+            auto value = results[t][i].get();
+            all_right = all_right && value.at(U("data")).at(U("mal_id")).as_integer() == 1 + (i + t) % keys;
+        }
+    }
+    JIKAN_CHECK(all_right);
+    JIKAN_CHECK(upstream.transport->requests == keys);
+    JIKAN_CHECK(upstream.per_path.size() == static_cast<size_t>(keys));
+    for (const auto& path : upstream.per_path) JIKAN_CHECK(path.second == 1);
+
+    JikanSingleFlightStats stats = api.coalescing_stats();
+    JIKAN_CHECK(stats.started == static_cast<uint64_t>(keys));
+    JIKAN_CHECK(stats.coalesced == static_cast<uint64_t>(threads * calls_per_thread - keys));
+    JIKAN_CHECK(stats.in_flight == 0);
+}
+
+JIKAN_TEST(a_finished_flight_lets_the_next_call_send_again) {
+    Jikan api;
+    JikanCacheConfig uncached;
+    uncached.enabled = false;
+    api.set_cache_config(uncached);
+    auto upstream = jikan_test_upstream(api);
+    api.getAnimeById(1).wait();
+    api.getAnimeById(1).wait();
+    JIKAN_CHECK(upstream->requests == 2);
+    JIKAN_CHECK(api.coalescing_stats().started == 2);
+    JIKAN_CHECK(api.coalescing_stats().coalesced == 0);
+}
+
+JIKAN_TEST_MAIN()
@@ -0,0 +1,118 @@
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+
+#include <unistd.h>
+
+#include "JikanSync.h"
+#include "JikanTest.h"
+
+// A tiny upstream: /seasons/now lists the feed ids, /anime/{id}/full answers with the current
+// version of each entity or with the status set for it, every other feed is empty
+struct Mirror {
+    std::mutex mutex;
+    std::set<int> feed;
+    std::map<int, web::http::status_code> statuses;
+    int version = 1;
+
+    Jikan api;
+    std::shared_ptr<JikanTestTransport> upstream = jikan_test_upstream(api);
+    JikanSyncConfig config;
+    std::map<int, std::string> changed;
+
+    explicit Mirror(const std::string& checkpoint) {
+        upstream->respond = [this](const std::string& path, const std::string&) { return answer(path); };
+        JikanRetryConfig retry;
+        retry.server_errors = JikanRetryPolicy(1);
+        api.set_retry_config(retry);
+        config.checkpoint_path = checkpoint;
+        config.include_manga = false;
+        config.search_orders.clear();
+    }
+
+    JikanSyncReport run(JikanSync& sync) {
+        changed.clear();
+        return sync.run([this](JikanSyncKind, int id, const web::json::value& data) {
+            changed[id] = utility::conversions::to_utf8string(data.at(U("title")).as_string());
+        });
+    }
+
+private:
+    JikanTestAnswer answer(const std::string& path) {
+        std::lock_guard<std::mutex> lock(mutex);
+        int id = 0;
+        if (path == "/seasons/now") {
+            std::string body = "{\"data\":[";
+            for (int item : feed) {
+                if (body.back() == '}') body += ",";
+                body += entity(item);
+            }
+            return JikanTestAnswer::json(body + "],\"pagination\":{\"has_next_page\":false}}");
+        }
+        if (std::sscanf(path.c_str(), "/anime/%d/full", &id) == 1) {
+            auto status = statuses.find(id);
+            if (status != statuses.end()) return JikanTestAnswer(status->second);
+            return JikanTestAnswer::json("{\"data\":" + entity(id) + "}");
+        }
+        return JikanTestAnswer::json("{\"data\":[],\"pagination\":{\"has_next_page\":false}}");
+    }
+
+    std::string entity(int id) const {
+        return "{\"mal_id\":" + std::to_string(id) + ",\"title\":\"v" + std::to_string(version) + "\"}";
+    }
+};
+
+static std::string checkpoint_path(const char* name) {
+    std::string path = "jikan-test-" + std::string(name) + "-" + std::to_string(getpid()) + ".sync";
+    std::remove(path.c_str());
+    return path;
+}
+
+JIKAN_TEST(resumed_run_drops_dead_ids_and_still_discovers) {
+    std::string path = checkpoint_path("resume");
+    {
+        std::ofstream out(path);
+        out << "jikan-sync 1\npending a 1 0\npending a 2 2\npending a 4 0\n";
+    }
+    Mirror mirror(path);
+    mirror.feed = {3};
+    mirror.statuses[1] = 404;
+    mirror.statuses[2] = 500;
+    mirror.statuses[4] = 500;
+    JikanSync sync(mirror.api, mirror.config);
+    JIKAN_CHECK(sync.pending_count() == 3);
+
+    JikanSyncReport report = mirror.run(sync);
+    JIKAN_CHECK(report.resumed);
+    // 1 is gone upstream, 2 failed its third run; 4 has failed once and is kept
+    JIKAN_CHECK(report.dropped == 2);
+    JIKAN_CHECK(report.failed == 3);
+    JIKAN_CHECK(sync.pending_count() == 1);
+    // 3 only appears in the feed, so discovery ran after the resumed work
+    JIKAN_CHECK(mirror.changed.size() == 1 && mirror.changed.count(3) == 1);
+
+    JikanSync reloaded(mirror.api, mirror.config);
+    JIKAN_CHECK(reloaded.pending_count() == 1);
+    std::remove(path.c_str());
+}
+
+JIKAN_TEST(sync_sees_changes_behind_fresh_cache_entries) {
+    std::string path = checkpoint_path("fresh");
+    Mirror mirror(path);
+    mirror.feed = {7};
+    JikanSync sync(mirror.api, mirror.config);
+    mirror.run(sync);
+    JIKAN_CHECK(mirror.changed[7] == "v1");
+
+    // Both the feed page and the full document are still fresh in the response cache
+    mirror.version = 2;
+    JikanSyncReport report = mirror.run(sync);
+    JIKAN_CHECK(report.changed == 1);
+    JIKAN_CHECK(mirror.changed[7] == "v2");
+    std::remove(path.c_str());
+}
+
+JIKAN_TEST_MAIN()